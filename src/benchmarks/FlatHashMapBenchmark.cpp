@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include <FlatHashMap.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Words of the corpus texts in reading order. Bytes >= 0x80 are kept, so Cyrillic words stay whole; ASCII
+// punctuation and spaces split words. The directory can be overridden with BENCHMARK_TEXTS_DIR in the environment.
+const std::vector<std::string>& CorpusWords()
+{
+    static const std::vector<std::string> words = [] {
+        const char* overrideDir = std::getenv("BENCHMARK_TEXTS_DIR");
+        const fs::path textsDir = overrideDir != nullptr ? overrideDir : BENCHMARK_TEXTS_DIR;
+
+        std::vector<std::string> result;
+        for (const auto& entry : fs::directory_iterator(textsDir)) {
+            std::ifstream file(entry.path(), std::ios::binary);
+            const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+            std::string word;
+            for (char c : text) {
+                const auto byte = static_cast<unsigned char>(c);
+                if (byte >= 0x80 || std::isalnum(byte)) {
+                    word.push_back(c);
+                } else if (!word.empty()) {
+                    result.push_back(std::move(word));
+                    word.clear();
+                }
+            }
+        }
+        return result;
+    }();
+    return words;
+}
+
+// Counting every word of the corpus, as TextCorpus does while collecting word frequencies
+template <typename Map>
+void BM_CountWords(benchmark::State& state)
+{
+    const auto& words = CorpusWords();
+    for (auto _ : state) {
+        Map frequencies;
+        for (const auto& word : words) {
+            frequencies[word]++;
+        }
+        benchmark::DoNotOptimize(frequencies.size());
+    }
+    state.SetItemsProcessed(state.iterations() * words.size());
+}
+
+// Looking up every word of the corpus in the finished vocabulary, as the TF and IDF calculations do
+template <typename Map>
+void BM_LookupWords(benchmark::State& state)
+{
+    const auto& words = CorpusWords();
+    Map frequencies;
+    for (const auto& word : words) {
+        frequencies[word]++;
+    }
+
+    for (auto _ : state) {
+        long long total = 0;
+        for (const auto& word : words) {
+            auto it = frequencies.find(word);
+            total += it != frequencies.end() ? it->second : 0;
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * words.size());
+}
+
+// Looking up substrings of a text without building a std::string for every word
+void BM_LookupWordViews(benchmark::State& state)
+{
+    const auto& words = CorpusWords();
+    std::string text;
+    std::vector<std::string_view> views;
+    FlatHashMap<std::string, int> frequencies;
+    for (const auto& word : words) {
+        frequencies[word]++;
+        text += word;
+    }
+    size_t offset = 0;
+    for (const auto& word : words) {
+        views.emplace_back(text.data() + offset, word.size());
+        offset += word.size();
+    }
+
+    for (auto _ : state) {
+        long long total = 0;
+        for (std::string_view word : views) {
+            auto it = frequencies.find(word);
+            total += it != frequencies.end() ? it->second : 0;
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * views.size());
+}
+
+using StdMap = std::unordered_map<std::string, int>;
+using FlatMap = FlatHashMap<std::string, int>;
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_CountWords, StdMap)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_CountWords, FlatMap)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_LookupWords, StdMap)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_LookupWords, FlatMap)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LookupWordViews)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+
+#include <HnswIndex.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+
+constexpr size_t kDimension = 300;
+constexpr size_t kVectorsCount = 20000;
+constexpr size_t kQueriesCount = 200;
+constexpr size_t kNeighborsCount = 10;
+
+// Vectors scattered around many centres, like the embeddings of cluster keys that share words; the queries are
+// drawn the same way.
+struct HnswData {
+    HnswData()
+    {
+        std::mt19937 random(23);
+        std::normal_distribution<float> value(0.0f, 1.0f);
+        std::vector<std::vector<float>> centres(500, std::vector<float>(kDimension));
+        for (auto& centre : centres) {
+            std::generate(centre.begin(), centre.end(), [&] { return value(random); });
+        }
+        auto draw = [&](std::vector<float>& values, size_t count) {
+            values.resize(count * kDimension);
+            for (size_t i = 0; i < count; ++i) {
+                const auto& centre = centres[random() % centres.size()];
+                for (size_t d = 0; d < kDimension; ++d) {
+                    values[i * kDimension + d] = centre[d] + 0.8f * value(random);
+                }
+            }
+        };
+        draw(vectors, kVectorsCount);
+        draw(queries, kQueriesCount);
+
+        std::vector<const float*> rows;
+        for (size_t i = 0; i < kVectorsCount; ++i) {
+            rows.push_back(vectors.data() + i * kDimension);
+        }
+        index.Build(rows, kDimension);
+        for (size_t query = 0; query < kQueriesCount; ++query) {
+            std::set<uint32_t> neighbors;
+            for (const auto& neighbor : index.ExactSearch(Query(query), kNeighborsCount)) {
+                neighbors.insert(neighbor.id);
+            }
+            exactNeighbors.push_back(std::move(neighbors));
+        }
+    }
+
+    const float* Query(size_t query) const
+    {
+        return queries.data() + query * kDimension;
+    }
+
+    static const HnswData& Get()
+    {
+        static const HnswData data;
+        return data;
+    }
+
+    std::vector<float> vectors;
+    std::vector<float> queries;
+    HnswIndex index;
+    std::vector<std::set<uint32_t>> exactNeighbors;
+};
+
+// Comparing the query with every vector, as searching synonyms without an index would.
+void BM_NeighborsBruteForce(benchmark::State& state)
+{
+    const HnswData& data = HnswData::Get();
+    size_t query = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(data.index.ExactSearch(data.Query(query), kNeighborsCount));
+        query = (query + 1) % kQueriesCount;
+    }
+    state.counters["recall"] = 1.0;
+}
+
+// The argument is the ef of the search; the recall is the share of the exact 10 nearest neighbours found.
+void BM_NeighborsHnsw(benchmark::State& state)
+{
+    const HnswData& data = HnswData::Get();
+    size_t query = 0;
+    size_t found = 0;
+    size_t searches = 0;
+    for (auto _ : state) {
+        const auto neighbors = data.index.Search(data.Query(query), kNeighborsCount, state.range(0));
+        state.PauseTiming();
+        for (const auto& neighbor : neighbors) {
+            found += data.exactNeighbors[query].count(neighbor.id);
+        }
+        ++searches;
+        query = (query + 1) % kQueriesCount;
+        state.ResumeTiming();
+    }
+    state.counters["recall"] = static_cast<double>(found) / (searches * kNeighborsCount);
+}
+
+// Build of the index over the vectors; the argument is the number of threads.
+void BM_HnswBuild(benchmark::State& state)
+{
+    const HnswData& data = HnswData::Get();
+    std::vector<const float*> rows;
+    for (size_t i = 0; i < kVectorsCount; ++i) {
+        rows.push_back(data.vectors.data() + i * kDimension);
+    }
+    for (auto _ : state) {
+        HnswIndex index;
+        index.Build(rows, kDimension, state.range(0));
+        benchmark::DoNotOptimize(index.Size());
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_NeighborsBruteForce)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_NeighborsHnsw)->Arg(10)->Arg(20)->Arg(40)->Arg(80)->Arg(160)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_HnswBuild)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->Iterations(1);
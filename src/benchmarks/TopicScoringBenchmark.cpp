@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <TopicScoring.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t kDimension = 300;
+constexpr size_t kPhrasesCount = 8192;
+constexpr float kThreshold = 0.6f; // Default Options::topicsThreshold
+
+// Random topics and cluster keys; every fifth key is a copy of a topic with noise of a varying level, so that some
+// pairs are selected and some are close to the threshold.
+struct TopicScoringData {
+    explicit TopicScoringData(size_t topicsCount)
+        : topics(topicsCount * kDimension), phrases(kPhrasesCount * kDimension)
+    {
+        std::mt19937 random(17);
+        std::normal_distribution<float> value(0.0f, 0.1f);
+        std::generate(topics.begin(), topics.end(), [&] { return value(random); });
+        for (size_t phrase = 0; phrase < kPhrasesCount; ++phrase) {
+            float* row = phrases.data() + phrase * kDimension;
+            if (phrase % 5 == 0) {
+                const float* topic = topics.data() + (phrase % topicsCount) * kDimension;
+                const float noise = 0.15f * (phrase % 11);
+                for (size_t i = 0; i < kDimension; ++i) {
+                    row[i] = topic[i] + noise * value(random);
+                }
+            } else {
+                std::generate(row, row + kDimension, [&] { return value(random); });
+            }
+        }
+        for (size_t topic = 0; topic < topicsCount; ++topic) {
+            topicRows.push_back(topics.data() + topic * kDimension);
+        }
+        for (size_t phrase = 0; phrase < kPhrasesCount; ++phrase) {
+            phraseRows.push_back(phrases.data() + phrase * kDimension);
+        }
+    }
+
+    std::vector<float> topics;
+    std::vector<float> phrases;
+    std::vector<const float*> topicRows;
+    std::vector<const float*> phraseRows;
+};
+
+// Every pair compared with the fused kernel, as the former loop of ComputeTextMetrics over TopicSimilarity did
+// (with the norms of the embeddings cached).
+void BM_TopicScoresPairwise(benchmark::State& state)
+{
+    const TopicScoringData data(state.range(0));
+    const VectorKernels& kernels = GetVectorKernels();
+    std::vector<float> topicNorms;
+    for (const float* topic : data.topicRows) {
+        topicNorms.push_back(std::sqrt(kernels.dotProduct(topic, topic, kDimension)));
+    }
+    for (auto _ : state) {
+        size_t selected = 0;
+        for (const float* phrase : data.phraseRows) {
+            const float phraseNorm = std::sqrt(kernels.dotProduct(phrase, phrase, kDimension));
+            for (size_t topic = 0; topic < data.topicRows.size(); ++topic) {
+                const VectorMetrics metrics = kernels.metrics(phrase, data.topicRows[topic], kDimension);
+                selected += TopicScore(metrics, phraseNorm, topicNorms[topic]) > kThreshold;
+            }
+        }
+        benchmark::DoNotOptimize(selected);
+    }
+    state.SetItemsProcessed(state.iterations() * kPhrasesCount * data.topicRows.size());
+}
+
+// TopicScoreMatrix::SelectTopics; the second argument is the number of threads.
+void BM_TopicScoresMatrix(benchmark::State& state)
+{
+    const TopicScoringData data(state.range(0));
+    const TopicScoreMatrix matrix(data.topicRows, kDimension);
+    size_t exactPairs = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(matrix.SelectTopics(data.phraseRows, kThreshold, state.range(1), &exactPairs));
+    }
+    state.SetItemsProcessed(state.iterations() * kPhrasesCount * data.topicRows.size());
+    state.counters["exact_pairs"] = static_cast<double>(exactPairs) / (kPhrasesCount * data.topicRows.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_TopicScoresPairwise)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TopicScoresMatrix)->ArgsProduct({{100, 400}, {1, 4}})->Unit(benchmark::kMillisecond);
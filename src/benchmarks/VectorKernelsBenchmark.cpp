@@ -0,0 +1,117 @@
+#include <benchmark/benchmark.h>
+
+#include <VectorKernels.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Pairs of random vectors of the benchmarked dimension; like the topic vectors they stay in the L2 cache.
+struct VectorPairs {
+    explicit VectorPairs(size_t dimension) : dimension(dimension), a(kPairs * dimension), b(kPairs * dimension)
+    {
+        std::mt19937 random(13);
+        std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+        for (size_t i = 0; i < a.size(); ++i) {
+            a[i] = value(random);
+            b[i] = value(random);
+        }
+    }
+
+    static constexpr size_t kPairs = 64;
+    size_t dimension;
+    std::vector<float> a;
+    std::vector<float> b;
+};
+
+// The three separate passes of the former WordEmbedding::CosineSimilarity: dot product and two magnitudes.
+void BM_CosineThreePasses(benchmark::State& state)
+{
+    const auto& kernels = GetSupportedVectorKernels()[state.range(1)];
+    const VectorPairs pairs(state.range(0));
+    size_t pair = 0;
+    for (auto _ : state) {
+        const float* a = pairs.a.data() + pair * pairs.dimension;
+        const float* b = pairs.b.data() + pair * pairs.dimension;
+        const float dot = kernels.dotProduct(a, b, pairs.dimension);
+        const float magA = std::sqrt(kernels.dotProduct(a, a, pairs.dimension));
+        const float magB = std::sqrt(kernels.dotProduct(b, b, pairs.dimension));
+        benchmark::DoNotOptimize(dot / (magA * magB));
+        pair = (pair + 1) % VectorPairs::kPairs;
+    }
+    state.SetLabel(kernels.name);
+}
+
+// Cosine with cached norms: one dot product.
+void BM_CosineCachedNorms(benchmark::State& state)
+{
+    const auto& kernels = GetSupportedVectorKernels()[state.range(1)];
+    const VectorPairs pairs(state.range(0));
+    size_t pair = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernels.dotProduct(pairs.a.data() + pair * pairs.dimension,
+                                                    pairs.b.data() + pair * pairs.dimension, pairs.dimension));
+        pair = (pair + 1) % VectorPairs::kPairs;
+    }
+    state.SetLabel(kernels.name);
+}
+
+// The five passes of the former topic score of ComputeTextMetrics: cosine as above, then the Euclidean and Manhattan
+// distances in scalar loops.
+void BM_TopicScoreSeparatePasses(benchmark::State& state)
+{
+    const auto& kernels = GetSupportedVectorKernels()[state.range(1)];
+    const VectorPairs pairs(state.range(0));
+    size_t pair = 0;
+    for (auto _ : state) {
+        const float* a = pairs.a.data() + pair * pairs.dimension;
+        const float* b = pairs.b.data() + pair * pairs.dimension;
+        const float dot = kernels.dotProduct(a, b, pairs.dimension);
+        const float magA = std::sqrt(kernels.dotProduct(a, a, pairs.dimension));
+        const float magB = std::sqrt(kernels.dotProduct(b, b, pairs.dimension));
+        float squared = 0.0f;
+        for (size_t i = 0; i < pairs.dimension; ++i) {
+            squared += (a[i] - b[i]) * (a[i] - b[i]);
+        }
+        float manhattan = 0.0f;
+        for (size_t i = 0; i < pairs.dimension; ++i) {
+            manhattan += std::abs(a[i] - b[i]);
+        }
+        benchmark::DoNotOptimize(dot / (magA * magB) + std::sqrt(squared) + manhattan);
+        pair = (pair + 1) % VectorPairs::kPairs;
+    }
+    state.SetLabel(kernels.name);
+}
+
+// All sums needed by the topic score (cosine, Euclidean and Manhattan distances) and by Jaccard in one pass.
+void BM_FusedMetrics(benchmark::State& state)
+{
+    const auto& kernels = GetSupportedVectorKernels()[state.range(1)];
+    const VectorPairs pairs(state.range(0));
+    size_t pair = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernels.metrics(pairs.a.data() + pair * pairs.dimension,
+                                                 pairs.b.data() + pair * pairs.dimension, pairs.dimension));
+        pair = (pair + 1) % VectorPairs::kPairs;
+    }
+    state.SetLabel(kernels.name);
+}
+
+// Every supported kernel at the dimensions of the fastText models: 100 and 300.
+void KernelArguments(benchmark::internal::Benchmark* benchmark)
+{
+    for (int64_t dimension : {100, 300}) {
+        for (size_t kernel = 0; kernel < GetSupportedVectorKernels().size(); ++kernel) {
+            benchmark->Args({dimension, static_cast<int64_t>(kernel)});
+        }
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_CosineThreePasses)->Apply(KernelArguments);
+BENCHMARK(BM_CosineCachedNorms)->Apply(KernelArguments);
+BENCHMARK(BM_TopicScoreSeparatePasses)->Apply(KernelArguments);
+BENCHMARK(BM_FusedMetrics)->Apply(KernelArguments);
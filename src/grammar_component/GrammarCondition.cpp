@@ -1,4 +1,5 @@
 #include <GrammarCondition.h>
+#include <LemmaDictionary.h>
 
 bool Additional::empty() const
 {
@@ -22,14 +23,17 @@ bool Additional::check(const X::MorphInfo& morphForm) const
 }
 
 Condition::Condition(SyntaxRole role, UniMorphTag morphTag, Additional cond)
-    : m_role(role), m_tag(morphTag), m_addcond(cond) {};
+    : m_role(role), m_tag(morphTag), m_addcond(cond), m_tagMask(MorphTagMask::Encode(morphTag)),
+      m_fieldMask(MorphTagMask::FieldMask(m_tagMask)),
+      m_exLexId(m_addcond.m_exLex.empty() ? LemmaDictionary::kUnknownId
+                                          : LemmaDictionary::GetDictionary().GetId(m_addcond.m_exLex)) {};
 
-const UniMorphTag Condition::getMorphTag() const
+const UniMorphTag& Condition::getMorphTag() const
 {
     return m_tag;
 };
 
-const Additional Condition::getAdditional() const
+const Additional& Condition::getAdditional() const
 {
     return m_addcond;
 };
@@ -87,4 +91,29 @@ bool Condition::check(const X::UniSPTag spTag, const X::WordFormPtr& form) const
         }
     }
     return true;
-}
\ No newline at end of file
+}
+
+bool Condition::exLexCheck(const LatticeCandidate& candidate) const
+{
+    return m_exLexId == LemmaDictionary::kUnknownId || m_exLexId == candidate.lemmaId;
+}
+
+bool Condition::check(const X::UniSPTag spTag, const LatticeCandidate& candidate) const
+{
+    return candidate.sp == spTag && morphTagCheck(candidate) && exLexCheck(candidate);
+}
+
+bool Condition::check(const X::UniSPTag spTag, const MorphLattice::Token& token) const
+{
+    return find(spTag, token) != nullptr;
+}
+
+const LatticeCandidate* Condition::find(const X::UniSPTag spTag, const MorphLattice::Token& token) const
+{
+    for (const auto& candidate : token) {
+        if (check(spTag, candidate)) {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
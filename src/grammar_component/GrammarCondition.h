@@ -6,6 +6,7 @@
 #include <xmorphy/tag/UniSPTag.h>
 
 #include <Logger.h>
+#include <MorphLattice.h>
 
 #include <memory>
 #include <optional>
@@ -39,6 +40,9 @@ private:
     SyntaxRole m_role;
     UniMorphTag m_tag;
     Additional m_addcond;
+    uint64_t m_tagMask;   ///< m_tag encoded with MorphTagMask::Encode.
+    uint64_t m_fieldMask; ///< Fields of m_tagMask that must match.
+    uint32_t m_exLexId;   ///< ID of m_addcond.m_exLex in the LemmaDictionary, or kUnknownId if it is empty.
 
 public:
     Condition(SyntaxRole role = SyntaxRole::Independent, UniMorphTag morphTag = UniMorphTag::UNKN,
@@ -47,14 +51,34 @@ public:
 
     bool morphTagCheck(const MorphInfo& morphForm) const;
 
-    const UniMorphTag getMorphTag() const;
-    const Additional getAdditional() const;
+    const UniMorphTag& getMorphTag() const;
+    const Additional& getAdditional() const;
     const SyntaxRole getSyntaxRole() const;
 
     // Checks if the Condition instance contains default or empty values.
     bool empty() const;
 
     bool check(const X::UniSPTag spTag, const X::WordFormPtr& form) const;
+
+    // \brief Checks a single lattice candidate: part of speech, morphological tag and example lexicon.
+    bool check(const X::UniSPTag spTag, const LatticeCandidate& candidate) const;
+
+    // \brief Lattice counterpart of check(spTag, form): succeeds if any candidate of the token satisfies
+    //        the condition, instead of requiring all analyses of the token to satisfy it.
+    bool check(const X::UniSPTag spTag, const MorphLattice::Token& token) const;
+
+    // \brief Returns the most probable candidate of the token that satisfies the condition, or nullptr if none does.
+    //        Phrases take the lemma of this candidate, which is not always the most probable analysis of the token.
+    const LatticeCandidate* find(const X::UniSPTag spTag, const MorphLattice::Token& token) const;
+
+    // \brief Checks only the morphological tag of a lattice candidate.
+    bool morphTagCheck(const LatticeCandidate& candidate) const
+    {
+        return MorphTagMask::Matches(candidate.tagMask, m_tagMask, m_fieldMask);
+    }
+
+    // \brief Checks only the example lexicon against a lattice candidate.
+    bool exLexCheck(const LatticeCandidate& candidate) const;
 };
 
 #endif // GRAMMAR_CONDITION_H
@@ -134,7 +134,7 @@ ModelComp::ModelComp(const std::string& form, const Components& comps, const Con
 {
 }
 
-const Condition ModelComp::getCondition() const
+const Condition& ModelComp::getCondition() const
 {
     return m_cond;
 }
@@ -52,7 +52,7 @@ class ModelComp : public Model {
 public:
     ModelComp(const std::string& form = "", const Components& comps = {}, const Condition& cond = {});
 
-    const Condition getCondition() const;
+    const Condition& getCondition() const;
 
     const std::optional<bool> isHead() const;
 };
@@ -0,0 +1,148 @@
+#include <LemmaDictionary.h>
+#include <MorphLattice.h>
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <stdexcept>
+
+namespace MorphTagMask {
+
+    namespace {
+        constexpr size_t kFieldBits = 5;
+        constexpr uint64_t kFieldMask = (uint64_t{1} << kFieldBits) - 1;
+        constexpr size_t kGroupsCount = 11;
+
+        static_assert(kFieldBits * kGroupsCount <= 64, "Tag mask does not fit into 64 bits");
+
+        using GroupValues = std::array<std::vector<X::UniMorphTag>, kGroupsCount>;
+
+        // Values seen so far in every attribute group; the field value of an attribute is its index plus one. Values
+        // are only appended, under the mutex. Function-local so that conditions built during static initialization
+        // can already encode their tags.
+        struct SharedGroupValues {
+            GroupValues values;
+            std::mutex mtx;
+        };
+
+        SharedGroupValues& GetSharedGroupValues()
+        {
+            static SharedGroupValues groupValues;
+            return groupValues;
+        }
+
+        // Copy of the shared values owned by the thread. A group holds a few values, so a scan of the copy is cheaper
+        // than hashing the tag, and threads that encode the lattices of different sentences never wait for each
+        // other. The copy of a group is refreshed only when a value is missing from it.
+        thread_local GroupValues localGroupValues;
+
+        uint32_t FindOrAddValue(size_t group, const X::UniMorphTag& value)
+        {
+            auto& localValues = localGroupValues[group];
+            auto it = std::find(localValues.begin(), localValues.end(), value);
+            if (it != localValues.end()) {
+                return static_cast<uint32_t>(it - localValues.begin());
+            }
+
+            auto& sharedGroupValues = GetSharedGroupValues();
+            std::lock_guard<std::mutex> lock(sharedGroupValues.mtx);
+            auto& values = sharedGroupValues.values[group];
+            auto sharedIt = std::find(values.begin(), values.end(), value);
+            if (sharedIt == values.end()) {
+                if (values.size() == kFieldMask) {
+                    throw std::overflow_error("Too many values in morphological attribute group " +
+                                              std::to_string(group));
+                }
+                sharedIt = values.insert(values.end(), value);
+            }
+            const auto index = static_cast<uint32_t>(sharedIt - values.begin());
+            localValues = values;
+            return index;
+        }
+
+        template <typename AttrType>
+        uint64_t EncodeAttribute(size_t group, bool (X::UniMorphTag::*hasAttribute)() const,
+                                 AttrType (X::UniMorphTag::*getAttribute)() const, const X::UniMorphTag& tag)
+        {
+            if (!(tag.*hasAttribute)()) {
+                return 0;
+            }
+
+            const uint64_t fieldValue = static_cast<uint64_t>(FindOrAddValue(group, (tag.*getAttribute)())) + 1;
+            return fieldValue << (group * kFieldBits);
+        }
+    } // namespace
+
+    uint64_t Encode(const X::UniMorphTag& tag)
+    {
+        return EncodeAttribute(0, &X::UniMorphTag::hasCase, &X::UniMorphTag::getCase, tag) |
+               EncodeAttribute(1, &X::UniMorphTag::hasAnimacy, &X::UniMorphTag::getAnimacy, tag) |
+               EncodeAttribute(2, &X::UniMorphTag::hasNumber, &X::UniMorphTag::getNumber, tag) |
+               EncodeAttribute(3, &X::UniMorphTag::hasTense, &X::UniMorphTag::getTense, tag) |
+               EncodeAttribute(4, &X::UniMorphTag::hasCmp, &X::UniMorphTag::getCmp, tag) |
+               EncodeAttribute(5, &X::UniMorphTag::hasVerbForm, &X::UniMorphTag::getVerbForm, tag) |
+               EncodeAttribute(6, &X::UniMorphTag::hasMood, &X::UniMorphTag::getMood, tag) |
+               EncodeAttribute(7, &X::UniMorphTag::hasPerson, &X::UniMorphTag::getPerson, tag) |
+               EncodeAttribute(8, &X::UniMorphTag::hasVariance, &X::UniMorphTag::getVariance, tag) |
+               EncodeAttribute(9, &X::UniMorphTag::hasVoice, &X::UniMorphTag::getVoice, tag) |
+               EncodeAttribute(10, &X::UniMorphTag::hasAspect, &X::UniMorphTag::getAspect, tag);
+    }
+
+    uint64_t FieldMask(uint64_t encodedTag)
+    {
+        uint64_t mask = 0;
+        for (size_t group = 0; group < kGroupsCount; ++group) {
+            const uint64_t field = kFieldMask << (group * kFieldBits);
+            if (encodedTag & field) {
+                mask |= field;
+            }
+        }
+        return mask;
+    }
+
+} // namespace MorphTagMask
+
+MorphLattice::MorphLattice(const std::vector<X::WordFormPtr>& forms, size_t kBest)
+{
+    auto& dictionary = LemmaDictionary::GetDictionary();
+
+    offsets.reserve(forms.size() + 1);
+    offsets.push_back(0);
+
+    for (const auto& form : forms) {
+        const size_t tokenStart = candidates.size();
+        for (const auto& morphForm : form->getMorphInfo()) {
+            candidates.push_back({dictionary.GetId(morphForm.normalForm.toLowerCase().getRawString()), morphForm.sp,
+                                  MorphTagMask::Encode(morphForm.tag), morphForm.probability});
+        }
+        FinishToken(tokenStart, kBest);
+    }
+}
+
+MorphLattice::MorphLattice(const std::vector<std::vector<LatticeCandidate>>& tokens, size_t kBest)
+{
+    offsets.reserve(tokens.size() + 1);
+    offsets.push_back(0);
+
+    for (const auto& token : tokens) {
+        const size_t tokenStart = candidates.size();
+        candidates.insert(candidates.end(), token.begin(), token.end());
+        FinishToken(tokenStart, kBest);
+    }
+}
+
+void MorphLattice::FinishToken(size_t tokenStart, size_t kBest)
+{
+    // Stable sort keeps the set order among equally probable analyses, so the first candidate is the same
+    // analysis that GetMostProbableMorphInfo returns.
+    auto tokenBegin = candidates.begin() + tokenStart;
+    std::stable_sort(tokenBegin, candidates.end(), [](const LatticeCandidate& a, const LatticeCandidate& b) {
+        return a.probability > b.probability;
+    });
+
+    if (kBest != 0 && candidates.size() - tokenStart > kBest) {
+        candidates.resize(tokenStart + kBest);
+    }
+
+    offsets.push_back(static_cast<uint32_t>(candidates.size()));
+}
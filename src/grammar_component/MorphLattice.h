@@ -0,0 +1,95 @@
+#ifndef MORPH_LATTICE_H
+#define MORPH_LATTICE_H
+
+#include <xmorphy/morph/WordForm.h>
+#include <xmorphy/tag/UniMorphTag.h>
+#include <xmorphy/tag/UniSPTag.h>
+
+#include <cstdint>
+#include <vector>
+
+// \namespace MorphTagMask
+// \brief Packs the attributes of a UniMorphTag that take part in pattern matching into a 64-bit mask.
+//        Every attribute group (case, number, tense, ...) owns a 5-bit field; 0 means the attribute is absent and
+//        any other value is the index of the attribute value assigned on first use. Encoding is thread-safe.
+namespace MorphTagMask {
+    // \brief Encodes all attribute groups of the tag.
+    uint64_t Encode(const X::UniMorphTag& tag);
+
+    // \brief Returns a mask with all bits set in the fields that are present in the encoded tag.
+    uint64_t FieldMask(uint64_t encodedTag);
+
+    // \brief Checks if the encoded form tag has the same values as the encoded condition tag in every field that the
+    //        condition sets. Equivalent to Condition::morphTagCheck on the original tags.
+    inline bool Matches(uint64_t formTag, uint64_t condTag, uint64_t condFieldMask)
+    {
+        return ((formTag ^ condTag) & condFieldMask) == 0;
+    }
+} // namespace MorphTagMask
+
+// \struct LatticeCandidate
+// \brief A single morphological analysis of a token reduced to the data used by pattern matching.
+struct LatticeCandidate {
+    uint32_t lemmaId;   ///< ID of the lowercase normal form in the LemmaDictionary.
+    X::UniSPTag sp;     ///< Part of speech.
+    uint64_t tagMask;   ///< Morphological tag encoded with MorphTagMask::Encode.
+    double probability; ///< Probability of the analysis.
+};
+
+// \class MorphLattice
+// \brief Compact representation of all morphological analyses of a sentence. The analyses of each token are
+//        converted once into a contiguous array of candidates ordered by decreasing probability, so matching a
+//        condition is a scan over a few plain structs instead of a scan over the MorphInfo set of the token.
+class MorphLattice {
+public:
+    // \brief Range of candidates that belong to one token.
+    struct Token {
+        const LatticeCandidate* first;
+        const LatticeCandidate* last;
+
+        const LatticeCandidate* begin() const
+        {
+            return first;
+        }
+        const LatticeCandidate* end() const
+        {
+            return last;
+        }
+        bool empty() const
+        {
+            return first == last;
+        }
+        // \brief The most probable candidate of the token. The token must not be empty.
+        const LatticeCandidate& best() const
+        {
+            return *first;
+        }
+    };
+
+    // \brief Builds the lattice for a sentence.
+    // \param forms     Word forms of the sentence.
+    // \param kBest     Maximum number of candidates kept per token; 0 keeps all analyses.
+    explicit MorphLattice(const std::vector<X::WordFormPtr>& forms, size_t kBest = 0);
+
+    // \brief Builds the lattice from candidates that are already converted, one vector per token.
+    explicit MorphLattice(const std::vector<std::vector<LatticeCandidate>>& tokens, size_t kBest = 0);
+
+    Token operator[](size_t tokenInd) const
+    {
+        return {candidates.data() + offsets[tokenInd], candidates.data() + offsets[tokenInd + 1]};
+    }
+
+    size_t size() const
+    {
+        return offsets.size() - 1;
+    }
+
+private:
+    std::vector<LatticeCandidate> candidates; ///< Candidates of all tokens, token by token.
+    std::vector<uint32_t> offsets;            ///< Start of the candidates of each token, plus the total count.
+
+    // Sorts the candidates of the token that starts at tokenStart and keeps the kBest most probable of them.
+    void FinishToken(size_t tokenStart, size_t kBest);
+};
+
+#endif // MORPH_LATTICE_H
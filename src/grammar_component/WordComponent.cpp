@@ -48,7 +48,7 @@ WordComp::WordComp(const UniSPTag& sp, const Condition& cond) : Word(sp), m_cond
 {
 }
 
-const Condition WordComp::getCondition() const
+const Condition& WordComp::getCondition() const
 {
     return m_cond;
 }
@@ -28,7 +28,7 @@ public:
     explicit WordComp(const UniSPTag& sp = UniSPTag::X, const Condition& cond = Condition());
     ~WordComp() override = default;
 
-    const Condition getCondition() const;
+    const Condition& getCondition() const;
 
     const bool isRec() const;
 
@@ -46,7 +46,10 @@ struct Process {
     {
 
         // Открываем существующий JSON или создаем новый
-        if (fs::exists(outputFile)) {
+        // Пустой путь означает, что результаты документа не сохраняются в JSON
+        if (outputFile.empty()) {
+            jsonData = json::array();
+        } else if (fs::exists(outputFile)) {
             std::ifstream inFile(outputFile);
             if (inFile) {
                 try {
@@ -70,6 +73,9 @@ struct Process {
 
     ~Process()
     {
+        if (outputFile.empty()) {
+            return;
+        }
         std::ofstream outFile(outputFile, std::ios::trunc | std::ios::binary);
         if (!outFile) {
             Logger::log("Process", LogLevel::Error, "Failed to open JSON file for writing: " + outputFile.string());
@@ -5,19 +5,39 @@
 #include <OutputRedirector.h>
 #include <PatternPhrasesStorage.h>
 #include <PhrasesStorageLoader.h>
+#include <PipelineImage.h>
+#include <ResourceUsage.h>
 #include <SemanticRelations.h>
 #include <TextCorpus.h>
 #include <TokenizedSentenceCorpus.h>
+#include <UnixSocket.h>
 #include <boost/program_options.hpp>
 
 #include <chrono>
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <sstream>
+#include <unordered_set>
 
 #include <sys/stat.h>
 
 namespace fs = std::filesystem;
 namespace po = boost::program_options;
 auto& options = Options::getOptions();
+std::optional<PipelineImage> pipelineImage; ///< State of the pipeline restored with --from-snapshot.
+fs::file_time_type pipelineImageTime;       ///< Modification time of the image; state files written later win.
+
+// Inputs that no command changes, so they are loaded once per process and shared by all requests of serve.
+bool corpusStatisticsLoaded = false;
+bool sentencesLoaded = false;
+bool embeddingsLoaded = false;
+bool totalResultsLoaded = false; ///< The storage holds the results last saved to total_results.bin or the image.
+bool servingResults = false;     ///< serve keeps the results in the storage, so commands never read them in place.
+uint64_t savedMisses = 0;        ///< Embeddings computed with the model when the cache was last saved.
+std::unique_ptr<LSA> lsaFactors; ///< SVD of the sentence corpus, computed by the first perform_lsa.
 
 static void printUsage(const po::options_description& desc)
 {
@@ -28,11 +48,26 @@ static void printUsage(const po::options_description& desc)
     std::cout << "  compute_text_metrics      Merge identical clusters and compute text metrics: tf, idf, tf-idf, "
                  "tag_match. Inicialize topic_relevance and centrality score.\n";
     std::cout << "  load_hypernyms            Load WikiWordNet relations (hypernyms/hyponyms) into clusters.\n";
+    std::cout << "  find_synonyms             Fill the synonyms of the clusters with the most similar cluster keys by "
+                 "their embeddings, found with an index saved to synonym_index.bin.\n";
     std::cout << "  build_tokenized_corpus    Save a all sentence from corpus in lemmatized form.\n";
     std::cout << "  perform_lsa               Perform LSA analysis on previously saved data, compute topic_relevance "
                  "and centrality score.\n";
     std::cout << "  get_terminological_phrases      Filter out more relevant and terminological phrases from all the "
                  "results.\n";
+    std::cout << "  export_json               Export the binary results (total_results.bin) of the previous commands "
+                 "to total_results.json.\n";
+    std::cout << "  save_snapshot             Pack the binary state of the previous commands and the embeddings of "
+                 "their lemmas into pipeline_snapshot.bin for --from-snapshot.\n";
+    std::cout << "  convert_embedding_model   Convert the fastText model to a layout mapped into memory instead "
+                 "of loaded (int8 with --quantize-embeddings).\n";
+    std::cout << "  check_embedding_model     Compare the topic similarities of the results computed with the model "
+                 "against the reference model and report load time and memory of both.\n";
+    std::cout << "  lookup                    Print the cluster of the phrase given by --term from the results.\n";
+    std::cout << "  serve                     Load the models and the results once and answer compute_text_metrics, "
+                 "load_hypernyms, find_synonyms, perform_lsa, get_terminological_phrases, export_json and lookup "
+                 "requests on a Unix socket until a shutdown request.\n";
+    std::cout << "\nAny command except serve is sent to a running server with --connect.\n";
     std::cout << "\nOptions:\n" << desc << "\n";
 }
 
@@ -86,6 +121,44 @@ void validateLimitOption(const po::variables_map& vm, int minVal = 1, int maxVal
     }
 }
 
+void validateIntOption(const po::variables_map& vm, const std::string& option_name, int& target, int minVal = 0,
+                       int maxVal = INT_MAX)
+{
+    if (vm.count(option_name)) {
+        try {
+            int value = vm[option_name].as<int>();
+
+            if (value < minVal || value > maxVal) {
+                throw std::runtime_error("Value for '" + option_name + "' is out of range (" + std::to_string(minVal) +
+                                         " - " + std::to_string(maxVal) + ")");
+            }
+
+            target = value;
+        } catch (const std::exception& ex) {
+            throw std::runtime_error("Invalid integer value for '" + option_name + "': " + std::string(ex.what()));
+        }
+    }
+}
+
+void validateFloatOption(const po::variables_map& vm, const std::string& option_name, float& target, float minVal,
+                         float maxVal)
+{
+    if (vm.count(option_name)) {
+        try {
+            float value = vm[option_name].as<float>();
+
+            if (value < minVal || value > maxVal) {
+                throw std::runtime_error("Value for '" + option_name + "' is out of range (" + std::to_string(minVal) +
+                                         " - " + std::to_string(maxVal) + ")");
+            }
+
+            target = value;
+        } catch (const std::exception& ex) {
+            throw std::runtime_error("Invalid float value for '" + option_name + "': " + std::string(ex.what()));
+        }
+    }
+}
+
 void setGlobalOptions(const po::variables_map& vm)
 {
     // Override default global options if provided by the user
@@ -96,11 +169,30 @@ void setGlobalOptions(const po::variables_map& vm)
     validatePathOption(vm, "stop-words-file", options.stopWordsFile);
     validatePathOption(vm, "patterns-file", options.patternsFile);
     validatePathOption(vm, "emb-model-file", options.embeddingModelFile);
+    validatePathOption(vm, "emb-reference-file", options.embeddingReferenceFile);
+    if (vm.count("emb-output-file")) {
+        options.embeddingOutputFile = vm["emb-output-file"].as<std::string>();
+    }
 
     validateLimitOption(vm, 1, options.textToProcessCount);
 
     validateBoolOption(vm, "clean-stop-words", options.cleanStopWords);
     validateBoolOption(vm, "validate-boundaries", options.validateBoundaries);
+    validateBoolOption(vm, "profile-patterns", options.profilePatterns);
+    validateBoolOption(vm, "lattice-matching", options.latticeMatching);
+    validateIntOption(vm, "lattice-k-best", options.latticeKBest);
+    validateBoolOption(vm, "dedup-sentences", options.dedupSentences);
+    validateIntOption(vm, "threads", options.threadsCount);
+    validateBoolOption(vm, "write-document-results", options.writeDocumentResults);
+    validateBoolOption(vm, "pretty-json", options.prettyJson);
+    validateBoolOption(vm, "from-snapshot", options.fromSnapshot);
+    validateBoolOption(vm, "quantize-embeddings", options.quantizeEmbeddings);
+    validateFloatOption(vm, "near-duplicate-threshold", options.nearDuplicateThreshold, 0.0f, 2.0f);
+    validateFloatOption(vm, "synonyms-threshold", options.synonymsThreshold, -1.0f, 1.0f);
+    validateIntOption(vm, "synonyms-count", options.synonymsCount);
+    if (vm.count("socket")) {
+        options.socketPath = vm["socket"].as<std::string>();
+    }
 
     Logger::log("Main", LogLevel::Info, "corpusDir: " + options.corpusDir.string());
     Logger::log("Main", LogLevel::Info, "textsDir:  " + options.textsDir.string());
@@ -116,15 +208,604 @@ void addOptions(po::options_description& desc)
     desc.add_options()("stop-words-file", po::value<std::string>(),
                        "Path to list of stop words file (default is inside in 'my_data')");
     desc.add_options()("emb-model-file", po::value<std::string>(),
-                       "Path to embeddings model file (default is my_custom_fasttext_model_finetuned.bin)");
+                       "Path to embeddings model file: a fastText .bin or .ftz model, or a model converted by "
+                       "convert_embedding_model (default is my_custom_fasttext_model_finetuned.bin)");
+    desc.add_options()("emb-reference-file", po::value<std::string>(),
+                       "Path to the full fastText model that check_embedding_model compares with (default is "
+                       "my_custom_fasttext_model_finetuned.bin)");
+    desc.add_options()("emb-output-file", po::value<std::string>(),
+                       "Path to the model written by convert_embedding_model (default is "
+                       "my_custom_fasttext_model_finetuned.emb)");
+    desc.add_options()("quantize-embeddings", po::value<bool>()->implicit_value(true),
+                       "Store the converted model as int8 with a scale per row (by default is false)");
     desc.add_options()("limit", po::value<int>(),
                        "How many text files to process (by default, it is calculated as the number of all files in the "
                        "texts directory.)");
     desc.add_options()("clean-stop-words", po::value<bool>(), "Option for clearing stop words (by default is true)");
     desc.add_options()("validate-boundaries", po::value<bool>(),
                        "Option for sentence boundaries validation (by default is true)");
+    desc.add_options()("profile-patterns", po::value<bool>(),
+                       "Collect per-pattern attempts, matches and timings during collect_phrases and save them to "
+                       "pattern_profile.json (by default is false)");
+    desc.add_options()("lattice-matching", po::value<bool>(),
+                       "Match patterns against all morphological analyses of a token instead of requiring every "
+                       "analysis to fit (by default is false)");
+    desc.add_options()("lattice-k-best", po::value<int>(),
+                       "How many most probable analyses per token are kept for lattice matching (by default is 0, "
+                       "which keeps all of them)");
+    desc.add_options()("threads", po::value<int>(),
+                       "Number of documents collected in parallel by collect_phrases, of result files loaded in "
+                       "parallel by compute_text_metrics, of threads computing cluster metrics in compute_text_metrics "
+                       "and perform_lsa and of threads serializing JSON outputs, 0 uses all hardware threads (by "
+                       "default is 1)");
+    desc.add_options()("write-document-results", po::value<bool>(),
+                       "Also write the phrases of every document to results/res_*.json during collect_phrases for "
+                       "debugging; clusters are always saved to clusters.bin (by default is false)");
+    desc.add_options()("pretty-json", po::value<bool>(),
+                       "Indent total_results.json and term_candidates.json; false writes compact JSON (by default is "
+                       "true)");
+    desc.add_options()("from-snapshot", po::value<bool>()->implicit_value(true),
+                       "Restore the inputs of the command from pipeline_snapshot.bin written by save_snapshot instead "
+                       "of the files of the previous commands, and load the embedding model only for lemmas missing "
+                       "from it (by default is false)");
+    desc.add_options()("dedup-sentences", po::value<bool>(),
+                       "Analyze identical sentences of the corpus only once during collect_phrases (by default is "
+                       "false)");
+    desc.add_options()("near-duplicate-threshold", po::value<float>(),
+                       "Minimal estimated Jaccard similarity of character shingles for near-duplicate sentences, "
+                       "which --dedup-sentences reports but still analyzes separately; values above 1 disable the "
+                       "search (by default is 2)");
+    desc.add_options()("synonyms-threshold", po::value<float>(),
+                       "Minimal cosine similarity of the key embeddings of clusters that find_synonyms marks as "
+                       "synonyms (by default is 0.85)");
+    desc.add_options()("synonyms-count", po::value<int>(),
+                       "How many most similar clusters find_synonyms considers for every cluster (by default is 10)");
+    desc.add_options()("term", po::value<std::string>(), "Phrase to look up with the lookup command");
+    desc.add_options()("socket", po::value<std::string>(),
+                       "Unix socket of serve and --connect (by default is server.sock in the corpus directory)");
+    desc.add_options()("connect", po::value<bool>()->implicit_value(true),
+                       "Send the command to a running serve process instead of running it (by default is false)");
+}
+
+// Returns the section of the pipeline snapshot, or nullptr if the command does not restore its state from it. The
+// state file of the section wins when a command has rewritten it after the image was saved, so that commands run with
+// --from-snapshot continue from the results of the previous ones.
+std::unique_ptr<BinaryReader> openSnapshotSection(std::string_view magic, uint32_t version, const fs::path& stateFile)
+{
+    if (!pipelineImage || !pipelineImage->HasSection(magic)) {
+        return nullptr;
+    }
+    std::error_code error;
+    const fs::file_time_type stateTime = fs::last_write_time(stateFile, error);
+    if (!error && stateTime > pipelineImageTime) {
+        Logger::log("Main", LogLevel::Info,
+                    stateFile.string() + " is newer than the pipeline snapshot, it is used instead of the image");
+        return nullptr;
+    }
+    return pipelineImage->OpenSection(magic, version);
+}
+
+// Loads the word and document frequencies; the texts of the corpus are not needed by the metric commands.
+void loadCorpusStatistics()
+{
+    if (corpusStatisticsLoaded) {
+        return;
+    }
+    auto& corpus = TextCorpus::GetCorpus();
+    if (auto section = openSnapshotSection(TextCorpus::kStatisticsMagic, TextCorpus::kStatisticsVersion,
+                                           options.corpusStatisticsPath)) {
+        corpus.LoadStatistics(*section);
+    } else if (fs::exists(options.corpusStatisticsPath)) {
+        corpus.LoadStatisticsFromFile(options.corpusStatisticsPath.string());
+    } else {
+        // Corpora filtered before the statistics file was introduced
+        corpus.LoadCorpusFromFile(options.filteredCorpusFile.string());
+    }
+    corpusStatisticsLoaded = true;
+}
+
+// Loads the clusters of collect_phrases.
+void loadClusters(PhrasesStorageLoader& loader, PatternPhrasesStorage& storage)
+{
+    if (auto section = openSnapshotSection(PatternPhrasesStorage::kSnapshotMagic,
+                                           PatternPhrasesStorage::kSnapshotVersion, options.clustersSnapshotPath)) {
+        loader.LoadClustersSnapshot(storage, *section);
+    } else if (fs::exists(options.clustersSnapshotPath)) {
+        loader.LoadClustersSnapshot(storage, options.clustersSnapshotPath.string());
+    } else {
+        // Results of collect_phrases runs that predate the snapshot
+        loader.LoadPhraseStorageFromResultsDir(storage);
+    }
+}
+
+// Loads the results of compute_text_metrics and the later commands, unless the storage already holds them.
+void loadTotalResults(PhrasesStorageLoader& loader, PatternPhrasesStorage& storage)
+{
+    if (totalResultsLoaded) {
+        return;
+    }
+    storage.Clear();
+    if (auto section =
+            openSnapshotSection(StorageSnapshot::kMagic, StorageSnapshot::kVersion, options.totalResultsSnapshotPath)) {
+        loader.LoadStorageSnapshot(storage, StorageSnapshot(std::move(*section)));
+    } else {
+        loader.LoadTotalResults(storage);
+    }
+    totalResultsLoaded = true;
+}
+
+// Opens the saved results in place for a command that only reads some of their columns, or returns nullopt if the
+// command has to load them into the storage: serve keeps them loaded for lookups, and results of older runs only exist
+// as total_results.json.
+std::optional<StorageSnapshot> openTotalResultsSnapshot()
+{
+    if (servingResults) {
+        return std::nullopt;
+    }
+    if (auto section =
+            openSnapshotSection(StorageSnapshot::kMagic, StorageSnapshot::kVersion, options.totalResultsSnapshotPath)) {
+        return StorageSnapshot(std::move(*section));
+    }
+    if (fs::exists(options.totalResultsSnapshotPath)) {
+        return StorageSnapshot(options.totalResultsSnapshotPath.string());
+    }
+    return std::nullopt;
+}
+
+// Saves the results of a command, which the storage then holds for the next commands of serve.
+void saveTotalResults(PatternPhrasesStorage& storage)
+{
+    storage.SaveStorageSnapshot(options.totalResultsSnapshotPath.string());
+    totalResultsLoaded = true;
+}
+
+void loadSentences()
+{
+    if (sentencesLoaded) {
+        return;
+    }
+    auto& sentences = TokenizedSentenceCorpus::GetCorpus();
+    if (auto section = openSnapshotSection(TokenizedSentenceCorpus::kMagic, TokenizedSentenceCorpus::kVersion,
+                                           options.sentencesSnapshotPath)) {
+        sentences.LoadSnapshot(std::move(section));
+        sentencesLoaded = true;
+        return;
+    }
+    // The binary layout is mapped in place; sentences.json of older runs is parsed
+    const fs::path sentencesPath =
+        fs::exists(options.sentencesSnapshotPath) ? options.sentencesSnapshotPath : options.sentencesFile;
+    sentences.LoadFromFile(sentencesPath.string());
+    sentencesLoaded = true;
+}
+
+// Restores the embeddings of the snapshot, or the embedding cache saved by the previous commands. The model is loaded
+// only when a word is missing from them.
+void loadEmbeddings()
+{
+    if (embeddingsLoaded) {
+        return;
+    }
+    embeddingsLoaded = true;
+    auto& embeddings = LemmaEmbeddings::GetInstance();
+    if (auto section =
+            openSnapshotSection(LemmaEmbeddings::kMagic, LemmaEmbeddings::kVersion, options.lemmaEmbeddingsPath)) {
+        embeddings.LoadEmbeddings(*section);
+    } else if (fs::exists(options.lemmaEmbeddingsPath)) {
+        // The cache is only an optimization, so a cache of an older format is replaced when the command ends
+        try {
+            BinaryReader reader(options.lemmaEmbeddingsPath.string(), LemmaEmbeddings::kMagic,
+                                LemmaEmbeddings::kVersion);
+            embeddings.LoadEmbeddings(reader);
+        } catch (const std::exception& ex) {
+            Logger::log("Main", LogLevel::Warning, std::string("Embedding cache is not used: ") + ex.what());
+        }
+    }
+}
+
+// Reports the hit rate of the embedding cache and saves the embeddings computed by the command, merged with the
+// cache of the previous commands.
+void saveEmbeddings()
+{
+    auto& embeddings = LemmaEmbeddings::GetInstance();
+    const uint64_t hits = embeddings.GetHits();
+    const uint64_t misses = embeddings.GetMisses();
+    if (hits + misses == 0) {
+        return;
+    }
+    Logger::log("Main", LogLevel::Info,
+                "Embedding cache: " + std::to_string(hits) + " hits, " + std::to_string(misses) +
+                    " computed with the model, hit rate " + std::to_string(100.0 * hits / (hits + misses)) + "%");
+    if (misses > savedMisses && !pipelineImage) {
+        loadEmbeddings();
+        embeddings.SaveEmbeddings(options.lemmaEmbeddingsPath.string());
+        savedMisses = misses;
+    }
+}
+
+// Packs the binary state files of the previous commands into one image. State that only exists in the JSON files of
+// older runs is converted first, and the embeddings of the lemmas of the results are computed and saved with it.
+void savePipelineSnapshot()
+{
+    PhrasesStorageLoader loader;
+    auto& storage = PatternPhrasesStorage::GetStorage();
+    if (fs::exists(options.totalResultsSnapshotPath) || fs::exists(options.totalResultsPath)) {
+        loader.LoadTotalResults(storage);
+        if (!fs::exists(options.totalResultsSnapshotPath)) {
+            storage.SaveStorageSnapshot(options.totalResultsSnapshotPath.string());
+        }
+    }
+    if (!fs::exists(options.sentencesSnapshotPath) && fs::exists(options.sentencesFile)) {
+        auto& sentences = TokenizedSentenceCorpus::GetCorpus();
+        sentences.LoadFromFile(options.sentencesFile.string());
+        sentences.SaveSnapshot(options.sentencesSnapshotPath.string());
+    }
+    if (!fs::exists(options.corpusStatisticsPath) && fs::exists(options.filteredCorpusFile)) {
+        auto& corpus = TextCorpus::GetCorpus();
+        corpus.LoadCorpusFromFile(options.filteredCorpusFile.string());
+        corpus.SaveStatisticsToFile(options.corpusStatisticsPath.string());
+    }
+    // Words of the cache are not computed again
+    loadEmbeddings();
+    for (const auto& [key, cluster] : storage.GetClusters()) {
+        for (size_t lemmaInd = 0; lemmaInd < cluster.lemmaIds.size(); ++lemmaInd) {
+            cluster.GetWordVector(lemmaInd);
+        }
+    }
+    auto& embeddings = LemmaEmbeddings::GetInstance();
+    embeddings.SaveEmbeddings(options.lemmaEmbeddingsPath.string());
+    savedMisses = embeddings.GetMisses();
+
+    PipelineImage::Write(options.pipelineSnapshotPath.string(),
+                         {options.clustersSnapshotPath.string(), options.corpusStatisticsPath.string(),
+                          options.totalResultsSnapshotPath.string(), options.sentencesSnapshotPath.string(),
+                          options.lsaFactorsPath.string(), options.lemmaEmbeddingsPath.string()});
+    Logger::log("Main", LogLevel::Info, "Saved pipeline snapshot to " + options.pipelineSnapshotPath.string());
 }
 
+// Computes the topic similarity of every cluster key to every topic word with the model in the file, printing the load
+// time and the memory used by the model.
+std::vector<float> computeTopicSimilarities(const std::string& modelFile, const std::vector<std::string>& keys,
+                                            const std::vector<std::string>& topics)
+{
+    const long long rssBefore = static_cast<long long>(GetResidentMemoryKb());
+    auto start = std::chrono::steady_clock::now();
+    auto model = EmbeddingModel::Open(modelFile);
+    std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - start;
+    const long long rssLoaded = static_cast<long long>(GetResidentMemoryKb());
+
+    std::vector<WordEmbedding> topicEmbeddings;
+    for (const auto& topic : topics) {
+        topicEmbeddings.emplace_back(model->GetWordVector(topic));
+    }
+    std::vector<float> similarities;
+    similarities.reserve(keys.size() * topics.size());
+    for (const auto& key : keys) {
+        const WordEmbedding embedding(model->GetWordVector(key));
+        for (const auto& topicEmbedding : topicEmbeddings) {
+            similarities.push_back(TopicSimilarity(embedding, topicEmbedding));
+        }
+    }
+    std::chrono::duration<double> totalTime = std::chrono::steady_clock::now() - start;
+
+    std::cout << modelFile << ": loaded in " << loadTime.count() << " s, RSS +" << (rssLoaded - rssBefore) / 1024
+              << " MiB after loading and +" << (static_cast<long long>(GetResidentMemoryKb()) - rssBefore) / 1024
+              << " MiB after " << keys.size() << " keys in " << totalTime.count() << " s\n";
+    return similarities;
+}
+
+// Checks that the model can replace the reference model: compares the topic similarities of the cluster keys of the
+// results and the topic matches they give at Options::topicsThreshold.
+void checkEmbeddingModel()
+{
+    PhrasesStorageLoader loader;
+    auto& storage = PatternPhrasesStorage::GetStorage();
+    loadTotalResults(loader, storage);
+    std::vector<std::string> keys;
+    for (const auto& clusterPair : storage.GetClusters()) {
+        keys.push_back(clusterPair.first);
+    }
+    const auto& topicSet = PhrasesCollectorUtils::GetTopics();
+    const std::vector<std::string> topics(topicSet.begin(), topicSet.end());
+
+    // The model under test is loaded first, so that its memory is not hidden by the heap of the reference model
+    const auto similarities = computeTopicSimilarities(options.embeddingModelFile.string(), keys, topics);
+    const auto referenceSimilarities = computeTopicSimilarities(options.embeddingReferenceFile.string(), keys, topics);
+
+    double maxDifference = 0.0;
+    double sumDifference = 0.0;
+    size_t changedMatches = 0;
+    size_t referenceMatches = 0;
+    for (size_t i = 0; i < similarities.size(); ++i) {
+        const double difference = std::abs(similarities[i] - referenceSimilarities[i]);
+        maxDifference = std::max(maxDifference, difference);
+        sumDifference += difference;
+        const bool match = similarities[i] > options.topicsThreshold;
+        const bool referenceMatch = referenceSimilarities[i] > options.topicsThreshold;
+        changedMatches += match != referenceMatch;
+        referenceMatches += referenceMatch;
+    }
+    std::cout << "Topic similarities of " << keys.size() << " keys and " << topics.size()
+              << " topics: max difference " << maxDifference << ", mean difference "
+              << (similarities.empty() ? 0.0 : sumDifference / similarities.size()) << ", " << changedMatches
+              << " of " << referenceMatches << " reference topic matches changed\n";
+}
+
+// Returns the JSON of the cluster of the phrase from the loaded storage, or from the snapshot if one is given, which
+// builds only the found cluster.
+// \param term          The phrase as given by the user.
+// \param key           Lemmas of the phrase, i.e. the key of its cluster.
+// \param snapshot      Saved results opened in place, or nullptr to search the storage.
+std::string lookupTerm(const std::string& term, const std::string& key, const StorageSnapshot* snapshot = nullptr)
+{
+    if (term.empty()) {
+        throw std::runtime_error("No term given, use --term");
+    }
+    const auto& storage = PatternPhrasesStorage::GetStorage();
+    std::optional<json> clusterJson;
+    if (!snapshot) {
+        clusterJson = storage.FindClusterJson(key);
+    } else if (auto clusterInd = snapshot->FindCluster(key)) {
+        clusterJson = storage.ClusterToJson(snapshot->MaterializeCluster(*clusterInd));
+    }
+    if (!clusterJson) {
+        throw std::runtime_error("No cluster for '" + term + "' (key '" + key + "')");
+    }
+    return clusterJson->dump(options.prettyJson ? 4 : -1);
+}
+
+// Runs one command of the pipeline.
+// \return              False if the command is unknown.
+bool runCommand(const std::string& command, const std::string& term = "")
+{
+    using namespace PhrasesCollectorUtils;
+
+    if (command == "collect_phrases") {
+        Logger::log("Main", LogLevel::Info, "Starting phrase collection...");
+        fs::path patternsPath = options.patternsFile;
+        GrammarPatternManager::GetManager()->readPatterns(patternsPath);
+        BuildPhraseStorage();
+        Logger::log("Main", LogLevel::Info, "Phrase collection completed successfully.");
+    } else if (command == "filter_corpus") {
+        Logger::log("Main", LogLevel::Info, "Starting filtering corpus...");
+        auto& corpus = TextCorpus::GetCorpus();
+        corpus.LoadCorpusFromFile(options.corpusFile.string());
+        corpus.SaveCorpusToFile(options.filteredCorpusFile);
+        corpus.SaveStatisticsToFile(options.corpusStatisticsPath.string());
+        Logger::log("Main", LogLevel::Info, "Filtering corpus completed successfully.");
+    } else if (command == "compute_text_metrics") {
+        Logger::log("Main", LogLevel::Info, "Starting computing text metrics...");
+        loadCorpusStatistics();
+        PhrasesStorageLoader loader;
+        loadEmbeddings();
+        auto& storage = PatternPhrasesStorage::GetStorage();
+        // The metrics are computed anew from the collected clusters
+        storage.Clear();
+        totalResultsLoaded = false;
+        loadClusters(loader, storage);
+        storage.MergeSimilarClusters();
+        storage.ComputeTextMetrics();
+        saveTotalResults(storage);
+        Logger::log("Main", LogLevel::Info, "Computing text metrics completed successfully.");
+    } else if (command == "load_hypernyms") {
+        // Load hypernym and hyponym relations for stored lemmas
+        Logger::log("Main", LogLevel::Info, "Loading hypernyms and hyponyms...");
+        loadCorpusStatistics();
+        loadEmbeddings();
+        PhrasesStorageLoader loader;
+        auto& storage = PatternPhrasesStorage::GetStorage();
+        loadTotalResults(loader, storage);
+        storage.LoadWikiWNRelations();
+        saveTotalResults(storage);
+    } else if (command == "find_synonyms") {
+        Logger::log("Main", LogLevel::Info, "Finding synonyms...");
+        loadEmbeddings();
+        if (auto snapshot = openTotalResultsSnapshot()) {
+            // Only the key column is read and the synonym column is replaced, the clusters are not built
+            std::vector<std::string_view> keys(snapshot->ClustersCount());
+            for (size_t clusterInd = 0; clusterInd < keys.size(); ++clusterInd) {
+                keys[clusterInd] = snapshot->GetKey(clusterInd);
+            }
+            snapshot->WriteWithSynonyms(
+                options.totalResultsSnapshotPath.string(),
+                PatternPhrasesStorage::FindKeySynonyms(keys, options.synonymIndexPath.string()));
+        } else {
+            PhrasesStorageLoader loader;
+            auto& storage = PatternPhrasesStorage::GetStorage();
+            loadTotalResults(loader, storage);
+            storage.FindSynonyms(options.synonymIndexPath.string());
+            saveTotalResults(storage);
+        }
+    } else if (command == "build_tokenized_corpus") {
+        // Generate a tokenized sentence corpus and save it
+        BuildTokenizedSentenceCorpus();
+    } else if (command == "perform_lsa") {
+        // Load preprocessed data and execute Latent Semantic Analysis (LSA)
+        Logger::log("Main", LogLevel::Info, "Starting LSA analysis...");
+        PhrasesStorageLoader loader;
+        loadEmbeddings();
+        auto& storage = PatternPhrasesStorage::GetStorage();
+        loadTotalResults(loader, storage);
+
+        if (!lsaFactors) {
+            auto lsa = std::make_unique<LSA>(TokenizedSentenceCorpus::GetCorpus());
+            if (auto section =
+                    openSnapshotSection(LSA::kFactorsMagic, LSA::kFactorsVersion, options.lsaFactorsPath)) {
+                // Metrics are computed again from the saved factors without the SVD
+                lsa->LoadFactors(*section);
+            } else {
+                loadSentences();
+                lsa->PerformAnalysis(false);
+                lsa->SaveFactors(options.lsaFactorsPath.string());
+            }
+            lsaFactors = std::move(lsa);
+        }
+        LSA& lsa = *lsaFactors;
+
+        MatrixXd U = lsa.GetU();
+        MatrixXd Sigma = lsa.GetSigma();
+        MatrixXd V = lsa.GetV();
+        std::vector<std::string> words = lsa.GetWords();
+
+        Logger::log("LSA", LogLevel::Info, "LSA analysis completed successfully.");
+        Logger::log("LSA", LogLevel::Info,
+                    "Matrix U size: " + std::to_string(U.rows()) + "x" + std::to_string(U.cols()));
+        Logger::log("LSA", LogLevel::Info,
+                    "Matrix Sigma size: " + std::to_string(Sigma.rows()) + "x" + std::to_string(Sigma.cols()));
+        Logger::log("LSA", LogLevel::Info,
+                    "Matrix V size: " + std::to_string(V.rows()) + "x" + std::to_string(V.cols()));
+
+        Logger::log("LSA", LogLevel::Info, "Analyzing top topics...");
+        lsa.AnalyzeTopics(5, 30);
+
+        // storage.UpdateClusterMetrics(U, words, lsa.GetTopics());
+
+        LSA_MetricsConfig config;
+        config.useCosineForCentrality = true;
+        config.useVectorRatioForTopicRelevance = true;
+        config.applySigmaScaling = true;
+        config.maxComponents = 50;
+        storage.CalculateLSAMetrics(U, words, Sigma, config);
+
+        saveTotalResults(storage);
+    } else if (command == "get_terminological_phrases") {
+        // Load precomputed results without additional processing
+        Logger::log("Main", LogLevel::Info, "Loading precomputed results...");
+        PhrasesStorageLoader loader;
+        loadSentences();
+        loadEmbeddings();
+
+        auto& storage = PatternPhrasesStorage::GetStorage();
+        loadTotalResults(loader, storage);
+        storage.AddContextsToClusters();
+        storage.CollectTerms();
+        storage.OutputClustersToJsonFile(options.termsCandidatesPath.string(), false, true);
+        // The contexts and the terms are not saved, so the next command starts from the saved results again
+        totalResultsLoaded = false;
+    } else if (command == "export_json") {
+        // Convert the binary results of the previous commands to total_results.json
+        Logger::log("Main", LogLevel::Info, "Exporting results to JSON...");
+        PhrasesStorageLoader loader;
+        auto& storage = PatternPhrasesStorage::GetStorage();
+        loadTotalResults(loader, storage);
+        storage.OutputClustersToJsonFile(options.totalResultsPath.string());
+    } else if (command == "save_snapshot") {
+        Logger::log("Main", LogLevel::Info, "Saving pipeline snapshot...");
+        savePipelineSnapshot();
+    } else if (command == "convert_embedding_model") {
+        Logger::log("Main", LogLevel::Info, "Converting " + options.embeddingModelFile.string() + "...");
+        FastTextModel(options.embeddingModelFile.string())
+            .Convert(options.embeddingOutputFile.string(), options.quantizeEmbeddings);
+    } else if (command == "check_embedding_model") {
+        checkEmbeddingModel();
+    } else if (command == "lookup") {
+        const std::string key = SentenceLemmatizer().Lemmatize(term);
+        if (auto snapshot = openTotalResultsSnapshot()) {
+            std::cout << lookupTerm(term, key, &*snapshot) << "\n";
+        } else {
+            PhrasesStorageLoader loader;
+            loadTotalResults(loader, PatternPhrasesStorage::GetStorage());
+            std::cout << lookupTerm(term, key) << "\n";
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Keeps the models and the results loaded and answers the requests of runClient on the socket until a shutdown
+// request. A request is the command and the term on separate lines; the response starts with an "OK" line or is
+// an "ERROR <message>" line. Lookups only read the storage and run concurrently; the other commands change the
+// storage and run one at a time with the options the server was started with. A command continues from the results
+// that the storage holds after the previous one instead of loading them again. A failed command restores the results
+// saved by the previous commands, so lookups keep answering from them.
+void serve()
+{
+    using namespace PhrasesCollectorUtils;
+
+    Logger::log("Main", LogLevel::Info, "Loading models and results...");
+    servingResults = true;
+    loadEmbeddings();
+    SentenceLemmatizer lemmatizer;
+    std::mutex lemmatizerMutex;
+    auto& storage = PatternPhrasesStorage::GetStorage();
+    auto loadSavedResults = [&storage]() {
+        storage.Clear();
+        totalResultsLoaded = false;
+        if (fs::exists(options.totalResultsSnapshotPath) || fs::exists(options.totalResultsPath) ||
+            (pipelineImage && pipelineImage->HasSection(StorageSnapshot::kMagic))) {
+            PhrasesStorageLoader loader;
+            loadTotalResults(loader, storage);
+        }
+    };
+    loadSavedResults();
+
+    const std::unordered_set<std::string> servedCommands = {"compute_text_metrics", "load_hypernyms", "find_synonyms",
+                                                            "perform_lsa", "get_terminological_phrases",
+                                                            "export_json"};
+    std::shared_mutex storageMutex;
+    std::optional<UnixSocketServer> server;
+    auto handleRequest = [&](const std::string& request) -> std::string {
+        std::istringstream input(request);
+        std::string command, term;
+        std::getline(input, command);
+        std::getline(input, term);
+
+        if (command == "shutdown") {
+            server->Stop();
+            return "OK\n";
+        }
+        if (command == "lookup") {
+            std::string key;
+            {
+                std::lock_guard<std::mutex> lock(lemmatizerMutex);
+                key = lemmatizer.Lemmatize(term);
+            }
+            std::shared_lock<std::shared_mutex> lock(storageMutex);
+            return "OK\n" + lookupTerm(term, key) + "\n";
+        }
+        if (!servedCommands.count(command)) {
+            throw std::runtime_error("Command is not served: " + command);
+        }
+
+        std::unique_lock<std::shared_mutex> lock(storageMutex);
+        Logger::log("Main", LogLevel::Info, "Serving " + command + "...");
+        auto start = std::chrono::steady_clock::now();
+        try {
+            runCommand(command);
+            saveEmbeddings();
+        } catch (const std::exception& ex) {
+            Logger::log("Main", LogLevel::Error, command + " failed: " + ex.what() + ", restoring the saved results");
+            try {
+                loadSavedResults();
+            } catch (const std::exception& loadEx) {
+                storage.Clear();
+                Logger::log("Main", LogLevel::Error, std::string("Failed to restore the results: ") + loadEx.what());
+            }
+            throw;
+        }
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        return "OK\n" + command + " took " + std::to_string(duration.count()) + " seconds.\n";
+    };
+    // One worker per thread of --threads answers the requests; the others wait in the listen backlog
+    server.emplace(options.socketPath.string(), handleRequest, static_cast<size_t>(options.threadsCount));
+
+    Logger::log("Main", LogLevel::Info, "Listening on " + options.socketPath.string());
+    server->Run();
+    Logger::log("Main", LogLevel::Info, "Server stopped.");
+}
+
+// Sends the command to a running serve process and prints its response.
+// \return              Exit code of the command.
+int runClient(const std::string& command, const std::string& term)
+{
+    const std::string response = SendUnixSocketRequest(options.socketPath.string(), command + "\n" + term);
+    if (response.rfind("OK\n", 0) == 0) {
+        std::cout << response.substr(3);
+        return 0;
+    }
+    std::cerr << response;
+    return 1;
+}
 int main(int argc, char** argv)
 {
 
@@ -172,106 +853,34 @@ int main(int argc, char** argv)
 
     // Set global options
     setGlobalOptions(vm);
+    bool connect = false;
+    validateBoolOption(vm, "connect", connect);
+    const std::string term = vm.count("term") ? vm["term"].as<std::string>() : std::string();
 
     // Execute command
     try {
-        if (command == "collect_phrases") {
-            Logger::log("Main", LogLevel::Info, "Starting phrase collection...");
-            fs::path patternsPath = options.patternsFile;
-            GrammarPatternManager::GetManager()->readPatterns(patternsPath);
-            BuildPhraseStorage();
-            Logger::log("Main", LogLevel::Info, "Phrase collection completed successfully.");
-        } else if (command == "filter_corpus") {
-            Logger::log("Main", LogLevel::Info, "Starting filtering corpus...");
-            auto& corpus = TextCorpus::GetCorpus();
-            corpus.LoadCorpusFromFile(options.corpusFile.string());
-            corpus.SaveCorpusToFile(options.filteredCorpusFile);
-            Logger::log("Main", LogLevel::Info, "Filtering corpus completed successfully.");
-        } else if (command == "compute_text_metrics") {
-            Logger::log("Main", LogLevel::Info, "Starting computing text metrics...");
-            auto& corpus = TextCorpus::GetCorpus();
-            corpus.LoadCorpusFromFile(options.filteredCorpusFile.string());
-            PhrasesStorageLoader loader;
-            ::Embedding e;
-            auto& storage = PatternPhrasesStorage::GetStorage();
-            loader.LoadPhraseStorageFromResultsDir(storage);
-            storage.MergeSimilarClusters();
-            storage.ComputeTextMetrics();
-            storage.OutputClustersToJsonFile(options.totalResultsPath.string());
-            Logger::log("Main", LogLevel::Info, "Computing text metrics completed successfully.");
-        } else if (command == "load_hypernyms") {
-            // Load hypernym and hyponym relations for stored lemmas
-            Logger::log("Main", LogLevel::Info, "Loading hypernyms and hyponyms...");
-            auto& corpus = TextCorpus::GetCorpus();
-            corpus.LoadCorpusFromFile(options.filteredCorpusFile.string());
-            ::Embedding e;
-            PhrasesStorageLoader loader;
-            auto& storage = PatternPhrasesStorage::GetStorage();
-            loader.LoadStorageFromFile(storage, options.totalResultsPath.string());
-            storage.LoadWikiWNRelations();
-            storage.OutputClustersToJsonFile(options.totalResultsPath);
-        } else if (command == "build_tokenized_corpus") {
-            // Generate a tokenized sentence corpus and save it
-            BuildTokenizedSentenceCorpus();
-        } else if (command == "perform_lsa") {
-            // Load preprocessed data and execute Latent Semantic Analysis (LSA)
-            Logger::log("Main", LogLevel::Info, "Starting LSA analysis...");
-            PhrasesStorageLoader loader;
-            ::Embedding e;
-            auto& storage = PatternPhrasesStorage::GetStorage();
-            loader.LoadStorageFromFile(storage, options.totalResultsPath.string());
-
-            auto& sentences = TokenizedSentenceCorpus::GetCorpus();
-            sentences.LoadFromFile(options.sentencesFile.string());
-
-            LSA lsa(sentences);
-            lsa.PerformAnalysis(false);
-
-            MatrixXd U = lsa.GetU();
-            MatrixXd Sigma = lsa.GetSigma();
-            MatrixXd V = lsa.GetV();
-            std::vector<std::string> words = lsa.GetWords();
-
-            Logger::log("LSA", LogLevel::Info, "LSA analysis completed successfully.");
-            Logger::log("LSA", LogLevel::Info,
-                        "Matrix U size: " + std::to_string(U.rows()) + "x" + std::to_string(U.cols()));
-            Logger::log("LSA", LogLevel::Info,
-                        "Matrix Sigma size: " + std::to_string(Sigma.rows()) + "x" + std::to_string(Sigma.cols()));
-            Logger::log("LSA", LogLevel::Info,
-                        "Matrix V size: " + std::to_string(V.rows()) + "x" + std::to_string(V.cols()));
-
-            Logger::log("LSA", LogLevel::Info, "Analyzing top topics...");
-            lsa.AnalyzeTopics(5, 30);
-
-            // storage.UpdateClusterMetrics(U, words, lsa.GetTopics());
-
-            LSA_MetricsConfig config;
-            config.useCosineForCentrality = true;
-            config.useVectorRatioForTopicRelevance = true;
-            config.applySigmaScaling = true;
-            config.maxComponents = 50;
-            storage.CalculateLSAMetrics(U, words, Sigma, config);
-
-            storage.OutputClustersToJsonFile(options.totalResultsPath);
-        } else if (command == "get_terminological_phrases") {
-            // Load precomputed results without additional processing
-            Logger::log("Main", LogLevel::Info, "Loading precomputed results...");
-            PhrasesStorageLoader loader;
-            auto& corpus = TokenizedSentenceCorpus::GetCorpus();
-            corpus.LoadFromFile(options.sentencesFile.string());
+        if (connect) {
+            return runClient(command, term);
+        }
 
-            ::Embedding e;
+        if (options.fromSnapshot) {
+            Logger::log("Main", LogLevel::Info, "Restoring state from " + options.pipelineSnapshotPath.string());
+            auto restoreStart = std::chrono::steady_clock::now();
+            pipelineImage.emplace(options.pipelineSnapshotPath.string());
+            pipelineImageTime = fs::last_write_time(options.pipelineSnapshotPath);
+            std::chrono::duration<double> restoreDuration = std::chrono::steady_clock::now() - restoreStart;
+            Logger::log("Main", LogLevel::Info,
+                        "Mapped the pipeline snapshot in " + std::to_string(restoreDuration.count()) + " seconds");
+        }
 
-            auto& storage = PatternPhrasesStorage::GetStorage();
-            loader.LoadStorageFromFile(storage, options.totalResultsPath.string());
-            storage.AddContextsToClusters();
-            storage.CollectTerms();
-            storage.OutputClustersToJsonFile(options.termsCandidatesPath.string(), false, true);
-        } else {
+        if (command == "serve") {
+            serve();
+        } else if (!runCommand(command, term)) {
             std::cerr << "Unknown command: " << command << "\n";
             printUsage(desc);
             return 1;
         }
+        saveEmbeddings();
     } catch (const std::exception& ex) {
         Logger::log("Main", LogLevel::Error, std::string("Exception: ") + ex.what());
         return 1;
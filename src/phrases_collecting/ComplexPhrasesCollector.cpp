@@ -1,12 +1,66 @@
 #include <ComplexPhrasesCollector.h>
+#include <LemmaDictionary.h>
 #include <PatternPhrasesStorage.h>
+#include <PatternProfiler.h>
 
 using namespace PhrasesCollectorUtils;
 
-bool ComplexPhrasesCollector::CheckMorphologicalTags(const std::unordered_set<MorphInfo>& morphForms,
-                                                     const Condition& cond, CurrentPhraseStatus& curPhrStatus)
+bool ComplexPhrasesCollector::CheckCondition(const std::shared_ptr<WordComp>& comp, size_t tokenInd,
+                                             std::string* lemma) const
 {
-    for (const auto& morphForm : morphForms) {
+    if (m_lattice) {
+        const LatticeCandidate* candidate = comp->getCondition().find(comp->getSPTag(), (*m_lattice)[tokenInd]);
+        if (candidate && lemma) {
+            *lemma = LemmaDictionary::GetDictionary().GetLemma(candidate->lemmaId);
+        }
+        return candidate != nullptr;
+    }
+    if (!comp->getCondition().check(comp->getSPTag(), m_sentence[tokenInd])) {
+        return false;
+    }
+    if (lemma) {
+        *lemma = GetLemma(m_sentence[tokenInd]);
+    }
+    return true;
+}
+
+bool ComplexPhrasesCollector::CheckExampleLexicon(const Condition& cond, size_t tokenInd) const
+{
+    if (m_lattice) {
+        for (const auto& candidate : (*m_lattice)[tokenInd]) {
+            if (cond.exLexCheck(candidate)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for (const auto& morphForm : m_sentence[tokenInd]->getMorphInfo()) {
+        if (!cond.getAdditional().check(morphForm)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ComplexPhrasesCollector::CheckMorphologicalTags(size_t tokenInd, const Condition& cond,
+                                                     CurrentPhraseStatus& curPhrStatus)
+{
+    if (m_lattice) {
+        for (const auto& candidate : (*m_lattice)[tokenInd]) {
+            if (cond.morphTagCheck(candidate)) {
+                curPhrStatus.headIsChecked = true;
+                curPhrStatus.headIsMatched = true;
+                if (cond.exLexCheck(candidate)) {
+                    curPhrStatus.foundLex = true;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for (const auto& morphForm : m_sentence[tokenInd]->getMorphInfo()) {
         if (!cond.morphTagCheck(morphForm)) {
             continue;
         } else {
@@ -28,8 +82,8 @@ bool ComplexPhrasesCollector::CheckWordComponents(const WordComplexPtr& curSimpl
     size_t wcInd = 0;
     for (const auto& wordComp : curModelComp->getComponents()) {
         if (const auto& wc = std::dynamic_pointer_cast<WordComp>(wordComp)) {
-            const auto& morphForms = m_sentence[curSimplePhr->pos.start + wcInd++]->getMorphInfo();
-            if (CheckMorphologicalTags(morphForms, curModelComp->getHead()->getCondition(), curPhrStatus)) {
+            if (CheckMorphologicalTags(curSimplePhr->pos.start + wcInd++, curModelComp->getHead()->getCondition(),
+                                       curPhrStatus)) {
                 if (wc->isHead()) {
                     curPhrStatus.headIsChecked = true;
                     curPhrStatus.headIsMatched = true;
@@ -112,7 +166,8 @@ bool ComplexPhrasesCollector::CheckAside(size_t curSPhPosCmp, const WordComplexP
 
         std::string formFromText = token->getWordForm().getRawString();
 
-        if (!wordComp->getCondition().check(wordComp->getSPTag(), token)) {
+        std::string lemma;
+        if (!CheckCondition(wordComp, formIndex, &lemma)) {
             return false;
         } else {
             if (!curPhrStatus.headIsChecked) {
@@ -121,7 +176,7 @@ bool ComplexPhrasesCollector::CheckAside(size_t curSPhPosCmp, const WordComplexP
             }
         }
 
-        UpdateWordComplex(wc, token, formFromText, isLeft);
+        UpdateWordComplex(wc, token, lemma, formFromText, isLeft);
 
         curPhrStatus.correct++;
         size_t nextCompIndex = isLeft ? compIndex - 1 : compIndex + 1;
@@ -161,8 +216,7 @@ bool ComplexPhrasesCollector::CheckAside(size_t curSPhPosCmp, const WordComplexP
 
             if (!curPhrStatus.headIsChecked) {
                 if (modelComp->isHead()) {
-                    if (modelComp->getHead()->getCondition().check(modelComp->getHead()->getSPTag(),
-                                                                   m_sentence[formIndex + *modelComp->getHeadPos()])) {
+                    if (CheckCondition(modelComp->getHead(), formIndex + *modelComp->getHeadPos())) {
                         curPhrStatus.headIsChecked = true;
                         curPhrStatus.headIsMatched = true;
                     } else {
@@ -175,13 +229,10 @@ bool ComplexPhrasesCollector::CheckAside(size_t curSPhPosCmp, const WordComplexP
 
             if (!curPhrStatus.foundLex) {
                 for (size_t offset = 0; offset < curSimplePhr->words.size(); offset++) {
-                    for (const auto& morphForm : m_sentence[formIndex + offset]->getMorphInfo()) {
-                        if (!modelComp->getCondition().getAdditional().check(morphForm)) {
-                            return false;
-                        } else {
-                            curPhrStatus.foundLex = true;
-                        }
+                    if (!CheckExampleLexicon(modelComp->getCondition(), formIndex + offset)) {
+                        return false;
                     }
+                    curPhrStatus.foundLex = true;
                 }
             }
 
@@ -271,7 +322,8 @@ void ComplexPhrasesCollector::ValidateBoundares()
 
 bool ComplexPhrasesCollector::ProcessModelComponent(const std::shared_ptr<Model>& model,
                                                     const WordComplexPtr& curSimplePhr, const size_t curSimplePhrInd,
-                                                    CurrentPhraseStatus& curPhrStatus, WordComplexPtr& wc)
+                                                    CurrentPhraseStatus& curPhrStatus, WordComplexPtr& wc,
+                                                    PatternStats* stats)
 {
     auto curSPhPosCmp = model->getModelCompIndByForm(curSimplePhr->modelName);
     if (!curSPhPosCmp)
@@ -280,9 +332,13 @@ bool ComplexPhrasesCollector::ProcessModelComponent(const std::shared_ptr<Model>
     if (!CheckCurrentSimplePhrase(curSimplePhr, model->getModelComponent(*curSPhPosCmp), curPhrStatus))
         return false;
 
+    PatternProfiler::Add(stats, &PatternStats::headPassed);
+
     wc = InicializeWordComplex(curSimplePhr, model->getForm());
     curPhrStatus.correct++;
 
+    PatternProfiler::ScopedTimer timer(stats);
+
     if (*curSPhPosCmp != 0 && wc->pos.start != 0) {
         if (CheckAside(*curSPhPosCmp, wc, model, *curSPhPosCmp - 1, curSimplePhr->pos.start - 1, true, curPhrStatus,
                        curSimplePhrInd))
@@ -298,13 +354,21 @@ bool ComplexPhrasesCollector::ProcessModelComponent(const std::shared_ptr<Model>
 
 void ComplexPhrasesCollector::Collect(Process& process)
 {
+    const auto& profiler = PatternProfiler::GetProfiler();
     for (size_t curSimplePhrInd = 0; curSimplePhrInd < m_simplePhrases.size(); curSimplePhrInd++) {
         const auto curSimplePhr = m_simplePhrases[curSimplePhrInd];
 
         for (const auto& [name, model] : manager.getComplexPatterns()) {
             CurrentPhraseStatus curPhrStatus;
             WordComplexPtr wc;
-            if (ProcessModelComponent(model, curSimplePhr, curSimplePhrInd, curPhrStatus, wc))
+            PatternStats* stats = profiler.GetStats(name);
+            PatternProfiler::Add(stats, &PatternStats::attempts);
+
+            const size_t collectedBefore = m_collection.size();
+            const bool found = ProcessModelComponent(model, curSimplePhr, curSimplePhrInd, curPhrStatus, wc, stats);
+            PatternProfiler::Add(stats, &PatternStats::matches, m_collection.size() - collectedBefore);
+
+            if (found)
                 break;
         }
     }
@@ -6,6 +6,8 @@
 
 #include <regex>
 
+struct PatternStats;
+
 // \class ComplexPhrasesCollector
 // \brief This class collects complex phrases from a given set of simple phrases and word forms.
 //        It utilizes the GrammarPatternManager to identify and collect complex phrases based on grammar patterns.
@@ -14,10 +16,11 @@ public:
     // \brief Constructor that initializes the ComplexPhrasesCollector with simple phrases and word forms.
     // \param simplePhrases     A vector of WordComplexPtr representing the simple phrases to analyze.
     // \param forms             A vector of WordFormPtr representing the sentence to analyze.
+    // \param lattice           Optional morphological lattice of the sentence, see SimplePhrasesCollector.
     explicit ComplexPhrasesCollector(const std::vector<PHUtils::WordComplexPtr>& simplePhrases,
-                                     const std::vector<WordFormPtr>& forms)
+                                     const std::vector<WordFormPtr>& forms, const MorphLattice* lattice = nullptr)
         : m_simplePhrases(simplePhrases), m_sentence(forms), m_collection{},
-          manager(*GrammarPatternManager::GetManager())
+          manager(*GrammarPatternManager::GetManager()), m_lattice(lattice)
     {
     }
 
@@ -35,6 +38,14 @@ private:
     std::vector<PHUtils::WordComplexPtr> m_collection;          ///< Collection of word complexes.
     std::vector<WordFormPtr> m_sentence;                        ///< Vector of word forms representing the sentence.
     const GrammarPatternManager& manager;                       ///< Reference to the GrammarPatternManager instance.
+    const MorphLattice* m_lattice;                              ///< Morphological lattice of the sentence, if enabled.
+
+    // Checks the condition of the component on the token. On success stores into lemma, if it is set, the lemma of
+    // the analysis that satisfies the condition: the most probable matching candidate of the lattice, or the most
+    // probable analysis of the token without a lattice.
+    bool CheckCondition(const std::shared_ptr<WordComp>& comp, size_t tokenInd, std::string* lemma = nullptr) const;
+
+    bool CheckExampleLexicon(const Condition& cond, size_t tokenInd) const;
 
     bool CheckCurrentSimplePhrase(const PHUtils::WordComplexPtr& curSimplePhr,
                                   const std::shared_ptr<ModelComp>& curModelComp,
@@ -47,8 +58,7 @@ private:
     bool ShouldSkip(size_t smpPhrOffset, size_t curSimplePhrInd, bool isLeft, const PHUtils::WordComplexPtr& wc,
                     std::shared_ptr<ModelComp> modelComp);
 
-    bool CheckMorphologicalTags(const std::unordered_set<MorphInfo>& morphForms, const Condition& cond,
-                                PHUtils::CurrentPhraseStatus& curPhrStatus);
+    bool CheckMorphologicalTags(size_t tokenInd, const Condition& cond, PHUtils::CurrentPhraseStatus& curPhrStatus);
 
     bool CheckWordComponents(const PHUtils::WordComplexPtr& curSimplePhr,
                              const std::shared_ptr<ModelComp>& curModelComp,
@@ -56,7 +66,7 @@ private:
 
     bool ProcessModelComponent(const std::shared_ptr<Model>& model, const PHUtils::WordComplexPtr& curSimplePhr,
                                const size_t curSimplePhrInd, PHUtils::CurrentPhraseStatus& curPhrStatus,
-                               PHUtils::WordComplexPtr& wc);
+                               PHUtils::WordComplexPtr& wc, PatternStats* stats = nullptr);
 };
 
 #endif // COMPLEX_PHRASES_COLLECTOR_H
\ No newline at end of file
@@ -1,26 +1,260 @@
 #include <Embedding.h>
 #include <PhrasesCollectorUtils.h>
+#include <ResourceUsage.h>
+#include <TopicScoring.h>
+#include <VectorKernels.h>
 
+#include <algorithm>
+#include <chrono>
+#include <exception>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 
 namespace fs = std::filesystem;
 
-std::unique_ptr<fasttext::FastText> Embedding::ft = nullptr;
+std::unique_ptr<EmbeddingModel> EmbeddingModel::Open(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open embedding model " + filename);
+    }
+    std::string magic(MappedEmbeddingModel::kMagic.size(), '\0');
+    file.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+    file.close();
+    if (magic == MappedEmbeddingModel::kMagic) {
+        return std::make_unique<MappedEmbeddingModel>(filename);
+    }
+    return std::make_unique<FastTextModel>(filename);
+}
+
+FastTextModel::FastTextModel(const std::string& filename)
+{
+    ft.loadModel(filename);
+}
 
-void Embedding::LoadModel(std::string model_path = "")
+std::vector<float> FastTextModel::GetWordVector(const std::string& word) const
 {
-    auto& options = PhrasesCollectorUtils::Options::getOptions();
-    if (!ft) {
-        ft = std::make_unique<fasttext::FastText>();
-        if (model_path.empty()) {
-            model_path = options.embeddingModelFile.string();
+    fasttext::Vector vec(ft.getDimension());
+    ft.getWordVector(vec, word);
+    return std::vector<float>(vec.data(), vec.data() + vec.size());
+}
+
+void FastTextModel::Convert(const std::string& filename, bool quantize)
+{
+    const auto dict = ft.getDictionary();
+    if (dict->isPruned()) {
+        throw std::runtime_error("Pruned fastText models cannot be converted, convert the model before quantization");
+    }
+    const fasttext::Args args = ft.getArgs();
+    const uint32_t dimension = static_cast<uint32_t>(ft.getDimension());
+    const uint64_t wordsCount = static_cast<uint64_t>(dict->nwords());
+    const uint64_t bucket = args.maxn > 0 ? static_cast<uint64_t>(args.bucket) : 0;
+
+    std::vector<uint64_t> wordBegins{0};
+    std::vector<char> wordBytes;
+    for (uint64_t id = 0; id < wordsCount; ++id) {
+        const std::string word = dict->getWord(static_cast<int32_t>(id));
+        wordBytes.insert(wordBytes.end(), word.begin(), word.end());
+        wordBegins.push_back(wordBytes.size());
+    }
+    std::vector<uint32_t> sortedWords(wordsCount);
+    for (uint32_t id = 0; id < wordsCount; ++id) {
+        sortedWords[id] = id;
+    }
+    auto word = [&](uint32_t id) {
+        return std::string_view(wordBytes.data() + wordBegins[id], wordBegins[id + 1] - wordBegins[id]);
+    };
+    std::sort(sortedWords.begin(), sortedWords.end(), [&](uint32_t a, uint32_t b) { return word(a) < word(b); });
+
+    BinaryWriter writer(filename, MappedEmbeddingModel::kMagic, MappedEmbeddingModel::kVersion);
+    writer.Write(dimension);
+    writer.Write(static_cast<uint32_t>(args.minn));
+    writer.Write(static_cast<uint32_t>(args.maxn));
+    writer.Write(wordsCount);
+    writer.Write(bucket);
+    writer.Write(static_cast<uint8_t>(quantize));
+    writer.Write(static_cast<uint64_t>(wordBytes.size()));
+    writer.WriteArray(wordBegins);
+    writer.WriteArray(wordBytes);
+    writer.WriteArray(sortedWords);
+
+    // The matrix is written row by row, so the conversion does not hold a second copy of it
+    const uint64_t rowsCount = wordsCount + bucket;
+    fasttext::Vector vec(dimension);
+    std::vector<float> row(dimension);
+    std::vector<int8_t> quantizedRow(dimension);
+    std::vector<float> scales;
+    for (uint64_t rowInd = 0; rowInd < rowsCount; ++rowInd) {
+        ft.getInputVector(vec, static_cast<int32_t>(rowInd));
+        if (!quantize) {
+            row.assign(vec.data(), vec.data() + dimension);
+            writer.WriteArray(row);
+            continue;
+        }
+        float maxAbs = 0.0f;
+        for (uint32_t i = 0; i < dimension; ++i) {
+            maxAbs = std::max(maxAbs, std::abs(vec.data()[i]));
+        }
+        const float scale = maxAbs / 127.0f;
+        for (uint32_t i = 0; i < dimension; ++i) {
+            quantizedRow[i] = scale > 0.0f ? static_cast<int8_t>(std::lround(vec.data()[i] / scale)) : 0;
         }
+        writer.WriteArray(quantizedRow);
+        scales.push_back(scale);
+    }
+    writer.WriteArray(scales);
+    writer.Close();
+
+    Logger::log("Embedding", LogLevel::Info,
+                "Converted " + std::to_string(rowsCount) + " rows" + (quantize ? " to int8" : "") + " into " +
+                    filename);
+}
+
+MappedEmbeddingModel::MappedEmbeddingModel(const std::string& filename) : reader(filename, kMagic, kVersion)
+{
+    dimension = reader.Read<uint32_t>();
+    minn = reader.Read<uint32_t>();
+    maxn = reader.Read<uint32_t>();
+    wordsCount = reader.Read<uint64_t>();
+    bucket = reader.Read<uint64_t>();
+    const bool quantized = reader.Read<uint8_t>() != 0;
+    const uint64_t wordBytesCount = reader.Read<uint64_t>();
+    wordBegins = reader.ReadArray<uint64_t>(wordsCount + 1);
+    wordBytes = reader.ReadArray<char>(wordBytesCount);
+    sortedWords = reader.ReadArray<uint32_t>(wordsCount);
+
+    const uint64_t rowsCount = wordsCount + bucket;
+    if (dimension != 0 && rowsCount > SIZE_MAX / dimension) {
+        throw std::runtime_error("Corrupted embedding model: " + reader.GetName());
+    }
+    if (quantized) {
+        quantizedMatrix = reader.ReadArray<int8_t>(rowsCount * dimension);
+        scales = reader.ReadArray<float>(rowsCount);
+    } else {
+        matrix = reader.ReadArray<float>(rowsCount * dimension);
+    }
+
+    // Words are checked once, so that lookups can use them without bounds checks
+    for (uint64_t id = 0; id < wordsCount; ++id) {
+        if (wordBegins[id] > wordBegins[id + 1] || wordBegins[id + 1] > wordBytesCount ||
+            sortedWords[id] >= wordsCount) {
+            throw std::runtime_error("Corrupted embedding model: " + reader.GetName());
+        }
+    }
+}
+
+uint32_t MappedEmbeddingModel::NgramHash(std::string_view ngram)
+{
+    uint32_t h = 2166136261;
+    for (char c : ngram) {
+        h = h ^ static_cast<uint32_t>(static_cast<int8_t>(c));
+        h = h * 16777619;
+    }
+    return h;
+}
+
+std::string_view MappedEmbeddingModel::GetWord(uint64_t id) const
+{
+    return {wordBytes + wordBegins[id], wordBegins[id + 1] - wordBegins[id]};
+}
+
+int64_t MappedEmbeddingModel::FindWord(std::string_view word) const
+{
+    const uint32_t* end = sortedWords + wordsCount;
+    const uint32_t* it =
+        std::lower_bound(sortedWords, end, word, [this](uint32_t id, std::string_view w) { return GetWord(id) < w; });
+    if (it == end || GetWord(*it) != word) {
+        return -1;
+    }
+    return *it;
+}
+
+void MappedEmbeddingModel::AddRow(uint64_t row, std::vector<float>& vector) const
+{
+    if (scales) {
+        const int8_t* values = quantizedMatrix + row * dimension;
+        const float scale = scales[row];
+        for (uint32_t i = 0; i < dimension; ++i) {
+            vector[i] += scale * values[i];
+        }
+    } else {
+        const float* values = matrix + row * dimension;
+        for (uint32_t i = 0; i < dimension; ++i) {
+            vector[i] += values[i];
+        }
+    }
+}
+
+std::vector<float> MappedEmbeddingModel::GetWordVector(const std::string& word) const
+{
+    std::vector<float> vector(dimension, 0.0f);
+    size_t rowsCount = 0;
+
+    const int64_t wordId = FindWord(word);
+    if (wordId >= 0) {
+        AddRow(static_cast<uint64_t>(wordId), vector);
+        ++rowsCount;
+    }
+
+    // Character ngrams of the word with the boundary symbols, as fastText computes them; single characters at the
+    // boundaries are skipped and the end-of-sentence token has no ngrams
+    if (bucket > 0 && word != "</s>") {
+        const std::string bounded = "<" + word + ">";
+        for (size_t i = 0; i < bounded.size(); ++i) {
+            if ((bounded[i] & 0xC0) == 0x80) {
+                continue;
+            }
+            size_t j = i;
+            for (uint32_t n = 1; j < bounded.size() && n <= maxn; ++n) {
+                ++j;
+                while (j < bounded.size() && (bounded[j] & 0xC0) == 0x80) {
+                    ++j;
+                }
+                if (n >= minn && !(n == 1 && (i == 0 || j == bounded.size()))) {
+                    const uint32_t hash = NgramHash(std::string_view(bounded).substr(i, j - i));
+                    AddRow(wordsCount + hash % bucket, vector);
+                    ++rowsCount;
+                }
+            }
+        }
+    }
+
+    if (rowsCount > 0) {
+        const float norm = 1.0f / static_cast<float>(rowsCount);
+        for (float& value : vector) {
+            value *= norm;
+        }
+    }
+    return vector;
+}
+
+std::unique_ptr<EmbeddingModel> Embedding::model = nullptr;
+
+void Embedding::LoadModel()
+{
+    // Embeddings may be requested from several threads, the first request loads the model. A failure is kept and
+    // rethrown to every later request, so the model file is not read again for each word.
+    static std::once_flag loaded;
+    static std::exception_ptr loadError;
+    std::call_once(loaded, []() {
+        const std::string modelPath = PhrasesCollectorUtils::Options::getOptions().embeddingModelFile.string();
+        const long long rssBefore = static_cast<long long>(GetResidentMemoryKb());
+        auto start = std::chrono::steady_clock::now();
         try {
-            ft->loadModel(model_path);
+            model = EmbeddingModel::Open(modelPath);
         } catch (const std::exception& e) {
-            std::cerr << "Exception occurred: " << e.what() << std::endl;
+            Logger::log("Embedding", LogLevel::Error, "Failed to load " + modelPath + ": " + e.what());
+            loadError = std::current_exception();
+            return;
         }
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        Logger::log("Embedding", LogLevel::Info,
+                    "Loaded " + modelPath + " in " + std::to_string(duration.count()) + " seconds, RSS grew by " +
+                        std::to_string((static_cast<long long>(GetResidentMemoryKb()) - rssBefore) / 1024) + " MiB");
+    });
+    if (loadError) {
+        std::rethrow_exception(loadError);
     }
 }
 
@@ -33,129 +267,298 @@ Embedding::Embedding()
 
 void Embedding::RunTest()
 {
-    if (!ft) {
+    if (!model) {
         std::cerr << "Model is not loaded. Please load the model before running the test." << std::endl;
         return;
     }
 
-    std::cout << "Listing all words in the model:" << std::endl;
-    const auto dict = ft->getDictionary();
-    std::cout << std::to_string(dict->nwords()) << std::endl;
-    fasttext::Vector vec(ft->getDimension());
-    ft->getWordVector(vec, "передовой");
-    for (int i = 0; i < 5; ++i) {
-        std::cout << dict->getWord(i) << std::endl;
+    const std::vector<float> vec = model->GetWordVector("передовой");
+    std::cout << "Dimension: " << vec.size() << std::endl;
+    for (size_t i = 0; i < 5 && i < vec.size(); ++i) {
+        std::cout << vec[i] << std::endl;
     }
 }
 
+std::string Embedding::GetModelIdentity()
+{
+    const fs::path& modelPath = PhrasesCollectorUtils::Options::getOptions().embeddingModelFile;
+    std::error_code error;
+    const auto size = fs::file_size(modelPath, error);
+    if (error) {
+        return "";
+    }
+    return modelPath.filename().string() + ":" + std::to_string(size);
+}
+
 std::vector<float> Embedding::GetWordVector(const std::string& word)
 {
-    fasttext::Vector vec(ft->getDimension());
-    ft->getWordVector(vec, word);
-    return std::vector<float>(vec.data(), vec.data() + vec.size());
+    LoadModel();
+    return model->GetWordVector(word);
 }
 
 WordEmbedding::WordEmbedding(const std::string& word)
 {
-    vector = Embedding::GetWordVector(word);
+    const WordEmbeddingPtr embedding = LemmaEmbeddings::GetInstance().GetEmbedding(word);
+    values = embedding->Data();
+    dimension = embedding->Size();
+    norm = embedding->norm;
+}
+
+void WordEmbedding::ComputeNorm()
+{
+    norm = std::sqrt(GetVectorKernels().dotProduct(values, values, dimension));
 }
 
-float WordEmbedding::CosineSimilarity(const WordEmbedding& other) const
+EmbeddingSimilarities WordEmbedding::Compare(const WordEmbedding& other) const
 {
-    float dot = DotProduct(other);
-    float magA = Magnitude();
-    float magB = other.Magnitude();
-    if (magA == 0.0f || magB == 0.0f) {
-        return 0;
+    const VectorMetrics metrics = GetVectorKernels().metrics(values, other.values, dimension);
+    EmbeddingSimilarities similarities;
+    if (norm != 0.0f && other.norm != 0.0f) {
+        similarities.cosine = metrics.dot / (norm * other.norm);
     }
-    return dot / (magA * magB);
+    similarities.euclidean = std::sqrt(metrics.squaredDistance);
+    similarities.manhattan = metrics.manhattanDistance;
+    if (metrics.maxSum != 0.0f) {
+        similarities.jaccard = metrics.minSum / metrics.maxSum;
+    }
+    return similarities;
 }
 
-float NormalizedLevenshteinDistance(const std::string& s1, const std::string& s2)
+float TopicSimilarity(const WordEmbedding& phrase, const WordEmbedding& topic)
 {
-    int len1 = s1.size();
-    int len2 = s2.size();
-    std::vector<std::vector<int>> dp(len1 + 1, std::vector<int>(len2 + 1));
+    const VectorMetrics metrics = GetVectorKernels().metrics(phrase.Data(), topic.Data(), phrase.Size());
+    return TopicScore(metrics, phrase.Magnitude(), topic.Magnitude());
+}
 
-    for (int i = 0; i <= len1; ++i) {
-        for (int j = 0; j <= len2; ++j) {
-            if (i == 0) {
-                dp[i][j] = j;
-            } else if (j == 0) {
-                dp[i][j] = i;
-            } else {
-                int cost = (s1[i - 1] == s2[j - 1]) ? 0 : 1;
-                dp[i][j] = std::min({dp[i - 1][j] + 1, dp[i][j - 1] + 1, dp[i - 1][j - 1] + cost});
-            }
+WordEmbeddingPtr LemmaEmbeddings::GetEmbedding(uint32_t id)
+{
+    Entry& entry = GetEntry(id);
+    bool computed = false;
+    std::call_once(entry.computed, [this, id, &entry, &computed]() {
+        const std::string& lemma = LemmaDictionary::GetDictionary().GetLemma(id);
+        // Embeddings loaded from a file, or requested before the word became a lemma, are in the word table
+        Entry* wordEntry = FindWordEntry(lemma);
+        if (!wordEntry) {
+            computed = ComputeOnce(entry, lemma);
+            return;
         }
+        computed = ComputeOnce(*wordEntry, lemma);
+        entry.embedding = wordEntry->embedding;
+        entry.ready = true;
+    });
+    ++(computed ? misses : hits);
+    return entry.embedding;
+}
+
+WordEmbeddingPtr LemmaEmbeddings::GetEmbedding(const std::string& word)
+{
+    const uint32_t lemmaId = LemmaDictionary::GetDictionary().FindId(word);
+    if (lemmaId != LemmaDictionary::kUnknownId) {
+        return GetEmbedding(lemmaId);
     }
+    Entry& entry = GetWordEntry(word);
+    ++(ComputeOnce(entry, word) ? misses : hits);
+    return entry.embedding;
+}
 
-    int levenshteinDistance = dp[len1][len2];
-    int maxLength = std::max(len1, len2);
+bool LemmaEmbeddings::ComputeOnce(Entry& entry, const std::string& word)
+{
+    bool computed = false;
+    std::call_once(entry.computed, [this, &entry, &word, &computed]() {
+        const std::vector<float> vector = Embedding::GetWordVector(word);
+        StoreEmbedding(word, entry, vector.data(), vector.size());
+        computed = true;
+    });
+    return computed;
+}
 
-    return static_cast<float>(levenshteinDistance) / maxLength;
+void LemmaEmbeddings::StoreEmbedding(std::string_view word, Entry& entry, const float* values, size_t size)
+{
+    float* row = nullptr;
+    {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        if (dimension == 0) {
+            dimension = size;
+        } else if (size != dimension) {
+            throw std::runtime_error("Embedding of '" + std::string(word) + "' has dimension " +
+                                     std::to_string(size) + " instead of " + std::to_string(dimension));
+        }
+        // Rows are taken in the order of storing, so the ids of words without an embedding take no memory
+        const size_t rowInd = rowsCount++;
+        if (rowInd / kBlockRows == blocks.size()) {
+            blocks.push_back(std::make_unique<float[]>(kBlockRows * dimension));
+        }
+        row = blocks[rowInd / kBlockRows].get() + (rowInd % kBlockRows) * dimension;
+    }
+    // Rows of different entries do not overlap, so they are filled without the lock
+    std::copy(values, values + size, row);
+    entry.embedding = std::make_shared<WordEmbedding>(row, size);
+    entry.ready = true;
 }
 
-float WordEmbedding::EuclideanDistance(const WordEmbedding& other) const
+void LemmaEmbeddings::SaveEmbeddings(const std::string& filename)
 {
-    float sum = 0.0f;
-    for (size_t i = 0; i < vector.size(); ++i) {
-        float diff = vector[i] - other.vector[i];
-        sum += diff * diff;
+    auto& dictionary = LemmaDictionary::GetDictionary();
+    std::vector<const Entry*> savedEntries;
+    std::vector<uint64_t> lemmaBegins{0};
+    std::vector<char> lemmaBytes;
+    auto save = [&](std::string_view word, const Entry& entry) {
+        lemmaBytes.insert(lemmaBytes.end(), word.begin(), word.end());
+        lemmaBegins.push_back(lemmaBytes.size());
+        savedEntries.push_back(&entry);
+    };
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        for (uint32_t id = 0; id < words.size(); ++id) {
+            if (wordEntries[id].ready) {
+                save(words[id], wordEntries[id]);
+            }
+        }
+        // A lemma that shares the embedding of the word table is saved once
+        for (uint32_t id = 0; id < entries.size(); ++id) {
+            if (!entries[id].ready) {
+                continue;
+            }
+            const std::string& lemma = dictionary.GetLemma(id);
+            const auto wordIt = wordIds.find(lemma);
+            if (wordIt == wordIds.end() || !wordEntries[wordIt->second].ready) {
+                save(lemma, entries[id]);
+            }
+        }
+    }
+
+    BinaryWriter writer(filename, kMagic, kVersion);
+    writer.Write(static_cast<uint64_t>(savedEntries.size()));
+    writer.Write(static_cast<uint32_t>(savedEntries.empty() ? 0 : dimension));
+    writer.WriteString(Embedding::GetModelIdentity());
+    writer.Write(static_cast<uint64_t>(lemmaBytes.size()));
+    writer.WriteArray(lemmaBegins);
+    writer.WriteArray(lemmaBytes);
+    // Rows are written one by one and form one contiguous matrix in the file
+    std::vector<float> row(dimension);
+    for (const Entry* entry : savedEntries) {
+        row.assign(entry->embedding->Data(), entry->embedding->Data() + entry->embedding->Size());
+        writer.WriteArray(row);
     }
-    return std::sqrt(sum);
+    writer.Close();
+
+    Logger::log("Embedding", LogLevel::Info,
+                "Saved embeddings of " + std::to_string(savedEntries.size()) + " words to " + filename);
 }
 
-float WordEmbedding::ManhattanDistance(const WordEmbedding& other) const
+bool LemmaEmbeddings::LoadEmbeddings(BinaryReader& reader)
 {
-    float sum = 0.0f;
-    for (size_t i = 0; i < vector.size(); ++i) {
-        sum += std::abs(vector[i] - other.vector[i]);
+    const uint64_t lemmasCount = reader.Read<uint64_t>();
+    const uint32_t savedDimension = reader.Read<uint32_t>();
+    const std::string_view modelIdentity = reader.ReadStringView();
+    const std::string currentIdentity = Embedding::GetModelIdentity();
+    if (!currentIdentity.empty() && modelIdentity != currentIdentity) {
+        Logger::log("Embedding", LogLevel::Warning,
+                    "Embeddings of " + reader.GetName() + " were computed with another model (" +
+                        std::string(modelIdentity) + "), they are not used");
+        return false;
+    }
+    const uint64_t lemmaBytesCount = reader.Read<uint64_t>();
+    const uint64_t* lemmaBegins = reader.ReadArray<uint64_t>(lemmasCount + 1);
+    const char* lemmaBytes = reader.ReadArray<char>(lemmaBytesCount);
+    if (savedDimension != 0 && lemmasCount > SIZE_MAX / savedDimension) {
+        throw std::runtime_error("Corrupted lemma embeddings: " + reader.GetName());
+    }
+    const float* vectors = reader.ReadArray<float>(lemmasCount * savedDimension);
+
+    for (uint64_t lemmaInd = 0; lemmaInd < lemmasCount; ++lemmaInd) {
+        if (lemmaBegins[lemmaInd] > lemmaBegins[lemmaInd + 1] || lemmaBegins[lemmaInd + 1] > lemmaBytesCount) {
+            throw std::runtime_error("Corrupted lemma embeddings: " + reader.GetName());
+        }
+        const std::string_view word(lemmaBytes + lemmaBegins[lemmaInd],
+                                    lemmaBegins[lemmaInd + 1] - lemmaBegins[lemmaInd]);
+        Entry& entry = GetWordEntry(word);
+        const float* vector = vectors + lemmaInd * savedDimension;
+        std::call_once(entry.computed, [this, word, &entry, vector, savedDimension]() {
+            StoreEmbedding(word, entry, vector, savedDimension);
+        });
     }
-    return sum;
+
+    Logger::log("Embedding", LogLevel::Info,
+                "Loaded embeddings of " + std::to_string(lemmasCount) + " words from " + reader.GetName());
+    return true;
 }
 
-float WordEmbedding::JaccardSimilarity(const WordEmbedding& other) const
+LemmaEmbeddings::Entry& LemmaEmbeddings::GetEntry(uint32_t id)
 {
-    float intersection = 0.0f;
-    float union_set = 0.0f;
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        if (id < entries.size()) {
+            return entries[id];
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    while (entries.size() <= id) {
+        entries.emplace_back();
+    }
+    return entries[id];
+}
 
-    for (size_t i = 0; i < vector.size(); ++i) {
-        intersection += std::min(vector[i], other.vector[i]);
-        union_set += std::max(vector[i], other.vector[i]);
+LemmaEmbeddings::Entry& LemmaEmbeddings::GetWordEntry(std::string_view word)
+{
+    if (Entry* entry = FindWordEntry(word)) {
+        return *entry;
     }
 
-    if (union_set == 0.0f) {
-        return 0.0f;
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    const auto it = wordIds.find(word);
+    if (it != wordIds.end()) {
+        return wordEntries[it->second];
     }
+    words.emplace_back(word);
+    wordIds.emplace(words.back(), static_cast<uint32_t>(wordEntries.size()));
+    return wordEntries.emplace_back();
+}
 
-    return intersection / union_set;
+LemmaEmbeddings::Entry* LemmaEmbeddings::FindWordEntry(std::string_view word)
+{
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    const auto it = wordIds.find(word);
+    return it != wordIds.end() ? &wordEntries[it->second] : nullptr;
 }
 
-float WordEmbedding::Magnitude() const
+float NormalizedLevenshteinDistance(const std::string& s1, const std::string& s2)
 {
-    float sum = 0.0f;
-    for (float val : vector) {
-        sum += val * val;
+    int len1 = s1.size();
+    int len2 = s2.size();
+    std::vector<std::vector<int>> dp(len1 + 1, std::vector<int>(len2 + 1));
+
+    for (int i = 0; i <= len1; ++i) {
+        for (int j = 0; j <= len2; ++j) {
+            if (i == 0) {
+                dp[i][j] = j;
+            } else if (j == 0) {
+                dp[i][j] = i;
+            } else {
+                int cost = (s1[i - 1] == s2[j - 1]) ? 0 : 1;
+                dp[i][j] = std::min({dp[i - 1][j] + 1, dp[i][j - 1] + 1, dp[i - 1][j - 1] + cost});
+            }
+        }
     }
-    return std::sqrt(sum);
+
+    int levenshteinDistance = dp[len1][len2];
+    int maxLength = std::max(len1, len2);
+
+    return static_cast<float>(levenshteinDistance) / maxLength;
 }
 
 float WordEmbedding::DotProduct(const WordEmbedding& other) const
 {
-    float dot = 0.0f;
-    for (size_t i = 0; i < vector.size(); ++i) {
-        dot += vector[i] * other.vector[i];
-    }
-    return dot;
+    return GetVectorKernels().dotProduct(values, other.values, dimension);
 }
 
 std::ostream& operator<<(std::ostream& os, const WordEmbedding& we)
 {
     os << "[";
-    for (size_t i = 0; i < we.vector.size(); ++i) {
-        os << we.vector[i];
-        if (i < we.vector.size() - 1) {
+    for (size_t i = 0; i < we.dimension; ++i) {
+        os << we.values[i];
+        if (i < we.dimension - 1) {
             os << ", ";
         }
     }
@@ -1,47 +1,184 @@
 #ifndef EMBEDDING_H
 #define EMBEDDING_H
 
+#include <BinaryIO.h>
+#include <LemmaDictionary.h>
+
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <deque>
 #include <fasttext.h>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+// \class EmbeddingModel
+// \brief Source of the word vectors of a fastText model. Implementations are thread-safe for reading.
+class EmbeddingModel {
+public:
+    virtual ~EmbeddingModel() = default;
+
+    virtual std::vector<float> GetWordVector(const std::string& word) const = 0;
+
+    // \brief Opens a model file: a layout written by FastTextModel::Convert is mapped, any other file is loaded by
+    //        fastText.
+    // \throws std::runtime_error if the file cannot be read.
+    static std::unique_ptr<EmbeddingModel> Open(const std::string& filename);
+};
+
+// \class FastTextModel
+// \brief Model loaded into memory by the fastText library, either a full .bin model or a quantized .ftz one.
+class FastTextModel : public EmbeddingModel {
+public:
+    explicit FastTextModel(const std::string& filename);
+
+    std::vector<float> GetWordVector(const std::string& word) const override;
+
+    // \brief Writes the dictionary and the input matrix in the layout read by MappedEmbeddingModel.
+    // \param quantize      Store the matrix as int8 with a scale per row, which takes a quarter of the space.
+    // \throws std::runtime_error if the model is pruned, since its ngram ids cannot be computed from the hashes alone.
+    void Convert(const std::string& filename, bool quantize);
+
+private:
+    fasttext::FastText ft;
+};
+
+// \class MappedEmbeddingModel
+// \brief Model converted by FastTextModel::Convert. The file is mapped instead of read, so only the rows of the words
+//        and ngrams that are looked up are paged in, and the kernel can drop them under memory pressure instead of
+//        swapping. Word vectors are computed as fastText does: the average of the rows of the word and of its
+//        character ngrams.
+class MappedEmbeddingModel : public EmbeddingModel {
+public:
+    static constexpr std::string_view kMagic = "ATTFTMAT";
+    static constexpr uint32_t kVersion = 1;
+
+    // \throws std::runtime_error if the file is corrupted or has another format version.
+    explicit MappedEmbeddingModel(const std::string& filename);
+
+    std::vector<float> GetWordVector(const std::string& word) const override;
+
+    bool IsQuantized() const
+    {
+        return scales != nullptr;
+    }
+
+    // \brief Hash of the character ngrams used by fastText: FNV-1a over the bytes taken as signed chars, so bytes of
+    //        non-ASCII characters hash differently than in the reference FNV-1a.
+    static uint32_t NgramHash(std::string_view ngram);
+
+private:
+    BinaryReader reader; ///< Owns the mapping that the arrays below point into.
+    uint32_t dimension = 0;
+    uint32_t minn = 0;
+    uint32_t maxn = 0;
+    uint64_t wordsCount = 0;
+    uint64_t bucket = 0;
+    const uint64_t* wordBegins = nullptr;
+    const char* wordBytes = nullptr;
+    const uint32_t* sortedWords = nullptr; ///< Word ids in the byte order of the words, for binary search.
+    const float* matrix = nullptr;         ///< Rows of words and then of ngram buckets, if not quantized.
+    const int8_t* quantizedMatrix = nullptr;
+    const float* scales = nullptr; ///< Scale of every quantized row.
+
+    std::string_view GetWord(uint64_t id) const;
+
+    // Returns the id of the word or -1 for words out of the vocabulary.
+    int64_t FindWord(std::string_view word) const;
+
+    void AddRow(uint64_t row, std::vector<float>& vector) const;
+};
+
 class Embedding {
 private:
-    static std::unique_ptr<fasttext::FastText> ft;
-    static void LoadModel(std::string model_path);
+    static std::unique_ptr<EmbeddingModel> model;
+    static void LoadModel();
 
 public:
+    // \brief Loads the model of Options::embeddingModelFile. Constructing an Embedding is optional: GetWordVector
+    //        loads the model on its first call, so a command whose embeddings are all restored from a snapshot never
+    //        reads the model.
+    // \throws the exception of EmbeddingModel::Open if the model cannot be loaded.
     Embedding();
 
+    // \throws the exception of EmbeddingModel::Open if the model cannot be loaded. The model is loaded once, so
+    //        every later call throws the error of the first attempt.
     static std::vector<float> GetWordVector(const std::string& word);
 
+    // \brief Name and size of the model file, stored with cached embeddings to detect that the model has changed.
+    //        Empty if the model file does not exist.
+    static std::string GetModelIdentity();
+
     static void RunTest();
 };
 
+// \struct EmbeddingSimilarities
+// \brief All similarities of two embeddings, computed by WordEmbedding::Compare in one pass.
+struct EmbeddingSimilarities {
+    float cosine = 0.0f;
+    float euclidean = 0.0f; ///< Euclidean distance.
+    float manhattan = 0.0f; ///< Manhattan distance.
+    float jaccard = 0.0f;
+};
+
+// \class WordEmbedding
+// \brief Embedding vector with its cached norm. Similarities are computed by the SIMD kernels of VectorKernels
+//        chosen for the CPU at run time.
 class WordEmbedding {
 private:
-    std::vector<float> vector;
+    std::vector<float> ownedValues; ///< Empty for embeddings that view a row of the LemmaEmbeddings matrix.
+    const float* values = nullptr;
+    size_t dimension = 0;
+    float norm = 0.0f;
+
+    void ComputeNorm();
 
 public:
+    // \brief Views the embedding of the word in the LemmaEmbeddings cache, computing it on the first request.
     WordEmbedding(const std::string& word);
 
-    const std::vector<float>& GetVector() const
+    explicit WordEmbedding(std::vector<float> vector)
+        : ownedValues(std::move(vector)), values(ownedValues.data()), dimension(ownedValues.size())
+    {
+        ComputeNorm();
+    }
+
+    // \brief Views values that must outlive the embedding.
+    WordEmbedding(const float* values, size_t dimension) : values(values), dimension(dimension)
     {
-        return vector;
+        ComputeNorm();
     }
 
-    float CosineSimilarity(const WordEmbedding& other) const;
+    // Moving a vector keeps its buffer, so the view stays valid; copies would need to rebind it
+    WordEmbedding(WordEmbedding&&) = default;
+    WordEmbedding& operator=(WordEmbedding&&) = default;
+    WordEmbedding(const WordEmbedding&) = delete;
+    WordEmbedding& operator=(const WordEmbedding&) = delete;
 
-    float EuclideanDistance(const WordEmbedding& other) const;
+    const float* Data() const
+    {
+        return values;
+    }
 
-    float ManhattanDistance(const WordEmbedding& other) const;
+    size_t Size() const
+    {
+        return dimension;
+    }
 
-    float JaccardSimilarity(const WordEmbedding& other) const;
+    // \brief Computes the cosine similarity, the distances and the Jaccard similarity in one pass over the vectors.
+    EmbeddingSimilarities Compare(const WordEmbedding& other) const;
 
-    float Magnitude() const;
+    float Magnitude() const
+    {
+        return norm;
+    }
 
     float DotProduct(const WordEmbedding& other) const;
 
@@ -50,4 +187,99 @@ public:
 
 using WordEmbeddingPtr = std::shared_ptr<WordEmbedding>;
 
+// \brief Similarity of a phrase to a topic word used for tag_match (TopicScore of their embeddings), compared
+//        with Options::topicsThreshold. TopicScoreMatrix selects the topics of many phrases with the same result.
+float TopicSimilarity(const WordEmbedding& phrase, const WordEmbedding& topic);
+
+// \class LemmaEmbeddings
+// \brief Process-wide embedding cache keyed by the ids of LemmaDictionary. Words that are not lemmas, such as cluster
+//        keys and topic words, are keyed by a word table of the cache instead, so LemmaDictionary holds lemmas only.
+//        The embedding of a word is computed on the first request only and stored as a row of a matrix allocated in
+//        blocks, so rows never move and embeddings view them without copies. Together with SaveEmbeddings and
+//        LoadEmbeddings, every distinct word is looked up in the model at most once, across commands too. All
+//        methods are thread-safe unless noted otherwise.
+class LemmaEmbeddings {
+public:
+    static LemmaEmbeddings& GetInstance()
+    {
+        static LemmaEmbeddings instance;
+        return instance;
+    }
+
+    // \brief Returns the embedding of the lemma with the given id of LemmaDictionary, computing it with the model on
+    //        the first call.
+    WordEmbeddingPtr GetEmbedding(uint32_t id);
+
+    // \brief Returns the embedding of any word, computing it with the model on the first call. A word known to
+    //        LemmaDictionary shares the entry of its lemma id; other words are not added to the dictionary.
+    WordEmbeddingPtr GetEmbedding(const std::string& word);
+
+    static constexpr std::string_view kMagic = "ATTEMBED";
+    static constexpr uint32_t kVersion = 2;
+
+    // \brief Saves the embeddings that are computed or loaded, so that LoadEmbeddings can restore them without the
+    //        model. Words are saved as text, since ids of LemmaDictionary differ between processes.
+    void SaveEmbeddings(const std::string& filename);
+
+    // \brief Adds the embeddings saved by SaveEmbeddings to the word table of the cache; a lemma takes its embedding
+    //        from there on its first request. Embeddings that are already computed are kept.
+    // \return              False if the embeddings were computed with another model than the current one; nothing is
+    //                      loaded then.
+    // \throws std::runtime_error if the file is corrupted or has another format version.
+    bool LoadEmbeddings(BinaryReader& reader);
+
+    // \brief Number of requests answered from the cache and of embeddings computed with the model.
+    uint64_t GetHits() const
+    {
+        return hits;
+    }
+
+    uint64_t GetMisses() const
+    {
+        return misses;
+    }
+
+    LemmaEmbeddings(const LemmaEmbeddings&) = delete;
+    LemmaEmbeddings& operator=(const LemmaEmbeddings&) = delete;
+
+private:
+    struct Entry {
+        std::once_flag computed;
+        WordEmbeddingPtr embedding;
+        std::atomic<bool> ready{false}; ///< Set once the embedding is stored.
+    };
+
+    static constexpr size_t kBlockRows = 4096;
+
+    mutable std::shared_mutex mtx;
+    std::deque<Entry> entries; ///< Indexed by lemma id; a deque keeps entries in place while the table grows.
+    std::deque<Entry> wordEntries;                          ///< Indexed by the ids of the word table.
+    std::deque<std::string> words;                          ///< Words of the word table by id.
+    std::unordered_map<std::string_view, uint32_t> wordIds; ///< Ids of the word table; keys point into `words`.
+    std::vector<std::unique_ptr<float[]>> blocks; ///< Rows of the stored embeddings, kBlockRows rows per block.
+    size_t rowsCount = 0;                         ///< Rows taken in the blocks, in the order embeddings are stored.
+    size_t dimension = 0;                         ///< Set by the first stored embedding.
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+
+    LemmaEmbeddings() = default;
+
+    // Entries never move, so the reference stays valid after the lock is released. Entries of lemmas that were
+    // never requested are added on the way, they hold no row.
+    Entry& GetEntry(uint32_t id);
+
+    // Entry of the word table, added on the first request; entries of the word table never move either.
+    Entry& GetWordEntry(std::string_view word);
+
+    // Entry of the word table or nullptr if the word was never requested or loaded.
+    Entry* FindWordEntry(std::string_view word);
+
+    // Computes the embedding of the entry with the model unless it is stored already; returns whether it was
+    // computed.
+    bool ComputeOnce(Entry& entry, const std::string& word);
+
+    // Copies the values into the next row and publishes the embedding; called once per entry.
+    void StoreEmbedding(std::string_view word, Entry& entry, const float* values, size_t size);
+};
+
 #endif // EMBEDDING_H
@@ -1,5 +1,12 @@
+#include <BinaryIO.h>
+#include <HnswIndex.h>
+#include <LemmaDictionary.h>
+#include <MorphLattice.h>
+#include <ParallelFor.h>
 #include <PatternPhrasesStorage.h>
 #include <PhrasesCollectorUtils.h>
+#include <StorageSnapshot.h>
+#include <TopicScoring.h>
 
 #include <unicode/uchar.h>
 #include <unicode/unistr.h>
@@ -7,6 +14,9 @@
 #include <unicode/ustream.h>
 #include <unicode/utypes.h>
 
+#include <optional>
+#include <tuple>
+
 using json = nlohmann::json;
 
 void PatternPhrasesStorage::AddCluster(const std::string& key, const WordComplexCluster& cluster)
@@ -14,6 +24,98 @@ void PatternPhrasesStorage::AddCluster(const std::string& key, const WordComplex
     clusters[key] = cluster;
 }
 
+void PatternPhrasesStorage::AddWordComplex(const std::string& key, const WordComplexPtr& wc)
+{
+    bool created = false;
+    auto createCluster = [&]() {
+        created = true;
+        auto& dictionary = LemmaDictionary::GetDictionary();
+        std::vector<std::string> lemmas(wc->lemmas.begin(), wc->lemmas.end());
+        std::vector<uint32_t> lemmaIds;
+        std::unordered_map<std::string, std::set<std::string>> lemmHypernyms;
+        std::unordered_map<std::string, std::set<std::string>> lemmHyponyms;
+        for (const auto& lemma : lemmas) {
+            lemmaIds.push_back(dictionary.GetId(lemma));
+            lemmHypernyms[lemma] = {};
+            lemmHyponyms[lemma] = {};
+        }
+
+        return WordComplexCluster{wc->lemmas.size(), false,         1.0,          0.0, 0.0, key,
+                                  wc->modelName,     lemmas,        {wc},         {},  {},  {},
+                                  lemmaIds,          lemmHypernyms, lemmHyponyms};
+    };
+    auto addPhrase = [&](WordComplexCluster& cluster) {
+        if (!created) {
+            cluster.wordComplexes.push_back(wc);
+        }
+    };
+    clusters.Upsert(key, createCluster, addPhrase);
+}
+
+void PatternPhrasesStorage::SaveClustersSnapshot(const std::string& filename) const
+{
+    Logger::log("PhrasesStorage", LogLevel::Info, "Saving clusters snapshot to " + filename);
+
+    std::vector<const WordComplexCluster*> sortedClusters;
+    sortedClusters.reserve(clusters.size());
+    for (const auto& [key, cluster] : clusters) {
+        sortedClusters.push_back(&cluster);
+    }
+    std::sort(sortedClusters.begin(), sortedClusters.end(),
+              [](const WordComplexCluster* a, const WordComplexCluster* b) { return a->key < b->key; });
+
+    BinaryWriter writer(filename, kSnapshotMagic, kSnapshotVersion);
+    writer.Write(static_cast<uint64_t>(sortedClusters.size()));
+    for (const WordComplexCluster* cluster : sortedClusters) {
+        writer.WriteString(cluster->key);
+        writer.WriteString(cluster->modelName);
+        writer.Write(static_cast<uint32_t>(cluster->lemmas.size()));
+        for (const auto& lemma : cluster->lemmas) {
+            writer.WriteString(lemma);
+        }
+
+        std::vector<const WordComplex*> phrases;
+        phrases.reserve(cluster->wordComplexes.size());
+        for (const auto& wc : cluster->wordComplexes) {
+            phrases.push_back(wc.get());
+        }
+        std::sort(phrases.begin(), phrases.end(), [](const WordComplex* a, const WordComplex* b) {
+            return std::tie(a->pos.docNum, a->pos.sentNum, a->pos.start, a->pos.end) <
+                   std::tie(b->pos.docNum, b->pos.sentNum, b->pos.start, b->pos.end);
+        });
+
+        writer.Write(static_cast<uint32_t>(phrases.size()));
+        for (const WordComplex* wc : phrases) {
+            writer.WriteString(wc->textForm);
+            writer.WriteString(wc->modelName);
+            writer.Write(static_cast<uint64_t>(wc->pos.start));
+            writer.Write(static_cast<uint64_t>(wc->pos.end));
+            writer.Write(static_cast<uint64_t>(wc->pos.docNum));
+            writer.Write(static_cast<uint64_t>(wc->pos.sentNum));
+        }
+    }
+    writer.Close();
+
+    Logger::log("PhrasesStorage", LogLevel::Info, "Saved " + std::to_string(sortedClusters.size()) + " clusters");
+}
+
+void PatternPhrasesStorage::SaveStorageSnapshot(const std::string& filename) const
+{
+    Logger::log("PhrasesStorage", LogLevel::Info, "Saving storage snapshot to " + filename);
+
+    std::vector<const WordComplexCluster*> sortedClusters;
+    sortedClusters.reserve(clusters.size());
+    for (const auto& [key, cluster] : clusters) {
+        sortedClusters.push_back(&cluster);
+    }
+    std::sort(sortedClusters.begin(), sortedClusters.end(),
+              [](const WordComplexCluster* a, const WordComplexCluster* b) { return a->key < b->key; });
+
+    StorageSnapshot::Write(filename, sortedClusters, options.textToProcessCount);
+
+    Logger::log("PhrasesStorage", LogLevel::Info, "Saved " + std::to_string(sortedClusters.size()) + " clusters");
+}
+
 WordComplexCluster* PatternPhrasesStorage::FindCluster(const std::string& key)
 {
     auto it = clusters.find(key);
@@ -23,6 +125,21 @@ WordComplexCluster* PatternPhrasesStorage::FindCluster(const std::string& key)
     return nullptr;
 }
 
+std::optional<json> PatternPhrasesStorage::FindClusterJson(const std::string& key) const
+{
+    std::optional<json> result;
+    clusters.Visit(key, [&](const WordComplexCluster& cluster) { result = ClusterToJson(cluster); });
+    return result;
+}
+
+void PatternPhrasesStorage::Clear()
+{
+    clusters.clear();
+    hypernymCache.clear();
+    hyponymCache.clear();
+    clustersToInclude.clear();
+}
+
 void PatternPhrasesStorage::ReserveClusters(size_t count)
 {
     clusters.reserve(count);
@@ -35,16 +152,18 @@ void PatternPhrasesStorage::AddContextsToClusters()
 
     for (auto& clusterPair : clusters) {
         WordComplexCluster& cluster = clusterPair.second;
-        cluster.contexts.clear();
+        cluster.contextIds.clear();
 
+        // Clusters only refer to the sentences, so a sentence shared by many clusters is stored once
         for (const auto& wordComplex : cluster.wordComplexes) {
             const Position& pos = wordComplex->pos;
-            const TokenizedSentence* sentence = corpus.GetSentence(pos.docNum, pos.sentNum);
-
-            if (sentence) {
-                cluster.contexts.push_back(*sentence);
+            if (auto sentenceId = corpus.FindSentenceId(pos.docNum, pos.sentNum)) {
+                cluster.contextIds.push_back(*sentenceId);
             }
         }
+        std::sort(cluster.contextIds.begin(), cluster.contextIds.end());
+        cluster.contextIds.erase(std::unique(cluster.contextIds.begin(), cluster.contextIds.end()),
+                                 cluster.contextIds.end());
     }
 }
 
@@ -119,7 +238,6 @@ static nlohmann::json LoadClassifiedPhrases(const std::string& filePath)
 void PatternPhrasesStorage::InitializeAndFilterClusters(double tfidfThreshold, std::set<std::string>& sortedKeys,
                                                         std::unordered_set<std::string>& clustersToInclude)
 {
-    const auto& clusters = GetClusters();
     std::regex romanNumeralsRegex(R"(^[ivxlcd]+$)", std::regex_constants::icase);
 
     for (const auto& pair : clusters) {
@@ -162,8 +280,6 @@ void PatternPhrasesStorage::ApplyClassifiedPhrases(const nlohmann::json& phraseL
                                                    std::set<std::string>& sortedKeys,
                                                    std::unordered_set<std::string>& clustersToInclude)
 {
-    const auto& clusters = GetClusters();
-
     for (const auto& phraseData : phraseLabels) {
         std::string phrase;
         std::string label;
@@ -200,8 +316,6 @@ void PatternPhrasesStorage::ApplyClassifiedPhrases(const nlohmann::json& phraseL
 void PatternPhrasesStorage::CheckModelPrefixRelationships(std::set<std::string>& sortedKeys,
                                                           std::unordered_set<std::string>& clustersToInclude)
 {
-    const auto& clusters = GetClusters();
-
     auto it = sortedKeys.begin();
     while (it != sortedKeys.end()) {
         auto nextIt = std::next(it);
@@ -245,7 +359,6 @@ void PatternPhrasesStorage::CollectTerms(double tfidfThreshold)
 {
     Logger::log("PhrasesStorage", LogLevel::Info, "Collecting terms...");
     std::set<std::string> sortedKeys;
-    const auto& clusters = GetClusters();
 
     InitializeAndFilterClusters(tfidfThreshold, sortedKeys, clustersToInclude);
 
@@ -275,69 +388,91 @@ void PatternPhrasesStorage::EvaluateTermRelevance(const LSA& lsa)
     }
 }
 
-const std::unordered_map<std::string, WordComplexCluster> PatternPhrasesStorage::GetClusters() const
+std::unordered_map<std::string, WordComplexCluster> PatternPhrasesStorage::SnapshotClusters() const
 {
-    return clusters;
+    return std::unordered_map<std::string, WordComplexCluster>(clusters.begin(), clusters.end());
 }
 
-void PatternPhrasesStorage::Collect(const std::vector<WordFormPtr>& forms, Process& process)
+void PatternPhrasesStorage::Collect(const std::vector<WordFormPtr>& forms, Process& process, DocumentContext& context)
 {
-    auto& corpus = TextCorpus::GetCorpus();
-
-    if (lastDocumentId != -1 && lastDocumentId != process.docNum) {
-        for (const auto& lemma : uniqueLemmasInDoc) {
-            corpus.UpdateDocumentFrequency(lemma);
-        }
-        uniqueLemmasInDoc.clear();
+    if (context.documentId != -1 && context.documentId != static_cast<int>(process.docNum)) {
+        FinalizeDocumentProcessing(context);
     }
 
-    std::unordered_set<std::string> uniqueLemmasInSentence;
-    for (const auto& form : forms) {
-        std::string lemma = GetLemma(form);
-        corpus.UpdateWordFrequency(lemma);
-        uniqueLemmasInSentence.insert(lemma);
+    auto& options = Options::getOptions();
+    std::optional<MorphLattice> lattice;
+    if (options.latticeMatching) {
+        lattice.emplace(forms, options.latticeKBest);
     }
 
-    uniqueLemmasInDoc.insert(uniqueLemmasInSentence.begin(), uniqueLemmasInSentence.end());
-    lastDocumentId = process.docNum;
+    // Frequencies are accumulated in the context and merged into the TextCorpus once per document
+    for (size_t tokenInd = 0; tokenInd < forms.size(); ++tokenInd) {
+        std::string lemma = lattice && !(*lattice)[tokenInd].empty()
+                                ? LemmaDictionary::GetDictionary().GetLemma((*lattice)[tokenInd].best().lemmaId)
+                                : GetLemma(forms[tokenInd]);
+        context.lemmaFrequency[lemma]++;
+    }
+    context.documentId = static_cast<int>(process.docNum);
 
-    SimplePhrasesCollector simplePhrasesCollector(forms);
+    const MorphLattice* latticePtr = lattice ? &*lattice : nullptr;
+    SimplePhrasesCollector simplePhrasesCollector(forms, latticePtr);
     simplePhrasesCollector.Collect(process);
-    ComplexPhrasesCollector complexPhrasesCollector(simplePhrasesCollector.GetCollection(), forms);
+    ComplexPhrasesCollector complexPhrasesCollector(simplePhrasesCollector.GetCollection(), forms, latticePtr);
     complexPhrasesCollector.Collect(process);
 }
 
-void PatternPhrasesStorage::FinalizeDocumentProcessing()
+void PatternPhrasesStorage::FinalizeDocumentProcessing(DocumentContext& context)
 {
-    auto& corpus = TextCorpus::GetCorpus();
-    for (const auto& lemma : uniqueLemmasInDoc) {
-        corpus.UpdateDocumentFrequency(lemma);
-    }
-    uniqueLemmasInDoc.clear();
+    TextCorpus::GetCorpus().MergeDocumentFrequencies(context.lemmaFrequency);
+    context.lemmaFrequency.clear();
+    context.documentId = -1;
+}
+
+namespace {
+    // Clusters handed to one task of the parallel metric passes
+    constexpr size_t kClustersPerChunk = 1024;
 }
 
-std::map<std::string, int>
-CalculateTopicFrequency(const std::unordered_map<std::string, std::vector<std::string>>& similar_words)
+// Counts for every topic the clusters that selected it. Every chunk of clusters is counted separately and the counts
+// are summed in chunk order.
+std::vector<int> CalculateTopicFrequency(const std::vector<std::vector<uint32_t>>& clusterTopics, size_t topicsCount,
+                                         size_t threadsCount)
 {
-    std::map<std::string, int> topicFrequency;
-    for (const auto& pair : similar_words) {
-        for (const auto& topic : pair.second) {
-            topicFrequency[topic]++;
+    std::vector<std::vector<int>> chunkFrequency(ChunksCount(clusterTopics.size(), kClustersPerChunk));
+    ParallelForChunks(clusterTopics.size(), kClustersPerChunk, threadsCount,
+                      [&](size_t chunk, size_t begin, size_t end) {
+                          std::vector<int>& frequency = chunkFrequency[chunk];
+                          frequency.assign(topicsCount, 0);
+                          for (size_t id = begin; id < end; ++id) {
+                              for (uint32_t topic : clusterTopics[id]) {
+                                  frequency[topic]++;
+                              }
+                          }
+                      });
+
+    std::vector<int> topicFrequency(topicsCount, 0);
+    for (const auto& frequency : chunkFrequency) {
+        for (size_t topic = 0; topic < topicsCount; ++topic) {
+            topicFrequency[topic] += frequency[topic];
         }
     }
     return topicFrequency;
 }
 
-void ApplyTopicFrequencyPenalty(std::unordered_map<std::string, std::vector<std::string>>& similar_words,
-                                int frequencyThreshold)
+// Removes from every cluster the topics selected by more than frequencyThreshold clusters, which are too common to
+// characterize a cluster.
+void ApplyTopicFrequencyPenalty(std::vector<std::vector<uint32_t>>& clusterTopics, size_t topicsCount,
+                                int frequencyThreshold, size_t threadsCount)
 {
-    auto topicFrequency = CalculateTopicFrequency(similar_words);
-    for (auto& pair : similar_words) {
-        pair.second.erase(
-            std::remove_if(pair.second.begin(), pair.second.end(),
-                           [&](const std::string& topic) { return topicFrequency[topic] > frequencyThreshold; }),
-            pair.second.end());
-    }
+    const std::vector<int> topicFrequency = CalculateTopicFrequency(clusterTopics, topicsCount, threadsCount);
+    ParallelForChunks(clusterTopics.size(), kClustersPerChunk, threadsCount, [&](size_t, size_t begin, size_t end) {
+        for (size_t id = begin; id < end; ++id) {
+            auto& topics = clusterTopics[id];
+            topics.erase(std::remove_if(topics.begin(), topics.end(),
+                                        [&](uint32_t topic) { return topicFrequency[topic] > frequencyThreshold; }),
+                         topics.end());
+        }
+    });
 }
 
 double PatternPhrasesStorage::CalculateTopicRelevance(const WordComplexCluster& cluster,
@@ -403,217 +538,416 @@ void PatternPhrasesStorage::CalculateLSAMetrics(const MatrixXd& U, const std::ve
 {
     Logger::log("PhrasesStorage", LogLevel::Info, "Updating cluster metrics...");
 
+    std::vector<WordComplexCluster*> clusterPtrs;
+    clusterPtrs.reserve(clusters.size());
     for (auto& clusterPair : clusters) {
-        auto& cluster = clusterPair.second;
+        clusterPtrs.push_back(&clusterPair.second);
+    }
+
+    // Clusters are independent, so chunks of them are updated in parallel
+    ParallelForChunks(clusterPtrs.size(), kClustersPerChunk, options.threadsCount,
+                      [&](size_t, size_t begin, size_t end) {
+                          for (size_t id = begin; id < end; ++id) {
+                              WordComplexCluster& cluster = *clusterPtrs[id];
+                              cluster.topicRelevance = CalculateTopicRelevance(cluster, topics);
+                              cluster.centralityScore = CalculateCentrality(cluster, U, words);
+                          }
+                      });
+}
 
-        cluster.topicRelevance = CalculateTopicRelevance(cluster, topics);
+ClusterColumns PatternPhrasesStorage::BuildClusterColumns()
+{
+    auto& dictionary = LemmaDictionary::GetDictionary();
+    ClusterColumns columns;
+    const size_t clustersCount = clusters.size();
+    columns.keys.reserve(clustersCount);
+    columns.clusters.reserve(clustersCount);
+    columns.frequency.reserve(clustersCount);
+    columns.topicRelevance.reserve(clustersCount);
+    columns.centralityScore.reserve(clustersCount);
+    columns.tagMatch.reserve(clustersCount);
+    columns.lemmaBegins.reserve(clustersCount + 1);
+    columns.lemmaBegins.push_back(0);
+
+    for (auto& [key, cluster] : clusters) {
+        columns.keys.push_back(&key);
+        columns.clusters.push_back(&cluster);
+        columns.frequency.push_back(cluster.frequency);
+        columns.topicRelevance.push_back(cluster.topicRelevance);
+        columns.centralityScore.push_back(cluster.centralityScore);
+        columns.tagMatch.push_back(cluster.tagMatch);
 
-        cluster.centralityScore = CalculateCentrality(cluster, U, words);
+        for (size_t i = 0; i < cluster.lemmas.size(); ++i) {
+            columns.lemmaIds.push_back(i < cluster.lemmaIds.size() ? cluster.lemmaIds[i]
+                                                                   : dictionary.GetId(cluster.lemmas[i]));
+            columns.tf.push_back(i < cluster.tf.size() ? cluster.tf[i] : 0.0);
+            columns.idf.push_back(i < cluster.idf.size() ? cluster.idf[i] : 0.0);
+            columns.tfidf.push_back(i < cluster.tfidf.size() ? cluster.tfidf[i] : 0.0);
+        }
+        columns.lemmaBegins.push_back(columns.lemmaIds.size());
     }
+    return columns;
+}
+
+void PatternPhrasesStorage::StoreClusterColumns(const ClusterColumns& columns)
+{
+    ParallelForChunks(columns.Size(), kClustersPerChunk, options.threadsCount, [&](size_t, size_t first, size_t last) {
+        for (size_t id = first; id < last; ++id) {
+            WordComplexCluster& cluster = *columns.clusters[id];
+            cluster.frequency = columns.frequency[id];
+            cluster.topicRelevance = columns.topicRelevance[id];
+            cluster.centralityScore = columns.centralityScore[id];
+            cluster.tagMatch = columns.tagMatch[id] != 0;
+
+            const size_t begin = columns.lemmaBegins[id];
+            const size_t end = columns.lemmaBegins[id + 1];
+            cluster.tf.assign(columns.tf.begin() + begin, columns.tf.begin() + end);
+            cluster.idf.assign(columns.idf.begin() + begin, columns.idf.begin() + end);
+            cluster.tfidf.assign(columns.tfidf.begin() + begin, columns.tfidf.begin() + end);
+        }
+    });
 }
 
 /*
- * Calculation of topicRelevance based on vectors from the U matrix (and optionally Sigma):
+ * Both LSA metrics depend on the lemmas only through their rows of U, so the rows are looked up and scaled once per
+ * distinct lemma and the clusters then just average over their lemma slots.
  *
+ * topicRelevance:
  * - For each lemma calculate its vector: row(U) (if desired, scale by Sigma).
  * - Determines which component in this vector is the largest modulo and counts ratio = max^2 / sumOfSquares.
  * - Summarizes the ratio for all lemmas and take the average.
+ *
+ * centralityScore:
+ * 1) The vectors of all lemmas of the cluster are collected
+ * 2) The "centroid" (the average of the vectors) is searched for
+ * 3) For each lemma, the similarity (or distance) to the centroid is read.
+ * 4) Cluster average = centrality
  */
-double PatternPhrasesStorage::CalculateTopicRelevance(const WordComplexCluster& cluster, const Eigen::MatrixXd& U,
-                                                      const Eigen::MatrixXd& Sigma,
-                                                      const std::vector<std::string>& words,
-                                                      const LSA_MetricsConfig& config)
+void PatternPhrasesStorage::CalculateLSAMetrics(const Eigen::MatrixXd& U, const std::vector<std::string>& words,
+                                                const Eigen::MatrixXd& Sigma, const LSA_MetricsConfig& config)
 {
-    // How much of the component is actually used
-    int usedCols = config.maxComponents.has_value() ? std::min<int>(config.maxComponents.value(), U.cols()) : U.cols();
+    Logger::log("PhrasesStorage", LogLevel::Info, "Updating cluster metrics with advanced LSA approach...");
 
-    double sumAll = 0.0;
-    int validLemmaCount = 0;
+    ClusterColumns columns = BuildClusterColumns();
+    auto& dictionary = LemmaDictionary::GetDictionary();
 
-    for (const auto& lemma : cluster.lemmas) {
-        // Find index for lemma
-        auto it = std::find(words.begin(), words.end(), lemma);
-        if (it == words.end()) {
+    // How much of the component is actually used
+    const int usedCols =
+        config.maxComponents.has_value() ? std::min<int>(config.maxComponents.value(), U.cols()) : U.cols();
+
+    // The first occurrence of a word defines its row, as std::find over the words did
+    std::unordered_map<std::string, int> rowOfWord;
+    rowOfWord.reserve(words.size());
+    for (size_t row = 0; row < words.size(); ++row) {
+        rowOfWord.emplace(words[row], static_cast<int>(row));
+    }
+
+    // Scaled vector and topic relevance of every distinct lemma of the clusters; -1 marks lemmas outside the LSA
+    // vocabulary
+    std::vector<int> vectorOfLemma(dictionary.Size(), -2);
+    for (uint32_t lemmaId : columns.lemmaIds) {
+        vectorOfLemma[lemmaId] = -1;
+    }
+    std::vector<int> lemmaRows;
+    for (uint32_t lemmaId = 0; lemmaId < vectorOfLemma.size(); ++lemmaId) {
+        if (vectorOfLemma[lemmaId] == -2) {
             continue;
         }
+        auto it = rowOfWord.find(dictionary.GetLemma(lemmaId));
+        if (it == rowOfWord.end()) {
+            vectorOfLemma[lemmaId] = -1;
+            continue;
+        }
+        vectorOfLemma[lemmaId] = static_cast<int>(lemmaRows.size());
+        lemmaRows.push_back(it->second);
+    }
 
-        int rowIndex = static_cast<int>(std::distance(words.begin(), it));
-
-        Eigen::VectorXd vec = U.row(rowIndex).head(usedCols);
-
-        // If needs to multiply by Sigma
-        if (config.applySigmaScaling && Sigma.cols() == Sigma.rows()) {
-            for (int d = 0; d < usedCols; ++d) {
-                double s = Sigma(d, d); // diagonal
-                vec[d] *= s;
+    // Rows of distinct lemmas and clusters are independent, so both passes run over chunks in parallel
+    const size_t threadsCount = ResolveThreadsCount(options.threadsCount);
+    const bool scaleBySigma = config.applySigmaScaling && Sigma.cols() == Sigma.rows();
+    Eigen::MatrixXd lemmaVectors(static_cast<Eigen::Index>(lemmaRows.size()), usedCols);
+    std::vector<double> lemmaNorms(lemmaRows.size());
+    std::vector<double> lemmaRelevance(lemmaRows.size(), -1.0);
+    ParallelForChunks(lemmaRows.size(), kClustersPerChunk, threadsCount, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            lemmaVectors.row(i) = U.row(lemmaRows[i]).head(usedCols);
+            // If needs to multiply by Sigma
+            if (scaleBySigma) {
+                for (int d = 0; d < usedCols; ++d) {
+                    lemmaVectors(i, d) *= Sigma(d, d);
+                }
             }
-        }
 
-        double sumSq = vec.squaredNorm();
-        if (sumSq < 1e-15) {
-            continue; // vector is almost zero, skipping
+            const double sumSq = lemmaVectors.row(i).squaredNorm();
+            lemmaNorms[i] = std::sqrt(sumSq);
+            if (sumSq >= 1e-15) {
+                lemmaRelevance[i] = lemmaVectors.row(i).cwiseAbs2().maxCoeff() / sumSq;
+            }
         }
+    });
+
+    ParallelForChunks(columns.Size(), kClustersPerChunk, threadsCount, [&](size_t, size_t first, size_t last) {
+        Eigen::VectorXd centroid(usedCols);
+        for (size_t id = first; id < last; ++id) {
+            const size_t begin = columns.lemmaBegins[id];
+            const size_t end = columns.lemmaBegins[id + 1];
+
+            double relevanceSum = 0.0;
+            int relevanceCount = 0;
+            int vectorsCount = 0;
+            centroid.setZero();
+            for (size_t slot = begin; slot < end; ++slot) {
+                const int vectorInd = vectorOfLemma[columns.lemmaIds[slot]];
+                if (vectorInd < 0) {
+                    continue;
+                }
+                if (lemmaRelevance[vectorInd] >= 0.0) {
+                    relevanceSum += lemmaRelevance[vectorInd];
+                    ++relevanceCount;
+                }
+                centroid += lemmaVectors.row(vectorInd).transpose();
+                ++vectorsCount;
+            }
+            columns.topicRelevance[id] = relevanceCount == 0 ? 0.0 : relevanceSum / relevanceCount;
 
-        // Find max^2
-        double maxSq = 0.0;
-        for (int d = 0; d < usedCols; ++d) {
-            double sq = vec[d] * vec[d];
-            if (sq > maxSq) {
-                maxSq = sq;
+            if (vectorsCount == 0) {
+                columns.centralityScore[id] = 0.0;
+                continue;
+            }
+            centroid /= static_cast<double>(vectorsCount);
+            const double centroidNorm = centroid.norm();
+
+            double sumScore = 0.0;
+            for (size_t slot = begin; slot < end; ++slot) {
+                const int vectorInd = vectorOfLemma[columns.lemmaIds[slot]];
+                if (vectorInd < 0) {
+                    continue;
+                }
+                if (config.useCosineForCentrality) {
+                    // Косинусное сходство
+                    const double denom = lemmaNorms[vectorInd] * centroidNorm;
+                    sumScore += denom < 1e-15 ? 0.0 : lemmaVectors.row(vectorInd).dot(centroid) / denom;
+                } else {
+                    // Евклидова метрика -> пусть centrality = 1 / (1 + dist)
+                    sumScore += 1.0 / (1.0 + (lemmaVectors.row(vectorInd).transpose() - centroid).norm());
+                }
             }
+            columns.centralityScore[id] = sumScore / static_cast<double>(vectorsCount);
         }
+    });
 
-        double lemmaRelevance = maxSq / sumSq;
-        sumAll += lemmaRelevance;
-        validLemmaCount++;
-    }
-
-    if (validLemmaCount == 0) {
-        return 0.0;
-    }
-
-    return sumAll / static_cast<double>(validLemmaCount);
+    StoreClusterColumns(columns);
 }
 
-/*
- * Calculation of using vectors from U (and Sigma).
- * 1) The vectors of all lemmas of the cluster are collected
- * 2) The "centroid" (the average of the vectors) is searched for
- * 3) For each lemma, the similarity (or distance) to the centroid is read.
- * 4) Cluster average = centrality
- */
-double PatternPhrasesStorage::CalculateCentrality(const WordComplexCluster& cluster, const Eigen::MatrixXd& U,
-                                                  const Eigen::MatrixXd& Sigma, const std::vector<std::string>& words,
-                                                  const LSA_MetricsConfig& config)
+void PatternPhrasesStorage::ComputeTextMetrics()
 {
-    // Сколько используем компонент
-    int usedCols = config.maxComponents.has_value() ? std::min<int>(config.maxComponents.value(), U.cols()) : U.cols();
-
-    // Собираем вектора всех лемм кластера
-    std::vector<Eigen::VectorXd> lemmaVectors;
-    lemmaVectors.reserve(cluster.lemmas.size());
-
-    for (const auto& lemma : cluster.lemmas) {
-        auto it = std::find(words.begin(), words.end(), lemma);
-        if (it == words.end()) {
-            continue;
+    Logger::log("PhrasesStorage", LogLevel::Info, "Computing text metrics...");
+    const auto& corpus = TextCorpus::GetCorpus();
+    const auto& topicVectors = GetTopicVectors();
+    auto& options = PhrasesCollectorUtils::Options::getOptions();
+    const size_t threadsCount = ResolveThreadsCount(options.threadsCount);
+
+    // TF and IDF depend only on the lemma, so they are computed once per distinct lemma and then spread over the
+    // lemma slots of all clusters
+    ClusterColumns columns = BuildClusterColumns();
+    auto& dictionary = LemmaDictionary::GetDictionary();
+    std::vector<uint8_t> usedLemmas(dictionary.Size(), 0);
+    for (uint32_t lemmaId : columns.lemmaIds) {
+        usedLemmas[lemmaId] = 1;
+    }
+    std::vector<uint32_t> distinctLemmas;
+    for (uint32_t lemmaId = 0; lemmaId < usedLemmas.size(); ++lemmaId) {
+        if (usedLemmas[lemmaId]) {
+            distinctLemmas.push_back(lemmaId);
+        }
+    }
+    std::vector<double> lemmaTf(usedLemmas.size(), 0.0);
+    std::vector<double> lemmaIdf(usedLemmas.size(), 0.0);
+    ParallelForChunks(distinctLemmas.size(), kClustersPerChunk, threadsCount, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t lemmaId = distinctLemmas[i];
+            lemmaTf[lemmaId] = corpus.CalculateTF(lemmaId);
+            lemmaIdf[lemmaId] = corpus.CalculateIDF(lemmaId);
         }
+    });
 
-        int rowIndex = static_cast<int>(std::distance(words.begin(), it));
-        Eigen::VectorXd vec = U.row(rowIndex).head(usedCols);
+    ParallelForChunks(columns.Size(), kClustersPerChunk, threadsCount, [&](size_t, size_t first, size_t last) {
+        for (size_t slot = columns.lemmaBegins[first]; slot < columns.lemmaBegins[last]; ++slot) {
+            columns.tf[slot] = lemmaTf[columns.lemmaIds[slot]];
+            columns.idf[slot] = lemmaIdf[columns.lemmaIds[slot]];
+            columns.tfidf[slot] = columns.tf[slot] * columns.idf[slot];
+        }
+    });
 
-        if (config.applySigmaScaling && Sigma.cols() == Sigma.rows()) {
-            for (int d = 0; d < usedCols; ++d) {
-                double s = Sigma(d, d);
-                vec[d] *= s;
-            }
+    // The cluster keys are scored against all topic vectors at once, a block of keys per matrix product
+    if (!topicVectors.empty()) {
+        std::vector<const float*> topicRows;
+        for (const auto& topicVecPair : topicVectors) {
+            topicRows.push_back(topicVecPair.second->Data());
         }
-        lemmaVectors.push_back(vec);
-    }
+        const TopicScoreMatrix topicMatrix(topicRows, topicVectors.begin()->second->Size());
 
-    if (lemmaVectors.empty()) {
-        return 0.0;
+        // Rows of the embedding cache never move, so the keys only keep pointers to them
+        std::vector<const float*> keyRows(columns.Size());
+        ParallelForChunks(columns.Size(), kClustersPerChunk, threadsCount, [&](size_t, size_t begin, size_t end) {
+            for (size_t id = begin; id < end; ++id) {
+                keyRows[id] = WordEmbedding(*columns.keys[id]).Data();
+            }
+        });
+
+        size_t exactPairs = 0;
+        std::vector<std::vector<uint32_t>> clusterTopics =
+            topicMatrix.SelectTopics(keyRows, options.topicsThreshold, threadsCount, &exactPairs);
+        Logger::log("PhrasesStorage", LogLevel::Info,
+                    "Scored " + std::to_string(columns.Size()) + " cluster keys against " +
+                        std::to_string(topicRows.size()) + " topics, " + std::to_string(exactPairs) +
+                        " pairs compared exactly");
+
+        const int frequencyThreshold = static_cast<int>(columns.Size() * options.freqTresholdCoeff);
+        ApplyTopicFrequencyPenalty(clusterTopics, topicRows.size(), frequencyThreshold, threadsCount);
+        ParallelForChunks(columns.Size(), kClustersPerChunk, threadsCount, [&](size_t, size_t begin, size_t end) {
+            for (size_t id = begin; id < end; ++id) {
+                const size_t topicsCount = clusterTopics[id].size();
+                if (topicsCount > 0 && topicsCount < static_cast<size_t>(options.tresholdTopicsCount)) {
+                    columns.tagMatch[id] = 1;
+                }
+            }
+        });
     }
+    StoreClusterColumns(columns);
+}
 
-    // Вычисляем центроид
-    Eigen::VectorXd centroid = Eigen::VectorXd::Zero(usedCols);
-    for (const auto& v : lemmaVectors) {
-        centroid += v;
-    }
-    centroid /= static_cast<double>(lemmaVectors.size());
+namespace {
+    constexpr std::string_view kSynonymIndexMagic = "ATTSYNIX";
+    constexpr uint32_t kSynonymIndexVersion = 1;
+    // Candidates of the bottom-layer search for synonyms; enough for a recall above 0.95 at 10 neighbours
+    constexpr size_t kSynonymSearchEf = 100;
 
-    // Теперь считаем среднее сходство (или обратное расстояние)
-    // между леммой и центроидом
-    double sumScore = 0.0;
-    for (const auto& v : lemmaVectors) {
-        if (config.useCosineForCentrality) {
-            // Косинусное сходство
-            double denom = v.norm() * centroid.norm();
-            if (denom < 1e-15) {
-                sumScore += 0.0;
-            } else {
-                sumScore += (v.dot(centroid) / denom);
+    // Reads the index saved for the keys, or returns false if it was built over other keys or another model, or if
+    // the file cannot be read: an index of an older version or a damaged one is rebuilt like a stale one.
+    bool LoadSynonymIndex(const std::string& filename, const std::vector<std::string_view>& keys, HnswIndex& index)
+    {
+        try {
+            BinaryReader reader(filename, kSynonymIndexMagic, kSynonymIndexVersion);
+            const std::string_view modelIdentity = reader.ReadStringView();
+            if (modelIdentity != Embedding::GetModelIdentity()) {
+                Logger::log("PhrasesStorage", LogLevel::Info,
+                            "Synonym index " + filename + " was built with another model, it is rebuilt");
+                return false;
+            }
+            if (reader.Read<uint64_t>() != keys.size()) {
+                return false;
             }
-        } else {
-            // Евклидова метрика -> пусть centrality = 1 / (1 + dist)
-            double dist = (v - centroid).norm();
-            sumScore += 1.0 / (1.0 + dist);
+            for (std::string_view key : keys) {
+                if (reader.ReadStringView() != key) {
+                    return false;
+                }
+            }
+            index.Load(reader);
+        } catch (const std::exception& ex) {
+            Logger::log("PhrasesStorage", LogLevel::Warning,
+                        "Synonym index " + filename + " cannot be read (" + ex.what() + "), it is rebuilt");
+            return false;
         }
+        return index.Size() == keys.size();
     }
 
-    return sumScore / static_cast<double>(lemmaVectors.size());
+    void SaveSynonymIndex(const std::string& filename, const std::vector<std::string_view>& keys,
+                          const HnswIndex& index)
+    {
+        BinaryWriter writer(filename, kSynonymIndexMagic, kSynonymIndexVersion);
+        writer.WriteString(Embedding::GetModelIdentity());
+        writer.Write(static_cast<uint64_t>(keys.size()));
+        for (std::string_view key : keys) {
+            writer.WriteString(key);
+        }
+        index.Save(writer);
+        writer.Close();
+    }
 }
 
-void PatternPhrasesStorage::CalculateLSAMetrics(const Eigen::MatrixXd& U, const std::vector<std::string>& words,
-                                                const Eigen::MatrixXd& Sigma, const LSA_MetricsConfig& config)
+void PatternPhrasesStorage::FindSynonyms(const std::string& indexPath)
 {
-    Logger::log("PhrasesStorage", LogLevel::Info, "Updating cluster metrics with advanced LSA approach...");
+    Logger::log("PhrasesStorage", LogLevel::Info, "Finding synonyms of clusters...");
 
-    for (auto& clusterPair : clusters) {
-        auto& cluster = clusterPair.second;
-
-        cluster.topicRelevance = CalculateTopicRelevance(cluster, U, Sigma, words, config);
+    // Ids of the index follow the sorted keys, so that a saved index can be matched with the clusters
+    std::vector<std::pair<std::string_view, WordComplexCluster*>> sortedClusters;
+    sortedClusters.reserve(clusters.size());
+    for (auto& [key, cluster] : clusters) {
+        sortedClusters.emplace_back(key, &cluster);
+    }
+    std::sort(sortedClusters.begin(), sortedClusters.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    std::vector<std::string_view> keys;
+    keys.reserve(sortedClusters.size());
+    for (const auto& sortedCluster : sortedClusters) {
+        keys.push_back(sortedCluster.first);
+    }
 
-        cluster.centralityScore = CalculateCentrality(cluster, U, Sigma, words, config);
+    const std::vector<std::vector<uint32_t>> synonyms = FindKeySynonyms(keys, indexPath);
+    for (size_t id = 0; id < keys.size(); ++id) {
+        WordComplexCluster& cluster = *sortedClusters[id].second;
+        cluster.synonyms.clear();
+        for (uint32_t synonymId : synonyms[id]) {
+            cluster.synonyms.emplace(keys[synonymId]);
+        }
     }
 }
 
-void PatternPhrasesStorage::ComputeTextMetrics()
+std::vector<std::vector<uint32_t>> PatternPhrasesStorage::FindKeySynonyms(const std::vector<std::string_view>& keys,
+                                                                          const std::string& indexPath)
 {
-    Logger::log("PhrasesStorage", LogLevel::Info, "Computing text metrics...");
-    const auto corpus = TextCorpus::GetCorpus();
-    int totalDocuments = corpus.GetTotalDocuments();
-    const auto& topicVectors = GetTopicVectors();
-    static std::unordered_map<std::string, std::vector<std::string>> totalTopics;
-    auto& options = PhrasesCollectorUtils::Options::getOptions();
-
-    for (auto& clusterPair : clusters) {
-        auto& cluster = clusterPair.second;
-
-        cluster.tf.resize(cluster.phraseSize, 0.0);
-        cluster.idf.resize(cluster.phraseSize, 0.0);
-        cluster.tfidf.resize(cluster.phraseSize, 0.0);
-
-        for (size_t i = 0; i < cluster.phraseSize; ++i) {
-            const std::string& lemma = cluster.lemmas[i];
-            cluster.tf[i] = corpus.CalculateTF(lemma);
-            cluster.idf[i] = corpus.CalculateIDF(lemma);
-            cluster.tfidf[i] = cluster.tf[i] * cluster.idf[i];
-        }
-
-        const WordEmbeddingPtr& myEmbedding = std::make_shared<WordEmbedding>(cluster.key);
-        std::vector<std::string> topics;
-        float cosineWeight = 0.6;
-        float euclideanWeight = 0.2;
-        float manhattanWeight = 0.2;
-
-        for (const auto& topicVecPair : topicVectors) {
-            const std::string& topicWord = topicVecPair.first;
-            const WordEmbeddingPtr& topicEmbedding = topicVecPair.second;
-
-            float cosineSim = myEmbedding->CosineSimilarity(*topicEmbedding);
-            float euclideanDist = myEmbedding->EuclideanDistance(*topicEmbedding);
-            float manhattanDist = myEmbedding->ManhattanDistance(*topicEmbedding);
-
-            float combinedScore = cosineWeight * cosineSim + euclideanWeight * (1.0f / (1.0f + euclideanDist)) +
-                                  manhattanWeight * (1.0f / (1.0f + manhattanDist));
+    const auto& options = PhrasesCollectorUtils::Options::getOptions();
+    const size_t threadsCount = ResolveThreadsCount(options.threadsCount);
 
-            if (combinedScore > options.topicsThreshold) {
-                topics.push_back(topicWord);
-            }
-            totalTopics[cluster.key] = topics;
+    std::vector<std::vector<uint32_t>> synonyms(keys.size());
+    if (keys.empty()) {
+        return synonyms;
+    }
+    std::vector<const float*> keyRows(keys.size());
+    ParallelForChunks(keys.size(), kClustersPerChunk, threadsCount, [&](size_t, size_t begin, size_t end) {
+        for (size_t id = begin; id < end; ++id) {
+            keyRows[id] = WordEmbedding(std::string(keys[id])).Data();
         }
+    });
+
+    HnswIndex index;
+    if (!fs::exists(indexPath) || !LoadSynonymIndex(indexPath, keys, index)) {
+        index.Build(keyRows, WordEmbedding(std::string(keys.front())).Size(), threadsCount);
+        SaveSynonymIndex(indexPath, keys, index);
+        Logger::log("PhrasesStorage", LogLevel::Info,
+                    "Built the synonym index over " + std::to_string(keys.size()) + " cluster keys");
     }
-    int frequencyThreshold = static_cast<int>(clusters.size() * options.freqTresholdCoeff);
-    ApplyTopicFrequencyPenalty(totalTopics, frequencyThreshold);
-    for (auto& clusterPair : clusters) {
-        auto& cluster = clusterPair.second;
-        if (const auto& iter = totalTopics.find(clusterPair.first); iter != totalTopics.end()) {
-            if (iter->second.size() > 0 && iter->second.size() < options.tresholdTopicsCount) {
-                cluster.tagMatch = true;
+
+    // The key itself is usually the nearest neighbour, so one more neighbour is requested and the key is skipped
+    const size_t synonymsCount = static_cast<size_t>(std::max(options.synonymsCount, 0));
+    const size_t neighborsCount = synonymsCount + 1;
+    std::vector<size_t> chunkLinks(ChunksCount(keys.size(), kClustersPerChunk), 0);
+    ParallelForChunks(keys.size(), kClustersPerChunk, threadsCount, [&](size_t chunk, size_t begin, size_t end) {
+        for (size_t id = begin; id < end; ++id) {
+            std::vector<uint32_t>& keySynonyms = synonyms[id];
+            for (const auto& neighbor :
+                 index.Search(keyRows[id], neighborsCount, std::max(kSynonymSearchEf, neighborsCount))) {
+                // The search may miss the key itself, then the last neighbour is one too many
+                if (keySynonyms.size() == synonymsCount) {
+                    break;
+                }
+                if (neighbor.id != id && neighbor.similarity >= options.synonymsThreshold) {
+                    keySynonyms.push_back(neighbor.id);
+                }
             }
+            std::sort(keySynonyms.begin(), keySynonyms.end());
+            chunkLinks[chunk] += keySynonyms.size();
         }
+    });
+
+    size_t links = 0;
+    for (size_t chunkCount : chunkLinks) {
+        links += chunkCount;
     }
+    Logger::log("PhrasesStorage", LogLevel::Info,
+                "Found " + std::to_string(links) + " synonyms of " + std::to_string(keys.size()) + " clusters");
+    return synonyms;
 }
 
 void PatternPhrasesStorage::MergeSimilarClusters()
@@ -792,13 +1126,12 @@ void PatternPhrasesStorage::LoadWikiWNRelations()
                         const WordEmbeddingPtr& myEmbedding = std::make_shared<WordEmbedding>(hyp);
                         const auto& topicVectors = GetTopicVectors();
 
+                        // One topic above the threshold is enough to keep the hyponym
                         for (const auto& topicVecPair : topicVectors) {
-                            const std::string& topicWord = topicVecPair.first;
                             const WordEmbeddingPtr& topicEmbedding = topicVecPair.second;
-
-                            float cosineSim = myEmbedding->CosineSimilarity(*topicEmbedding);
-                            if (cosineSim > options.topicsHyponymThreshold) {
+                            if (myEmbedding->Compare(*topicEmbedding).cosine > options.topicsHyponymThreshold) {
                                 validHyponyms.insert(hyp);
+                                break;
                             }
                         }
                     }
@@ -810,12 +1143,64 @@ void PatternPhrasesStorage::LoadWikiWNRelations()
     }
 }
 
+json PatternPhrasesStorage::ClusterToJson(const WordComplexCluster& cluster) const
+{
+    double phrasesCount = static_cast<double>(cluster.wordComplexes.size());
+
+    json clusterJson;
+    clusterJson["0_phrase_size"] = cluster.phraseSize;
+    clusterJson["1_frequency"] = phrasesCount / static_cast<double>(options.textToProcessCount);
+    clusterJson["2_topic_relevance"] = cluster.topicRelevance;
+    clusterJson["3_centrality_score"] = cluster.centralityScore;
+    clusterJson["4_tag_match"] = cluster.tagMatch;
+    clusterJson["5_model_name"] = cluster.modelName;
+
+    std::vector<std::string> synonymsJson(cluster.synonyms.begin(), cluster.synonyms.end());
+    clusterJson["9_synonyms"] = synonymsJson;
+
+    std::vector<json> lemmasJson;
+    for (size_t i = 0; i < cluster.lemmas.size(); ++i) {
+        json lemmaJson;
+        std::string lemmaStrNumbered = std::to_string(i) + "_" + cluster.lemmas[i];
+        lemmaJson["0_lemma"] = lemmaStrNumbered;
+        lemmaJson["1_tf"] = cluster.tf[i];
+        lemmaJson["2_idf"] = cluster.idf[i];
+        lemmaJson["3_tf-idf"] = cluster.tfidf[i];
+        lemmaJson["4_hypernyms"] = cluster.hypernyms.at(cluster.lemmas[i]);
+        lemmaJson["5_hyponyms"] = cluster.hyponyms.at(cluster.lemmas[i]);
+        lemmasJson.push_back(lemmaJson);
+    }
+    clusterJson["6_lemmas"] = lemmasJson;
+
+    clusterJson["7_phrases_count"] = phrasesCount;
+    const auto& sentences = TokenizedSentenceCorpus::GetCorpus();
+    std::vector<json> phrases;
+    for (const auto& wordComplex : cluster.wordComplexes) {
+        json phraseJson;
+        phraseJson["0_text_form"] = wordComplex->textForm;
+        phraseJson["1_position"] = {{"0_start", wordComplex->pos.start},
+                                    {"1_end", wordComplex->pos.end},
+                                    {"2_doc_num", wordComplex->pos.docNum},
+                                    {"3_sent_num", wordComplex->pos.sentNum}};
+
+        // The sentence of the phrase is its context if the context was attached to the cluster
+        const auto sentenceId = sentences.FindSentenceId(wordComplex->pos.docNum, wordComplex->pos.sentNum);
+        if (sentenceId && std::binary_search(cluster.contextIds.begin(), cluster.contextIds.end(), *sentenceId)) {
+            phraseJson["2_context"] = std::string(sentences.GetSentenceById(*sentenceId).originalStr);
+        }
+
+        phrases.push_back(phraseJson);
+    }
+    clusterJson["8_phrases"] = phrases;
+
+    return clusterJson;
+}
+
 void PatternPhrasesStorage::OutputClustersToJsonFile(const std::string& filename, bool mergeNestedClusters,
                                                      bool termsOnly) const
 {
     Logger::log("PhrasesStorage", LogLevel::Info, "Outputting clusters to JSON file: " + filename);
 
-    json j;
     std::vector<std::string> keys;
 
     if (termsOnly) {
@@ -833,80 +1218,88 @@ void PatternPhrasesStorage::OutputClustersToJsonFile(const std::string& filename
 
     std::sort(keys.begin(), keys.end());
 
-    json* previousClusterJson = nullptr;
-    std::string previousKey;
-
-    for (const auto& key : keys) {
-        const auto& cluster = clusters.at(key);
-        double phrasesCount = static_cast<double>(cluster.wordComplexes.size());
+    // A top-level cluster is written together with the clusters nested into it (keys that start with its key), so
+    // the sorted keys are split into such groups first. Groups are independent and are serialized in parallel.
+    std::vector<size_t> groupBegins;
+    std::string_view previousKey;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const std::string_view key = keys[i];
+        if (mergeNestedClusters && !groupBegins.empty() && key.substr(0, previousKey.size()) == previousKey) {
+            continue;
+        }
+        groupBegins.push_back(i);
+        previousKey = key;
+    }
+    const size_t groupsCount = groupBegins.size();
+    groupBegins.push_back(keys.size());
 
-        json clusterJson;
-        clusterJson["0_phrase_size"] = cluster.phraseSize;
-        clusterJson["1_frequency"] = phrasesCount / static_cast<double>(options.textToProcessCount);
-        clusterJson["2_topic_relevance"] = cluster.topicRelevance;
-        clusterJson["3_centrality_score"] = cluster.centralityScore;
-        clusterJson["4_tag_match"] = cluster.tagMatch;
-        clusterJson["5_model_name"] = cluster.modelName;
+    std::ofstream outFile(filename, std::ios::binary);
+    if (!outFile.is_open()) {
+        throw std::runtime_error("Could not open file for writing");
+    }
 
-        std::vector<std::string> synonymsJson(cluster.synonyms.begin(), cluster.synonyms.end());
-        clusterJson["9_synonyms"] = synonymsJson;
+    // The output matches json::dump of the whole object: pretty output puts every member on its own line with an
+    // indent of 4, compact output has no whitespace
+    const bool pretty = options.prettyJson;
+    auto appendGroup = [&](std::string& buffer, size_t group) {
+        const size_t begin = groupBegins[group];
+        const size_t end = groupBegins[group + 1];
+
+        json clusterJson = ClusterToJson(clusters.at(keys[begin]));
+        for (size_t i = begin + 1; i < end; ++i) {
+            json nestedClusterJson = ClusterToJson(clusters.at(keys[i]));
+            nestedClusterJson["00_key"] = keys[i]; // Add the key to the nested cluster
+            clusterJson["nested_clusters"].push_back(std::move(nestedClusterJson));
+        }
 
-        std::vector<json> lemmasJson;
-        for (size_t i = 0; i < cluster.lemmas.size(); ++i) {
-            json lemmaJson;
-            std::string lemmaStrNumbered = std::to_string(i) + "_" + cluster.lemmas[i];
-            lemmaJson["0_lemma"] = lemmaStrNumbered;
-            lemmaJson["1_tf"] = cluster.tf[i];
-            lemmaJson["2_idf"] = cluster.idf[i];
-            lemmaJson["3_tf-idf"] = cluster.tfidf[i];
-            lemmaJson["4_hypernyms"] = cluster.hypernyms.at(cluster.lemmas[i]);
-            lemmaJson["5_hyponyms"] = cluster.hyponyms.at(cluster.lemmas[i]);
-            lemmasJson.push_back(lemmaJson);
-        }
-        clusterJson["6_lemmas"] = lemmasJson;
-
-        clusterJson["7_phrases_count"] = phrasesCount;
-        std::vector<json> phrases;
-        for (const auto& wordComplex : cluster.wordComplexes) {
-            json phraseJson;
-            phraseJson["0_text_form"] = wordComplex->textForm;
-            phraseJson["1_position"] = {{"0_start", wordComplex->pos.start},
-                                        {"1_end", wordComplex->pos.end},
-                                        {"2_doc_num", wordComplex->pos.docNum},
-                                        {"3_sent_num", wordComplex->pos.sentNum}};
-
-            for (const auto& contextSentence : cluster.contexts) {
-                const TokenizedSentence& context = contextSentence;
-
-                if (context.docNum == wordComplex->pos.docNum && context.sentNum == wordComplex->pos.sentNum) {
-                    phraseJson["2_context"] = context.originalStr;
-                    break;
-                }
+        if (group > 0) {
+            buffer += ',';
+        }
+        if (!pretty) {
+            buffer += json(keys[begin]).dump();
+            buffer += ':';
+            buffer += clusterJson.dump();
+            return;
+        }
+        buffer += "\n    ";
+        buffer += json(keys[begin]).dump();
+        buffer += ": ";
+        // Shift the nested lines of the member by one level, as the enclosing object would
+        const std::string value = clusterJson.dump(4);
+        for (char c : value) {
+            buffer += c;
+            if (c == '\n') {
+                buffer += "    ";
             }
-
-            phrases.push_back(phraseJson);
         }
-        clusterJson["8_phrases"] = phrases;
-
-        // If mergeNestedClusters is true, check for substring relation with the previous key
-        if (mergeNestedClusters && previousClusterJson && key.find(previousKey) == 0) {
-            // If the key starts with the previous key, treat it as a nested cluster
-            json nestedClusterJson = clusterJson;
-            nestedClusterJson["00_key"] = key; // Add the key to the nested cluster
-            (*previousClusterJson)["nested_clusters"].push_back(nestedClusterJson);
-        } else {
-            // Save current clusterJson for potential nesting in the next iteration
-            j[key] = clusterJson;
-            previousClusterJson = &j[key];
-            previousKey = key;
+    };
+
+    // Chunks of groups are serialized into separate buffers and written in order; only one window of chunks is kept
+    // in memory at a time
+    constexpr size_t kGroupsPerChunk = 256;
+    const size_t threadsCount = ResolveThreadsCount(options.threadsCount);
+    const size_t chunksCount = (groupsCount + kGroupsPerChunk - 1) / kGroupsPerChunk;
+    const size_t chunksPerWindow = threadsCount * 4;
+
+    outFile << '{';
+    std::vector<std::string> buffers;
+    for (size_t windowBegin = 0; windowBegin < chunksCount; windowBegin += chunksPerWindow) {
+        buffers.assign(std::min(chunksPerWindow, chunksCount - windowBegin), std::string());
+        ParallelFor(buffers.size(), threadsCount, [&](size_t i) {
+            const size_t firstGroup = (windowBegin + i) * kGroupsPerChunk;
+            const size_t lastGroup = std::min(firstGroup + kGroupsPerChunk, groupsCount);
+            for (size_t group = firstGroup; group < lastGroup; ++group) {
+                appendGroup(buffers[i], group);
+            }
+        });
+        for (const auto& buffer : buffers) {
+            outFile.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
         }
     }
+    outFile << (pretty && groupsCount > 0 ? "\n}" : "}");
 
-    std::ofstream outFile(filename);
-    if (!outFile.is_open()) {
-        throw std::runtime_error("Could not open file for writing");
-    }
-
-    outFile << j.dump(4);
     outFile.close();
-}
\ No newline at end of file
+    if (!outFile) {
+        throw std::runtime_error("Failed to write file: " + filename);
+    }
+}
@@ -5,6 +5,7 @@
 #include <Embedding.h>
 #include <LSA.h>
 #include <SemanticRelations.h>
+#include <ShardedMap.h>
 #include <TextCorpus.h>
 #include <ThreadController.h>
 #include <regex>
@@ -14,6 +15,8 @@
 #include <algorithm>
 #include <condition_variable>
 #include <mutex>
+#include <optional>
+#include <string_view>
 
 using namespace PhrasesCollectorUtils;
 // using CoOccurrenceMap = std::unordered_map<std::string, std::unordered_map<std::string, int>>;
@@ -34,12 +37,50 @@ struct WordComplexCluster {
     std::vector<double> tf;                                           ///< Vector of TF values for the words.
     std::vector<double> idf;                                          ///< Vector of IDF values for the words.
     std::vector<double> tfidf;                                        ///< Vector of TF-IDF values for the words.
-    std::vector<WordEmbeddingPtr> wordVectors;                        ///< Vector of FastText vectors for the words.
+    std::vector<uint32_t> lemmaIds;                                   ///< Ids of the lemmas in LemmaDictionary.
     std::unordered_map<std::string, std::set<std::string>> hypernyms; ///< Hypernyms for each word in the phrase.
     std::unordered_map<std::string, std::set<std::string>> hyponyms;  ///< Hyponyms for each word in the phrase.
     std::unordered_set<std::string> synonyms;
-    std::vector<TokenizedSentence> contexts;
+    std::vector<uint32_t> contextIds; ///< Sorted ids of the context sentences in TokenizedSentenceCorpus.
     bool is_term;
+
+    // \brief Returns the FastText vector of a lemma, computing it on the first request in the process.
+    WordEmbeddingPtr GetWordVector(size_t lemmaInd) const
+    {
+        return LemmaEmbeddings::GetInstance().GetEmbedding(lemmaIds[lemmaInd]);
+    }
+};
+
+// \struct ClusterColumns
+// \brief Columnar side store of the numeric cluster fields that the metric passes work on. Clusters get dense ids;
+//        every cluster field is a vector indexed by the id, and the lemmas of cluster i occupy the slots
+//        [lemmaBegins[i], lemmaBegins[i + 1]) of the per-lemma vectors. Passes run as tight loops over these vectors
+//        instead of walking the clusters, and the results are stored back into the clusters afterwards.
+struct ClusterColumns {
+    std::vector<const std::string*> keys;      ///< Key of every cluster id.
+    std::vector<WordComplexCluster*> clusters; ///< Cluster of every id.
+    std::vector<double> frequency;
+    std::vector<double> topicRelevance;
+    std::vector<double> centralityScore;
+    std::vector<uint8_t> tagMatch;
+    std::vector<size_t> lemmaBegins; ///< First lemma slot of every id, followed by the total number of slots.
+    std::vector<uint32_t> lemmaIds;  ///< Lemma of every slot as an id in LemmaDictionary.
+    std::vector<double> tf;          ///< TF of every slot.
+    std::vector<double> idf;         ///< IDF of every slot.
+    std::vector<double> tfidf;       ///< TF-IDF of every slot.
+
+    size_t Size() const
+    {
+        return clusters.size();
+    }
+};
+
+// \struct DocumentContext
+// \brief Per-document state of phrase collection. Each document collected concurrently owns its own context, so
+//        the storage itself keeps no state about the document currently being processed.
+struct DocumentContext {
+    int documentId = -1;                                 ///< Number of the document the context belongs to.
+    std::unordered_map<std::string, int> lemmaFrequency; ///< Frequencies of the lemmas in the document so far.
 };
 
 // \class PatternPhrasesStorage
@@ -47,6 +88,8 @@ struct WordComplexCluster {
 //        adding word complexes, computing text metrics, and outputting data to text and JSON files.
 class PatternPhrasesStorage {
 public:
+    using ClusterMap = ShardedMap<std::string, WordComplexCluster>;
+
     // \brief Gets the singleton instance of PatternPhrasesStorage.
     // \return          Reference to the singleton instance of PatternPhrasesStorage.
     static PatternPhrasesStorage& GetStorage()
@@ -57,10 +100,46 @@ public:
 
     void AddCluster(const std::string& key, const WordComplexCluster& cluster);
 
+    // \brief Thread-safe insert or update of a cluster: calls update(cluster) under the lock of the cluster's shard,
+    //        creating the cluster with create() first if the key is new.
+    template <typename CreateFn, typename UpdateFn>
+    void UpsertCluster(const std::string& key, CreateFn&& create, UpdateFn&& update)
+    {
+        clusters.Upsert(key, std::forward<CreateFn>(create), std::forward<UpdateFn>(update));
+    }
+
+    // \brief Thread-safe: adds a collected phrase to the cluster of its key, creating the cluster if needed.
+    // \param key       Normalized key of the phrase.
+    // \param wc        The phrase; it should not hold word forms, only text, position and lemmas.
+    void AddWordComplex(const std::string& key, const WordComplexPtr& wc);
+
+    // \brief Writes the collected clusters (keys, lemmas and phrases, without metrics) to a binary snapshot, which
+    //        LoadClustersSnapshot of PhrasesStorageLoader reads back. Clusters and phrases are written in a sorted
+    //        order, so the file does not depend on the number of threads used for collection.
+    void SaveClustersSnapshot(const std::string& filename) const;
+
+    static constexpr std::string_view kSnapshotMagic = "ATTCLUST";
+    static constexpr uint32_t kSnapshotVersion = 1;
+
+    // \brief Saves the clusters with all their metrics and relations in the binary format of StorageSnapshot, which
+    //        later commands load instead of parsing the JSON output.
+    void SaveStorageSnapshot(const std::string& filename) const;
+
     void ReserveClusters(size_t count);
 
     WordComplexCluster* FindCluster(const std::string& key);
 
+    // \brief Thread-safe: the JSON object of the cluster as written by OutputClustersToJsonFile, if the key exists.
+    std::optional<json> FindClusterJson(const std::string& key) const;
+
+    // \brief Thread-safe: builds the JSON object of a cluster as written by OutputClustersToJsonFile, also for clusters
+    //        that are not in the storage, e.g. materialized from a StorageSnapshot.
+    json ClusterToJson(const WordComplexCluster& cluster) const;
+
+    // \brief Removes all clusters and the cached relations, so that a long-running process can load the storage
+    //        again before the next command.
+    void Clear();
+
     void AddContextsToClusters();
 
     void MergeSimilarClusters();
@@ -69,15 +148,33 @@ public:
                         bool CheckFirstOnly = false);
 
     // \brief Collects phrases from the provided word forms and process.
+    //        Safe to call concurrently for different documents, each with its own context.
     // \param forms     A vector of WordFormPtr representing the sentence to analyze.
     // \param process   The process used for phrase collection.
-    void Collect(const std::vector<WordFormPtr>& forms, Process& process);
+    // \param context   State of the document the sentence belongs to.
+    void Collect(const std::vector<WordFormPtr>& forms, Process& process, DocumentContext& context);
 
-    void FinalizeDocumentProcessing();
+    // \brief Merges the lemma frequencies of the document into the TextCorpus and resets the context.
+    void FinalizeDocumentProcessing(DocumentContext& context);
 
     // \brief Computes text metrics such as TF, IDF, and TF-IDF for the stored word complexes.
     void ComputeTextMetrics();
 
+    // \brief Fills the synonyms of every cluster with the keys of its Options::synonymsCount nearest clusters whose
+    //        key embeddings have a cosine similarity of at least Options::synonymsThreshold. Neighbours are found
+    //        with an HNSW index over the key embeddings, which is saved to the file and reused while the cluster keys
+    //        and the embedding model stay the same.
+    // \param indexPath     Path to the index file.
+    void FindSynonyms(const std::string& indexPath);
+
+    // \brief Finds the synonyms of the keys as FindSynonyms does for the cluster keys, for callers that only read the
+    //        keys, such as the key column of a StorageSnapshot.
+    // \param keys          Keys sorted in ascending order.
+    // \param indexPath     Path to the index file.
+    // \return              Indices in keys of the synonyms of every key, in ascending order.
+    static std::vector<std::vector<uint32_t>> FindKeySynonyms(const std::vector<std::string_view>& keys,
+                                                              const std::string& indexPath);
+
     // Сalculates topicRelevance and centralityScore metrics for all clusters after an LSA analysis.
     void CalculateLSAMetrics(const Eigen::MatrixXd& U, const std::vector<std::string>& words,
                              const Eigen::MatrixXd& Sigma, const LSA_MetricsConfig& config);
@@ -86,31 +183,40 @@ public:
     void CalculateLSAMetrics(const MatrixXd& U, const std::vector<std::string>& words,
                              const std::unordered_map<int, std::vector<std::string>>& topics);
 
-    // \brief Outputs the clusters to a JSON file.
-    // \param filename  The path to the output JSON file.
+    // \brief Outputs the clusters to a JSON file. Clusters are serialized in sorted key order by several threads and
+    //        streamed to the file chunk by chunk, without building the whole document in memory. The output is
+    //        indented if Options::prettyJson is set and compact otherwise.
+    // \param filename              The path to the output JSON file.
+    // \param mergeNestedClusters   Write clusters whose key starts with the key of the previous top-level cluster
+    //                              into its "nested_clusters" array.
+    // \param termsOnly             Write only the clusters selected as terms.
     void OutputClustersToJsonFile(const std::string& filename, bool mergeNestedClusters = false,
                                   bool termsOnly = false) const;
 
     void LoadWikiWNRelations();
 
     void EvaluateTermRelevance(const LSA& lsa);
-    const std::unordered_map<std::string, WordComplexCluster> GetClusters() const;
+
+    // \brief Read-only view of all clusters without copying them. The view supports find, at, count and iteration
+    //        over (key, cluster) pairs; it must not be used while other threads add clusters.
+    const ClusterMap& GetClusters() const
+    {
+        return clusters;
+    }
+
+    // \brief Deep copy of all clusters, for the rare callers that need them isolated from later changes.
+    std::unordered_map<std::string, WordComplexCluster> SnapshotClusters() const;
 
     void CollectTerms(double tfidfThreshold = 0.0000088);
 
     ThreadController threadController; ///< Controller for managing thread synchronization.
 
 private:
-    // Topic relevance calculation for a cluster based on row vectors U (and optionally Sigma) using the "max^2 /
-    // sum^2" method
-    static double CalculateTopicRelevance(const WordComplexCluster& cluster, const Eigen::MatrixXd& U,
-                                          const Eigen::MatrixXd& Sigma, const std::vector<std::string>& words,
-                                          const LSA_MetricsConfig& config);
+    // Copies the numeric fields and lemma ids of all clusters into columns indexed by cluster id.
+    ClusterColumns BuildClusterColumns();
 
-    // Centrality score calculation through the mean cosine or through the Euclidean measure
-    static double CalculateCentrality(const WordComplexCluster& cluster, const Eigen::MatrixXd& U,
-                                      const Eigen::MatrixXd& Sigma, const std::vector<std::string>& words,
-                                      const LSA_MetricsConfig& config);
+    // Writes the metrics computed in the columns back into the clusters.
+    void StoreClusterColumns(const ClusterColumns& columns);
 
     // Proportion of cluster lemmas that occur among the top words for the identified topics
     double CalculateTopicRelevance(const WordComplexCluster& cluster,
@@ -122,6 +228,7 @@ private:
 
 private:
     Options& options = Options::getOptions();
+
     void InitializeAndFilterClusters(double tfidfThreshold, std::set<std::string>& sortedKeys,
                                      std::unordered_set<std::string>& clustersToInclude);
 
@@ -146,15 +253,12 @@ private:
     {
     }
 
-    int lastDocumentId = -1;
-    std::unordered_set<std::string> uniqueLemmasInDoc;
-
     // \brief Deleted copy constructor to enforce singleton pattern.
     PatternPhrasesStorage(const PatternPhrasesStorage&) = delete;
 
     // \brief Deleted assignment operator to enforce singleton pattern.
     PatternPhrasesStorage& operator=(const PatternPhrasesStorage&) = delete;
-    std::unordered_map<std::string, WordComplexCluster> clusters; ///< Map of word complex clusters.
+    ClusterMap clusters; ///< Map of word complex clusters.
 };
 
 #endif // PATTERN_PHRASES_STORAGE_H
@@ -0,0 +1,67 @@
+#include <PatternProfiler.h>
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+
+using json = nlohmann::json;
+
+void PatternProfiler::Enable(const GrammarPatternManager& manager)
+{
+    stats.clear();
+    for (const auto& [name, model] : manager.getSimplePatterns()) {
+        stats[name] = std::make_unique<PatternStats>();
+    }
+    for (const auto& [name, model] : manager.getComplexPatterns()) {
+        auto patternStats = std::make_unique<PatternStats>();
+        patternStats->isComplex = true;
+        stats[name] = std::move(patternStats);
+    }
+    enabled = true;
+
+    Logger::log("PatternProfiler", LogLevel::Info,
+                "Pattern profiling enabled for " + std::to_string(stats.size()) + " patterns.");
+}
+
+void PatternProfiler::WriteReport(const std::string& filename) const
+{
+    if (!enabled) {
+        return;
+    }
+
+    json j = json::object();
+    size_t neverFired = 0;
+
+    for (const auto& [name, patternStats] : stats) {
+        const uint64_t attempts = patternStats->attempts.load(std::memory_order_relaxed);
+        const uint64_t headPassed = patternStats->headPassed.load(std::memory_order_relaxed);
+        const uint64_t matches = patternStats->matches.load(std::memory_order_relaxed);
+        const double checkAsideMs = patternStats->checkAsideNs.load(std::memory_order_relaxed) / 1e6;
+
+        json patternJson;
+        patternJson["0_type"] = patternStats->isComplex ? "complex" : "simple";
+        patternJson["1_attempts"] = attempts;
+        patternJson["2_head_passed"] = headPassed;
+        patternJson["3_matches"] = matches;
+        patternJson["4_check_aside_ms"] = checkAsideMs;
+        patternJson["5_ms_per_match"] = matches ? checkAsideMs / static_cast<double>(matches) : 0.0;
+        j[name] = patternJson;
+
+        if (matches == 0) {
+            ++neverFired;
+            Logger::log("PatternProfiler", LogLevel::Info, "Pattern never fired: " + name);
+        }
+    }
+
+    std::ofstream outFile(filename);
+    if (!outFile.is_open()) {
+        Logger::log("PatternProfiler", LogLevel::Error, "Could not open profile report file: " + filename);
+        return;
+    }
+    outFile << j.dump(4);
+    outFile.close();
+
+    Logger::log("PatternProfiler", LogLevel::Info,
+                "Pattern profile written to " + filename + " (" + std::to_string(neverFired) + " of " +
+                    std::to_string(stats.size()) + " patterns never fired).");
+}
@@ -0,0 +1,102 @@
+#ifndef PATTERN_PROFILER_H
+#define PATTERN_PROFILER_H
+
+#include <GrammarPatternManager.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// \struct PatternStats
+// \brief Counters collected for a single grammar pattern. All fields are updated with relaxed atomics so the same
+//        instance can be shared between collectors running in different threads.
+struct PatternStats {
+    std::atomic<uint64_t> attempts{0};     ///< How many times the pattern was tried.
+    std::atomic<uint64_t> headPassed{0};   ///< How many times the head check of the pattern succeeded.
+    std::atomic<uint64_t> matches{0};      ///< How many phrases the pattern emitted.
+    std::atomic<uint64_t> checkAsideNs{0}; ///< Cumulative time spent in CheckAside recursion, in nanoseconds.
+    bool isComplex = false;                ///< Indicates if the pattern belongs to the complex patterns.
+};
+
+// \class PatternProfiler
+// \brief This class collects per-pattern hit, miss and latency statistics for both phrase collectors.
+//        When profiling is disabled GetStats returns nullptr and every helper below degrades to a single branch.
+class PatternProfiler {
+public:
+    // \brief Gets the singleton instance of PatternProfiler.
+    static PatternProfiler& GetProfiler()
+    {
+        static PatternProfiler profiler;
+        return profiler;
+    }
+
+    // \brief Registers all simple and complex patterns of the manager and enables profiling.
+    //        Registration happens once, so lookups during collection never modify the map.
+    void Enable(const GrammarPatternManager& manager);
+
+    bool IsEnabled() const
+    {
+        return enabled;
+    }
+
+    // \brief Returns the counters of the pattern, or nullptr if profiling is disabled or the pattern is unknown.
+    PatternStats* GetStats(const std::string& pattern) const
+    {
+        if (!enabled) {
+            return nullptr;
+        }
+        auto it = stats.find(pattern);
+        return it != stats.end() ? it->second.get() : nullptr;
+    }
+
+    static void Add(PatternStats* patternStats, std::atomic<uint64_t> PatternStats::*counter, uint64_t value = 1)
+    {
+        if (patternStats && value) {
+            (patternStats->*counter).fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+
+    // \brief Writes the collected statistics to a JSON file, sorted by pattern name.
+    void WriteReport(const std::string& filename) const;
+
+    // \class ScopedTimer
+    // \brief Adds the lifetime of the object to the checkAsideNs counter of the pattern.
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(PatternStats* patternStats) : patternStats(patternStats)
+        {
+            if (patternStats) {
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~ScopedTimer()
+        {
+            if (patternStats) {
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                patternStats->checkAsideNs.fetch_add(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+            }
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        PatternStats* patternStats;
+        std::chrono::steady_clock::time_point start;
+    };
+
+private:
+    PatternProfiler() = default;
+
+    PatternProfiler(const PatternProfiler&) = delete;
+    PatternProfiler& operator=(const PatternProfiler&) = delete;
+
+    bool enabled = false;
+    std::unordered_map<std::string, std::unique_ptr<PatternStats>> stats; ///< Counters by pattern name.
+};
+
+#endif // PATTERN_PROFILER_H
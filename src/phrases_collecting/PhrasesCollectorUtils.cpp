@@ -16,13 +16,18 @@
 
 #include <GrammarPatternManager.h>
 #include <PatternPhrasesStorage.h>
+#include <PatternProfiler.h>
+#include <ParallelFor.h>
 #include <PhrasesCollectorUtils.h>
 #include <StringFilters.h>
 #include <TokenizedSentenceCorpus.h>
 
 #include <cctype>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <unicode/locid.h>
+#include <unicode/uchar.h>
+#include <unicode/utf8.h>
 #include <unicode/unistr.h>
 #include <unicode/ustream.h>
 
@@ -43,18 +48,42 @@ namespace PhrasesCollectorUtils {
         resDir = corpusDir / "results";
         corpusFile = corpusDir / "corpus";
         filteredCorpusFile = corpusDir / "filtered_corpus";
+        corpusStatisticsPath = corpusDir / "corpus_stats.bin";
         sentencesFile = corpusDir / "sentences.json";
+        sentencesSnapshotPath = corpusDir / "sentences.bin";
         embeddingModelFile = repoPath / "my_custom_fasttext_model_finetuned.bin";
+        embeddingReferenceFile = embeddingModelFile;
+        embeddingOutputFile = repoPath / "my_custom_fasttext_model_finetuned.emb";
         totalResultsPath = corpusDir / "total_results.json";
+        totalResultsSnapshotPath = corpusDir / "total_results.bin";
         termsCandidatesPath = corpusDir / "term_candidates.json";
+        patternProfilePath = corpusDir / "pattern_profile.json";
+        clustersSnapshotPath = corpusDir / "clusters.bin";
+        lsaFactorsPath = corpusDir / "lsa_factors.bin";
+        lemmaEmbeddingsPath = corpusDir / "lemma_embeddings.bin";
+        pipelineSnapshotPath = corpusDir / "pipeline_snapshot.bin";
+        socketPath = corpusDir / "server.sock";
+        synonymIndexPath = corpusDir / "synonym_index.bin";
 
         textToProcessCount = 0;
         tresholdTopicsCount = 7;
         cleanStopWords = true; ///< Indicates if stop words should be cleaned.
         validateBoundaries = true;
+        profilePatterns = false;
+        latticeMatching = false;
+        latticeKBest = 0;
+        dedupSentences = false;
+        threadsCount = 1;
+        writeDocumentResults = false;
+        prettyJson = true;
+        fromSnapshot = false;
+        quantizeEmbeddings = false;
         topicsThreshold = 0.6;
         topicsHyponymThreshold = 0.98;
         freqTresholdCoeff = 0.12;
+        nearDuplicateThreshold = 2.0;
+        synonymsThreshold = 0.85;
+        synonymsCount = 10;
     }
 
     void Options::recomputeCorpusDependenciesPaths()
@@ -65,9 +94,19 @@ namespace PhrasesCollectorUtils {
             resDir = corpusDir / "results";
             corpusFile = corpusDir / "corpus";
             filteredCorpusFile = corpusDir / "filtered_corpus";
+            corpusStatisticsPath = corpusDir / "corpus_stats.bin";
             sentencesFile = corpusDir / "sentences.json";
+            sentencesSnapshotPath = corpusDir / "sentences.bin";
             totalResultsPath = corpusDir / "total_results.json";
+            totalResultsSnapshotPath = corpusDir / "total_results.bin";
             termsCandidatesPath = corpusDir / "term_candidates.json";
+            patternProfilePath = corpusDir / "pattern_profile.json";
+            clustersSnapshotPath = corpusDir / "clusters.bin";
+            lsaFactorsPath = corpusDir / "lsa_factors.bin";
+            lemmaEmbeddingsPath = corpusDir / "lemma_embeddings.bin";
+            pipelineSnapshotPath = corpusDir / "pipeline_snapshot.bin";
+            socketPath = corpusDir / "server.sock";
+            synonymIndexPath = corpusDir / "synonym_index.bin";
         }
     }
 
@@ -160,55 +199,124 @@ namespace PhrasesCollectorUtils {
                     forms.end());
     }
 
-    void ProcessFile(const fs::path& inputFile, const fs::path& outputDir)
+    void BuildDeduplicationPlan(const std::vector<fs::path>& files, DeduplicationPlan& plan)
     {
-        std::string filename = inputFile.filename().replace_extension(".json").string();
-        fs::path outputFile = outputDir / ("res_" + filename);
+        auto& options = PhrasesCollectorUtils::Options::getOptions();
+        SentenceDeduplicator deduplicator(options.nearDuplicateThreshold);
+        plan.fileSentences.resize(files.size());
+
+        for (size_t fileIndex = 0; fileIndex < files.size(); ++fileIndex) {
+            CorpusDocument document(files[fileIndex].string());
+            auto input = document.OpenStream();
+
+            // Must split sentences exactly like ProcessFile does, so the plan lines up with its loop
+            SentenceSplitter ssplitter(*input);
+            do {
+                std::string sentence;
+                ssplitter.readSentence(sentence);
+                if (sentence.empty())
+                    continue;
+                plan.fileSentences[fileIndex].push_back(deduplicator.Add(sentence));
+            } while (!ssplitter.eof());
+        }
 
-        std::ofstream outFile(outputFile);
-        if (!outFile) {
-            Logger::log("ProcessFile", LogLevel::Error, "Failed to create JSON file: " + outputFile.string());
-            return;
+        std::vector<uint32_t> occurrences(deduplicator.ClustersCount());
+        for (uint32_t clusterId = 0; clusterId < deduplicator.ClustersCount(); ++clusterId) {
+            occurrences[clusterId] = deduplicator.OccurrenceCount(clusterId);
+        }
+        plan.analyses.Reset(std::move(occurrences));
+
+        // Near-duplicates are only reported: their analysis is not shared, since it differs from the one they resemble
+        Logger::log("Deduplication", LogLevel::Info,
+                    "Sentences: " + std::to_string(deduplicator.SentencesCount()) +
+                        ", to analyze: " + std::to_string(deduplicator.ClustersCount()) +
+                        ", near-duplicates among them: " + std::to_string(deduplicator.NearDuplicatesCount()));
+    }
+
+    bool IsCollectableKey(const std::string& key)
+    {
+        if (key.find('_') != std::string::npos) {
+            return false;
+        }
+
+        // Decode in place instead of building an icu::UnicodeString for every phrase
+        const auto* data = reinterpret_cast<const uint8_t*>(key.data());
+        const int32_t length = static_cast<int32_t>(key.size());
+        for (int32_t i = 0; i < length;) {
+            UChar32 codepoint;
+            U8_NEXT(data, i, length, codepoint);
+            if (codepoint >= 0 && u_isdigit(codepoint)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void ProcessFile(const CorpusDocument& document, const fs::path& outputDir, DeduplicationPlan* plan,
+                     size_t fileIndex)
+    {
+        const fs::path inputFile = document.GetPath();
+
+        // Phrases go straight into the storage; the per-document JSON is only written on request
+        fs::path outputFile;
+        if (Options::getOptions().writeDocumentResults) {
+            std::string filename = inputFile.filename().replace_extension(".json").string();
+            outputFile = outputDir / ("res_" + filename);
+
+            std::ofstream outFile(outputFile);
+            if (!outFile) {
+                Logger::log("ProcessFile", LogLevel::Error, "Failed to create JSON file: " + outputFile.string());
+                return;
+            }
+            outFile << "[]" << std::endl;
+            Logger::log("ProcessFile", LogLevel::Debug, "Created empty JSON file: " + outputFile.string());
         }
-        outFile << "[]" << std::endl;
-        Logger::log("ProcessFile", LogLevel::Debug, "Created empty JSON file: " + outputFile.string());
 
         Tokenizer tok;
         TFMorphemicSplitter morphemic_splitter;
         Process process(inputFile, outputFile);
-        std::ifstream input(inputFile);
-        if (!input) {
-            Logger::log("ProcessFile", LogLevel::Error, "Failed to open input file: " + inputFile.string());
-            return;
-        }
-        SentenceSplitter ssplitter(input);
+        auto input = document.OpenStream();
+        SentenceSplitter ssplitter(*input);
         Processor analyzer;
         SingleWordDisambiguate disamb;
         TFJoinedModel joiner;
 
+        DocumentContext context;
+        const std::vector<uint32_t>* sentenceClusters = plan ? &plan->fileSentences[fileIndex] : nullptr;
+        size_t sentenceInd = 0;
+
         do {
             std::string sentence;
             ssplitter.readSentence(sentence);
             if (sentence.empty())
                 continue;
 
-            std::vector<TokenPtr> tokens = tok.analyze(UniString(sentence));
-            std::vector<WordFormPtr> forms = analyzer.analyze(tokens);
+            std::optional<uint32_t> clusterId;
+            if (sentenceClusters && sentenceInd < sentenceClusters->size()) {
+                clusterId = (*sentenceClusters)[sentenceInd++];
+            }
 
-            RemoveSeparatorTokens(forms);
-            disamb.disambiguate(forms);
-            joiner.disambiguateAndMorphemicSplit(forms);
+            auto analyze = [&] {
+                std::vector<TokenPtr> tokens = tok.analyze(UniString(sentence));
+                std::vector<WordFormPtr> forms = analyzer.analyze(tokens);
 
-            for (auto& form : forms) {
-                morphemic_splitter.split(form);
-            }
+                RemoveSeparatorTokens(forms);
+                disamb.disambiguate(forms);
+                joiner.disambiguateAndMorphemicSplit(forms);
+
+                for (auto& form : forms) {
+                    morphemic_splitter.split(form);
+                }
+                return forms;
+            };
+            const std::vector<WordFormPtr> forms = clusterId ? plan->analyses.Get(*clusterId, analyze) : analyze();
 
             Logger::log("SentenceReading", LogLevel::Info, "Read sentence: " + sentence);
-            PatternPhrasesStorage::GetStorage().Collect(forms, process);
+            PatternPhrasesStorage::GetStorage().Collect(forms, process, context);
 
             process.sentNum++;
         } while (!ssplitter.eof());
-        PatternPhrasesStorage::GetStorage().FinalizeDocumentProcessing();
+        PatternPhrasesStorage::GetStorage().FinalizeDocumentProcessing(context);
     }
 
     void BuildPhraseStorage()
@@ -220,15 +328,32 @@ namespace PhrasesCollectorUtils {
 
         auto& storage = PatternPhrasesStorage::GetStorage();
         auto& corpus = TextCorpus::GetCorpus();
+        auto& profiler = PatternProfiler::GetProfiler();
+        if (options.profilePatterns) {
+            profiler.Enable(*GrammarPatternManager::GetManager());
+        }
+
         try {
             std::vector<fs::path> files_to_process = GetFilesToProcess();
 
-            for (unsigned int i = 0; i < files_to_process.size(); ++i) {
-                corpus.LoadTextsFromFile(files_to_process[i]);
-                ProcessFile(files_to_process[i], outputDir);
+            std::optional<DeduplicationPlan> plan;
+            if (options.dedupSentences) {
+                BuildDeduplicationPlan(files_to_process, plan.emplace());
             }
 
+            // Documents are independent: every one gets its own analyzers, result file and DocumentContext
+            const size_t threadsCount = ResolveThreadsCount(options.threadsCount);
+            Logger::log("", LogLevel::Info, "Collecting phrases using " + std::to_string(threadsCount) + " threads");
+            ParallelFor(files_to_process.size(), threadsCount, [&](size_t i) {
+                // One mapping of the text serves both the corpus loader and the sentence splitter
+                CorpusDocument document(files_to_process[i].string());
+                corpus.LoadTextsFromDocument(document);
+                ProcessFile(document, outputDir, plan ? &*plan : nullptr, i);
+            });
+
             TextCorpus::GetCorpus().SaveCorpusToFile(options.corpusFile.string());
+            storage.SaveClustersSnapshot(options.clustersSnapshotPath.string());
+            profiler.WriteReport(options.patternProfilePath.string());
         } catch (const std::exception& e) {
             Logger::log("", LogLevel::Error, "Exception caught: " + std::string(e.what()));
         } catch (...) {
@@ -236,6 +361,42 @@ namespace PhrasesCollectorUtils {
         }
     }
 
+    struct SentenceLemmatizer::Models {
+        Tokenizer tok;
+        TFMorphemicSplitter morphemicSplitter;
+        Processor analyzer;
+        SingleWordDisambiguate disamb;
+        TFJoinedModel joiner;
+    };
+
+    SentenceLemmatizer::SentenceLemmatizer() : models(std::make_unique<Models>())
+    {
+    }
+
+    SentenceLemmatizer::~SentenceLemmatizer() = default;
+
+    std::string SentenceLemmatizer::Lemmatize(const std::string& sentence)
+    {
+        std::vector<TokenPtr> tokens = models->tok.analyze(UniString(sentence));
+        std::vector<WordFormPtr> forms = models->analyzer.analyze(tokens);
+
+        RemoveSeparatorTokens(forms);
+        models->disamb.disambiguate(forms);
+        models->joiner.disambiguateAndMorphemicSplit(forms);
+
+        std::string lemmas;
+        for (auto& form : forms) {
+            models->morphemicSplitter.split(form);
+            if (form->getTokenType() != TokenTypeTag::WORD)
+                continue;
+            lemmas.append(GetLemma(form) + " ");
+        }
+        if (!lemmas.empty()) {
+            lemmas.pop_back();
+        }
+        return lemmas;
+    }
+
     void BuildTokenizedSentenceCorpus()
     {
         Logger::log("", LogLevel::Info, "Building and saving tokenized sentence corpus...");
@@ -243,17 +404,15 @@ namespace PhrasesCollectorUtils {
 
         try {
             std::vector<fs::path> files_to_process = GetFilesToProcess();
+            // The models are loaded once for the whole corpus
+            SentenceLemmatizer lemmatizer;
 
             for (unsigned int i = 0; i < files_to_process.size(); ++i) {
                 size_t docNum = ParserUtils::extractNumberFromPath(files_to_process[i].string());
                 size_t sentNum = 0;
-                Tokenizer tok;
-                TFMorphemicSplitter morphemic_splitter;
-                std::ifstream input = files_to_process[i];
-                SentenceSplitter ssplitter(input);
-                Processor analyzer;
-                SingleWordDisambiguate disamb;
-                TFJoinedModel joiner;
+                CorpusDocument document(files_to_process[i].string());
+                auto input = document.OpenStream();
+                SentenceSplitter ssplitter(*input);
 
                 do {
                     std::string data;
@@ -261,23 +420,8 @@ namespace PhrasesCollectorUtils {
                     if (data.empty())
                         continue;
 
-                    std::vector<TokenPtr> tokens = tok.analyze(UniString(data));
-                    std::vector<WordFormPtr> forms = analyzer.analyze(tokens);
-
-                    RemoveSeparatorTokens(forms);
-                    disamb.disambiguate(forms);
-                    joiner.disambiguateAndMorphemicSplit(forms);
-
-                    std::string normalizedData;
-
-                    for (auto& form : forms) {
-                        morphemic_splitter.split(form);
-                        if (form->getTokenType() != TokenTypeTag::WORD)
-                            continue;
-                        normalizedData.append(GetLemma(form) + " ");
-                    }
+                    const std::string normalizedData = lemmatizer.Lemmatize(data);
                     if (!normalizedData.empty()) {
-                        normalizedData.pop_back();
                         sentences.AddSentence(docNum, sentNum, data, normalizedData);
                     }
                     sentNum++;
@@ -285,6 +429,7 @@ namespace PhrasesCollectorUtils {
             }
             auto& options = PhrasesCollectorUtils::Options::getOptions();
             sentences.SaveToFile(options.sentencesFile.string());
+            sentences.SaveSnapshot(options.sentencesSnapshotPath.string());
         } catch (const std::exception& e) {
             Logger::log("", LogLevel::Error, "Exception caught: " + std::string(e.what()));
         } catch (...) {
@@ -293,15 +438,15 @@ namespace PhrasesCollectorUtils {
         Logger::log("Main", LogLevel::Info, "Tokenized corpus build completed successfully.");
     }
 
-    MorphInfo GetMostProbableMorphInfo(const std::unordered_set<X::MorphInfo>& morphSet)
+    const MorphInfo& GetMostProbableMorphInfo(const std::unordered_set<X::MorphInfo>& morphSet)
     {
-        auto maxElement = *morphSet.begin();
-        for (const auto& elem : morphSet) {
-            if (elem.probability > maxElement.probability) {
-                maxElement = elem;
+        auto maxElement = morphSet.begin();
+        for (auto it = morphSet.begin(); it != morphSet.end(); ++it) {
+            if (it->probability > maxElement->probability) {
+                maxElement = it;
             }
         }
-        return maxElement;
+        return *maxElement;
     }
 
     bool MorphAnanlysisError(const WordFormPtr& token)
@@ -335,15 +480,9 @@ namespace PhrasesCollectorUtils {
         return lowerLine;
     }
 
-    const std::unordered_set<std::string> GetStopWords()
+    static std::unordered_set<std::string> LoadStopWords()
     {
-        static std::unordered_set<std::string> stopWords;
-        static bool initialized = false;
-
-        if (initialized) {
-            return stopWords;
-        }
-
+        std::unordered_set<std::string> stopWords;
         auto& options = PhrasesCollectorUtils::Options::getOptions();
         std::filesystem::path inputPath = options.stopWordsFile;
 
@@ -357,8 +496,13 @@ namespace PhrasesCollectorUtils {
             const auto lowerLine = GetLowerCase(line);
             stopWords.insert(lowerLine);
         }
+        return stopWords;
+    }
 
-        initialized = true;
+    const std::unordered_set<std::string>& GetStopWords()
+    {
+        // Initialization of a function-local static is thread-safe
+        static const std::unordered_set<std::string> stopWords = LoadStopWords();
         return stopWords;
     }
 
@@ -372,15 +516,9 @@ namespace PhrasesCollectorUtils {
         return true;
     }
 
-    const std::unordered_set<std::string> GetTopics()
+    static std::unordered_set<std::string> LoadTopics()
     {
-        static std::unordered_set<std::string> topics;
-        static bool initialized = false;
-
-        if (initialized) {
-            return topics;
-        }
-
+        std::unordered_set<std::string> topics;
         auto& options = PhrasesCollectorUtils::Options::getOptions();
         std::filesystem::path inputPath = options.tagsAndHubsFile;
 
@@ -408,25 +546,24 @@ namespace PhrasesCollectorUtils {
             if (lowerLine.size() > 3)
                 topics.insert(lowerLine);
         }
+        return topics;
+    }
 
-        initialized = true;
+    const std::unordered_set<std::string>& GetTopics()
+    {
+        static const std::unordered_set<std::string> topics = LoadTopics();
         return topics;
     }
 
     const std::unordered_map<std::string, WordEmbeddingPtr>& GetTopicVectors()
     {
-        static std::unordered_map<std::string, WordEmbeddingPtr> topicVectors;
-        static bool initialized = false;
-
-        if (!initialized) {
-            std::unordered_set<std::string> topics = GetTopics();
-
-            for (const auto& t : topics) {
-                topicVectors[t] = std::make_shared<WordEmbedding>(t);
+        static const std::unordered_map<std::string, WordEmbeddingPtr> topicVectors = []() {
+            std::unordered_map<std::string, WordEmbeddingPtr> vectors;
+            for (const auto& t : GetTopics()) {
+                vectors[t] = std::make_shared<WordEmbedding>(t);
             }
-
-            initialized = true;
-        }
+            return vectors;
+        }();
 
         return topicVectors;
     }
@@ -460,15 +597,32 @@ namespace PhrasesCollectorUtils {
         if (collection.empty())
             return;
 
+        auto& storage = PatternPhrasesStorage::GetStorage();
+        const bool writeJson = !process.outputFile.empty();
         for (const auto& wc : collection) {
+            // The key is built from the lemmas of the analyses that matched the pattern
             std::string key;
-            for (const auto& w : wc->words) {
-                key.append(GetLemma(w) + " ");
+            for (const auto& lemma : wc->lemmas) {
+                key.append(lemma + " ");
             }
             if (!key.empty()) {
                 key.pop_back();
             }
 
+            if (IsCollectableKey(key)) {
+                // The stored copy drops the word forms, which keep the whole morphological analysis alive
+                WordComplexPtr stored = std::make_shared<WordComplex>();
+                stored->lemmas = wc->lemmas;
+                stored->textForm = wc->textForm;
+                stored->modelName = wc->modelName;
+                stored->pos = {wc->pos.start, wc->pos.end, process.docNum, process.sentNum};
+                storage.AddWordComplex(key, stored);
+            }
+
+            if (!writeJson) {
+                continue;
+            }
+
             json lemmas_json = json::array();
             for (size_t i = 0; i < wc->lemmas.size(); i++) {
                 lemmas_json.push_back(std::to_string(i) + "_" + wc->lemmas[i]);
@@ -487,7 +641,7 @@ namespace PhrasesCollectorUtils {
             //            process.m_output << j.dump(4) << std::endl;
             process.addJsonObject(j);
         }
-        Logger::log("OutputResults", LogLevel::Info, "Appended results to JSON.");
+        Logger::log("OutputResults", LogLevel::Info, "Added results to the storage.");
     }
 
     const std::string GetLemma(const WordFormPtr& form)
@@ -7,10 +7,12 @@
 #include <ModelComponent.h>
 #include <PatternParser.h>
 #include <PhrasesCollectorUtils.h>
+#include <SentenceDeduplicator.h>
 #include <TextCorpus.h>
 #include <WordComplex.h>
 
 #include <filesystem>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <unordered_map>
@@ -27,9 +29,21 @@ namespace PhrasesCollectorUtils {
         int tresholdTopicsCount;
         bool cleanStopWords; ///< Indicates if stop words should be cleaned.
         bool validateBoundaries;
+        bool profilePatterns; ///< Indicates if per-pattern statistics should be collected.
+        bool latticeMatching; ///< Indicates if patterns are matched against all morphological analyses.
+        int latticeKBest;     ///< How many analyses per token the lattice keeps (0 keeps all of them).
+        bool dedupSentences;  ///< Indicates if duplicate sentences are analyzed only once.
+        int threadsCount;     ///< Threads for collection, loading, metrics and JSON output (0 uses all cores).
+        bool writeDocumentResults; ///< Indicates if per-document res_*.json files are written for debugging.
+        bool prettyJson;           ///< Indicates if cluster JSON outputs are indented (compact otherwise).
+        bool fromSnapshot;         ///< Indicates if commands restore their inputs from the pipeline snapshot.
+        bool quantizeEmbeddings;   ///< Indicates if convert_embedding_model stores the matrix as int8.
         float topicsThreshold;
         float topicsHyponymThreshold;
         float freqTresholdCoeff;
+        float nearDuplicateThreshold; ///< Minimal similarity of reported near-duplicates (above 1 disables them).
+        float synonymsThreshold;      ///< Minimal cosine similarity of the cluster keys found by find_synonyms.
+        int synonymsCount;            ///< How many nearest cluster keys find_synonyms considers per cluster.
 
         fs::path dataDir;
         fs::path corpusDir;
@@ -40,10 +54,22 @@ namespace PhrasesCollectorUtils {
         fs::path resDir;
         fs::path corpusFile;
         fs::path filteredCorpusFile;
+        fs::path corpusStatisticsPath;
         fs::path sentencesFile;
-        fs::path embeddingModelFile;
+        fs::path sentencesSnapshotPath;
+        fs::path embeddingModelFile;     ///< fastText .bin or .ftz model, or a layout of convert_embedding_model.
+        fs::path embeddingReferenceFile; ///< Full model that check_embedding_model compares the model with.
+        fs::path embeddingOutputFile;    ///< Layout written by convert_embedding_model.
         fs::path totalResultsPath;
+        fs::path totalResultsSnapshotPath;
         fs::path termsCandidatesPath;
+        fs::path patternProfilePath;
+        fs::path clustersSnapshotPath;
+        fs::path lsaFactorsPath;
+        fs::path lemmaEmbeddingsPath;
+        fs::path pipelineSnapshotPath;
+        fs::path socketPath;       ///< Unix domain socket of the serve command.
+        fs::path synonymIndexPath; ///< Nearest-neighbour index over the cluster keys built by find_synonyms.
 
         static Options& getOptions()
         {
@@ -76,22 +102,59 @@ namespace PhrasesCollectorUtils {
 
     std::vector<fs::path> GetResFiles();
 
-    // \brief Processes a single file and outputs the results to the specified directory.
-    // \param inputFile     The path to the input file.
+    // \brief Checks if a phrase with the given key is stored in a cluster. Keys with underscores or digits
+    //        (in any script) are skipped.
+    bool IsCollectableKey(const std::string& key);
+
+    // \struct DeduplicationPlan
+    // \brief This structure maps the sentences of the files to process onto clusters of identical sentences and keeps
+    //        the morphological analyses of the clusters that occur again later, so every cluster is analyzed once.
+    struct DeduplicationPlan {
+        std::vector<std::vector<uint32_t>> fileSentences; ///< Cluster ID of every non-empty sentence, by file index.
+        DuplicateAnalysisCache<std::vector<WordFormPtr>> analyses; ///< Analyses shared between identical sentences.
+    };
+
+    // \brief Splits all files into sentences, groups identical sentences into clusters and reports near-duplicates.
+    // \param files         Files to process, in processing order.
+    // \param plan          The plan used by ProcessFile to share analyses between duplicates.
+    void BuildDeduplicationPlan(const std::vector<fs::path>& files, DeduplicationPlan& plan);
+
+    // \brief Processes a single document and outputs the results to the specified directory.
+    // \param document      The mapped text file of the document.
     // \param outputDir     The directory where the output will be saved.
-    // \param counter       A reference to a counter for processed files.
-    // \param counterMutex  A mutex for synchronizing access to the counter.
-    void ProcessFile(const fs::path& inputFile, const fs::path& outputDir, int& counter, std::mutex& counterMutex);
+    // \param plan          Optional deduplication plan; identical sentences reuse the analysis of their cluster but
+    //                      are still collected at their own position.
+    // \param fileIndex     Index of the file in the plan.
+    void ProcessFile(const CorpusDocument& document, const fs::path& outputDir, DeduplicationPlan* plan = nullptr,
+                     size_t fileIndex = 0);
 
     // \brief Builds the phrase storage for processing.
     void BuildPhraseStorage();
 
     void BuildTokenizedSentenceCorpus();
 
+    // \class SentenceLemmatizer
+    // \brief XMorphy models that turn a sentence into the lemmas of its words. Creating them loads the dictionaries
+    //        and the TFLite models, so one instance is meant to be reused for many sentences, e.g. for a whole corpus
+    //        or for all requests of the server. Not thread-safe.
+    class SentenceLemmatizer {
+    public:
+        SentenceLemmatizer();
+        ~SentenceLemmatizer();
+
+        // \brief Returns the lemmas of the words of the sentence separated by spaces, as in sentence corpora and
+        //        cluster keys.
+        std::string Lemmatize(const std::string& sentence);
+
+    private:
+        struct Models;
+        std::unique_ptr<Models> models;
+    };
+
     // \brief Retrieves the most probable morphological information from a set.
     // \param morphSet      A set of morphological information.
-    // \return              The most probable MorphInfo object.
-    MorphInfo GetMostProbableMorphInfo(const std::unordered_set<X::MorphInfo>& morphSet);
+    // \return              A reference to the most probable MorphInfo object in the set.
+    const MorphInfo& GetMostProbableMorphInfo(const std::unordered_set<X::MorphInfo>& morphSet);
 
     // \brief Checks if there is an error in morphological analysis.
     // \param token         The WordFormPtr token to check.
@@ -120,14 +183,14 @@ namespace PhrasesCollectorUtils {
                             CurrentPhraseStatus& curPhrStatus, bool isLeft);
 
     // \brief Retrieves the set of topics for phrase collection.
-    // \return              A set of topic strings.
-    const std::unordered_set<std::string> GetTopics();
+    // \return              A set of topic strings, loaded once in a thread-safe way.
+    const std::unordered_set<std::string>& GetTopics();
 
     const std::unordered_map<std::string, WordEmbeddingPtr>& GetTopicVectors();
 
     // \brief Retrieves the set of stop words for cleaning.
-    // \return              A set of stop word strings.
-    const std::unordered_set<std::string> GetStopWords();
+    // \return              A set of stop word strings, loaded once in a thread-safe way.
+    const std::unordered_set<std::string>& GetStopWords();
 
     // \brief Outputs the results of the phrase collection process.
     // \param collection    A vector of collected word complexes.
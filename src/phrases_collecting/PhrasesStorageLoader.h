@@ -1,23 +1,51 @@
 #ifndef PHRASES_STORAGE_LOADER_H
 #define PHRASES_STORAGE_LOADER_H
 
+#include <BinaryIO.h>
+#include <JsonMembersReader.h>
+#include <MappedFile.h>
+#include <ParallelFor.h>
 #include <PatternPhrasesStorage.h>
+#include <StorageSnapshot.h>
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 using json = nlohmann::json;
 
 class PhrasesStorageLoader {
 public:
+    // \brief Loads clusters from a JSON file written by OutputClustersToJsonFile. The file is parsed in a streaming
+    //        way: every cluster is built as soon as its object closes, so at most one cluster exists as a JSON DOM.
     void LoadStorageFromFile(PatternPhrasesStorage& storage, const std::string& filename)
     {
-        std::ifstream file(filename);
-        if (file.is_open()) {
-            json j;
-            file >> j;
-            Deserialize(storage, j);
-        } else {
+        if (!fs::exists(filename)) {
             std::cerr << "Failed to open file: " << filename << std::endl;
+            return;
+        }
+
+        try {
+            MappedFile file(filename);
+            JsonMembersReader reader(
+                [&](const std::string& key, const json& obj) { DeserializeCluster(storage, key, obj); });
+            const std::string_view content = file.View();
+            json::sax_parse(content.begin(), content.end(), &reader);
+        } catch (json::exception& e) {
+            std::cerr << "Error parsing JSON: " << e.what() << std::endl;
+            throw;
+        } catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            throw;
         }
     }
 
+    // \brief Loads the per-document results of collect_phrases. Files are parsed in parallel into partial cluster
+    //        maps, which are merged pairwise in a reduction tree. Phrases of every cluster end up sorted by their
+    //        position, so the result does not depend on the number of threads.
     void LoadPhraseStorageFromResultsDir(PatternPhrasesStorage& storage)
     {
         Logger::log("PhrasesStorage", LogLevel::Info, "Loading phrase storage from results directory...");
@@ -25,178 +53,271 @@ public:
         fs::path outputDir = options.resDir;
         fs::create_directories(outputDir);
         std::vector<fs::path> res_files = GetResFiles();
+        std::sort(res_files.begin(), res_files.end());
 
-        auto& corpus = TextCorpus::GetCorpus();
-        storage.ReserveClusters(corpus.GetTotalTexts());
+        const size_t threadsCount = ResolveThreadsCount(options.threadsCount);
+        std::vector<PartialClusters> partials(res_files.size());
+        ParallelFor(res_files.size(), threadsCount, [&](size_t i) { partials[i] = ParseResFile(res_files[i]); });
 
-        for (const auto& file_path : res_files) {
-            std::ifstream file(file_path);
+        for (size_t stride = 1; stride < partials.size(); stride *= 2) {
+            const size_t pairsCount = (partials.size() - stride + 2 * stride - 1) / (2 * stride);
+            ParallelFor(pairsCount, threadsCount, [&](size_t pairInd) {
+                const size_t left = pairInd * 2 * stride;
+                MergePartialClusters(partials[left], partials[left + stride]);
+            });
+        }
+        if (partials.empty()) {
+            return;
+        }
 
-            if (!file.is_open()) {
-                continue;
-            }
+        std::vector<std::pair<std::string, std::vector<WordComplexPtr>>> merged(
+            std::make_move_iterator(partials[0].begin()), std::make_move_iterator(partials[0].end()));
+        partials.clear();
+
+        storage.ReserveClusters(merged.size());
+        ParallelFor(merged.size(), threadsCount, [&](size_t i) {
+            WordComplexCluster cluster = BuildCluster(merged[i].first, merged[i].second);
+            storage.UpsertCluster(
+                merged[i].first, [&]() { return std::move(cluster); }, [](WordComplexCluster&) {});
+        });
 
-            nlohmann::json j;
-            file >> j;
-            file.close();
+        Logger::log("PhrasesStorage", LogLevel::Info,
+                    "Loaded " + std::to_string(merged.size()) + " clusters from " + std::to_string(res_files.size()) +
+                        " files");
+    }
 
-            if (!j.is_array()) {
-                continue;
+    // \brief Loads the clusters written by PatternPhrasesStorage::SaveClustersSnapshot at the end of collect_phrases.
+    // \throws std::runtime_error if the snapshot is truncated or has another format version.
+    void LoadClustersSnapshot(PatternPhrasesStorage& storage, const std::string& filename)
+    {
+        Logger::log("PhrasesStorage", LogLevel::Info, "Loading clusters snapshot from " + filename);
+        BinaryReader reader(filename, PatternPhrasesStorage::kSnapshotMagic, PatternPhrasesStorage::kSnapshotVersion);
+        LoadClustersSnapshot(storage, reader);
+    }
+
+    // \brief Same as above for a reader of the snapshot, e.g. a section of a PipelineImage.
+    void LoadClustersSnapshot(PatternPhrasesStorage& storage, BinaryReader& reader)
+    {
+        const uint64_t clustersCount = reader.Read<uint64_t>();
+        storage.ReserveClusters(clustersCount);
+        for (uint64_t clusterInd = 0; clusterInd < clustersCount; ++clusterInd) {
+            WordComplexCluster cluster{};
+            cluster.key = reader.ReadString();
+            cluster.modelName = reader.ReadString();
+            cluster.frequency = 1.0;
+
+            const uint32_t lemmasCount = reader.Read<uint32_t>();
+            for (uint32_t i = 0; i < lemmasCount; ++i) {
+                std::string lemma = reader.ReadString();
+                cluster.lemmaIds.push_back(LemmaDictionary::GetDictionary().GetId(lemma));
+                cluster.hypernyms[lemma] = {};
+                cluster.hyponyms[lemma] = {};
+                cluster.lemmas.push_back(std::move(lemma));
             }
+            cluster.phraseSize = cluster.lemmas.size();
 
-            for (const auto& obj : j) {
-                try {
-                    // Extract data from JSON
-                    std::string key = obj.at("0_key").get<std::string>();
-                    if (key.find('_') != std::string::npos) {
-                        continue;
-                    }
-                    bool skip = false;
-                    icu::UnicodeString unicodeText = icu::UnicodeString::fromUTF8(key);
-                    for (int32_t i = 0; i < unicodeText.length(); ++i) {
-                        UChar32 codepoint = unicodeText.char32At(i);
-                        // Check if the character is a digit
-                        if (u_isdigit(codepoint)) {
-                            skip = true;
-                        }
-                    }
-                    if (skip) {
-                        continue;
-                    }
-                    std::string textForm = obj.at("1_textForm").get<std::string>();
-                    std::string modelName = obj.at("2_modelName").get<std::string>();
-
-                    Position pos;
-                    pos.docNum = obj.at("3_docNum").get<size_t>();
-                    pos.sentNum = obj.at("4_sentNum").get<size_t>();
-                    pos.start = obj.at("5_start_ind").get<size_t>();
-                    pos.end = obj.at("6_end_ind").get<size_t>();
-
-                    std::deque<std::string> lemmas;
-                    if (obj.contains("7_lemmas")) {
-                        lemmas = obj.at("7_lemmas").get<std::deque<std::string>>();
-                        for (auto& lemma : lemmas) {
-                            size_t pos = lemma.find('_');
-                            if (pos != std::string::npos) {
-                                lemma = lemma.substr(pos + 1);
-                            }
-                        }
-                    }
+            const uint32_t phrasesCount = reader.Read<uint32_t>();
+            cluster.wordComplexes.reserve(phrasesCount);
+            for (uint32_t i = 0; i < phrasesCount; ++i) {
+                WordComplexPtr wc = std::make_shared<WordComplex>();
+                wc->textForm = reader.ReadString();
+                wc->modelName = reader.ReadString();
+                wc->pos.start = reader.Read<uint64_t>();
+                wc->pos.end = reader.Read<uint64_t>();
+                wc->pos.docNum = reader.Read<uint64_t>();
+                wc->pos.sentNum = reader.Read<uint64_t>();
+                wc->lemmas.assign(cluster.lemmas.begin(), cluster.lemmas.end());
+                cluster.wordComplexes.push_back(std::move(wc));
+            }
 
-                    // Create a WordComplex object
-                    WordComplexPtr wc = std::make_shared<WordComplex>();
-                    wc->textForm = textForm;
-                    wc->pos = pos;
-                    wc->modelName = modelName;
-                    wc->lemmas = lemmas;
+            storage.AddCluster(cluster.key, cluster);
+        }
 
-                    auto cluster = storage.FindCluster(key);
-                    if (cluster != nullptr) {
+        Logger::log("PhrasesStorage", LogLevel::Info, "Loaded " + std::to_string(clustersCount) + " clusters");
+    }
 
-                        if (std::find(cluster->wordComplexes.begin(), cluster->wordComplexes.end(), wc) ==
-                            cluster->wordComplexes.end()) {
-                            cluster->wordComplexes.push_back(wc);
-                        }
-                    } else {
-                        std::vector<std::string> lemmas;
-                        std::vector<WordEmbeddingPtr> lemVectors;
-                        std::unordered_map<std::string, std::set<std::string>> lemmHypernyms;
-                        std::unordered_map<std::string, std::set<std::string>> lemmHyponyms;
-                        for (const auto& lemma : wc->lemmas) {
-                            lemmas.push_back(lemma);
-                            lemVectors.push_back(std::make_shared<WordEmbedding>(lemma));
-                            lemmHypernyms[lemma] = {};
-                            lemmHyponyms[lemma] = {};
-                        }
+    // \brief Loads a storage saved by PatternPhrasesStorage::SaveStorageSnapshot.
+    // \throws std::runtime_error if the snapshot is missing, corrupted or has another format version.
+    void LoadStorageSnapshot(PatternPhrasesStorage& storage, const std::string& filename)
+    {
+        Logger::log("PhrasesStorage", LogLevel::Info, "Loading storage snapshot from " + filename);
+        LoadStorageSnapshot(storage, StorageSnapshot(filename));
+    }
 
-                        WordComplexCluster newCluster = {wc->lemmas.size(), false,         1.0,         0.0, 0.0, key,
-                                                         wc->modelName,     lemmas,        {wc},        {},  {},  {},
-                                                         lemVectors,        lemmHypernyms, lemmHyponyms};
-                        storage.AddCluster(key, newCluster);
-                    }
-                } catch (const std::exception& e) {
-                    Logger::log("", LogLevel::Error, "Error parsing JSON object: " + std::string(e.what()));
-                }
-            }
+    // \brief Same as above for an opened snapshot, e.g. a section of a PipelineImage.
+    void LoadStorageSnapshot(PatternPhrasesStorage& storage, const StorageSnapshot& snapshot)
+    {
+        storage.ReserveClusters(snapshot.ClustersCount());
+        for (size_t clusterInd = 0; clusterInd < snapshot.ClustersCount(); ++clusterInd) {
+            WordComplexCluster cluster = snapshot.MaterializeCluster(clusterInd);
+            storage.AddCluster(cluster.key, cluster);
+        }
+
+        Logger::log("PhrasesStorage", LogLevel::Info,
+                    "Loaded " + std::to_string(snapshot.ClustersCount()) + " clusters");
+    }
+
+    // \brief Loads the results of compute_text_metrics and later commands: the binary snapshot if it exists, otherwise
+    //        total_results.json written by older versions.
+    void LoadTotalResults(PatternPhrasesStorage& storage)
+    {
+        auto& options = PhrasesCollectorUtils::Options::getOptions();
+        if (fs::exists(options.totalResultsSnapshotPath)) {
+            LoadStorageSnapshot(storage, options.totalResultsSnapshotPath.string());
+        } else {
+            LoadStorageFromFile(storage, options.totalResultsPath.string());
         }
     }
 
 private:
-    void Deserialize(PatternPhrasesStorage& storage, const json& j)
+    using PartialClusters = std::unordered_map<std::string, std::vector<WordComplexPtr>>;
+
+    // Parses one res_*.json file into phrases grouped by their keys, skipping the keys that are not collected.
+    static PartialClusters ParseResFile(const fs::path& file_path)
     {
+        PartialClusters partial;
+        json j;
         try {
-            if (!j.is_object()) {
-                throw std::runtime_error("Expected a JSON object.");
-            }
+            MappedFile file(file_path.string());
+            const std::string_view content = file.View();
+            j = json::parse(content.begin(), content.end());
+        } catch (const std::exception& e) {
+            Logger::log("PhrasesStorage", LogLevel::Error,
+                        "Failed to read " + file_path.string() + ": " + std::string(e.what()));
+            return partial;
+        }
 
-            for (auto it = j.begin(); it != j.end(); ++it) {
-                std::string key = it.key();
-                const json& obj = it.value();
+        if (!j.is_array()) {
+            return partial;
+        }
 
-                if (!obj.is_object()) {
-                    throw std::runtime_error("Expected a JSON object for each cluster.");
+        for (const auto& obj : j) {
+            try {
+                // Extract data from JSON
+                std::string key = obj.at("0_key").get<std::string>();
+                if (!IsCollectableKey(key)) {
+                    continue;
                 }
 
-                WordComplexCluster cluster;
-                cluster.key = key;
-                cluster.phraseSize = obj.at("0_phrase_size").get<size_t>();
-                cluster.frequency = obj.at("1_frequency").get<double>();
-                cluster.topicRelevance = obj.at("2_topic_relevance").get<double>();
-                cluster.centralityScore = obj.at("3_centrality_score").get<double>();
-                cluster.tagMatch = obj.at("4_tag_match").get<bool>();
-                cluster.modelName = obj.at("5_model_name").get<std::string>();
-
-                std::unordered_set<std::string> synonyms;
-                if (obj.contains("9_synonyms")) {
-                    cluster.synonyms = obj.at("9_synonyms").get<std::unordered_set<std::string>>();
-                }
+                // Create a WordComplex object
+                WordComplexPtr wc = std::make_shared<WordComplex>();
+                wc->textForm = obj.at("1_textForm").get<std::string>();
+                wc->modelName = obj.at("2_modelName").get<std::string>();
+                wc->pos.docNum = obj.at("3_docNum").get<size_t>();
+                wc->pos.sentNum = obj.at("4_sentNum").get<size_t>();
+                wc->pos.start = obj.at("5_start_ind").get<size_t>();
+                wc->pos.end = obj.at("6_end_ind").get<size_t>();
 
-                // Deserialize Lemmas
-                const json& lemmas_json = obj.at("6_lemmas");
-                for (const auto& lemma_obj : lemmas_json) {
-                    std::string lemmaStr = "";
-                    auto lemmaStrNumbered = lemma_obj.at("0_lemma").get<std::string>();
-                    size_t pos = lemmaStrNumbered.find('_');
-                    if (pos != std::string::npos) {
-                        lemmaStr = lemmaStrNumbered.substr(pos + 1);
+                if (obj.contains("7_lemmas")) {
+                    wc->lemmas = obj.at("7_lemmas").get<std::deque<std::string>>();
+                    for (auto& lemma : wc->lemmas) {
+                        size_t pos = lemma.find('_');
+                        if (pos != std::string::npos) {
+                            lemma = lemma.substr(pos + 1);
+                        }
                     }
-                    cluster.lemmas.push_back(lemmaStr);
-                    cluster.tf.push_back(lemma_obj.at("1_tf").get<double>());
-                    cluster.idf.push_back(lemma_obj.at("2_idf").get<double>());
-                    cluster.tfidf.push_back(lemma_obj.at("3_tf-idf").get<double>());
-                    cluster.hypernyms[lemmaStr] = lemma_obj.at("4_hypernyms").get<std::set<std::string>>();
-                    cluster.hyponyms[lemmaStr] = lemma_obj.at("5_hyponyms").get<std::set<std::string>>();
-
-                    // Add word embedding (assuming you need to create an embedding for each lemma)
-                    cluster.wordVectors.push_back(std::make_shared<WordEmbedding>(lemmaStr));
                 }
 
-                // Deserialize WordComplexes (Phrases in your JSON)
-                const json& phrases_json = obj.at("8_phrases");
-                for (const auto& phrase_obj : phrases_json) {
-                    WordComplexPtr wc = std::make_shared<WordComplex>();
-                    wc->textForm = phrase_obj.at("0_text_form").get<std::string>();
-                    wc->modelName = cluster.modelName;
+                partial[key].push_back(std::move(wc));
+            } catch (const std::exception& e) {
+                Logger::log("", LogLevel::Error, "Error parsing JSON object: " + std::string(e.what()));
+            }
+        }
+        return partial;
+    }
 
-                    wc->pos.start = phrase_obj.at("1_position").at("0_start").get<size_t>();
-                    wc->pos.end = phrase_obj.at("1_position").at("1_end").get<size_t>();
-                    wc->pos.docNum = phrase_obj.at("1_position").at("2_doc_num").get<size_t>();
-                    wc->pos.sentNum = phrase_obj.at("1_position").at("3_sent_num").get<size_t>();
+    static void MergePartialClusters(PartialClusters& target, PartialClusters& source)
+    {
+        for (auto& [key, phrases] : source) {
+            auto& targetPhrases = target[key];
+            targetPhrases.insert(targetPhrases.end(), std::make_move_iterator(phrases.begin()),
+                                 std::make_move_iterator(phrases.end()));
+        }
+        source.clear();
+    }
 
-                    wc->lemmas.assign(cluster.lemmas.begin(), cluster.lemmas.end());
+    // Builds a cluster from all phrases of its key. The first phrase by position defines the lemmas and the model.
+    static WordComplexCluster BuildCluster(const std::string& key, std::vector<WordComplexPtr>& phrases)
+    {
+        std::sort(phrases.begin(), phrases.end(), [](const WordComplexPtr& a, const WordComplexPtr& b) {
+            return std::tie(a->pos.docNum, a->pos.sentNum, a->pos.start, a->pos.end) <
+                   std::tie(b->pos.docNum, b->pos.sentNum, b->pos.start, b->pos.end);
+        });
 
-                    cluster.wordComplexes.push_back(wc);
-                }
+        const WordComplexPtr& first = phrases.front();
+        WordComplexCluster cluster{};
+        cluster.key = key;
+        cluster.modelName = first->modelName;
+        cluster.frequency = 1.0;
+        cluster.lemmas.assign(first->lemmas.begin(), first->lemmas.end());
+        cluster.phraseSize = cluster.lemmas.size();
+        for (const auto& lemma : cluster.lemmas) {
+            cluster.lemmaIds.push_back(LemmaDictionary::GetDictionary().GetId(lemma));
+            cluster.hypernyms[lemma] = {};
+            cluster.hyponyms[lemma] = {};
+        }
+        cluster.wordComplexes = std::move(phrases);
+        return cluster;
+    }
+
+    void DeserializeCluster(PatternPhrasesStorage& storage, const std::string& key, const json& obj)
+    {
+        if (!obj.is_object()) {
+            throw std::runtime_error("Expected a JSON object for each cluster.");
+        }
+
+        WordComplexCluster cluster;
+        cluster.key = key;
+        cluster.phraseSize = obj.at("0_phrase_size").get<size_t>();
+        cluster.frequency = obj.at("1_frequency").get<double>();
+        cluster.topicRelevance = obj.at("2_topic_relevance").get<double>();
+        cluster.centralityScore = obj.at("3_centrality_score").get<double>();
+        cluster.tagMatch = obj.at("4_tag_match").get<bool>();
+        cluster.modelName = obj.at("5_model_name").get<std::string>();
 
-                storage.AddCluster(key, cluster);
+        std::unordered_set<std::string> synonyms;
+        if (obj.contains("9_synonyms")) {
+            cluster.synonyms = obj.at("9_synonyms").get<std::unordered_set<std::string>>();
+        }
+
+        // Deserialize Lemmas
+        const json& lemmas_json = obj.at("6_lemmas");
+        for (const auto& lemma_obj : lemmas_json) {
+            std::string lemmaStr = "";
+            auto lemmaStrNumbered = lemma_obj.at("0_lemma").get<std::string>();
+            size_t pos = lemmaStrNumbered.find('_');
+            if (pos != std::string::npos) {
+                lemmaStr = lemmaStrNumbered.substr(pos + 1);
             }
-        } catch (json::exception& e) {
-            std::cerr << "Error parsing JSON: " << e.what() << std::endl;
-            throw;
-        } catch (std::exception& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
-            throw;
+            cluster.lemmas.push_back(lemmaStr);
+            cluster.tf.push_back(lemma_obj.at("1_tf").get<double>());
+            cluster.idf.push_back(lemma_obj.at("2_idf").get<double>());
+            cluster.tfidf.push_back(lemma_obj.at("3_tf-idf").get<double>());
+            cluster.hypernyms[lemmaStr] = lemma_obj.at("4_hypernyms").get<std::set<std::string>>();
+            cluster.hyponyms[lemmaStr] = lemma_obj.at("5_hyponyms").get<std::set<std::string>>();
+
+            // The embedding itself is computed on first access
+            cluster.lemmaIds.push_back(LemmaDictionary::GetDictionary().GetId(lemmaStr));
+        }
+
+        // Deserialize WordComplexes (Phrases in your JSON)
+        const json& phrases_json = obj.at("8_phrases");
+        for (const auto& phrase_obj : phrases_json) {
+            WordComplexPtr wc = std::make_shared<WordComplex>();
+            wc->textForm = phrase_obj.at("0_text_form").get<std::string>();
+            wc->modelName = cluster.modelName;
+
+            wc->pos.start = phrase_obj.at("1_position").at("0_start").get<size_t>();
+            wc->pos.end = phrase_obj.at("1_position").at("1_end").get<size_t>();
+            wc->pos.docNum = phrase_obj.at("1_position").at("2_doc_num").get<size_t>();
+            wc->pos.sentNum = phrase_obj.at("1_position").at("3_sent_num").get<size_t>();
+
+            wc->lemmas.assign(cluster.lemmas.begin(), cluster.lemmas.end());
+
+            cluster.wordComplexes.push_back(wc);
         }
+
+        storage.AddCluster(key, cluster);
     }
 };
 
@@ -1,4 +1,6 @@
+#include <LemmaDictionary.h>
 #include <PatternPhrasesStorage.h>
+#include <PatternProfiler.h>
 #include <SimplePhrasesCollector.h>
 #include <StringFilters.h>
 
@@ -6,14 +8,6 @@
 
 using namespace PhrasesCollectorUtils;
 
-static bool HeadCheck(const std::shared_ptr<Model>& simpleModel, const X::WordFormPtr& form)
-{
-    if (!simpleModel->getHead()->getCondition().check(simpleModel->getHead()->getSPTag(), form)) {
-        return false;
-    }
-    return true;
-}
-
 static bool HaveSpHead(const std::unordered_set<X::MorphInfo>& currFormMorphInfo)
 {
     for (const auto& morphForm : currFormMorphInfo) {
@@ -30,6 +24,25 @@ static bool HaveSpHead(const std::unordered_set<X::MorphInfo>& currFormMorphInfo
     return false;
 }
 
+bool SimplePhrasesCollector::CheckCondition(const std::shared_ptr<WordComp>& comp, size_t tokenInd,
+                                            std::string* lemma) const
+{
+    if (m_lattice) {
+        const LatticeCandidate* candidate = comp->getCondition().find(comp->getSPTag(), (*m_lattice)[tokenInd]);
+        if (candidate && lemma) {
+            *lemma = LemmaDictionary::GetDictionary().GetLemma(candidate->lemmaId);
+        }
+        return candidate != nullptr;
+    }
+    if (!comp->getCondition().check(comp->getSPTag(), m_sentence[tokenInd])) {
+        return false;
+    }
+    if (lemma) {
+        *lemma = GetLemma(m_sentence[tokenInd]);
+    }
+    return true;
+}
+
 bool SimplePhrasesCollector::CheckAside(const std::shared_ptr<WordComplex>& wc, const std::shared_ptr<Model>& model,
                                         size_t compIndex, size_t tokenInd, size_t& correct, const bool isLeft)
 {
@@ -54,9 +67,10 @@ bool SimplePhrasesCollector::CheckAside(const std::shared_ptr<WordComplex>& wc,
 
     std::string formFromText = token->getWordForm().getRawString();
 
-    if (!comp->getCondition().check(comp->getSPTag(), token))
+    std::string lemma;
+    if (!CheckCondition(comp, tokenInd, &lemma))
         return false;
-    UpdateWordComplex(wc, token, formFromText, isLeft);
+    UpdateWordComplex(wc, token, lemma, formFromText, isLeft);
 
     ++correct;
     size_t nextCompIndex = isLeft ? compIndex - 1 : compIndex + 1;
@@ -82,6 +96,7 @@ void SimplePhrasesCollector::Collect(Process& process)
 {
     auto& options = PhrasesCollectorUtils::Options::getOptions();
     const auto& simplePatterns = manager.getSimplePatterns();
+    const auto& profiler = PatternProfiler::GetProfiler();
 
     for (size_t tokenInd = 0; tokenInd < m_sentence.size(); tokenInd++) {
         const auto token = m_sentence[tokenInd];
@@ -105,21 +120,33 @@ void SimplePhrasesCollector::Collect(Process& process)
             continue;
 
         for (const auto& [name, model] : simplePatterns) {
+            PatternStats* stats = profiler.GetStats(name);
+            PatternProfiler::Add(stats, &PatternStats::attempts);
 
-            if (!HeadCheck(model, token))
+            std::string headLemma;
+            if (!CheckCondition(model->getHead(), tokenInd, &headLemma))
                 continue;
 
+            PatternProfiler::Add(stats, &PatternStats::headPassed);
+
             size_t headPos = *model->getHeadPos();
             size_t correct = 0;
 
-            WordComplexPtr wc = InicializeWordComplex(tokenInd, token, model->getForm(), process);
+            WordComplexPtr wc = InicializeWordComplex(tokenInd, token, headLemma, model->getForm(), process);
             ++correct;
 
-            if (headPos != 0 && tokenInd != 0 && CheckAside(wc, model, headPos - 1, tokenInd - 1, correct, true)) {
-                break;
+            const size_t collectedBefore = m_collection.size();
+            bool found = false;
+            {
+                PatternProfiler::ScopedTimer timer(stats);
+                found = (headPos != 0 && tokenInd != 0 &&
+                         CheckAside(wc, model, headPos - 1, tokenInd - 1, correct, true)) ||
+                        (headPos != model->size() - 1 &&
+                         CheckAside(wc, model, headPos + 1, tokenInd + 1, correct, false));
             }
+            PatternProfiler::Add(stats, &PatternStats::matches, m_collection.size() - collectedBefore);
 
-            if (headPos != model->size() - 1 && CheckAside(wc, model, headPos + 1, tokenInd + 1, correct, false)) {
+            if (found) {
                 break;
             }
         }
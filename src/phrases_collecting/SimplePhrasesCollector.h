@@ -5,6 +5,7 @@
 
 #include <GrammarPatternManager.h>
 #include <ModelComponent.h>
+#include <MorphLattice.h>
 #include <PhrasesCollectorUtils.h>
 
 #include <unordered_map>
@@ -16,8 +17,10 @@ class SimplePhrasesCollector {
 public:
     // \brief Constructor that initializes the SimplePhrasesCollector with a vector of word forms.
     // \param forms     A vector of WordFormPtr representing the sentence to analyze.
-    explicit SimplePhrasesCollector(const std::vector<WordFormPtr>& forms)
-        : m_sentence(forms), m_collection{}, manager(*GrammarPatternManager::GetManager())
+    // \param lattice   Optional morphological lattice of the sentence. When set, conditions are matched against
+    //                  the candidates of the lattice instead of the MorphInfo sets of the word forms.
+    explicit SimplePhrasesCollector(const std::vector<WordFormPtr>& forms, const MorphLattice* lattice = nullptr)
+        : m_sentence(forms), m_collection{}, manager(*GrammarPatternManager::GetManager()), m_lattice(lattice)
     {
     }
 
@@ -39,6 +42,12 @@ private:
     std::vector<PHUtils::WordComplexPtr> m_collection; ///< Collection of word complexes.
     std::vector<WordFormPtr> m_sentence;               ///< Vector of word forms representing the sentence.
     const GrammarPatternManager& manager;              ///< Reference to the GrammarPatternManager instance.
+    const MorphLattice* m_lattice;                     ///< Morphological lattice of the sentence, if enabled.
+
+    // Checks the condition of the component on the token. On success stores into lemma, if it is set, the lemma of
+    // the analysis that satisfies the condition: the most probable matching candidate of the lattice, or the most
+    // probable analysis of the token without a lattice.
+    bool CheckCondition(const std::shared_ptr<WordComp>& comp, size_t tokenInd, std::string* lemma = nullptr) const;
 
     bool CheckAside(const PHUtils::WordComplexPtr& wc, const std::shared_ptr<Model>& model, size_t compIndex,
                     size_t formIndex, size_t& correct, const bool isLeft);
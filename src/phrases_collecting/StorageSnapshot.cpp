@@ -0,0 +1,376 @@
+#include <StorageSnapshot.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+    // Assigns consecutive ids to distinct strings and packs them into one buffer.
+    class StringPoolBuilder {
+    public:
+        StringPoolBuilder()
+        {
+            begins.push_back(0);
+        }
+
+        uint32_t Add(const std::string& str)
+        {
+            auto [it, inserted] = ids.try_emplace(str, static_cast<uint32_t>(ids.size()));
+            if (inserted) {
+                if (ids.size() > UINT32_MAX) {
+                    throw std::length_error("Too many distinct strings for a storage snapshot");
+                }
+                bytes.append(str);
+                begins.push_back(bytes.size());
+            }
+            return it->second;
+        }
+
+        std::unordered_map<std::string, uint32_t> ids;
+        std::vector<uint64_t> begins;
+        std::string bytes;
+    };
+
+    const std::set<std::string> kNoRelations;
+
+    template <typename Set>
+    void AppendRelations(StringPoolBuilder& pool, const Set& relations, std::vector<uint32_t>& ids,
+                         std::vector<uint64_t>& begins)
+    {
+        for (const auto& relation : relations) {
+            ids.push_back(pool.Add(relation));
+        }
+        begins.push_back(ids.size());
+    }
+
+    void CheckOffsets(const uint64_t* begins, uint64_t count, uint64_t total, const std::string& what)
+    {
+        if (begins[0] != 0 || begins[count] != total || !std::is_sorted(begins, begins + count + 1)) {
+            throw std::runtime_error("Corrupted storage snapshot: invalid " + what + " offsets");
+        }
+    }
+
+    void CheckIds(const uint32_t* ids, uint64_t count, uint64_t stringsCount, const std::string& what)
+    {
+        if (std::any_of(ids, ids + count, [stringsCount](uint32_t id) { return id >= stringsCount; })) {
+            throw std::runtime_error("Corrupted storage snapshot: invalid " + what + " string ids");
+        }
+    }
+
+    // Columns of a snapshot held in memory while it is written.
+    struct SnapshotColumns {
+        std::vector<uint64_t> stringBegins;
+        std::vector<char> stringBytes;
+
+        std::vector<uint32_t> keyIds, modelNameIds, synonymIds;
+        std::vector<uint64_t> phraseSizes, lemmaBegins, phraseBegins, synonymBegins;
+        std::vector<double> frequencies, topicRelevances, centralityScores;
+        std::vector<uint8_t> tagMatches, isTerms;
+
+        std::vector<uint32_t> lemmaIds, hypernymIds, hyponymIds;
+        std::vector<uint64_t> hypernymBegins, hyponymBegins;
+        std::vector<double> tfs, idfs, tfidfs;
+
+        std::vector<uint32_t> textFormIds;
+        std::vector<uint64_t> starts, ends, docNums, sentNums;
+    };
+
+    // Writes the columns in the order in which the StorageSnapshot constructor reads them.
+    void WriteColumns(const std::string& filename, const SnapshotColumns& columns)
+    {
+        BinaryWriter writer(filename, StorageSnapshot::kMagic, StorageSnapshot::kVersion);
+        writer.Write(static_cast<uint64_t>(columns.keyIds.size()));
+        writer.Write(static_cast<uint64_t>(columns.lemmaIds.size()));
+        writer.Write(static_cast<uint64_t>(columns.textFormIds.size()));
+        writer.Write(static_cast<uint64_t>(columns.stringBegins.size() - 1));
+        writer.Write(static_cast<uint64_t>(columns.stringBytes.size()));
+        writer.Write(static_cast<uint64_t>(columns.synonymIds.size()));
+        writer.Write(static_cast<uint64_t>(columns.hypernymIds.size()));
+        writer.Write(static_cast<uint64_t>(columns.hyponymIds.size()));
+
+        writer.WriteArray(columns.stringBegins);
+        writer.WriteArray(columns.stringBytes);
+
+        writer.WriteArray(columns.keyIds);
+        writer.WriteArray(columns.modelNameIds);
+        writer.WriteArray(columns.phraseSizes);
+        writer.WriteArray(columns.frequencies);
+        writer.WriteArray(columns.topicRelevances);
+        writer.WriteArray(columns.centralityScores);
+        writer.WriteArray(columns.tagMatches);
+        writer.WriteArray(columns.isTerms);
+        writer.WriteArray(columns.lemmaBegins);
+        writer.WriteArray(columns.phraseBegins);
+        writer.WriteArray(columns.synonymBegins);
+        writer.WriteArray(columns.synonymIds);
+
+        writer.WriteArray(columns.lemmaIds);
+        writer.WriteArray(columns.tfs);
+        writer.WriteArray(columns.idfs);
+        writer.WriteArray(columns.tfidfs);
+        writer.WriteArray(columns.hypernymBegins);
+        writer.WriteArray(columns.hypernymIds);
+        writer.WriteArray(columns.hyponymBegins);
+        writer.WriteArray(columns.hyponymIds);
+
+        writer.WriteArray(columns.textFormIds);
+        writer.WriteArray(columns.starts);
+        writer.WriteArray(columns.ends);
+        writer.WriteArray(columns.docNums);
+        writer.WriteArray(columns.sentNums);
+        writer.Close();
+    }
+
+    template <typename T>
+    std::vector<T> CopyColumn(const T* values, uint64_t count)
+    {
+        return std::vector<T>(values, values + count);
+    }
+}
+
+void StorageSnapshot::Write(const std::string& filename, const std::vector<const WordComplexCluster*>& clusters,
+                            int textsCount)
+{
+    StringPoolBuilder pool;
+    SnapshotColumns columns;
+    columns.lemmaBegins.push_back(0);
+    columns.phraseBegins.push_back(0);
+    columns.synonymBegins.push_back(0);
+    columns.hypernymBegins.push_back(0);
+    columns.hyponymBegins.push_back(0);
+
+    for (const WordComplexCluster* cluster : clusters) {
+        const double phrasesCount = static_cast<double>(cluster->wordComplexes.size());
+
+        columns.keyIds.push_back(pool.Add(cluster->key));
+        columns.modelNameIds.push_back(pool.Add(cluster->modelName));
+        columns.phraseSizes.push_back(cluster->phraseSize);
+        columns.frequencies.push_back(phrasesCount / static_cast<double>(textsCount));
+        columns.topicRelevances.push_back(cluster->topicRelevance);
+        columns.centralityScores.push_back(cluster->centralityScore);
+        columns.tagMatches.push_back(cluster->tagMatch);
+        columns.isTerms.push_back(cluster->is_term);
+
+        std::vector<std::string> synonyms(cluster->synonyms.begin(), cluster->synonyms.end());
+        std::sort(synonyms.begin(), synonyms.end());
+        AppendRelations(pool, synonyms, columns.synonymIds, columns.synonymBegins);
+
+        for (size_t i = 0; i < cluster->lemmas.size(); ++i) {
+            const std::string& lemma = cluster->lemmas[i];
+            columns.lemmaIds.push_back(pool.Add(lemma));
+            columns.tfs.push_back(i < cluster->tf.size() ? cluster->tf[i] : 0.0);
+            columns.idfs.push_back(i < cluster->idf.size() ? cluster->idf[i] : 0.0);
+            columns.tfidfs.push_back(i < cluster->tfidf.size() ? cluster->tfidf[i] : 0.0);
+
+            auto hypernymsIt = cluster->hypernyms.find(lemma);
+            AppendRelations(pool, hypernymsIt != cluster->hypernyms.end() ? hypernymsIt->second : kNoRelations,
+                            columns.hypernymIds, columns.hypernymBegins);
+            auto hyponymsIt = cluster->hyponyms.find(lemma);
+            AppendRelations(pool, hyponymsIt != cluster->hyponyms.end() ? hyponymsIt->second : kNoRelations,
+                            columns.hyponymIds, columns.hyponymBegins);
+        }
+        columns.lemmaBegins.push_back(columns.lemmaIds.size());
+
+        for (const auto& wc : cluster->wordComplexes) {
+            columns.textFormIds.push_back(pool.Add(wc->textForm));
+            columns.starts.push_back(wc->pos.start);
+            columns.ends.push_back(wc->pos.end);
+            columns.docNums.push_back(wc->pos.docNum);
+            columns.sentNums.push_back(wc->pos.sentNum);
+        }
+        columns.phraseBegins.push_back(columns.textFormIds.size());
+    }
+
+    columns.stringBegins = std::move(pool.begins);
+    columns.stringBytes.assign(pool.bytes.begin(), pool.bytes.end());
+    WriteColumns(filename, columns);
+}
+
+void StorageSnapshot::WriteWithSynonyms(const std::string& filename,
+                                        const std::vector<std::vector<uint32_t>>& synonymClusters) const
+{
+    if (synonymClusters.size() != clustersCount) {
+        throw std::invalid_argument("Synonyms are given for " + std::to_string(synonymClusters.size()) +
+                                    " clusters instead of " + std::to_string(clustersCount));
+    }
+
+    // The synonyms are keys of other clusters, so their strings are already in the pool
+    SnapshotColumns columns;
+    columns.synonymBegins.push_back(0);
+    for (const auto& clusterSynonyms : synonymClusters) {
+        for (uint32_t clusterInd : clusterSynonyms) {
+            if (clusterInd >= clustersCount) {
+                throw std::out_of_range("Synonym cluster index " + std::to_string(clusterInd) + " is out of range");
+            }
+            columns.synonymIds.push_back(keyIds[clusterInd]);
+        }
+        columns.synonymBegins.push_back(columns.synonymIds.size());
+    }
+
+    columns.stringBegins = CopyColumn(stringBegins, stringsCount + 1);
+    columns.stringBytes = CopyColumn(stringBytes, stringBegins[stringsCount]);
+
+    columns.keyIds = CopyColumn(keyIds, clustersCount);
+    columns.modelNameIds = CopyColumn(modelNameIds, clustersCount);
+    columns.phraseSizes = CopyColumn(phraseSizes, clustersCount);
+    columns.frequencies = CopyColumn(frequencies, clustersCount);
+    columns.topicRelevances = CopyColumn(topicRelevances, clustersCount);
+    columns.centralityScores = CopyColumn(centralityScores, clustersCount);
+    columns.tagMatches = CopyColumn(tagMatches, clustersCount);
+    columns.isTerms = CopyColumn(isTerms, clustersCount);
+    columns.lemmaBegins = CopyColumn(lemmaBegins, clustersCount + 1);
+    columns.phraseBegins = CopyColumn(phraseBegins, clustersCount + 1);
+
+    columns.lemmaIds = CopyColumn(lemmaIds, lemmaSlotsCount);
+    columns.tfs = CopyColumn(tfs, lemmaSlotsCount);
+    columns.idfs = CopyColumn(idfs, lemmaSlotsCount);
+    columns.tfidfs = CopyColumn(tfidfs, lemmaSlotsCount);
+    columns.hypernymBegins = CopyColumn(hypernymBegins, lemmaSlotsCount + 1);
+    columns.hypernymIds = CopyColumn(hypernymIds, hypernymBegins[lemmaSlotsCount]);
+    columns.hyponymBegins = CopyColumn(hyponymBegins, lemmaSlotsCount + 1);
+    columns.hyponymIds = CopyColumn(hyponymIds, hyponymBegins[lemmaSlotsCount]);
+
+    columns.textFormIds = CopyColumn(textFormIds, phrasesCount);
+    columns.starts = CopyColumn(starts, phrasesCount);
+    columns.ends = CopyColumn(ends, phrasesCount);
+    columns.docNums = CopyColumn(docNums, phrasesCount);
+    columns.sentNums = CopyColumn(sentNums, phrasesCount);
+
+    // The file may be the one this snapshot maps, so it is replaced only after the new snapshot is complete
+    const std::string tempFilename = filename + ".tmp";
+    WriteColumns(tempFilename, columns);
+    std::filesystem::rename(tempFilename, filename);
+}
+
+StorageSnapshot::StorageSnapshot(const std::string& filename)
+    : StorageSnapshot(BinaryReader(filename, kMagic, kVersion))
+{
+}
+
+StorageSnapshot::StorageSnapshot(BinaryReader snapshotReader) : reader(std::move(snapshotReader))
+{
+    clustersCount = reader.Read<uint64_t>();
+    lemmaSlotsCount = reader.Read<uint64_t>();
+    phrasesCount = reader.Read<uint64_t>();
+    stringsCount = reader.Read<uint64_t>();
+    const uint64_t stringBytesCount = reader.Read<uint64_t>();
+    const uint64_t synonymsCount = reader.Read<uint64_t>();
+    const uint64_t hypernymsCount = reader.Read<uint64_t>();
+    const uint64_t hyponymsCount = reader.Read<uint64_t>();
+
+    stringBegins = reader.ReadArray<uint64_t>(stringsCount + 1);
+    stringBytes = reader.ReadArray<char>(stringBytesCount);
+
+    keyIds = reader.ReadArray<uint32_t>(clustersCount);
+    modelNameIds = reader.ReadArray<uint32_t>(clustersCount);
+    phraseSizes = reader.ReadArray<uint64_t>(clustersCount);
+    frequencies = reader.ReadArray<double>(clustersCount);
+    topicRelevances = reader.ReadArray<double>(clustersCount);
+    centralityScores = reader.ReadArray<double>(clustersCount);
+    tagMatches = reader.ReadArray<uint8_t>(clustersCount);
+    isTerms = reader.ReadArray<uint8_t>(clustersCount);
+    lemmaBegins = reader.ReadArray<uint64_t>(clustersCount + 1);
+    phraseBegins = reader.ReadArray<uint64_t>(clustersCount + 1);
+    synonymBegins = reader.ReadArray<uint64_t>(clustersCount + 1);
+    synonymIds = reader.ReadArray<uint32_t>(synonymsCount);
+
+    lemmaIds = reader.ReadArray<uint32_t>(lemmaSlotsCount);
+    tfs = reader.ReadArray<double>(lemmaSlotsCount);
+    idfs = reader.ReadArray<double>(lemmaSlotsCount);
+    tfidfs = reader.ReadArray<double>(lemmaSlotsCount);
+    hypernymBegins = reader.ReadArray<uint64_t>(lemmaSlotsCount + 1);
+    hypernymIds = reader.ReadArray<uint32_t>(hypernymsCount);
+    hyponymBegins = reader.ReadArray<uint64_t>(lemmaSlotsCount + 1);
+    hyponymIds = reader.ReadArray<uint32_t>(hyponymsCount);
+
+    textFormIds = reader.ReadArray<uint32_t>(phrasesCount);
+    starts = reader.ReadArray<uint64_t>(phrasesCount);
+    ends = reader.ReadArray<uint64_t>(phrasesCount);
+    docNums = reader.ReadArray<uint64_t>(phrasesCount);
+    sentNums = reader.ReadArray<uint64_t>(phrasesCount);
+
+    CheckOffsets(stringBegins, stringsCount, stringBytesCount, "string");
+    CheckOffsets(lemmaBegins, clustersCount, lemmaSlotsCount, "lemma");
+    CheckOffsets(phraseBegins, clustersCount, phrasesCount, "phrase");
+    CheckOffsets(synonymBegins, clustersCount, synonymsCount, "synonym");
+    CheckOffsets(hypernymBegins, lemmaSlotsCount, hypernymsCount, "hypernym");
+    CheckOffsets(hyponymBegins, lemmaSlotsCount, hyponymsCount, "hyponym");
+
+    CheckIds(keyIds, clustersCount, stringsCount, "key");
+    CheckIds(modelNameIds, clustersCount, stringsCount, "model name");
+    CheckIds(synonymIds, synonymsCount, stringsCount, "synonym");
+    CheckIds(lemmaIds, lemmaSlotsCount, stringsCount, "lemma");
+    CheckIds(hypernymIds, hypernymsCount, stringsCount, "hypernym");
+    CheckIds(hyponymIds, hyponymsCount, stringsCount, "hyponym");
+    CheckIds(textFormIds, phrasesCount, stringsCount, "text form");
+}
+
+std::optional<size_t> StorageSnapshot::FindCluster(std::string_view key) const
+{
+    size_t left = 0;
+    size_t right = clustersCount;
+    while (left < right) {
+        const size_t middle = left + (right - left) / 2;
+        if (GetKey(middle) < key) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+    if (left < clustersCount && GetKey(left) == key) {
+        return left;
+    }
+    return std::nullopt;
+}
+
+WordComplexCluster StorageSnapshot::MaterializeCluster(size_t clusterInd) const
+{
+    auto& dictionary = LemmaDictionary::GetDictionary();
+    WordComplexCluster cluster{};
+    cluster.key = std::string(GetKey(clusterInd));
+    cluster.modelName = std::string(GetString(modelNameIds[clusterInd]));
+    cluster.phraseSize = phraseSizes[clusterInd];
+    cluster.frequency = frequencies[clusterInd];
+    cluster.topicRelevance = topicRelevances[clusterInd];
+    cluster.centralityScore = centralityScores[clusterInd];
+    cluster.tagMatch = tagMatches[clusterInd] != 0;
+    cluster.is_term = isTerms[clusterInd] != 0;
+
+    for (uint64_t i = synonymBegins[clusterInd]; i < synonymBegins[clusterInd + 1]; ++i) {
+        cluster.synonyms.emplace(GetString(synonymIds[i]));
+    }
+
+    for (uint64_t slot = lemmaBegins[clusterInd]; slot < lemmaBegins[clusterInd + 1]; ++slot) {
+        std::string lemma(GetString(lemmaIds[slot]));
+        cluster.tf.push_back(tfs[slot]);
+        cluster.idf.push_back(idfs[slot]);
+        cluster.tfidf.push_back(tfidfs[slot]);
+
+        auto& hypernyms = cluster.hypernyms[lemma];
+        for (uint64_t i = hypernymBegins[slot]; i < hypernymBegins[slot + 1]; ++i) {
+            hypernyms.emplace(GetString(hypernymIds[i]));
+        }
+        auto& hyponyms = cluster.hyponyms[lemma];
+        for (uint64_t i = hyponymBegins[slot]; i < hyponymBegins[slot + 1]; ++i) {
+            hyponyms.emplace(GetString(hyponymIds[i]));
+        }
+
+        cluster.lemmaIds.push_back(dictionary.GetId(lemma));
+        cluster.lemmas.push_back(std::move(lemma));
+    }
+
+    cluster.wordComplexes.reserve(GetPhrasesCount(clusterInd));
+    for (uint64_t i = phraseBegins[clusterInd]; i < phraseBegins[clusterInd + 1]; ++i) {
+        WordComplexPtr wc = std::make_shared<WordComplex>();
+        wc->textForm = std::string(GetString(textFormIds[i]));
+        wc->modelName = cluster.modelName;
+        wc->pos = {starts[i], ends[i], docNums[i], sentNums[i]};
+        wc->lemmas.assign(cluster.lemmas.begin(), cluster.lemmas.end());
+        cluster.wordComplexes.push_back(std::move(wc));
+    }
+
+    return cluster;
+}
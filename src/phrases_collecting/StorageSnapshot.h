@@ -0,0 +1,138 @@
+#ifndef STORAGE_SNAPSHOT_H
+#define STORAGE_SNAPSHOT_H
+
+#include <BinaryIO.h>
+#include <PatternPhrasesStorage.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// \class StorageSnapshot
+// \brief Read-only view of a PatternPhrasesStorage saved in the binary format of total_results.bin. The file is
+//        memory-mapped and used in place: opening it sets up pointers to the columns and checks their offsets without
+//        copying or parsing anything, and any cluster is reached by its index in O(1).
+//
+//        Layout: all strings (keys, model names, lemmas, relations, synonyms and text forms) are stored once in a
+//        string pool. Every cluster field is a column indexed by the cluster, every lemma field is a column indexed by
+//        the lemma slot, and every phrase field is a column indexed by the phrase. Lemmas, phrases, synonyms and the
+//        hypernyms and hyponyms of lemmas are attached to their owners with CSR offset arrays. Clusters are sorted by
+//        key, so a key is found with a binary search.
+class StorageSnapshot {
+public:
+    static constexpr std::string_view kMagic = "ATTSTORE";
+    static constexpr uint32_t kVersion = 1;
+
+    // \brief Maps the snapshot and checks that its offsets and string ids stay inside the arrays they point into.
+    // \throws std::runtime_error if the file is missing, truncated, corrupted or has another format version.
+    explicit StorageSnapshot(const std::string& filename);
+
+    // \brief Same as above for a reader of a snapshot, e.g. a section of a PipelineImage.
+    explicit StorageSnapshot(BinaryReader snapshotReader);
+
+    // \brief Writes the clusters to a snapshot.
+    // \param filename          Path to the snapshot.
+    // \param clusters          Clusters sorted by key.
+    // \param textsCount        Number of processed texts; frequencies are saved relative to it, as in the JSON output.
+    static void Write(const std::string& filename, const std::vector<const WordComplexCluster*>& clusters,
+                      int textsCount);
+
+    // \brief Writes a copy of the snapshot with the synonyms replaced, without materializing the clusters. The file may
+    //        be the one this snapshot maps: it is replaced only after the copy has been written.
+    // \param filename          Path to the new snapshot.
+    // \param synonymClusters   For every cluster, the indices of the clusters whose keys are its synonyms, in
+    //                          ascending order.
+    // \throws std::invalid_argument if the synonyms are not given for every cluster, std::out_of_range if an index is
+    //         out of range.
+    void WriteWithSynonyms(const std::string& filename,
+                           const std::vector<std::vector<uint32_t>>& synonymClusters) const;
+
+    size_t ClustersCount() const
+    {
+        return clustersCount;
+    }
+
+    std::string_view GetKey(size_t clusterInd) const
+    {
+        return GetString(keyIds[clusterInd]);
+    }
+
+    double GetFrequency(size_t clusterInd) const
+    {
+        return frequencies[clusterInd];
+    }
+
+    double GetTopicRelevance(size_t clusterInd) const
+    {
+        return topicRelevances[clusterInd];
+    }
+
+    double GetCentralityScore(size_t clusterInd) const
+    {
+        return centralityScores[clusterInd];
+    }
+
+    size_t GetPhrasesCount(size_t clusterInd) const
+    {
+        return phraseBegins[clusterInd + 1] - phraseBegins[clusterInd];
+    }
+
+    // \brief Finds the index of the cluster with the given key.
+    std::optional<size_t> FindCluster(std::string_view key) const;
+
+    // \brief Builds a WordComplexCluster with all saved fields of the cluster.
+    WordComplexCluster MaterializeCluster(size_t clusterInd) const;
+
+private:
+    BinaryReader reader;
+
+    uint64_t clustersCount = 0;
+    uint64_t lemmaSlotsCount = 0;
+    uint64_t phrasesCount = 0;
+    uint64_t stringsCount = 0;
+
+    // String pool
+    const uint64_t* stringBegins = nullptr;
+    const char* stringBytes = nullptr;
+
+    // Cluster columns
+    const uint32_t* keyIds = nullptr;
+    const uint32_t* modelNameIds = nullptr;
+    const uint64_t* phraseSizes = nullptr;
+    const double* frequencies = nullptr;
+    const double* topicRelevances = nullptr;
+    const double* centralityScores = nullptr;
+    const uint8_t* tagMatches = nullptr;
+    const uint8_t* isTerms = nullptr;
+    const uint64_t* lemmaBegins = nullptr;
+    const uint64_t* phraseBegins = nullptr;
+    const uint64_t* synonymBegins = nullptr;
+    const uint32_t* synonymIds = nullptr;
+
+    // Lemma columns
+    const uint32_t* lemmaIds = nullptr;
+    const double* tfs = nullptr;
+    const double* idfs = nullptr;
+    const double* tfidfs = nullptr;
+    const uint64_t* hypernymBegins = nullptr;
+    const uint32_t* hypernymIds = nullptr;
+    const uint64_t* hyponymBegins = nullptr;
+    const uint32_t* hyponymIds = nullptr;
+
+    // Phrase columns
+    const uint32_t* textFormIds = nullptr;
+    const uint64_t* starts = nullptr;
+    const uint64_t* ends = nullptr;
+    const uint64_t* docNums = nullptr;
+    const uint64_t* sentNums = nullptr;
+
+    std::string_view GetString(uint32_t stringId) const
+    {
+        return std::string_view(stringBytes + stringBegins[stringId],
+                                stringBegins[stringId + 1] - stringBegins[stringId]);
+    }
+};
+
+#endif // STORAGE_SNAPSHOT_H
@@ -41,12 +41,12 @@ namespace PhrasesCollectorUtils {
         return wc;
     }
 
-    WordComplexPtr InicializeWordComplex(const size_t tokenInd, const WordFormPtr token, const std::string modelName,
-                                         const Process& process)
+    WordComplexPtr InicializeWordComplex(const size_t tokenInd, const WordFormPtr token, const std::string& lemma,
+                                         const std::string modelName, const Process& process)
     {
         WordComplexPtr wc = std::make_shared<WordComplex>();
         wc->words.push_back(token);
-        wc->lemmas.push_back(GetLemma(token));
+        wc->lemmas.push_back(lemma);
         wc->textForm = token->getWordForm().getRawString();
         wc->pos = {tokenInd, tokenInd, process.docNum, process.sentNum};
         wc->modelName = modelName;
@@ -54,17 +54,17 @@ namespace PhrasesCollectorUtils {
         return wc;
     }
 
-    void UpdateWordComplex(const WordComplexPtr& wc, const WordFormPtr& form, const std::string& formFromText,
-                           bool isLeft)
+    void UpdateWordComplex(const WordComplexPtr& wc, const WordFormPtr& form, const std::string& lemma,
+                           const std::string& formFromText, bool isLeft)
     {
         if (isLeft) {
             wc->words.push_front(form);
-            wc->lemmas.push_front(GetLemma(form));
+            wc->lemmas.push_front(lemma);
             wc->pos.start--;
             wc->textForm.insert(0, formFromText + " ");
         } else {
             wc->words.push_back(form);
-            wc->lemmas.push_back(GetLemma(form));
+            wc->lemmas.push_back(lemma);
             wc->pos.end++;
             wc->textForm.append(" " + formFromText);
         }
@@ -72,17 +72,13 @@ namespace PhrasesCollectorUtils {
 
     void AddWordsToFront(const WordComplexPtr& wc, const WordComplexPtr& asidePhrase)
     {
-        for (auto rit = asidePhrase->words.rbegin(); rit != asidePhrase->words.rend(); ++rit) {
-            wc->words.push_front(*rit);
-            wc->lemmas.push_front(GetLemma(*rit));
-        }
+        wc->words.insert(wc->words.begin(), asidePhrase->words.begin(), asidePhrase->words.end());
+        wc->lemmas.insert(wc->lemmas.begin(), asidePhrase->lemmas.begin(), asidePhrase->lemmas.end());
     }
 
     void AddWordsToBack(const WordComplexPtr& wc, const WordComplexPtr& asidePhrase)
     {
-        for (const auto& word : asidePhrase->words) {
-            wc->words.push_back(word);
-            wc->lemmas.push_back(GetLemma(word));
-        }
+        wc->words.insert(wc->words.end(), asidePhrase->words.begin(), asidePhrase->words.end());
+        wc->lemmas.insert(wc->lemmas.end(), asidePhrase->lemmas.begin(), asidePhrase->lemmas.end());
     }
 }
\ No newline at end of file
@@ -54,26 +54,28 @@ namespace PhrasesCollectorUtils {
     // \brief Initializes a WordComplex object with the given parameters.
     // \param tokenInd      The index of the token.
     // \param token         The WordFormPtr token.
+    // \param lemma         Lemma of the analysis of the token that matched the pattern.
     // \param modelName     The name of the model.
     // \param process       The process associated with the initialization.
     // \return              A shared pointer to the initialized WordComplex object.
-    WordComplexPtr InicializeWordComplex(const size_t tokenInd, const WordFormPtr token, const std::string modelName,
-                                         const Process& process);
+    WordComplexPtr InicializeWordComplex(const size_t tokenInd, const WordFormPtr token, const std::string& lemma,
+                                         const std::string modelName, const Process& process);
 
     // \brief Updates a WordComplex object with the given form and text form.
     // \param wc            A shared pointer to the WordComplex object to update.
     // \param form          The WordFormPtr form to add.
+    // \param lemma         Lemma of the analysis of the form that matched the pattern.
     // \param formFromText  The form from the text to add.
     // \param isLeft        A boolean indicating if the form is added to the left.
-    void UpdateWordComplex(const WordComplexPtr& wc, const WordFormPtr& form, const std::string& formFromText,
-                           bool isLeft);
+    void UpdateWordComplex(const WordComplexPtr& wc, const WordFormPtr& form, const std::string& lemma,
+                           const std::string& formFromText, bool isLeft);
 
-    // \brief Adds words to the front of a WordComplex object.
+    // \brief Adds the words of the aside phrase with their lemmas to the front of a WordComplex object.
     // \param wc            A shared pointer to the WordComplex object to update.
     // \param asidePhrase   A shared pointer to the aside phrase to add.
     void AddWordsToFront(const WordComplexPtr& wc, const WordComplexPtr& asidePhrase);
 
-    // \brief Adds words to the back of a WordComplex object.
+    // \brief Adds the words of the aside phrase with their lemmas to the back of a WordComplex object.
     // \param wc            A shared pointer to the WordComplex object to update.
     // \param asidePhrase   A shared pointer to the aside phrase to add.
     void AddWordsToBack(const WordComplexPtr& wc, const WordComplexPtr& asidePhrase);
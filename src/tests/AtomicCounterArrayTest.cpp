@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <AtomicCounterArray.h>
+#include <ParallelFor.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr size_t kThreadsCount = 16;
+constexpr size_t kDocumentsCount = 256;
+constexpr uint32_t kIdsPerDocument = 5000;
+
+// Documents share most of their ids and every one adds a few ids past the end of the previous ones, so threads
+// contend on the same counters while others allocate new segments
+uint32_t IdOf(size_t document, uint32_t index)
+{
+    return static_cast<uint32_t>((index * 7919 + document * 97) % (kIdsPerDocument + document * 40));
+}
+
+} // namespace
+
+TEST(AtomicCounterArrayTest, MissingCountersAreToldApartFromZero)
+{
+    AtomicCounterArray counters;
+    EXPECT_EQ(counters.Size(), 0u);
+    EXPECT_EQ(counters.Get(0), AtomicCounterArray::kMissing);
+    EXPECT_EQ(counters.Get(UINT32_MAX), AtomicCounterArray::kMissing);
+
+    counters.Set(3, 0);
+    counters.Add(5, 2);
+    counters.Add(5, 3);
+    counters.Add(1000000, 1);
+    EXPECT_EQ(counters.Get(3), 0);
+    EXPECT_EQ(counters.Get(4), AtomicCounterArray::kMissing);
+    EXPECT_EQ(counters.Get(5), 5);
+    EXPECT_EQ(counters.Get(1000000), 1);
+    EXPECT_EQ(counters.Get(999999), AtomicCounterArray::kMissing);
+    EXPECT_GT(counters.Size(), 1000000u);
+
+    counters.Clear();
+    EXPECT_EQ(counters.Size(), 0u);
+    EXPECT_EQ(counters.Get(5), AtomicCounterArray::kMissing);
+}
+
+TEST(AtomicCounterArrayTest, SegmentsCoverConsecutiveIds)
+{
+    AtomicCounterArray counters;
+    for (uint32_t id = 0; id < 100000; ++id) {
+        counters.Set(id, static_cast<int32_t>(id));
+    }
+    for (uint32_t id = 0; id < 100000; ++id) {
+        ASSERT_EQ(counters.Get(id), static_cast<int32_t>(id));
+    }
+    EXPECT_GE(counters.Size(), 100000u);
+    EXPECT_EQ(counters.Get(counters.Size()), AtomicCounterArray::kMissing);
+}
+
+TEST(AtomicCounterArrayTest, ConcurrentAddsMatchSerialCounts)
+{
+    AtomicCounterArray counters;
+    ParallelFor(kDocumentsCount, kThreadsCount, [&](size_t document) {
+        for (uint32_t index = 0; index < kIdsPerDocument; ++index) {
+            counters.Add(IdOf(document, index), 1 + index % 3);
+        }
+    });
+
+    std::vector<int32_t> expected;
+    for (size_t document = 0; document < kDocumentsCount; ++document) {
+        for (uint32_t index = 0; index < kIdsPerDocument; ++index) {
+            const uint32_t id = IdOf(document, index);
+            if (id >= expected.size()) {
+                expected.resize(id + 1, AtomicCounterArray::kMissing);
+            }
+            expected[id] = std::max(expected[id], 0) + static_cast<int32_t>(1 + index % 3);
+        }
+    }
+    for (uint32_t id = 0; id < expected.size(); ++id) {
+        ASSERT_EQ(counters.Get(id), expected[id]) << "id " << id;
+    }
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <BinaryIO.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::string_view kMagic = "TESTBIN0";
+
+fs::path TempPath(const std::string& name)
+{
+    return fs::temp_directory_path() / ("binary_io_test_" + name);
+}
+
+} // namespace
+
+TEST(BinaryIOTest, ValuesAndStringsRoundTrip)
+{
+    const fs::path path = TempPath("round_trip");
+    {
+        BinaryWriter writer(path.string(), kMagic, 3);
+        writer.Write(static_cast<uint64_t>(42));
+        writer.WriteString("лемма");
+        writer.WriteString("");
+        writer.Write(0.25);
+        writer.Close();
+    }
+
+    BinaryReader reader(path.string(), kMagic, 3);
+    EXPECT_EQ(reader.Read<uint64_t>(), 42u);
+    EXPECT_EQ(reader.ReadString(), "лемма");
+    EXPECT_EQ(reader.ReadStringView(), "");
+    EXPECT_EQ(reader.Read<double>(), 0.25);
+    EXPECT_TRUE(reader.AtEnd());
+    EXPECT_THROW(reader.Read<uint32_t>(), std::runtime_error);
+
+    fs::remove(path);
+}
+
+TEST(BinaryIOTest, ArraysAreAlignedInPlace)
+{
+    const fs::path path = TempPath("arrays");
+    const std::vector<uint8_t> flags = {1, 0, 1};
+    const std::vector<double> values = {0.5, 1.5};
+    {
+        BinaryWriter writer(path.string(), kMagic, 1);
+        writer.WriteArray(flags);
+        writer.WriteArray(values);
+        writer.WriteArray(std::vector<uint64_t>{});
+        writer.Close();
+    }
+
+    BinaryReader reader(path.string(), kMagic, 1);
+    const uint8_t* readFlags = reader.ReadArray<uint8_t>(flags.size());
+    const double* readValues = reader.ReadArray<double>(values.size());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(readValues) % alignof(double), 0u);
+    EXPECT_EQ(std::vector<uint8_t>(readFlags, readFlags + flags.size()), flags);
+    EXPECT_EQ(std::vector<double>(readValues, readValues + values.size()), values);
+    reader.ReadArray<uint64_t>(0);
+    EXPECT_TRUE(reader.AtEnd());
+    EXPECT_THROW(reader.ReadArray<uint64_t>(1), std::runtime_error);
+
+    fs::remove(path);
+}
+
+TEST(BinaryIOTest, RejectsForeignFilesAndOtherVersions)
+{
+    const fs::path path = TempPath("header");
+    {
+        BinaryWriter writer(path.string(), kMagic, 1);
+        writer.Close();
+    }
+
+    EXPECT_THROW(BinaryReader(path.string(), kMagic, 2), std::runtime_error);
+    EXPECT_THROW(BinaryReader(path.string(), "OTHERBIN", 1), std::runtime_error);
+    EXPECT_NO_THROW(BinaryReader(path.string(), kMagic, 1));
+
+    fs::remove(path);
+}
+
+TEST(BinaryIOTest, DetectsTruncatedStrings)
+{
+    const fs::path path = TempPath("truncated");
+    {
+        BinaryWriter writer(path.string(), kMagic, 1);
+        writer.Write(static_cast<uint32_t>(100));
+        writer.Close();
+    }
+
+    BinaryReader reader(path.string(), kMagic, 1);
+    EXPECT_THROW(reader.ReadStringView(), std::runtime_error);
+
+    fs::remove(path);
+}
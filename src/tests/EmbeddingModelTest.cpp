@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <Embedding.h>
+#include <PhrasesCollectorUtils.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint64_t kBucket = 100;
+
+// Writes a model in the layout of FastTextModel::Convert with 3-character ngrams, 2 dimensions and the single word
+// "да". The word row is (1, 0) and the row of ngram bucket b is (0, b), so the second value of a word vector is the
+// mean bucket of its ngrams.
+fs::path WriteModel(const std::string& name, bool quantize)
+{
+    const fs::path path = fs::temp_directory_path() / ("embedding_model_test_" + name);
+    const std::string word = "да";
+
+    BinaryWriter writer(path.string(), MappedEmbeddingModel::kMagic, MappedEmbeddingModel::kVersion);
+    writer.Write(static_cast<uint32_t>(2));
+    writer.Write(static_cast<uint32_t>(3));
+    writer.Write(static_cast<uint32_t>(3));
+    writer.Write(static_cast<uint64_t>(1));
+    writer.Write(kBucket);
+    writer.Write(static_cast<uint8_t>(quantize));
+    writer.Write(static_cast<uint64_t>(word.size()));
+    writer.WriteArray(std::vector<uint64_t>{0, word.size()});
+    writer.WriteArray(std::vector<char>(word.begin(), word.end()));
+    writer.WriteArray(std::vector<uint32_t>{0});
+
+    std::vector<float> rows{1.0f, 0.0f};
+    for (uint64_t bucket = 0; bucket < kBucket; ++bucket) {
+        rows.push_back(0.0f);
+        rows.push_back(static_cast<float>(bucket));
+    }
+    if (quantize) {
+        writer.WriteArray(std::vector<int8_t>(rows.begin(), rows.end()));
+        writer.WriteArray(std::vector<float>(1 + kBucket, 1.0f));
+    } else {
+        writer.WriteArray(rows);
+    }
+    writer.Close();
+    return path;
+}
+
+// Writes embeddings in the layout of LemmaEmbeddings::SaveEmbeddings
+void WriteEmbeddings(const fs::path& path, const std::vector<std::string>& words, const std::vector<float>& rows)
+{
+    std::vector<uint64_t> wordBegins{0};
+    std::vector<char> wordBytes;
+    for (const auto& word : words) {
+        wordBytes.insert(wordBytes.end(), word.begin(), word.end());
+        wordBegins.push_back(wordBytes.size());
+    }
+    BinaryWriter writer(path.string(), LemmaEmbeddings::kMagic, LemmaEmbeddings::kVersion);
+    writer.Write(static_cast<uint64_t>(words.size()));
+    writer.Write(static_cast<uint32_t>(rows.size() / words.size()));
+    writer.WriteString(Embedding::GetModelIdentity());
+    writer.Write(static_cast<uint64_t>(wordBytes.size()));
+    writer.WriteArray(wordBegins);
+    writer.WriteArray(wordBytes);
+    writer.WriteArray(rows);
+    writer.Close();
+}
+
+// Words of a file written by LemmaEmbeddings::SaveEmbeddings
+std::vector<std::string> ReadEmbeddingWords(const fs::path& path)
+{
+    BinaryReader reader(path.string(), LemmaEmbeddings::kMagic, LemmaEmbeddings::kVersion);
+    const uint64_t wordsCount = reader.Read<uint64_t>();
+    reader.Read<uint32_t>();
+    reader.ReadStringView();
+    const uint64_t wordBytesCount = reader.Read<uint64_t>();
+    const uint64_t* wordBegins = reader.ReadArray<uint64_t>(wordsCount + 1);
+    const char* wordBytes = reader.ReadArray<char>(wordBytesCount);
+    std::vector<std::string> words;
+    for (uint64_t i = 0; i < wordsCount; ++i) {
+        words.emplace_back(wordBytes + wordBegins[i], wordBegins[i + 1] - wordBegins[i]);
+    }
+    return words;
+}
+
+} // namespace
+
+TEST(EmbeddingModelTest, NgramHashMatchesFastText)
+{
+    // Reference FNV-1a values, which fastText shares for ASCII
+    EXPECT_EQ(MappedEmbeddingModel::NgramHash(""), 2166136261u);
+    EXPECT_EQ(MappedEmbeddingModel::NgramHash("a"), 0xe40c292cu);
+    EXPECT_EQ(MappedEmbeddingModel::NgramHash("foobar"), 0xbf9cf968u);
+
+    // fastText sign-extends the bytes, so Cyrillic ngrams differ from the reference FNV-1a (0xb31389d7 and 0x917ce975)
+    EXPECT_EQ(MappedEmbeddingModel::NgramHash("<да"), 0xccf679d7u);
+    EXPECT_EQ(MappedEmbeddingModel::NgramHash("да>"), 0x2aa00f75u);
+}
+
+TEST(EmbeddingModelTest, WordVectorAveragesWordAndNgramRows)
+{
+    for (bool quantize : {false, true}) {
+        const fs::path path = WriteModel(quantize ? "int8" : "float", quantize);
+        const MappedEmbeddingModel model(path.string());
+        EXPECT_EQ(model.IsQuantized(), quantize);
+
+        // "<да>" has the ngrams "<да" and "да>" in buckets 0xccf679d7 % 100 = 11 and 0x2aa00f75 % 100 = 89
+        const std::vector<float> known = model.GetWordVector("да");
+        ASSERT_EQ(known.size(), 2u);
+        EXPECT_FLOAT_EQ(known[0], 1.0f / 3);
+        EXPECT_FLOAT_EQ(known[1], (11.0f + 89.0f) / 3);
+
+        // Out-of-vocabulary words only average their ngrams: "<ab" and "ab>" fall into buckets 8 and 56
+        const std::vector<float> unknown = model.GetWordVector("ab");
+        EXPECT_FLOAT_EQ(unknown[0], 0.0f);
+        EXPECT_FLOAT_EQ(unknown[1], (8.0f + 56.0f) / 2);
+
+        fs::remove(path);
+    }
+}
+
+TEST(EmbeddingModelTest, CacheKeepsWordsOutOfLemmaDictionary)
+{
+    auto& dictionary = LemmaDictionary::GetDictionary();
+    auto& cache = LemmaEmbeddings::GetInstance();
+    const std::string phrase = "ключевая фраза кэша";
+    const std::string lemma = "лемма кэша";
+    const fs::path path = fs::temp_directory_path() / "embedding_model_test_embeddings";
+    // The cache is process-wide and takes the dimension of its first embedding, so tests store 3 values per word
+    WriteEmbeddings(path, {phrase, lemma}, {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f});
+
+    BinaryReader reader(path.string(), LemmaEmbeddings::kMagic, LemmaEmbeddings::kVersion);
+    ASSERT_TRUE(cache.LoadEmbeddings(reader));
+    EXPECT_EQ(dictionary.FindId(phrase), LemmaDictionary::kUnknownId);
+    EXPECT_EQ(dictionary.FindId(lemma), LemmaDictionary::kUnknownId);
+
+    // No model is configured, so every embedding below comes from the loaded file
+    const uint64_t misses = cache.GetMisses();
+    const WordEmbedding phraseEmbedding(phrase);
+    ASSERT_EQ(phraseEmbedding.Size(), 3u);
+    EXPECT_FLOAT_EQ(phraseEmbedding.Data()[0], 1.0f);
+    EXPECT_FLOAT_EQ(phraseEmbedding.Data()[2], 3.0f);
+    EXPECT_EQ(dictionary.FindId(phrase), LemmaDictionary::kUnknownId);
+
+    // A word that becomes a lemma later shares the row loaded for it
+    const WordEmbedding lemmaBefore(lemma);
+    const WordEmbeddingPtr byId = cache.GetEmbedding(dictionary.GetId(lemma));
+    EXPECT_EQ(byId->Data(), lemmaBefore.Data());
+    EXPECT_EQ(WordEmbedding(lemma).Data(), lemmaBefore.Data());
+    EXPECT_FLOAT_EQ(byId->Data()[0], 4.0f);
+    EXPECT_EQ(cache.GetMisses(), misses);
+
+    // The shared row is saved once
+    cache.SaveEmbeddings(path.string());
+    const std::vector<std::string> words = ReadEmbeddingWords(path);
+    EXPECT_EQ(std::count(words.begin(), words.end(), phrase), 1);
+    EXPECT_EQ(std::count(words.begin(), words.end(), lemma), 1);
+
+    fs::remove(path);
+}
+
+TEST(EmbeddingModelTest, LoadErrorIsRethrownToLaterRequests)
+{
+    // The model is loaded once per process and no other test loads it, so this request is the first one
+    auto& options = PhrasesCollectorUtils::Options::getOptions();
+    const fs::path savedModelFile = options.embeddingModelFile;
+    options.embeddingModelFile = fs::temp_directory_path() / "embedding_model_test_late_model";
+    fs::remove(options.embeddingModelFile);
+
+    std::string firstError;
+    try {
+        Embedding::GetWordVector("да");
+        FAIL() << "A missing model was loaded";
+    } catch (const std::runtime_error& ex) {
+        firstError = ex.what();
+    }
+    EXPECT_NE(firstError.find("Could not open embedding model"), std::string::npos) << firstError;
+
+    // The model is not looked for again once the file appears
+    const fs::path modelPath = WriteModel("late_model", false);
+    try {
+        Embedding::GetWordVector("да");
+        FAIL() << "The model was loaded after the first attempt failed";
+    } catch (const std::runtime_error& ex) {
+        EXPECT_EQ(ex.what(), firstError);
+    }
+
+    fs::remove(modelPath);
+    options.embeddingModelFile = savedModelFile;
+}
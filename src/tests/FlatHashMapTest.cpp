@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <FlatHashMap.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+TEST(FlatHashMapTest, MatchesUnorderedMapUnderRandomOperations)
+{
+    FlatHashMap<std::string, int> map;
+    std::unordered_map<std::string, int> expected;
+    std::mt19937 random(42);
+
+    for (int step = 0; step < 200000; ++step) {
+        const std::string key = "лемма_" + std::to_string(random() % 5000);
+        switch (random() % 4) {
+        case 0:
+        case 1:
+            map[key] += step;
+            expected[key] += step;
+            break;
+        case 2:
+            EXPECT_EQ(map.erase(key), expected.erase(key));
+            break;
+        default:
+            EXPECT_EQ(map.count(key), expected.count(key));
+            break;
+        }
+    }
+
+    ASSERT_EQ(map.size(), expected.size());
+    for (const auto& [key, value] : expected) {
+        auto it = map.find(key);
+        ASSERT_NE(it, map.end());
+        EXPECT_EQ(it->second, value);
+    }
+    size_t visited = 0;
+    for (const auto& [key, value] : map) {
+        EXPECT_EQ(expected.at(key), value);
+        ++visited;
+    }
+    EXPECT_EQ(visited, expected.size());
+}
+
+TEST(FlatHashMapTest, HeterogeneousLookup)
+{
+    FlatHashMap<std::string, int> map;
+    map.try_emplace(std::string_view("термин"), 1);
+    map["слово"] = 2;
+
+    const std::string_view key = "термин";
+    EXPECT_EQ(map.at(key), 1);
+    EXPECT_EQ(map.count("слово"), 1u);
+    EXPECT_EQ(map.find(std::string_view("нет")), map.end());
+    EXPECT_THROW(map.at("нет"), std::out_of_range);
+    EXPECT_FALSE(map.try_emplace(key, 5).second);
+    EXPECT_EQ(map.at(key), 1);
+}
+
+TEST(FlatHashMapTest, EraseWhileIterating)
+{
+    FlatHashMap<int, int> map;
+    map.reserve(1000);
+    const size_t bucketsCount = map.bucket_count();
+    for (int i = 0; i < 1000; ++i) {
+        map[i] = i;
+    }
+    EXPECT_EQ(map.bucket_count(), bucketsCount);
+
+    for (auto it = map.begin(); it != map.end();) {
+        it = it->first % 3 == 0 ? map.erase(it) : std::next(it);
+    }
+
+    EXPECT_EQ(map.size(), 666u);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(map.count(i), i % 3 == 0 ? 0u : 1u);
+    }
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(1), map.end());
+}
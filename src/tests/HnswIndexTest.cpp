@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <HnswIndex.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+
+constexpr size_t kDimension = 32;
+
+// Vectors scattered around a few centres, so that every vector has close neighbours as cluster keys do
+struct ClusteredVectors {
+    ClusteredVectors(size_t count, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::normal_distribution<float> value(0.0f, 1.0f);
+        std::vector<std::vector<float>> centres(20, std::vector<float>(kDimension));
+        for (auto& centre : centres) {
+            std::generate(centre.begin(), centre.end(), [&] { return value(random); });
+        }
+        for (size_t i = 0; i < count; ++i) {
+            std::vector<float> vector = centres[i % centres.size()];
+            for (float& x : vector) {
+                x += 0.5f * value(random);
+            }
+            vectors.push_back(std::move(vector));
+        }
+    }
+
+    std::vector<const float*> Rows() const
+    {
+        std::vector<const float*> rows;
+        for (const auto& vector : vectors) {
+            rows.push_back(vector.data());
+        }
+        return rows;
+    }
+
+    std::vector<std::vector<float>> vectors;
+};
+
+double Recall(const HnswIndex& index, const ClusteredVectors& queries, size_t k, size_t ef)
+{
+    size_t found = 0;
+    size_t total = 0;
+    for (const auto& query : queries.vectors) {
+        std::set<uint32_t> exact;
+        for (const auto& neighbor : index.ExactSearch(query.data(), k)) {
+            exact.insert(neighbor.id);
+        }
+        for (const auto& neighbor : index.Search(query.data(), k, ef)) {
+            found += exact.count(neighbor.id);
+        }
+        total += exact.size();
+    }
+    return static_cast<double>(found) / total;
+}
+
+} // namespace
+
+TEST(HnswIndexTest, SearchFindsMostExactNeighbours)
+{
+    const ClusteredVectors data(3000, 1);
+    const ClusteredVectors queries(100, 2);
+    for (size_t threadsCount : {1, 4}) {
+        HnswIndex index;
+        index.Build(data.Rows(), kDimension, threadsCount);
+        ASSERT_EQ(index.Size(), data.vectors.size());
+        EXPECT_GT(Recall(index, queries, 10, 100), 0.95) << threadsCount << " threads";
+    }
+}
+
+TEST(HnswIndexTest, SearchReturnsSortedNeighbours)
+{
+    const ClusteredVectors data(500, 3);
+    HnswIndex index;
+    index.Build(data.Rows(), kDimension);
+
+    const auto neighbors = index.Search(data.vectors[7].data(), 10);
+    ASSERT_EQ(neighbors.size(), 10u);
+    EXPECT_EQ(neighbors[0].id, 7u);
+    EXPECT_NEAR(neighbors[0].similarity, 1.0f, 1e-5f);
+    for (size_t i = 1; i < neighbors.size(); ++i) {
+        EXPECT_GE(neighbors[i - 1].similarity, neighbors[i].similarity);
+    }
+    EXPECT_EQ(index.Search(data.vectors[7].data(), 1000).size(), data.vectors.size());
+}
+
+TEST(HnswIndexTest, RadiusSearchFindsVectorsAboveBound)
+{
+    const ClusteredVectors data(2000, 4);
+    HnswIndex index;
+    index.Build(data.Rows(), kDimension, 2);
+
+    const float minSimilarity = 0.8f;
+    size_t found = 0;
+    size_t expected = 0;
+    for (size_t query = 0; query < 50; ++query) {
+        const auto neighbors = index.SearchRadius(data.vectors[query].data(), minSimilarity);
+        for (const auto& neighbor : neighbors) {
+            EXPECT_GE(neighbor.similarity, minSimilarity);
+        }
+        for (const auto& neighbor : index.ExactSearch(data.vectors[query].data(), data.vectors.size())) {
+            expected += neighbor.similarity >= minSimilarity;
+        }
+        found += neighbors.size();
+    }
+    ASSERT_GT(expected, 0u);
+    EXPECT_GT(static_cast<double>(found) / expected, 0.95);
+}
+
+TEST(HnswIndexTest, SaveAndLoadKeepSearchResults)
+{
+    const ClusteredVectors data(1000, 5);
+    HnswIndex index;
+    index.Build(data.Rows(), kDimension, 3);
+
+    const std::string filename = (std::filesystem::temp_directory_path() / "hnsw_index_test.bin").string();
+    index.Save(filename);
+    HnswIndex loaded;
+    loaded.Load(filename);
+    std::remove(filename.c_str());
+
+    ASSERT_EQ(loaded.Size(), index.Size());
+    ASSERT_EQ(loaded.Dimension(), index.Dimension());
+    for (size_t query = 0; query < 20; ++query) {
+        const auto expected = index.Search(data.vectors[query].data(), 5);
+        const auto actual = loaded.Search(data.vectors[query].data(), 5);
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(actual[i].id, expected[i].id);
+            EXPECT_EQ(actual[i].similarity, expected[i].similarity);
+        }
+    }
+}
+
+TEST(HnswIndexTest, EmptyIndex)
+{
+    HnswIndex index;
+    index.Build({}, kDimension);
+    const std::vector<float> query(kDimension, 1.0f);
+    EXPECT_TRUE(index.Search(query.data(), 5).empty());
+    EXPECT_TRUE(index.SearchRadius(query.data(), 0.5f).empty());
+}
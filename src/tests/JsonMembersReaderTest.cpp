@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <JsonMembersReader.h>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Members in the order the reader reported them
+std::vector<std::pair<std::string, json>> ReadMembers(const std::string& text)
+{
+    std::vector<std::pair<std::string, json>> members;
+    JsonMembersReader reader([&](const std::string& key, const json& value) { members.emplace_back(key, value); });
+    json::sax_parse(text, &reader);
+    return members;
+}
+
+} // namespace
+
+TEST(JsonMembersReaderTest, MembersMatchDomParse)
+{
+    const std::string text = R"({
+        "кластер": {"0_phrase_size": 2, "6_lemmas": [{"0_lemma": "0_анализ", "4_hypernyms": ["метод", "процесс"]},
+                                                     {"0_lemma": "1_данные", "4_hypernyms": []}],
+                    "nested_clusters": [{"00_key": "кластер данных", "deep": {"a": [1, [2, [3, {}]]]}}]},
+        "скаляр": -1.5,
+        "пустой объект": {},
+        "пустой массив": [],
+        "массив": [true, false, null, 18446744073709551615, -3, "строка"],
+        "строка": "значение"
+    })";
+
+    const auto members = ReadMembers(text);
+    const json expected = json::parse(text);
+    const std::vector<std::string> expectedKeys = {"кластер",       "скаляр", "пустой объект",
+                                                   "пустой массив", "массив", "строка"};
+    ASSERT_EQ(members.size(), expectedKeys.size());
+    for (size_t i = 0; i < members.size(); ++i) {
+        EXPECT_EQ(members[i].first, expectedKeys[i]);
+        EXPECT_EQ(members[i].second, expected.at(expectedKeys[i])) << expectedKeys[i];
+    }
+}
+
+TEST(JsonMembersReaderTest, EscapedKeysAndStringsAreDecoded)
+{
+    const json expected = {{"ключ \"в кавычках\"", {{"вложенный\\ключ", "строка\nс \t переводом"}}},
+                           {"\u0001управляющий", json::array({"\\\"", "é"})},
+                           {"", {{"", ""}}}};
+    const auto members = ReadMembers(expected.dump());
+    ASSERT_EQ(members.size(), expected.size());
+    for (const auto& [key, value] : members) {
+        EXPECT_EQ(value, expected.at(key)) << key;
+    }
+}
+
+TEST(JsonMembersReaderTest, EmptyObjectHasNoMembers)
+{
+    EXPECT_TRUE(ReadMembers("{}").empty());
+    EXPECT_TRUE(ReadMembers("  {\n}  ").empty());
+}
+
+TEST(JsonMembersReaderTest, RejectsDocumentsThatAreNotObjects)
+{
+    EXPECT_THROW(ReadMembers("[{\"a\": 1}]"), std::runtime_error);
+    EXPECT_THROW(ReadMembers("42"), std::runtime_error);
+    EXPECT_THROW(ReadMembers("\"строка\""), std::runtime_error);
+}
+
+TEST(JsonMembersReaderTest, RejectsMalformedInput)
+{
+    const std::vector<std::string> malformed = {
+        "",
+        "{",
+        "{\"a\": 1",
+        "{\"a\" 1}",
+        "{\"a\": [1, 2}",
+        "{\"a\": {\"b\": }}",
+        "{\"a\": 1,}",
+        "{\"a\": \"незакрытая строка}",
+        "{\"a\": 1} лишнее",
+    };
+    for (const auto& text : malformed) {
+        EXPECT_THROW(ReadMembers(text), json::exception) << text;
+    }
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <GrammarCondition.h>
+#include <LemmaDictionary.h>
+#include <MorphLattice.h>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+LatticeCandidate Candidate(const std::string& lemma, X::UniSPTag sp, const X::UniMorphTag& tag, double probability)
+{
+    return {LemmaDictionary::GetDictionary().GetId(lemma), sp, MorphTagMask::Encode(tag), probability};
+}
+
+// "стали": most probably the verb "стать", less probably the genitive of the noun "сталь"
+std::vector<LatticeCandidate> AmbiguousToken()
+{
+    return {Candidate("стать", X::UniSPTag::VERB, X::UniMorphTag::Past | X::UniMorphTag::Plur, 0.7),
+            Candidate("сталь", X::UniSPTag::NOUN, X::UniMorphTag::Gen | X::UniMorphTag::Sing, 0.2),
+            Candidate("сталь", X::UniSPTag::NOUN, X::UniMorphTag::Nom | X::UniMorphTag::Plur, 0.1)};
+}
+
+} // namespace
+
+TEST(MorphTagMaskTest, EncodesEveryAttributeGroupSeparately)
+{
+    const uint64_t genSing = MorphTagMask::Encode(X::UniMorphTag::Gen | X::UniMorphTag::Sing);
+    const uint64_t genPlur = MorphTagMask::Encode(X::UniMorphTag::Gen | X::UniMorphTag::Plur);
+    const uint64_t nomSing = MorphTagMask::Encode(X::UniMorphTag::Nom | X::UniMorphTag::Sing);
+    EXPECT_NE(genSing, genPlur);
+    EXPECT_NE(genSing, nomSing);
+    EXPECT_EQ(MorphTagMask::Encode(X::UniMorphTag::UNKN), 0u);
+
+    // A condition on the case alone ignores the number of the form
+    const uint64_t gen = MorphTagMask::Encode(X::UniMorphTag::Gen);
+    const uint64_t genFields = MorphTagMask::FieldMask(gen);
+    EXPECT_TRUE(MorphTagMask::Matches(genSing, gen, genFields));
+    EXPECT_TRUE(MorphTagMask::Matches(genPlur, gen, genFields));
+    EXPECT_FALSE(MorphTagMask::Matches(nomSing, gen, genFields));
+    EXPECT_EQ(MorphTagMask::FieldMask(genSing), MorphTagMask::FieldMask(nomSing));
+
+    // An empty condition matches any form, and a form without the attribute does not match a condition on it
+    EXPECT_TRUE(MorphTagMask::Matches(genSing, 0, 0));
+    const uint64_t past = MorphTagMask::Encode(X::UniMorphTag::Past);
+    EXPECT_FALSE(MorphTagMask::Matches(past, gen, genFields));
+}
+
+TEST(MorphTagMaskTest, EncodingIsTheSameInAllThreads)
+{
+    const std::vector<X::UniMorphTag> tags = {
+        X::UniMorphTag::Loc | X::UniMorphTag::Plur, X::UniMorphTag::Ins | X::UniMorphTag::Sing,
+        X::UniMorphTag::Fut | X::UniMorphTag::_3,   X::UniMorphTag::Dat | X::UniMorphTag::Anim,
+        X::UniMorphTag::Act | X::UniMorphTag::Perf, X::UniMorphTag::Sup};
+
+    std::vector<std::vector<uint64_t>> masks(4);
+    std::vector<std::thread> threads;
+    for (size_t threadInd = 0; threadInd < masks.size(); ++threadInd) {
+        threads.emplace_back([&, threadInd] {
+            for (size_t i = 0; i < tags.size(); ++i) {
+                // Threads meet the values in different orders
+                masks[threadInd].push_back(MorphTagMask::Encode(tags[(i + threadInd) % tags.size()]));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t threadInd = 0; threadInd < masks.size(); ++threadInd) {
+        for (size_t i = 0; i < tags.size(); ++i) {
+            EXPECT_EQ(masks[threadInd][i], MorphTagMask::Encode(tags[(i + threadInd) % tags.size()]));
+        }
+    }
+}
+
+TEST(MorphLatticeTest, SortsCandidatesAndKeepsKBest)
+{
+    auto token = AmbiguousToken();
+    std::swap(token[0], token[2]);
+
+    const MorphLattice lattice({token, {}}, 2);
+    ASSERT_EQ(lattice.size(), 2u);
+    EXPECT_TRUE(lattice[1].empty());
+
+    const auto candidates = lattice[0];
+    ASSERT_EQ(candidates.end() - candidates.begin(), 2);
+    EXPECT_DOUBLE_EQ(candidates.best().probability, 0.7);
+    EXPECT_DOUBLE_EQ(candidates.begin()[1].probability, 0.2);
+
+    const MorphLattice fullLattice({token}, 0);
+    EXPECT_EQ(fullLattice[0].end() - fullLattice[0].begin(), 3);
+}
+
+TEST(MorphLatticeTest, ConditionMatchesSecondaryAnalysis)
+{
+    const Condition genitiveNoun(SyntaxRole::Head, X::UniMorphTag::Gen);
+    const MorphLattice lattice({AmbiguousToken()});
+
+    // The most probable analysis is a verb, so only the lattice finds the noun
+    EXPECT_FALSE(genitiveNoun.check(X::UniSPTag::NOUN, lattice[0].best()));
+    const LatticeCandidate* matched = genitiveNoun.find(X::UniSPTag::NOUN, lattice[0]);
+    ASSERT_NE(matched, nullptr);
+    EXPECT_DOUBLE_EQ(matched->probability, 0.2);
+
+    // The phrase takes the lemma of the matched analysis, not the lemma of the most probable one
+    auto& dictionary = LemmaDictionary::GetDictionary();
+    EXPECT_EQ(dictionary.GetLemma(matched->lemmaId), "сталь");
+    EXPECT_EQ(dictionary.GetLemma(lattice[0].best().lemmaId), "стать");
+}
+
+TEST(MorphLatticeTest, KBestDropsSecondaryAnalyses)
+{
+    const Condition genitiveNoun(SyntaxRole::Head, X::UniMorphTag::Gen);
+    EXPECT_TRUE(genitiveNoun.check(X::UniSPTag::NOUN, MorphLattice({AmbiguousToken()}, 2)[0]));
+    EXPECT_FALSE(genitiveNoun.check(X::UniSPTag::NOUN, MorphLattice({AmbiguousToken()}, 1)[0]));
+
+    const Condition nominativeNoun(SyntaxRole::Head, X::UniMorphTag::Nom);
+    EXPECT_EQ(nominativeNoun.find(X::UniSPTag::NOUN, MorphLattice({AmbiguousToken()}, 2)[0]), nullptr);
+    EXPECT_NE(nominativeNoun.find(X::UniSPTag::NOUN, MorphLattice({AmbiguousToken()}, 3)[0]), nullptr);
+}
+
+TEST(MorphLatticeTest, ExampleLexiconSelectsCandidateByLemma)
+{
+    Additional lexicon;
+    lexicon.m_exLex = "сталь";
+    const Condition steel(SyntaxRole::Head, X::UniMorphTag::UNKN, lexicon);
+    const MorphLattice lattice({AmbiguousToken()});
+
+    const LatticeCandidate* matched = steel.find(X::UniSPTag::NOUN, lattice[0]);
+    ASSERT_NE(matched, nullptr);
+    EXPECT_DOUBLE_EQ(matched->probability, 0.2);
+    EXPECT_EQ(steel.find(X::UniSPTag::VERB, lattice[0]), nullptr);
+}
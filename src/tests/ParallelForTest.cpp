@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <ParallelFor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+TEST(ParallelForTest, ChunksCoverRangeOnce)
+{
+    for (size_t count : {0, 1, 7, 64, 1000}) {
+        std::vector<int> visits(count, 0);
+        std::vector<size_t> chunkBegins(ChunksCount(count, 64), count);
+        ParallelForChunks(count, 64, 4, [&](size_t chunk, size_t begin, size_t end) {
+            chunkBegins[chunk] = begin;
+            for (size_t i = begin; i < end; ++i) {
+                visits[i]++;
+            }
+        });
+        EXPECT_EQ(std::count(visits.begin(), visits.end(), 1), static_cast<long>(count));
+        for (size_t chunk = 0; chunk < chunkBegins.size(); ++chunk) {
+            EXPECT_EQ(chunkBegins[chunk], chunk * 64);
+        }
+    }
+}
+
+TEST(ParallelForTest, PerChunkSumsMergeDeterministically)
+{
+    // Float sums depend on the order of additions, so per-chunk partial sums merged in chunk order must not depend on
+    // the number of threads
+    std::vector<float> values(10000);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = 1.0f / static_cast<float>(i + 1);
+    }
+    auto sum = [&](size_t threadsCount) {
+        std::vector<float> partial(ChunksCount(values.size(), 128), 0.0f);
+        ParallelForChunks(values.size(), 128, threadsCount, [&](size_t chunk, size_t begin, size_t end) {
+            partial[chunk] = std::accumulate(values.begin() + begin, values.begin() + end, 0.0f);
+        });
+        return std::accumulate(partial.begin(), partial.end(), 0.0f);
+    };
+    const float expected = sum(1);
+    for (size_t threadsCount : {2, 3, 8}) {
+        EXPECT_EQ(sum(threadsCount), expected);
+    }
+}
+
+TEST(ParallelForTest, RethrowsFirstException)
+{
+    std::atomic<size_t> processed{0};
+    EXPECT_THROW(ParallelFor(1000, 16,
+                             [&](size_t index) {
+                                 if (index == 10) {
+                                     throw std::runtime_error("failure");
+                                 }
+                                 processed++;
+                             }),
+                 std::runtime_error);
+    EXPECT_LT(processed.load(), 1000u);
+}
@@ -0,0 +1,302 @@
+#include <gtest/gtest.h>
+
+#include <BinaryIO.h>
+#include <Embedding.h>
+#include <ParallelFor.h>
+#include <PatternPhrasesStorage.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kThreadsCount = 8;
+constexpr size_t kDocumentsCount = 128;
+constexpr size_t kSentencesPerDocument = 20;
+
+const std::vector<std::string> kLemmas = {"анализ", "корпус", "фраза", "термин", "шаблон", "словарь", "текст"};
+
+// Phrases of a cluster as (document, sentence, start), plus the lemmas and model of the cluster
+struct CollectedCluster {
+    std::vector<std::string> lemmas;
+    std::string modelName;
+    std::vector<std::tuple<size_t, size_t, size_t>> positions;
+
+    bool operator==(const CollectedCluster& other) const
+    {
+        return lemmas == other.lemmas && modelName == other.modelName && positions == other.positions;
+    }
+};
+
+// Collects one document the way ProcessFile does: phrases go straight into the storage, and the lemma frequencies
+// are kept in the context of the document until it is finalized
+void CollectDocument(size_t docNum)
+{
+    auto& storage = PatternPhrasesStorage::GetStorage();
+    DocumentContext context;
+    context.documentId = static_cast<int>(docNum);
+
+    for (size_t sentNum = 0; sentNum < kSentencesPerDocument; ++sentNum) {
+        // Documents share keys, so threads add phrases to the same clusters
+        const std::string& dependent = kLemmas[(docNum * 3 + sentNum) % kLemmas.size()];
+        const std::string& head = kLemmas[(docNum + sentNum * 5) % kLemmas.size()];
+
+        auto wc = std::make_shared<WordComplex>();
+        wc->lemmas = {dependent, head};
+        wc->textForm = dependent + " " + head;
+        wc->pos = {sentNum * 10, sentNum * 10 + 2, docNum, sentNum};
+        wc->modelName = "NOUN[] + NOUN[Gen]";
+        storage.AddWordComplex(dependent + " " + head, wc);
+
+        context.lemmaFrequency[dependent]++;
+        context.lemmaFrequency[head]++;
+    }
+    storage.FinalizeDocumentProcessing(context);
+}
+
+std::map<std::string, CollectedCluster> CollectedClusters()
+{
+    std::map<std::string, CollectedCluster> result;
+    for (const auto& [key, cluster] : PatternPhrasesStorage::GetStorage().GetClusters()) {
+        auto& collected = result[key];
+        collected.lemmas = cluster.lemmas;
+        collected.modelName = cluster.modelName;
+        for (const auto& wc : cluster.wordComplexes) {
+            collected.positions.emplace_back(wc->pos.docNum, wc->pos.sentNum, wc->pos.start);
+        }
+        // Phrases arrive in a thread-dependent order, the set of phrases must still be the same
+        std::sort(collected.positions.begin(), collected.positions.end());
+    }
+    return result;
+}
+
+// Two pairs of close keys: each key has one synonym, the other key of its pair
+const std::vector<std::string> kSynonymKeys = {"синоним_а", "синоним_б", "синоним_в", "синоним_г"};
+const std::vector<float> kSynonymRows = {1.0f, 0.0f, 0.0f, 0.9f, 0.1f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.9f, 0.1f};
+
+// Puts the embeddings of the synonym keys into the cache, as SaveEmbeddings would save them
+void LoadSynonymKeyEmbeddings()
+{
+    const fs::path path = fs::temp_directory_path() / "pattern_phrases_storage_test_embeddings";
+    std::vector<uint64_t> lemmaBegins{0};
+    std::vector<char> lemmaBytes;
+    for (const auto& key : kSynonymKeys) {
+        lemmaBytes.insert(lemmaBytes.end(), key.begin(), key.end());
+        lemmaBegins.push_back(lemmaBytes.size());
+    }
+    {
+        BinaryWriter writer(path.string(), LemmaEmbeddings::kMagic, LemmaEmbeddings::kVersion);
+        writer.Write(static_cast<uint64_t>(kSynonymKeys.size()));
+        writer.Write(static_cast<uint32_t>(kSynonymRows.size() / kSynonymKeys.size()));
+        writer.WriteString(Embedding::GetModelIdentity());
+        writer.Write(static_cast<uint64_t>(lemmaBytes.size()));
+        writer.WriteArray(lemmaBegins);
+        writer.WriteArray(lemmaBytes);
+        writer.WriteArray(kSynonymRows);
+        writer.Close();
+    }
+    BinaryReader reader(path.string(), LemmaEmbeddings::kMagic, LemmaEmbeddings::kVersion);
+    ASSERT_TRUE(LemmaEmbeddings::GetInstance().LoadEmbeddings(reader));
+    fs::remove(path);
+}
+
+// Cluster with one phrase per lemma; the key and the text forms may contain characters that JSON escapes
+WordComplexCluster MakeOutputCluster(const std::string& key, size_t lemmasCount)
+{
+    WordComplexCluster cluster{};
+    cluster.key = key;
+    cluster.modelName = "ADJ[] + NOUN[\"Gen\"]";
+    cluster.phraseSize = lemmasCount;
+    cluster.topicRelevance = 0.125;
+    cluster.centralityScore = 1.0 / 3.0;
+    cluster.tagMatch = lemmasCount % 2 == 0;
+    for (size_t i = 0; i < lemmasCount; ++i) {
+        const std::string lemma = "лемма" + std::to_string(i);
+        cluster.lemmas.push_back(lemma);
+        cluster.tf.push_back(0.5 / (i + 1));
+        cluster.idf.push_back(2.0 + i);
+        cluster.tfidf.push_back(cluster.tf.back() * cluster.idf.back());
+        cluster.hypernyms[lemma] = {"понятие"};
+        cluster.hyponyms[lemma] = {};
+
+        auto wc = std::make_shared<WordComplex>();
+        wc->textForm = key + "\t\\ \"" + std::to_string(i) + "\"\n";
+        wc->pos = {i, i + 1, i * 7, i * 3};
+        cluster.wordComplexes.push_back(wc);
+    }
+    cluster.synonyms = {key + " синоним"};
+    return cluster;
+}
+
+// The whole output built as one DOM object; nested clusters are the ones whose keys start with the key of the
+// previous top-level cluster
+json ExpectedClustersJson(bool mergeNestedClusters)
+{
+    const auto& storage = PatternPhrasesStorage::GetStorage();
+    std::vector<std::string> keys;
+    for (const auto& [key, cluster] : storage.GetClusters()) {
+        keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    json result = json::object();
+    std::string topKey;
+    for (const auto& key : keys) {
+        json clusterJson = storage.ClusterToJson(storage.GetClusters().at(key));
+        if (mergeNestedClusters && !topKey.empty() && key.rfind(topKey, 0) == 0) {
+            clusterJson["00_key"] = key;
+            result[topKey]["nested_clusters"].push_back(std::move(clusterJson));
+            continue;
+        }
+        result[key] = std::move(clusterJson);
+        topKey = key;
+    }
+    return result;
+}
+
+std::string ReadFile(const fs::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+TEST(PatternPhrasesStorageTest, ParallelCollectionMatchesSerialRun)
+{
+    auto& storage = PatternPhrasesStorage::GetStorage();
+    auto& corpus = TextCorpus::GetCorpus();
+
+    storage.Clear();
+    std::map<std::string, int> initialFrequency;
+    for (const auto& lemma : kLemmas) {
+        initialFrequency[lemma] = corpus.GetWordFrequency(lemma);
+    }
+
+    for (size_t docNum = 0; docNum < kDocumentsCount; ++docNum) {
+        CollectDocument(docNum);
+    }
+    const auto expected = CollectedClusters();
+    std::map<std::string, int> serialFrequency;
+    for (const auto& lemma : kLemmas) {
+        serialFrequency[lemma] = corpus.GetWordFrequency(lemma) - initialFrequency[lemma];
+    }
+
+    storage.Clear();
+    ParallelFor(kDocumentsCount, kThreadsCount, [](size_t docNum) { CollectDocument(docNum); });
+    const auto collected = CollectedClusters();
+
+    ASSERT_EQ(collected.size(), expected.size());
+    for (const auto& [key, cluster] : expected) {
+        auto it = collected.find(key);
+        ASSERT_NE(it, collected.end()) << key;
+        EXPECT_TRUE(it->second == cluster) << key;
+    }
+
+    // The parallel run merges the same document frequencies into the corpus once more
+    for (const auto& lemma : kLemmas) {
+        EXPECT_EQ(corpus.GetWordFrequency(lemma) - initialFrequency[lemma], 2 * serialFrequency[lemma]) << lemma;
+    }
+    storage.Clear();
+}
+
+TEST(PatternPhrasesStorageTest, UnreadableSynonymIndexIsRebuilt)
+{
+    auto& storage = PatternPhrasesStorage::GetStorage();
+    auto& options = PhrasesCollectorUtils::Options::getOptions();
+    const int savedSynonymsCount = options.synonymsCount;
+    const float savedSynonymsThreshold = options.synonymsThreshold;
+    options.synonymsCount = 1;
+    options.synonymsThreshold = 0.0f;
+
+    LoadSynonymKeyEmbeddings();
+    storage.Clear();
+    for (size_t keyInd = 0; keyInd < kSynonymKeys.size(); ++keyInd) {
+        auto wc = std::make_shared<WordComplex>();
+        wc->lemmas = {kSynonymKeys[keyInd]};
+        wc->textForm = kSynonymKeys[keyInd];
+        wc->pos = {0, 1, keyInd, 0};
+        storage.AddWordComplex(kSynonymKeys[keyInd], wc);
+    }
+
+    const fs::path indexPath = fs::temp_directory_path() / "pattern_phrases_storage_test_synonym_index";
+    const std::vector<std::string> damagedIndexes = {"not an index",
+                                                     // The magic of the index followed by another version
+                                                     std::string("ATTSYNIX") + std::string(4, '\0')};
+    for (const auto& damagedIndex : damagedIndexes) {
+        std::ofstream(indexPath, std::ios::binary) << damagedIndex;
+        ASSERT_NO_THROW(storage.FindSynonyms(indexPath.string()));
+
+        // The key itself is skipped and only synonymsCount neighbours are kept
+        const auto& clusters = storage.GetClusters();
+        for (size_t keyInd = 0; keyInd < kSynonymKeys.size(); ++keyInd) {
+            const auto& synonyms = clusters.at(kSynonymKeys[keyInd]).synonyms;
+            ASSERT_EQ(synonyms.size(), 1u) << kSynonymKeys[keyInd];
+            EXPECT_EQ(*synonyms.begin(), kSynonymKeys[keyInd ^ 1]);
+        }
+    }
+
+    // The rebuilt index is saved and read by the next search
+    ASSERT_NO_THROW(storage.FindSynonyms(indexPath.string()));
+    EXPECT_EQ(storage.GetClusters().at(kSynonymKeys[0]).synonyms.size(), 1u);
+
+    fs::remove(indexPath);
+    storage.Clear();
+    options.synonymsCount = savedSynonymsCount;
+    options.synonymsThreshold = savedSynonymsThreshold;
+}
+
+TEST(PatternPhrasesStorageTest, JsonOutputMatchesDomDump)
+{
+    auto& storage = PatternPhrasesStorage::GetStorage();
+    auto& options = PhrasesCollectorUtils::Options::getOptions();
+    const bool savedPrettyJson = options.prettyJson;
+    const int savedThreadsCount = options.threadsCount;
+    const int savedTextsCount = options.textToProcessCount;
+    options.threadsCount = 3;
+    options.textToProcessCount = 10;
+
+    const fs::path path = fs::temp_directory_path() / "pattern_phrases_storage_test_output.json";
+    auto checkOutput = [&](const std::string& name) {
+        for (bool pretty : {true, false}) {
+            options.prettyJson = pretty;
+            for (bool mergeNestedClusters : {false, true}) {
+                storage.OutputClustersToJsonFile(path.string(), mergeNestedClusters);
+                const json expected = ExpectedClustersJson(mergeNestedClusters);
+                EXPECT_EQ(ReadFile(path), expected.dump(pretty ? 4 : -1))
+                    << name << (pretty ? ", pretty" : ", compact") << (mergeNestedClusters ? ", nested" : "");
+            }
+        }
+    };
+
+    storage.Clear();
+    checkOutput("empty storage");
+
+    // Keys that nest into the previous key, keys that need escaping and enough groups for several chunks of output
+    const std::vector<std::string> specialKeys = {"анализ",       "анализ данных", "анализ данных \"big\"",
+                                                  "анализатор",   "ключ\\путь",   "ключ\u0001управляющий",
+                                                  "строка\nвторая"};
+    for (size_t i = 0; i < specialKeys.size(); ++i) {
+        storage.AddCluster(specialKeys[i], MakeOutputCluster(specialKeys[i], 1 + i % 3));
+    }
+    for (size_t i = 0; i < 700; ++i) {
+        const std::string key = "термин " + std::to_string(i);
+        storage.AddCluster(key, MakeOutputCluster(key, 1 + i % 2));
+    }
+    checkOutput("clusters");
+
+    fs::remove(path);
+    storage.Clear();
+    options.prettyJson = savedPrettyJson;
+    options.threadsCount = savedThreadsCount;
+    options.textToProcessCount = savedTextsCount;
+}
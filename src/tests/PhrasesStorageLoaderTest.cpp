@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <PatternPhrasesStorage.h>
+#include <PhrasesStorageLoader.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kResFilesCount = 7;
+constexpr size_t kPhrasesPerFile = 60;
+
+const std::vector<std::string> kKeys = {"анализ текста", "корпус", "новый термин", "словарь терминов", "фраза"};
+
+// Phrases of a loaded cluster as (document, sentence, start, end, text form), in the order of the cluster
+struct LoadedCluster {
+    std::vector<std::string> lemmas;
+    std::string modelName;
+    std::vector<std::tuple<size_t, size_t, size_t, size_t, std::string>> phrases;
+
+    bool operator==(const LoadedCluster& other) const
+    {
+        return lemmas == other.lemmas && modelName == other.modelName && phrases == other.phrases;
+    }
+};
+
+// Phrase object of a res_*.json file; lemmas are numbered the way collect_phrases writes them
+json MakeResPhrase(const std::string& key, size_t docNum, size_t sentNum, size_t start)
+{
+    json lemmas = json::array();
+    size_t lemmaInd = 0;
+    for (size_t begin = 0; begin <= key.size(); ++lemmaInd) {
+        const size_t end = std::min(key.find(' ', begin), key.size());
+        lemmas.push_back(std::to_string(lemmaInd) + "_" + key.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return {{"0_key", key},
+            {"1_textForm", key + " \"" + std::to_string(docNum) + "\""},
+            {"2_modelName", "NOUN[] #" + std::to_string(docNum % 3)},
+            {"3_docNum", docNum},
+            {"4_sentNum", sentNum},
+            {"5_start_ind", start},
+            {"6_end_ind", start + 2},
+            {"7_lemmas", lemmas}};
+}
+
+// Every file holds phrases of every key from several documents, so clusters are merged across files, and the
+// phrases of a file are not sorted by position
+void WriteResFiles(const fs::path& resDir)
+{
+    fs::create_directories(resDir);
+    for (size_t fileInd = 0; fileInd < kResFilesCount; ++fileInd) {
+        json phrases = json::array();
+        for (size_t i = kPhrasesPerFile; i > 0; --i) {
+            const size_t docNum = (fileInd * 13 + i * 7) % 40;
+            phrases.push_back(MakeResPhrase(kKeys[(fileInd + i) % kKeys.size()], docNum, i % 5, fileInd * 100 + i));
+        }
+        // Keys with digits or underscores are not collected
+        phrases.push_back(MakeResPhrase("термин 2", fileInd, 0, 0));
+        phrases.push_back(MakeResPhrase("термин_б", fileInd, 0, 0));
+        std::ofstream(resDir / ("res" + std::to_string(fileInd) + "_text.json")) << phrases.dump();
+    }
+    // A broken result is skipped and files with other names are not read
+    std::ofstream(resDir / "res_broken_text.json") << "[{\"0_key\": ";
+    std::ofstream(resDir / "other.json") << json::array({MakeResPhrase("чужой ключ", 0, 0, 0)}).dump();
+}
+
+std::map<std::string, LoadedCluster> LoadClusters(int threadsCount)
+{
+    auto& storage = PatternPhrasesStorage::GetStorage();
+    auto& options = PhrasesCollectorUtils::Options::getOptions();
+    options.threadsCount = threadsCount;
+    storage.Clear();
+    PhrasesStorageLoader().LoadPhraseStorageFromResultsDir(storage);
+
+    std::map<std::string, LoadedCluster> result;
+    for (const auto& [key, cluster] : storage.GetClusters()) {
+        auto& loaded = result[key];
+        loaded.lemmas = cluster.lemmas;
+        loaded.modelName = cluster.modelName;
+        for (const auto& wc : cluster.wordComplexes) {
+            loaded.phrases.emplace_back(wc->pos.docNum, wc->pos.sentNum, wc->pos.start, wc->pos.end, wc->textForm);
+        }
+    }
+    storage.Clear();
+    return result;
+}
+
+} // namespace
+
+TEST(PhrasesStorageLoaderTest, ParallelLoadMatchesSerialLoad)
+{
+    auto& options = PhrasesCollectorUtils::Options::getOptions();
+    const fs::path savedResDir = options.resDir;
+    const int savedThreadsCount = options.threadsCount;
+    options.resDir = fs::temp_directory_path() / "phrases_storage_loader_test_results";
+    fs::remove_all(options.resDir);
+    WriteResFiles(options.resDir);
+
+    const auto expected = LoadClusters(1);
+    ASSERT_EQ(expected.size(), kKeys.size());
+    size_t phrasesCount = 0;
+    for (const auto& key : kKeys) {
+        const LoadedCluster& cluster = expected.at(key);
+        phrasesCount += cluster.phrases.size();
+        EXPECT_TRUE(std::is_sorted(cluster.phrases.begin(), cluster.phrases.end())) << key;
+        // The first phrase by position defines the lemmas and the model, without the numbers of the lemmas
+        EXPECT_EQ(cluster.modelName, "NOUN[] #" + std::to_string(std::get<0>(cluster.phrases.front()) % 3)) << key;
+        EXPECT_EQ(cluster.lemmas.size(), static_cast<size_t>(std::count(key.begin(), key.end(), ' ') + 1)) << key;
+        EXPECT_EQ(cluster.lemmas.front(), key.substr(0, key.find(' '))) << key;
+    }
+    EXPECT_EQ(phrasesCount, kResFilesCount * kPhrasesPerFile);
+
+    for (int threadsCount : {2, 3, 16}) {
+        EXPECT_EQ(LoadClusters(threadsCount), expected) << threadsCount << " threads";
+    }
+
+    fs::remove_all(options.resDir);
+    options.resDir = savedResDir;
+    options.threadsCount = savedThreadsCount;
+}
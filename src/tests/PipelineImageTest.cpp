@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <PipelineImage.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path TempPath(const std::string& name)
+{
+    return fs::temp_directory_path() / ("pipeline_image_test_" + name);
+}
+
+} // namespace
+
+TEST(PipelineImageTest, SectionsAreReadInPlace)
+{
+    const fs::path first = TempPath("first");
+    const fs::path second = TempPath("second");
+    const fs::path image = TempPath("image");
+    {
+        BinaryWriter writer(first.string(), "SECTION1", 1);
+        writer.WriteString("лемма");
+        writer.Close();
+    }
+    {
+        BinaryWriter writer(second.string(), "SECTION2", 2);
+        writer.Write(static_cast<uint8_t>(7));
+        writer.WriteArray(std::vector<double>{0.5, 1.5});
+        writer.Close();
+    }
+    PipelineImage::Write(image.string(), {first.string(), TempPath("missing").string(), second.string()});
+    fs::remove(first);
+    fs::remove(second);
+
+    std::unique_ptr<BinaryReader> secondReader;
+    {
+        PipelineImage pipelineImage(image.string());
+        EXPECT_TRUE(pipelineImage.HasSection("SECTION1"));
+        EXPECT_FALSE(pipelineImage.HasSection("SECTION3"));
+        EXPECT_THROW(pipelineImage.OpenSection("SECTION3", 1), std::runtime_error);
+        EXPECT_THROW(pipelineImage.OpenSection("SECTION1", 2), std::runtime_error);
+
+        auto firstReader = pipelineImage.OpenSection("SECTION1", 1);
+        EXPECT_EQ(firstReader->ReadString(), "лемма");
+        EXPECT_TRUE(firstReader->AtEnd());
+        secondReader = pipelineImage.OpenSection("SECTION2", 2);
+    }
+
+    // The reader keeps the image mapped after the image is destroyed
+    EXPECT_EQ(secondReader->Read<uint8_t>(), 7);
+    const double* values = secondReader->ReadArray<double>(2);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(values) % alignof(double), 0u);
+    EXPECT_EQ(values[1], 1.5);
+    EXPECT_TRUE(secondReader->AtEnd());
+
+    fs::remove(image);
+}
+
+TEST(PipelineImageTest, RejectsDuplicateSections)
+{
+    const fs::path section = TempPath("duplicate");
+    {
+        BinaryWriter writer(section.string(), "SECTION1", 1);
+        writer.Close();
+    }
+
+    EXPECT_THROW(PipelineImage::Write(TempPath("duplicate_image").string(), {section.string(), section.string()}),
+                 std::runtime_error);
+
+    fs::remove(section);
+    fs::remove(TempPath("duplicate_image"));
+}
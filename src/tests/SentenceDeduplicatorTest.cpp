@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <ParallelFor.h>
+#include <SentenceDeduplicator.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::string kSentence = "Морфологический анализ выполняется для каждого предложения корпуса.";
+const std::string kNearDuplicate = "Морфологический анализ выполняется для каждого предложения корпусов.";
+const std::string kOther = "Ключевые фразы собираются по грамматическим шаблонам.";
+
+// Every file repeats the same sentences in its own order, so identical sentences are processed by different threads
+const std::vector<std::vector<std::string>> kFiles = {
+    {kSentence, kOther, kNearDuplicate}, {kNearDuplicate, kSentence}, {kOther, kSentence, kSentence}, {kOther}};
+
+// Stands for the morphological analysis, which depends on every character of the sentence
+std::string Analyze(const std::string& sentence)
+{
+    return std::string(sentence.rbegin(), sentence.rend());
+}
+
+} // namespace
+
+TEST(SentenceDeduplicatorTest, IdenticalSentencesShareCluster)
+{
+    SentenceDeduplicator deduplicator;
+    const uint32_t first = deduplicator.Add(kSentence);
+    EXPECT_NE(deduplicator.Add(kOther), first);
+    EXPECT_EQ(deduplicator.Add(kSentence), first);
+
+    EXPECT_EQ(deduplicator.ClustersCount(), 2u);
+    EXPECT_EQ(deduplicator.SentencesCount(), 3u);
+    EXPECT_EQ(deduplicator.OccurrenceCount(first), 2u);
+    EXPECT_EQ(deduplicator.NearDuplicatesCount(), 0u);
+}
+
+TEST(SentenceDeduplicatorTest, NearDuplicatesAreReportedInTheirOwnCluster)
+{
+    SentenceDeduplicator deduplicator(0.5);
+    const uint32_t first = deduplicator.Add(kSentence);
+    const uint32_t near = deduplicator.Add(kNearDuplicate);
+    const uint32_t other = deduplicator.Add(kOther);
+
+    EXPECT_NE(near, first);
+    EXPECT_EQ(deduplicator.OccurrenceCount(first), 1u);
+    EXPECT_EQ(deduplicator.NearDuplicateOf(near), first);
+    EXPECT_EQ(deduplicator.NearDuplicateOf(other), other);
+    EXPECT_EQ(deduplicator.NearDuplicatesCount(), 1u);
+}
+
+TEST(SentenceDeduplicatorTest, NearDuplicatesAreNotSearchedByDefault)
+{
+    SentenceDeduplicator deduplicator;
+    deduplicator.Add(kSentence);
+    const uint32_t near = deduplicator.Add(kNearDuplicate);
+    EXPECT_EQ(deduplicator.NearDuplicateOf(near), near);
+    EXPECT_EQ(deduplicator.NearDuplicatesCount(), 0u);
+}
+
+TEST(DuplicateAnalysisCacheTest, SharesAnalysesOnlyBetweenIdenticalSentences)
+{
+    SentenceDeduplicator deduplicator(0.5);
+    std::vector<std::vector<uint32_t>> fileSentences(kFiles.size());
+    for (size_t fileInd = 0; fileInd < kFiles.size(); ++fileInd) {
+        for (const auto& sentence : kFiles[fileInd]) {
+            fileSentences[fileInd].push_back(deduplicator.Add(sentence));
+        }
+    }
+    ASSERT_EQ(deduplicator.NearDuplicatesCount(), 1u);
+
+    std::vector<uint32_t> occurrences(deduplicator.ClustersCount());
+    for (uint32_t clusterId = 0; clusterId < occurrences.size(); ++clusterId) {
+        occurrences[clusterId] = deduplicator.OccurrenceCount(clusterId);
+    }
+
+    for (size_t threadsCount : {1, 4}) {
+        DuplicateAnalysisCache<std::string> cache;
+        cache.Reset(occurrences);
+        std::atomic<size_t> analysesCount{0};
+
+        std::vector<std::vector<std::string>> results(kFiles.size());
+        ParallelFor(kFiles.size(), threadsCount, [&](size_t fileInd) {
+            for (size_t i = 0; i < kFiles[fileInd].size(); ++i) {
+                const std::string& sentence = kFiles[fileInd][i];
+                results[fileInd].push_back(cache.Get(fileSentences[fileInd][i], [&] {
+                    ++analysesCount;
+                    return Analyze(sentence);
+                }));
+            }
+        });
+
+        // Every sentence gets the analysis of its own text, whichever thread analyzed its cluster first
+        for (size_t fileInd = 0; fileInd < kFiles.size(); ++fileInd) {
+            ASSERT_EQ(results[fileInd].size(), kFiles[fileInd].size());
+            for (size_t i = 0; i < kFiles[fileInd].size(); ++i) {
+                EXPECT_EQ(results[fileInd][i], Analyze(kFiles[fileInd][i])) << threadsCount << " threads";
+            }
+        }
+        EXPECT_EQ(cache.CachedCount(), 0u);
+        if (threadsCount == 1) {
+            EXPECT_EQ(analysesCount.load(), deduplicator.ClustersCount());
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <ParallelFor.h>
+#include <ShardedMap.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Mirrors the shape of a WordComplexCluster: a counter plus a list of merged entries
+struct TestCluster {
+    int frequency = 0;
+    std::vector<size_t> entries;
+};
+
+constexpr size_t kThreadsCount = 16;
+constexpr size_t kDocumentsCount = 256;
+constexpr size_t kPhrasesPerDocument = 200;
+constexpr size_t kKeysCount = 997;
+
+std::string KeyOf(size_t document, size_t phrase)
+{
+    // Deterministic pseudo-random key, so that documents share keys and threads contend on the same shards
+    const size_t value = (document * 7919 + phrase * 104729) % kKeysCount;
+    return "phrase_" + std::to_string(value);
+}
+
+template <typename Map>
+void CollectDocument(Map& clusters, size_t document)
+{
+    for (size_t phrase = 0; phrase < kPhrasesPerDocument; ++phrase) {
+        const size_t entry = document * kPhrasesPerDocument + phrase;
+        clusters.Upsert(
+            KeyOf(document, phrase), [] { return TestCluster{}; },
+            [entry](TestCluster& cluster) {
+                cluster.frequency++;
+                cluster.entries.push_back(entry);
+            });
+    }
+}
+
+std::unordered_map<std::string, TestCluster> CollectSerially()
+{
+    std::unordered_map<std::string, TestCluster> result;
+    for (size_t document = 0; document < kDocumentsCount; ++document) {
+        for (size_t phrase = 0; phrase < kPhrasesPerDocument; ++phrase) {
+            auto& cluster = result[KeyOf(document, phrase)];
+            cluster.frequency++;
+            cluster.entries.push_back(document * kPhrasesPerDocument + phrase);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(ShardedMapTest, ParallelUpsertMatchesSerialRun)
+{
+    const auto expected = CollectSerially();
+
+    ShardedMap<std::string, TestCluster> clusters;
+    ParallelFor(kDocumentsCount, kThreadsCount, [&](size_t document) { CollectDocument(clusters, document); });
+
+    ASSERT_EQ(clusters.size(), expected.size());
+    size_t iterated = 0;
+    for (auto& [key, cluster] : clusters) {
+        auto it = expected.find(key);
+        ASSERT_NE(it, expected.end()) << key;
+        EXPECT_EQ(cluster.frequency, it->second.frequency) << key;
+
+        // Entries arrive in a thread-dependent order, the set of entries must still be the same
+        std::sort(cluster.entries.begin(), cluster.entries.end());
+        EXPECT_EQ(cluster.entries, it->second.entries) << key;
+        ++iterated;
+    }
+    EXPECT_EQ(iterated, expected.size());
+}
+
+TEST(ShardedMapTest, ParallelUpdateAndVisit)
+{
+    ShardedMap<size_t, size_t> counters;
+    ParallelFor(kDocumentsCount, kThreadsCount, [&](size_t) {
+        for (size_t phrase = 0; phrase < kPhrasesPerDocument; ++phrase) {
+            counters.Update(phrase % 64, [](size_t& value) { value++; });
+        }
+    });
+
+    ASSERT_EQ(counters.size(), 64u);
+    for (size_t key = 0; key < 64; ++key) {
+        size_t value = 0;
+        EXPECT_TRUE(counters.Visit(key, [&](size_t v) { value = v; }));
+        const size_t perDocument = (kPhrasesPerDocument - key + 63) / 64;
+        EXPECT_EQ(value, kDocumentsCount * perDocument) << key;
+    }
+    EXPECT_FALSE(counters.Visit(64, [](size_t) {}));
+}
+
+TEST(ShardedMapTest, UnlockedInterface)
+{
+    ShardedMap<std::string, int> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.begin(), map.end());
+
+    map["a"] = 1;
+    map.InsertOrAssign("b", 2);
+    map.InsertOrAssign("b", 3);
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.at("b"), 3);
+    EXPECT_EQ(map.count("a"), 1u);
+    EXPECT_NE(map.find("a"), map.end());
+    EXPECT_EQ(map.find("c"), map.end());
+    EXPECT_THROW(map.at("c"), std::out_of_range);
+
+    EXPECT_EQ(map.erase("a"), 1u);
+    EXPECT_EQ(map.size(), 1u);
+    map.clear();
+    EXPECT_TRUE(map.empty());
+}
@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+
+#include <StorageSnapshot.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int kTextsCount = 4;
+
+// The header is the magic, the version and eight counts; the string offsets are the first array after it
+constexpr size_t kClustersCountOffset = 12;
+constexpr size_t kStringsCountOffset = kClustersCountOffset + 3 * sizeof(uint64_t);
+constexpr size_t kStringBytesCountOffset = kStringsCountOffset + sizeof(uint64_t);
+constexpr size_t kStringBeginsOffset = 80;
+
+fs::path TempPath(const std::string& name)
+{
+    return fs::temp_directory_path() / ("storage_snapshot_test_" + name);
+}
+
+WordComplexCluster MakeCluster(const std::string& key, const std::vector<std::string>& lemmas, size_t phrasesCount)
+{
+    WordComplexCluster cluster{};
+    cluster.key = key;
+    cluster.modelName = "ADJ[] + NOUN[]";
+    cluster.phraseSize = lemmas.size();
+    cluster.topicRelevance = 0.25 * phrasesCount;
+    cluster.centralityScore = 0.5 / phrasesCount;
+    cluster.tagMatch = phrasesCount % 2 == 0;
+    cluster.is_term = phrasesCount > 1;
+    cluster.lemmas = lemmas;
+    for (size_t i = 0; i < lemmas.size(); ++i) {
+        cluster.tf.push_back(0.1 * (i + 1));
+        cluster.idf.push_back(1.5 + i);
+        cluster.tfidf.push_back(cluster.tf.back() * cluster.idf.back());
+        cluster.hypernyms[lemmas[i]] = {"понятие " + lemmas[i]};
+        cluster.hyponyms[lemmas[i]] = {};
+    }
+    for (size_t i = 0; i < phrasesCount; ++i) {
+        auto wc = std::make_shared<WordComplex>();
+        wc->textForm = key + " \"" + std::to_string(i) + "\"";
+        wc->pos = {100 + i, 102 + i, 10 + i, 20 + i};
+        cluster.wordComplexes.push_back(wc);
+    }
+    return cluster;
+}
+
+// Clusters sorted by key, as PatternPhrasesStorage::SaveStorageSnapshot passes them
+std::vector<WordComplexCluster> MakeClusters()
+{
+    std::vector<WordComplexCluster> clusters;
+    clusters.push_back(MakeCluster("быстрый анализ", {"быстрый", "анализ"}, 3));
+    clusters.push_back(MakeCluster("корпус", {"корпус"}, 1));
+    clusters.push_back(MakeCluster("новый термин", {"новый", "термин"}, 2));
+    clusters[0].synonyms = {"новый термин", "корпус"};
+    return clusters;
+}
+
+void WriteClusters(const fs::path& path, const std::vector<WordComplexCluster>& clusters)
+{
+    std::vector<const WordComplexCluster*> pointers;
+    for (const auto& cluster : clusters) {
+        pointers.push_back(&cluster);
+    }
+    StorageSnapshot::Write(path.string(), pointers, kTextsCount);
+}
+
+std::string ReadBytes(const fs::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void WriteBytes(const fs::path& path, const std::string& bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+template <typename T>
+T GetAt(const std::string& bytes, size_t offset)
+{
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void SetAt(std::string& bytes, size_t offset, T value)
+{
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+void ExpectSameCluster(const WordComplexCluster& actual, const WordComplexCluster& expected)
+{
+    EXPECT_EQ(actual.key, expected.key);
+    EXPECT_EQ(actual.modelName, expected.modelName);
+    EXPECT_EQ(actual.phraseSize, expected.phraseSize);
+    EXPECT_DOUBLE_EQ(actual.frequency, static_cast<double>(expected.wordComplexes.size()) / kTextsCount);
+    EXPECT_DOUBLE_EQ(actual.topicRelevance, expected.topicRelevance);
+    EXPECT_DOUBLE_EQ(actual.centralityScore, expected.centralityScore);
+    EXPECT_EQ(actual.tagMatch, expected.tagMatch);
+    EXPECT_EQ(actual.is_term, expected.is_term);
+    EXPECT_EQ(actual.lemmas, expected.lemmas);
+    EXPECT_EQ(actual.tf, expected.tf);
+    EXPECT_EQ(actual.idf, expected.idf);
+    EXPECT_EQ(actual.tfidf, expected.tfidf);
+    EXPECT_EQ(actual.hypernyms, expected.hypernyms);
+    EXPECT_EQ(actual.hyponyms, expected.hyponyms);
+    EXPECT_EQ(actual.synonyms, expected.synonyms);
+    ASSERT_EQ(actual.wordComplexes.size(), expected.wordComplexes.size());
+    for (size_t i = 0; i < actual.wordComplexes.size(); ++i) {
+        const WordComplex& wc = *actual.wordComplexes[i];
+        const WordComplex& expectedWc = *expected.wordComplexes[i];
+        EXPECT_EQ(wc.textForm, expectedWc.textForm);
+        EXPECT_EQ(wc.modelName, expected.modelName);
+        EXPECT_EQ(wc.pos.start, expectedWc.pos.start);
+        EXPECT_EQ(wc.pos.end, expectedWc.pos.end);
+        EXPECT_EQ(wc.pos.docNum, expectedWc.pos.docNum);
+        EXPECT_EQ(wc.pos.sentNum, expectedWc.pos.sentNum);
+    }
+}
+
+} // namespace
+
+TEST(StorageSnapshotTest, RoundTripKeepsClusters)
+{
+    const fs::path path = TempPath("round_trip");
+    const auto clusters = MakeClusters();
+    WriteClusters(path, clusters);
+
+    const StorageSnapshot snapshot(path.string());
+    ASSERT_EQ(snapshot.ClustersCount(), clusters.size());
+    for (size_t clusterInd = 0; clusterInd < clusters.size(); ++clusterInd) {
+        const auto found = snapshot.FindCluster(clusters[clusterInd].key);
+        ASSERT_TRUE(found.has_value());
+        EXPECT_EQ(*found, clusterInd);
+        EXPECT_EQ(snapshot.GetKey(clusterInd), clusters[clusterInd].key);
+        EXPECT_EQ(snapshot.GetPhrasesCount(clusterInd), clusters[clusterInd].wordComplexes.size());
+        ExpectSameCluster(snapshot.MaterializeCluster(clusterInd), clusters[clusterInd]);
+    }
+    // Keys before, between and after the saved ones
+    EXPECT_FALSE(snapshot.FindCluster("анализ").has_value());
+    EXPECT_FALSE(snapshot.FindCluster("корпуса").has_value());
+    EXPECT_FALSE(snapshot.FindCluster("язык").has_value());
+
+    fs::remove(path);
+}
+
+TEST(StorageSnapshotTest, EmptySnapshotHasNoClusters)
+{
+    const fs::path path = TempPath("empty");
+    WriteClusters(path, {});
+
+    const StorageSnapshot snapshot(path.string());
+    EXPECT_EQ(snapshot.ClustersCount(), 0u);
+    EXPECT_FALSE(snapshot.FindCluster("корпус").has_value());
+
+    fs::remove(path);
+}
+
+TEST(StorageSnapshotTest, WriteWithSynonymsReplacesTheMappedFile)
+{
+    const fs::path path = TempPath("synonyms");
+    auto clusters = MakeClusters();
+    WriteClusters(path, clusters);
+
+    {
+        const StorageSnapshot snapshot(path.string());
+        snapshot.WriteWithSynonyms(path.string(), {{2}, {}, {0, 1}});
+        // The old mapping stays readable after the file is replaced
+        EXPECT_EQ(snapshot.MaterializeCluster(0).synonyms.size(), 2u);
+        EXPECT_THROW(snapshot.WriteWithSynonyms(path.string(), {{}, {}}), std::invalid_argument);
+        EXPECT_THROW(snapshot.WriteWithSynonyms(path.string(), {{3}, {}, {}}), std::out_of_range);
+    }
+
+    clusters[0].synonyms = {"новый термин"};
+    clusters[2].synonyms = {"быстрый анализ", "корпус"};
+    const StorageSnapshot snapshot(path.string());
+    ASSERT_EQ(snapshot.ClustersCount(), clusters.size());
+    for (size_t clusterInd = 0; clusterInd < clusters.size(); ++clusterInd) {
+        ExpectSameCluster(snapshot.MaterializeCluster(clusterInd), clusters[clusterInd]);
+    }
+    EXPECT_FALSE(fs::exists(path.string() + ".tmp"));
+
+    fs::remove(path);
+}
+
+TEST(StorageSnapshotTest, RejectsInvalidOffsets)
+{
+    const fs::path path = TempPath("invalid_offsets");
+    WriteClusters(path, MakeClusters());
+    std::string bytes = ReadBytes(path);
+    ASSERT_EQ(GetAt<uint64_t>(bytes, kClustersCountOffset), 3u);
+
+    // The second string would end after the end of the string bytes
+    const uint64_t stringBytesCount = GetAt<uint64_t>(bytes, kStringBytesCountOffset);
+    SetAt<uint64_t>(bytes, kStringBeginsOffset + sizeof(uint64_t), stringBytesCount + 1);
+    WriteBytes(path, bytes);
+
+    try {
+        StorageSnapshot snapshot(path.string());
+        FAIL() << "A snapshot with unsorted string offsets was opened";
+    } catch (const std::runtime_error& ex) {
+        EXPECT_NE(std::string(ex.what()).find("invalid string offsets"), std::string::npos) << ex.what();
+    }
+
+    fs::remove(path);
+}
+
+TEST(StorageSnapshotTest, RejectsInvalidStringIds)
+{
+    const fs::path path = TempPath("invalid_ids");
+    WriteClusters(path, MakeClusters());
+    std::string bytes = ReadBytes(path);
+
+    // Key ids follow the string offsets and the string bytes, aligned to their size
+    const uint64_t stringsCount = GetAt<uint64_t>(bytes, kStringsCountOffset);
+    const uint64_t stringBytesCount = GetAt<uint64_t>(bytes, kStringBytesCountOffset);
+    size_t keyIdsOffset = kStringBeginsOffset + (stringsCount + 1) * sizeof(uint64_t) + stringBytesCount;
+    keyIdsOffset += (sizeof(uint32_t) - keyIdsOffset % sizeof(uint32_t)) % sizeof(uint32_t);
+    SetAt<uint32_t>(bytes, keyIdsOffset + sizeof(uint32_t), static_cast<uint32_t>(stringsCount));
+    WriteBytes(path, bytes);
+
+    try {
+        StorageSnapshot snapshot(path.string());
+        FAIL() << "A snapshot with a key id outside the string pool was opened";
+    } catch (const std::runtime_error& ex) {
+        EXPECT_NE(std::string(ex.what()).find("invalid key string ids"), std::string::npos) << ex.what();
+    }
+
+    fs::remove(path);
+}
+
+TEST(StorageSnapshotTest, RejectsTruncatedFile)
+{
+    const fs::path path = TempPath("truncated");
+    WriteClusters(path, MakeClusters());
+    const std::string bytes = ReadBytes(path);
+    WriteBytes(path, bytes.substr(0, bytes.size() - sizeof(uint64_t)));
+
+    EXPECT_THROW(StorageSnapshot(path.string()), std::runtime_error);
+
+    fs::remove(path);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <TextCorpus.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int kDocumentsCount = 4;
+
+fs::path TempPath(const std::string& name)
+{
+    return fs::temp_directory_path() / ("text_corpus_test_" + name);
+}
+
+std::string ReadBytes(const fs::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Corpus whose lemmas have a word frequency, a document frequency, both or a zero one
+void FillCorpus(TextCorpus& corpus)
+{
+    corpus.Deserialize({{"0_totalDocuments", kDocumentsCount},
+                        {"1_totalTexts", 9},
+                        {"2_totalWords", 40},
+                        {"3_documentFrequency", {{"статистика", 3}, {"частота", 0}, {"документ", 2}}},
+                        {"4_wordFrequency", {{"статистика", 7}, {"частота", 5}, {"словарь", 4}}},
+                        {"5_documents", json::array()}});
+    // Merged counts are not filtered, so rejected lemmas reach the corpus
+    corpus.MergeDocumentFrequencies({{"100%", 3}, {"***", 2}, {"статистика", 1}});
+}
+
+} // namespace
+
+TEST(TextCorpusTest, StatisticsRoundTripKeepsMissingFrequencies)
+{
+    TextCorpus corpus;
+    FillCorpus(corpus);
+    ASSERT_EQ(corpus.GetWordFrequency("100%"), 3);
+
+    const fs::path path = TempPath("statistics.bin");
+    corpus.SaveStatisticsToFile(path.string());
+
+    TextCorpus loaded;
+    loaded.MergeDocumentFrequencies({{"устаревший", 6}});
+    loaded.LoadStatisticsFromFile(path.string());
+
+    EXPECT_EQ(loaded.GetTotalDocuments(), kDocumentsCount);
+    EXPECT_EQ(loaded.GetTotalTexts(), 9);
+    EXPECT_EQ(loaded.GetTotalWords(), corpus.GetTotalWords());
+    EXPECT_TRUE(loaded.GetTexts().empty());
+
+    for (const std::string lemma : {"статистика", "частота", "документ", "словарь"}) {
+        EXPECT_EQ(loaded.GetWordFrequency(lemma), corpus.GetWordFrequency(lemma)) << lemma;
+        EXPECT_EQ(loaded.GetDocumentFrequency(lemma), corpus.GetDocumentFrequency(lemma)) << lemma;
+        EXPECT_DOUBLE_EQ(loaded.CalculateTF(lemma), corpus.CalculateTF(lemma)) << lemma;
+        EXPECT_DOUBLE_EQ(loaded.CalculateIDF(lemma), corpus.CalculateIDF(lemma)) << lemma;
+    }
+    EXPECT_EQ(loaded.GetWordFrequency("статистика"), 8);
+    EXPECT_EQ(loaded.GetDocumentFrequency("статистика"), 4);
+
+    // A zero document frequency gives the largest IDF, a missing one gives no IDF at all
+    EXPECT_DOUBLE_EQ(loaded.CalculateIDF("частота"), std::log(kDocumentsCount / 1.0));
+    EXPECT_DOUBLE_EQ(loaded.CalculateIDF("словарь"), 0.0);
+    EXPECT_DOUBLE_EQ(loaded.CalculateTF("документ"), 0.0);
+
+    // Lemmas rejected by StringFilters::ShouldFilterOut are not written, and loading replaces the old counts
+    const std::string bytes = ReadBytes(path);
+    EXPECT_EQ(bytes.find("100%"), std::string::npos);
+    EXPECT_EQ(bytes.find("***"), std::string::npos);
+    EXPECT_EQ(loaded.GetWordFrequency("100%"), 0);
+    EXPECT_DOUBLE_EQ(loaded.CalculateIDF("***"), 0.0);
+    EXPECT_EQ(loaded.GetWordFrequency("устаревший"), 0);
+    EXPECT_DOUBLE_EQ(loaded.CalculateIDF("устаревший"), 0.0);
+
+    fs::remove(path);
+}
+
+TEST(TextCorpusTest, LoadStatisticsRejectsOtherFiles)
+{
+    TextCorpus corpus;
+    EXPECT_THROW(corpus.LoadStatisticsFromFile(TempPath("missing").string()), std::runtime_error);
+
+    // The sentence corpus and the statistics share the header layout but not the magic
+    const fs::path path = TempPath("foreign.bin");
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "ATTSENTS" << std::string(64, '\0');
+    EXPECT_THROW(corpus.LoadStatisticsFromFile(path.string()), std::runtime_error);
+
+    fs::remove(path);
+}
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <TokenizedSentenceCorpus.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct TestSentence {
+    size_t docNum;
+    size_t sentNum;
+    std::string originalStr;
+    std::string normalizedStr;
+};
+
+fs::path TempPath(const std::string& name)
+{
+    return fs::temp_directory_path() / ("tokenized_sentence_corpus_test_" + name);
+}
+
+// Lemmatized text of the given length in bytes; ASCII, so that cutting it keeps valid UTF-8
+std::string Normalized(size_t docNum, size_t sentNum, size_t length)
+{
+    std::string text = "lemma " + std::to_string(docNum) + " " + std::to_string(sentNum) + " ";
+    text.resize(length, 'x');
+    return text;
+}
+
+// Documents and sentences are numbered sparsely; short sentences sit in the middle and at the end of documents
+std::vector<TestSentence> MakeSentences()
+{
+    std::vector<TestSentence> sentences;
+    const std::vector<std::tuple<size_t, size_t, size_t>> positions = {
+        {3, 0, 60}, {3, 2, 49}, {3, 5, 50}, {3, 6, 10}, {17, 9, 120}, {17, 11, 80}, {1000000, 0, 0}, {1000000, 4, 75}};
+    for (const auto& [docNum, sentNum, length] : positions) {
+        sentences.push_back({docNum, sentNum, "Предложение \"" + std::to_string(sentNum) + "\" документа.",
+                             Normalized(docNum, sentNum, length)});
+    }
+    return sentences;
+}
+
+bool IsKept(const TestSentence& sentence)
+{
+    return sentence.normalizedStr.size() >= TokenizedSentenceCorpus::kMinNormalizedLength;
+}
+
+void FillCorpus(TokenizedSentenceCorpus& corpus, const std::vector<TestSentence>& sentences)
+{
+    for (const auto& sentence : sentences) {
+        corpus.AddSentence(sentence.docNum, sentence.sentNum, sentence.originalStr, sentence.normalizedStr);
+    }
+    corpus.Pack();
+}
+
+// Checks that the kept sentences are found with their texts and the dropped ones are missing
+void ExpectKeptSentences(const TokenizedSentenceCorpus& corpus, const std::vector<TestSentence>& sentences)
+{
+    size_t keptCount = 0;
+    for (const auto& sentence : sentences) {
+        const auto found = corpus.GetSentence(sentence.docNum, sentence.sentNum);
+        if (!IsKept(sentence)) {
+            EXPECT_FALSE(found.has_value()) << sentence.docNum << ":" << sentence.sentNum;
+            EXPECT_FALSE(corpus.FindSentenceId(sentence.docNum, sentence.sentNum).has_value());
+            continue;
+        }
+        ++keptCount;
+        ASSERT_TRUE(found.has_value()) << sentence.docNum << ":" << sentence.sentNum;
+        EXPECT_EQ(found->docNum, sentence.docNum);
+        EXPECT_EQ(found->sentNum, sentence.sentNum);
+        EXPECT_EQ(found->originalStr, sentence.originalStr);
+        EXPECT_EQ(found->normalizedStr, sentence.normalizedStr);
+    }
+
+    size_t visited = 0;
+    corpus.ForEachSentence([&](const TokenizedSentence&) { ++visited; });
+    EXPECT_EQ(visited, keptCount);
+
+    // Numbers between and after the saved ones
+    EXPECT_FALSE(corpus.FindSentenceId(3, 1).has_value());
+    EXPECT_FALSE(corpus.FindSentenceId(3, 100).has_value());
+    EXPECT_FALSE(corpus.FindSentenceId(4, 0).has_value());
+    EXPECT_FALSE(corpus.FindSentenceId(2000000, 0).has_value());
+}
+
+} // namespace
+
+TEST(TokenizedSentenceCorpusTest, SnapshotRoundTripKeepsSentenceIds)
+{
+    const auto sentences = MakeSentences();
+    TokenizedSentenceCorpus corpus;
+    FillCorpus(corpus, sentences);
+
+    std::vector<std::optional<uint32_t>> ids;
+    for (const auto& sentence : sentences) {
+        ids.push_back(corpus.FindSentenceId(sentence.docNum, sentence.sentNum));
+        ASSERT_TRUE(ids.back().has_value());
+    }
+
+    const fs::path path = TempPath("snapshot.bin");
+    corpus.SaveSnapshot(path.string());
+
+    TokenizedSentenceCorpus loaded;
+    loaded.LoadFromFile(path.string());
+    EXPECT_EQ(loaded.totalSentences, static_cast<int>(sentences.size()));
+    ExpectKeptSentences(loaded, sentences);
+
+    // Dropped sentences leave empty slots, so the ids of the kept ones do not move
+    for (size_t i = 0; i < sentences.size(); ++i) {
+        if (!IsKept(sentences[i])) {
+            continue;
+        }
+        EXPECT_EQ(loaded.FindSentenceId(sentences[i].docNum, sentences[i].sentNum), ids[i]);
+        const TokenizedSentence byId = loaded.GetSentenceById(*ids[i]);
+        EXPECT_EQ(byId.docNum, sentences[i].docNum);
+        EXPECT_EQ(byId.sentNum, sentences[i].sentNum);
+        EXPECT_EQ(byId.originalStr, sentences[i].originalStr);
+    }
+
+    fs::remove(path);
+}
+
+TEST(TokenizedSentenceCorpusTest, LoadFromFileDetectsJson)
+{
+    const auto sentences = MakeSentences();
+    TokenizedSentenceCorpus corpus;
+    FillCorpus(corpus, sentences);
+
+    const fs::path path = TempPath("sentences.json");
+    corpus.SaveToFile(path.string());
+
+    TokenizedSentenceCorpus loaded;
+    loaded.LoadFromFile(path.string());
+    EXPECT_EQ(loaded.totalSentences, static_cast<int>(sentences.size()));
+    ExpectKeptSentences(loaded, sentences);
+
+    // A JSON document shorter than the magic is parsed as well
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << R"({"sentences":[],"totalSentences":0})";
+    loaded.LoadFromFile(path.string());
+    EXPECT_EQ(loaded.totalSentences, 0);
+    EXPECT_FALSE(loaded.FindSentenceId(3, 0).has_value());
+
+    fs::remove(path);
+}
+
+TEST(TokenizedSentenceCorpusTest, LoadFromFileRejectsBadFiles)
+{
+    TokenizedSentenceCorpus corpus;
+    EXPECT_THROW(corpus.LoadFromFile(TempPath("missing").string()), std::runtime_error);
+
+    const fs::path path = TempPath("bad");
+    // The magic of a snapshot followed by another version
+    std::ofstream(path, std::ios::binary | std::ios::trunc)
+        << std::string(TokenizedSentenceCorpus::kMagic) << std::string("\x07\0\0\0", 4);
+    EXPECT_THROW(corpus.LoadFromFile(path.string()), std::runtime_error);
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "neither a snapshot nor JSON";
+    EXPECT_THROW(corpus.LoadFromFile(path.string()), nlohmann::json::exception);
+
+    // A snapshot whose document table points past its slots
+    TokenizedSentenceCorpus source;
+    FillCorpus(source, MakeSentences());
+    source.SaveSnapshot(path.string());
+    // The header is the magic, the version, the sentence count and three sizes; the document numbers and the first
+    // slots of the documents follow
+    constexpr std::streamoff kDocNumsOffset = 48;
+    constexpr std::streamoff kDocBeginsOffset = kDocNumsOffset + 3 * sizeof(uint64_t);
+    const uint64_t pastSlots = 1000;
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(kDocBeginsOffset + sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(&pastSlots), sizeof(pastSlots));
+    file.close();
+    try {
+        corpus.LoadFromFile(path.string());
+        FAIL() << "A snapshot with a document past the slots was loaded";
+    } catch (const std::runtime_error& ex) {
+        EXPECT_NE(std::string(ex.what()).find("Corrupted sentences snapshot"), std::string::npos) << ex.what();
+    }
+
+    fs::remove(path);
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <TopicScoring.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t kDimension = 300;
+
+// The pairwise computation of TopicSimilarity
+float PairScore(const float* phrase, const float* topic)
+{
+    const VectorKernels& kernels = GetVectorKernels();
+    const float phraseNorm = std::sqrt(kernels.dotProduct(phrase, phrase, kDimension));
+    const float topicNorm = std::sqrt(kernels.dotProduct(topic, topic, kDimension));
+    return TopicScore(kernels.metrics(phrase, topic, kDimension), phraseNorm, topicNorm);
+}
+
+struct TopicScoringData {
+    std::vector<std::vector<float>> topics;
+    std::vector<std::vector<float>> phrases;
+
+    TopicScoringData()
+    {
+        std::mt19937 random(11);
+        std::normal_distribution<float> value(0.0f, 0.1f);
+        auto randomVector = [&]() {
+            std::vector<float> vector(kDimension);
+            std::generate(vector.begin(), vector.end(), [&] { return value(random); });
+            return vector;
+        };
+
+        for (size_t i = 0; i < 37; ++i) {
+            topics.push_back(randomVector());
+        }
+        topics.push_back(std::vector<float>(kDimension, 0.0f));
+
+        // More than two blocks of phrases: random ones, copies of topics, noisy topics and a zero vector
+        for (size_t i = 0; i < 600; ++i) {
+            if (i % 5 == 0) {
+                std::vector<float> vector = topics[i % topics.size()];
+                const float noise = 0.01f * (i % 7);
+                for (float& x : vector) {
+                    x += noise * value(random);
+                }
+                phrases.push_back(std::move(vector));
+            } else {
+                phrases.push_back(randomVector());
+            }
+        }
+        phrases.push_back(std::vector<float>(kDimension, 0.0f));
+    }
+
+    static std::vector<const float*> Rows(const std::vector<std::vector<float>>& vectors)
+    {
+        std::vector<const float*> rows;
+        for (const auto& vector : vectors) {
+            rows.push_back(vector.data());
+        }
+        return rows;
+    }
+};
+
+} // namespace
+
+TEST(TopicScoringTest, SelectsSameTopicsAsPairwiseScores)
+{
+    const TopicScoringData data;
+    const TopicScoreMatrix matrix(TopicScoringData::Rows(data.topics), kDimension);
+    ASSERT_EQ(matrix.TopicsCount(), data.topics.size());
+
+    std::vector<float> scores;
+    for (const auto& phrase : data.phrases) {
+        for (const auto& topic : data.topics) {
+            scores.push_back(PairScore(phrase.data(), topic.data()));
+        }
+    }
+    // Thresholds at quantiles of the scores put many pairs right next to them, and one pair exactly on them
+    std::vector<float> sortedScores = scores;
+    std::sort(sortedScores.begin(), sortedScores.end());
+    for (double quantile : {0.1, 0.5, 0.9, 0.99}) {
+        const float threshold = sortedScores[static_cast<size_t>(quantile * (sortedScores.size() - 1))];
+        SCOPED_TRACE("threshold " + std::to_string(threshold));
+
+        size_t exactPairs = 0;
+        const auto selected = matrix.SelectTopics(TopicScoringData::Rows(data.phrases), threshold, 4, &exactPairs);
+        ASSERT_EQ(selected.size(), data.phrases.size());
+        EXPECT_LT(exactPairs, scores.size());
+        for (size_t phrase = 0; phrase < data.phrases.size(); ++phrase) {
+            std::vector<uint32_t> expected;
+            for (size_t topic = 0; topic < data.topics.size(); ++topic) {
+                if (scores[phrase * data.topics.size() + topic] > threshold) {
+                    expected.push_back(static_cast<uint32_t>(topic));
+                }
+            }
+            EXPECT_EQ(selected[phrase], expected) << "phrase " << phrase;
+        }
+    }
+}
+
+TEST(TopicScoringTest, ResultDoesNotDependOnThreads)
+{
+    const TopicScoringData data;
+    const TopicScoreMatrix matrix(TopicScoringData::Rows(data.topics), kDimension);
+    const auto rows = TopicScoringData::Rows(data.phrases);
+    EXPECT_EQ(matrix.SelectTopics(rows, 0.3f, 1), matrix.SelectTopics(rows, 0.3f, 8));
+}
+
+TEST(TopicScoringTest, EmptyInputs)
+{
+    const TopicScoreMatrix noTopics({}, kDimension);
+    const std::vector<float> phrase(kDimension, 1.0f);
+    const auto selected = noTopics.SelectTopics({phrase.data()}, 0.0f);
+    ASSERT_EQ(selected.size(), 1u);
+    EXPECT_TRUE(selected[0].empty());
+
+    const TopicScoreMatrix matrix({phrase.data()}, kDimension);
+    EXPECT_TRUE(matrix.SelectTopics({}, 0.0f).empty());
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <UnixSocket.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string SocketPath(const std::string& name)
+{
+    return (fs::temp_directory_path() / ("unix_socket_test_" + name + "_" + std::to_string(::getpid()))).string();
+}
+
+} // namespace
+
+TEST(UnixSocketTest, ConcurrentRequestsAreAnswered)
+{
+    const std::string path = SocketPath("echo");
+    std::atomic<int> handled{0};
+    UnixSocketServer server(path, [&](const std::string& request) {
+        ++handled;
+        return "OK " + request;
+    });
+    std::thread serverThread([&]() { server.Run(); });
+
+    std::vector<std::thread> clients;
+    std::vector<std::string> responses(8);
+    for (size_t i = 0; i < responses.size(); ++i) {
+        clients.emplace_back([&, i]() { responses[i] = SendUnixSocketRequest(path, "lookup\n" + std::to_string(i)); });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    // A large request exercises the partial reads and writes
+    const std::string large(1 << 20, 'x');
+    EXPECT_EQ(SendUnixSocketRequest(path, large), "OK " + large);
+
+    server.Stop();
+    serverThread.join();
+
+    EXPECT_EQ(handled, 9);
+    for (size_t i = 0; i < responses.size(); ++i) {
+        EXPECT_EQ(responses[i], "OK lookup\n" + std::to_string(i));
+    }
+}
+
+TEST(UnixSocketTest, WorkersBoundConcurrentRequests)
+{
+    const std::string path = SocketPath("workers");
+    constexpr size_t kWorkersCount = 2;
+    std::atomic<int> running{0};
+    std::atomic<int> maxRunning{0};
+    UnixSocketServer server(
+        path,
+        [&](const std::string& request) {
+            const int current = ++running;
+            int observed = maxRunning;
+            while (current > observed && !maxRunning.compare_exchange_weak(observed, current)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            --running;
+            return "OK " + request;
+        },
+        kWorkersCount);
+    std::thread serverThread([&]() { server.Run(); });
+
+    std::vector<std::thread> clients;
+    std::vector<std::string> responses(16);
+    for (size_t i = 0; i < responses.size(); ++i) {
+        clients.emplace_back([&, i]() { responses[i] = SendUnixSocketRequest(path, std::to_string(i)); });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    server.Stop();
+    serverThread.join();
+
+    // Connections beyond the workers wait for a free worker instead of getting a thread each
+    EXPECT_LE(maxRunning.load(), static_cast<int>(kWorkersCount));
+    for (size_t i = 0; i < responses.size(); ++i) {
+        EXPECT_EQ(responses[i], "OK " + std::to_string(i));
+    }
+}
+
+TEST(UnixSocketTest, HandlerExceptionsAndStopFromHandler)
+{
+    const std::string path = SocketPath("stop");
+    UnixSocketServer* serverPtr = nullptr;
+    UnixSocketServer server(path, [&](const std::string& request) -> std::string {
+        if (request == "shutdown") {
+            serverPtr->Stop();
+            return "OK\n";
+        }
+        throw std::runtime_error("unknown command");
+    });
+    serverPtr = &server;
+    std::thread serverThread([&]() { server.Run(); });
+
+    EXPECT_EQ(SendUnixSocketRequest(path, "bad"), "ERROR unknown command\n");
+    EXPECT_EQ(SendUnixSocketRequest(path, "shutdown"), "OK\n");
+    serverThread.join();
+}
+
+TEST(UnixSocketTest, MissingServerThrows)
+{
+    EXPECT_THROW(SendUnixSocketRequest(SocketPath("missing"), "lookup"), std::runtime_error);
+}
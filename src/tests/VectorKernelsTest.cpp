@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <VectorKernels.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+VectorMetrics ReferenceMetrics(const std::vector<float>& a, const std::vector<float>& b)
+{
+    double dot = 0, squared = 0, manhattan = 0, minSum = 0, maxSum = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        dot += double(a[i]) * b[i];
+        squared += double(a[i] - b[i]) * (a[i] - b[i]);
+        manhattan += std::abs(double(a[i]) - b[i]);
+        minSum += std::min(a[i], b[i]);
+        maxSum += std::max(a[i], b[i]);
+    }
+    return {float(dot), float(squared), float(manhattan), float(minSum), float(maxSum)};
+}
+
+} // namespace
+
+TEST(VectorKernelsTest, AllKernelsMatchReference)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    const auto& kernels = GetSupportedVectorKernels();
+    ASSERT_FALSE(kernels.empty());
+    EXPECT_STREQ(kernels.back().name, "scalar");
+
+    // Sizes cover empty vectors, tails of every length and the embedding dimensions
+    std::vector<size_t> sizes;
+    for (size_t size = 0; size <= 40; ++size) {
+        sizes.push_back(size);
+    }
+    sizes.insert(sizes.end(), {100, 300});
+
+    for (size_t size : sizes) {
+        std::vector<float> a(size), b(size);
+        std::generate(a.begin(), a.end(), [&] { return value(random); });
+        std::generate(b.begin(), b.end(), [&] { return value(random); });
+        const VectorMetrics expected = ReferenceMetrics(a, b);
+        const float tolerance = 1e-4f * (size + 1);
+
+        for (const auto& kernel : kernels) {
+            SCOPED_TRACE(std::string(kernel.name) + ", size " + std::to_string(size));
+            EXPECT_NEAR(kernel.dotProduct(a.data(), b.data(), size), expected.dot, tolerance);
+            const VectorMetrics metrics = kernel.metrics(a.data(), b.data(), size);
+            EXPECT_NEAR(metrics.dot, expected.dot, tolerance);
+            EXPECT_NEAR(metrics.squaredDistance, expected.squaredDistance, tolerance);
+            EXPECT_NEAR(metrics.manhattanDistance, expected.manhattanDistance, tolerance);
+            EXPECT_NEAR(metrics.minSum, expected.minSum, tolerance);
+            EXPECT_NEAR(metrics.maxSum, expected.maxSum, tolerance);
+        }
+    }
+}
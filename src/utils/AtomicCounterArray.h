@@ -0,0 +1,115 @@
+#ifndef ATOMIC_COUNTER_ARRAY_H
+#define ATOMIC_COUNTER_ARRAY_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// \class AtomicCounterArray
+// \brief Counters indexed by dense ids, such as the ids of LemmaDictionary, that any number of threads may add to
+//        while new ids keep appearing. Counters live in segments of doubling size that are allocated on first use and
+//        never move, so adding to a counter takes one or two atomic operations and no lock. A counter that was never
+//        set holds kMissing, which tells an unused id apart from a zero count.
+//        Set and Clear are meant for phases where no other thread uses the array, e.g. loading saved counts.
+class AtomicCounterArray {
+public:
+    static constexpr int32_t kMissing = -1;
+
+    AtomicCounterArray() = default;
+
+    AtomicCounterArray(const AtomicCounterArray&) = delete;
+    AtomicCounterArray& operator=(const AtomicCounterArray&) = delete;
+
+    ~AtomicCounterArray()
+    {
+        Clear();
+    }
+
+    // \brief Returns the counter of the id, or kMissing if it was never set.
+    int32_t Get(uint32_t id) const
+    {
+        const auto [segmentInd, offset] = Locate(id);
+        const std::atomic<int32_t>* segment = segments[segmentInd].load(std::memory_order_acquire);
+        return segment ? segment[offset].load(std::memory_order_relaxed) : kMissing;
+    }
+
+    // \brief Adds count to the counter of the id; a missing counter starts from zero. Thread-safe.
+    void Add(uint32_t id, int32_t count)
+    {
+        std::atomic<int32_t>& counter = Counter(id);
+        int32_t expected = kMissing;
+        if (!counter.compare_exchange_strong(expected, count, std::memory_order_relaxed)) {
+            counter.fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+    void Set(uint32_t id, int32_t value)
+    {
+        Counter(id).store(value, std::memory_order_relaxed);
+    }
+
+    // \brief Number of ids covered by the allocated segments; the counters of all larger ids are missing.
+    size_t Size() const
+    {
+        for (size_t segmentInd = kSegmentsCount; segmentInd > 0; --segmentInd) {
+            if (segments[segmentInd - 1].load(std::memory_order_acquire)) {
+                return SegmentBegin(segmentInd);
+            }
+        }
+        return 0;
+    }
+
+    // \brief Makes all counters missing and frees their memory.
+    void Clear()
+    {
+        for (auto& segment : segments) {
+            delete[] segment.exchange(nullptr, std::memory_order_acq_rel);
+        }
+    }
+
+private:
+    static constexpr size_t kFirstSegmentSize = 1024;
+    // Segment k holds kFirstSegmentSize * 2^k counters, so 23 segments cover every uint32_t id
+    static constexpr size_t kSegmentsCount = 23;
+
+    std::array<std::atomic<std::atomic<int32_t>*>, kSegmentsCount> segments{};
+
+    // First id of the segment
+    static size_t SegmentBegin(size_t segmentInd)
+    {
+        return kFirstSegmentSize * ((size_t{1} << segmentInd) - 1);
+    }
+
+    // Segment of the id and the offset of its counter in the segment
+    static std::pair<size_t, size_t> Locate(uint32_t id)
+    {
+        const unsigned long long position = id / kFirstSegmentSize + 1;
+        const size_t segmentInd = 63 - __builtin_clzll(position);
+        return {segmentInd, id - SegmentBegin(segmentInd)};
+    }
+
+    // Counter of the id, allocating its segment if no thread has done it yet
+    std::atomic<int32_t>& Counter(uint32_t id)
+    {
+        const auto [segmentInd, offset] = Locate(id);
+        std::atomic<int32_t>* segment = segments[segmentInd].load(std::memory_order_acquire);
+        if (!segment) {
+            const size_t size = kFirstSegmentSize << segmentInd;
+            std::atomic<int32_t>* allocated = new std::atomic<int32_t>[size];
+            for (size_t i = 0; i < size; ++i) {
+                allocated[i].store(kMissing, std::memory_order_relaxed);
+            }
+            // Threads that lose the race use the segment of the winner
+            if (segments[segmentInd].compare_exchange_strong(segment, allocated, std::memory_order_acq_rel)) {
+                segment = allocated;
+            } else {
+                delete[] allocated;
+            }
+        }
+        return segment[offset];
+    }
+};
+
+#endif // ATOMIC_COUNTER_ARRAY_H
@@ -0,0 +1,112 @@
+#include <BinaryIO.h>
+
+#include <cstddef>
+#include <utility>
+
+static constexpr size_t kMagicSize = 8;
+
+BinaryWriter::BinaryWriter(const std::string& filename, std::string_view magic, uint32_t version)
+    : filename(filename), file(filename, std::ios::binary | std::ios::trunc)
+{
+    if (magic.size() != kMagicSize) {
+        throw std::invalid_argument("Binary file magic must be 8 characters long");
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to create file: " + filename);
+    }
+    file.write(magic.data(), kMagicSize);
+    offset = kMagicSize;
+    Write(version);
+}
+
+void BinaryWriter::WriteString(std::string_view str)
+{
+    if (str.size() > UINT32_MAX) {
+        throw std::length_error("String is too long to be written: " + filename);
+    }
+    Write(static_cast<uint32_t>(str.size()));
+    file.write(str.data(), static_cast<std::streamsize>(str.size()));
+    offset += str.size();
+}
+
+void BinaryWriter::Align(size_t alignment)
+{
+    static constexpr char zeros[alignof(std::max_align_t)] = {};
+    const size_t padding = (alignment - offset % alignment) % alignment;
+    file.write(zeros, static_cast<std::streamsize>(padding));
+    offset += padding;
+}
+
+void BinaryWriter::WriteBlock(std::string_view bytes, size_t alignment)
+{
+    Align(alignment);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    offset += bytes.size();
+}
+
+void BinaryWriter::Close()
+{
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error("Failed to write file: " + filename);
+    }
+}
+
+BinaryReader::BinaryReader(const std::string& filename, std::string_view magic, uint32_t version)
+    : filename(filename), file(std::make_shared<MappedFile>(filename))
+{
+    data = file->Data();
+    size = file->Size();
+    CheckHeader(magic, version);
+}
+
+BinaryReader::BinaryReader(std::shared_ptr<const MappedFile> file, size_t begin, size_t size, std::string name,
+                           std::string_view magic, uint32_t version)
+    : filename(std::move(name)), file(std::move(file)), size(size)
+{
+    if (begin > this->file->Size() || size > this->file->Size() - begin) {
+        throw std::runtime_error("Section is out of the file: " + filename);
+    }
+    if (begin % alignof(std::max_align_t) != 0) {
+        throw std::runtime_error("Misaligned section: " + filename);
+    }
+    data = this->file->Data() + begin;
+    CheckHeader(magic, version);
+}
+
+void BinaryReader::CheckHeader(std::string_view magic, uint32_t version)
+{
+    if (magic.size() != kMagicSize) {
+        throw std::invalid_argument("Binary file magic must be 8 characters long");
+    }
+    if (size < kMagicSize || std::string_view(Take(kMagicSize), kMagicSize) != magic) {
+        throw std::runtime_error("Unexpected file format: " + filename);
+    }
+    const uint32_t fileVersion = Read<uint32_t>();
+    if (fileVersion != version) {
+        throw std::runtime_error("Unsupported format version " + std::to_string(fileVersion) + " of " + filename +
+                                 ", expected " + std::to_string(version));
+    }
+}
+
+std::string_view BinaryReader::ReadStringView()
+{
+    const uint32_t size = Read<uint32_t>();
+    return std::string_view(Take(size), size);
+}
+
+const char* BinaryReader::Take(size_t count)
+{
+    if (count > size - offset) {
+        throw std::runtime_error("Unexpected end of file: " + filename);
+    }
+    const char* result = data + offset;
+    offset += count;
+    return result;
+}
+
+void BinaryReader::Align(size_t alignment)
+{
+    // The mapping starts at a page boundary and sections at aligned offsets, so aligned offsets give aligned pointers
+    Take((alignment - offset % alignment) % alignment);
+}
@@ -0,0 +1,146 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <MappedFile.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// \class BinaryWriter
+// \brief Writes a binary file that starts with an 8-byte magic and a format version. Values are stored in the
+//        native byte order, strings are prefixed with their 32-bit length and arrays are aligned to their elements.
+//        Files are meant to be read back on the same machine by BinaryReader, not to be exchanged between platforms.
+class BinaryWriter {
+public:
+    // \brief Creates the file and writes the header.
+    // \param filename      Path to the file.
+    // \param magic         Exactly 8 characters identifying the file type.
+    // \param version       Version of the format that follows the header.
+    // \throws std::runtime_error if the file cannot be created.
+    BinaryWriter(const std::string& filename, std::string_view magic, uint32_t version);
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written as is");
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        offset += sizeof(T);
+    }
+
+    void WriteString(std::string_view str);
+
+    // \brief Writes the elements as one block aligned to alignof(T), so BinaryReader::ReadArray can return a pointer
+    //        into the mapping. The number of elements is not written.
+    template <typename T>
+    void WriteArray(const std::vector<T>& values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written as is");
+        Align(alignof(T));
+        const size_t size = values.size() * sizeof(T);
+        file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(size));
+        offset += size;
+    }
+
+    // \brief Writes the bytes as they are, starting at a multiple of alignment; used to embed whole files.
+    void WriteBlock(std::string_view bytes, size_t alignment);
+
+    // \brief Number of bytes written so far, including the header.
+    size_t Offset() const
+    {
+        return offset;
+    }
+
+    // \brief Flushes and closes the file.
+    // \throws std::runtime_error if any write has failed.
+    void Close();
+
+private:
+    std::string filename;
+    std::ofstream file;
+    size_t offset = 0;
+
+    // Pads the file with zeros up to a multiple of alignment.
+    void Align(size_t alignment);
+};
+
+// \class BinaryReader
+// \brief Reads a file written by BinaryWriter from a memory mapping. Every read is bounds-checked, so truncated or
+//        foreign files are reported with an exception instead of undefined behavior.
+class BinaryReader {
+public:
+    // \brief Maps the file and checks its header.
+    // \throws std::runtime_error if the file cannot be mapped, the magic differs or the version is not supported.
+    BinaryReader(const std::string& filename, std::string_view magic, uint32_t version);
+
+    // \brief Reads a file written by BinaryWriter that is embedded in a larger mapping, such as a section of a
+    //        PipelineImage. The section must start at a multiple of alignof(std::max_align_t) within the mapping.
+    // \param file          Mapping that holds the section; the reader shares its ownership.
+    // \param begin         Offset of the section in the mapping.
+    // \param size          Size of the section.
+    // \param name          Name of the section used in error messages.
+    // \throws std::runtime_error if the section is out of the mapping, the magic differs or the version is not
+    //         supported.
+    BinaryReader(std::shared_ptr<const MappedFile> file, size_t begin, size_t size, std::string name,
+                 std::string_view magic, uint32_t version);
+
+    template <typename T>
+    T Read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read as is");
+        T value;
+        std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    // \brief Returns a pointer to count elements written by BinaryWriter::WriteArray without copying them. The pointer
+    //        is valid while the reader exists.
+    template <typename T>
+    const T* ReadArray(size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read as is");
+        Align(alignof(T));
+        if (count > (size - offset) / sizeof(T)) {
+            throw std::runtime_error("Unexpected end of file: " + filename);
+        }
+        return reinterpret_cast<const T*>(Take(count * sizeof(T)));
+    }
+
+    // \brief Returns a view of the next string; the view is valid while the reader exists.
+    std::string_view ReadStringView();
+
+    std::string ReadString()
+    {
+        return std::string(ReadStringView());
+    }
+
+    bool AtEnd() const
+    {
+        return offset == size;
+    }
+
+    // \brief Path of the file, or the name of the section, used in error messages.
+    const std::string& GetName() const
+    {
+        return filename;
+    }
+
+private:
+    std::string filename;
+    std::shared_ptr<const MappedFile> file;
+    const char* data = nullptr; ///< Start of the file or of the section within the mapping.
+    size_t size = 0;
+    size_t offset = 0;
+
+    void CheckHeader(std::string_view magic, uint32_t version);
+    const char* Take(size_t count);
+    void Align(size_t alignment);
+};
+
+#endif // BINARY_IO_H
@@ -0,0 +1,69 @@
+#include <CorpusDocument.h>
+
+#include <fstream>
+#include <stdexcept>
+
+static std::vector<std::string> ReadLines(const std::string& filename)
+{
+    std::vector<std::string> lines;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+CorpusDocument::CorpusDocument(const std::string& textFile) : path(textFile), text(textFile) {}
+
+std::vector<std::string_view> CorpusDocument::GetParagraphs() const
+{
+    std::vector<std::string_view> paragraphs;
+    std::string_view view = text.View();
+
+    size_t start = 0;
+    while (start < view.size()) {
+        size_t end = view.find('\n', start);
+        if (end == std::string_view::npos) {
+            end = view.size();
+        }
+        paragraphs.push_back(view.substr(start, end - start));
+        start = end + 1;
+    }
+    return paragraphs;
+}
+
+const DocumentMetadata& CorpusDocument::GetMetadata() const
+{
+    if (metadata) {
+        return *metadata;
+    }
+
+    auto result = std::make_unique<DocumentMetadata>();
+
+    const std::string titleFilename = GetSiblingPath(path, "_title.txt");
+    std::ifstream titleFile(titleFilename);
+    if (!titleFile.is_open()) {
+        throw std::runtime_error("Failed to open title file: " + titleFilename);
+    }
+    std::getline(titleFile, result->title);
+
+    result->tags = ReadLines(GetSiblingPath(path, "_tags.txt"));
+    result->hubs = ReadLines(GetSiblingPath(path, "_hubs.txt"));
+
+    metadata = std::move(result);
+    return *metadata;
+}
+
+std::string CorpusDocument::GetSiblingPath(const std::string& textFile, const std::string& suffix)
+{
+    static const std::string textSuffix = "_text.txt";
+
+    size_t pos = textFile.rfind(textSuffix);
+    if (pos == std::string::npos) {
+        throw std::runtime_error("Unexpected filename format: " + textFile);
+    }
+    return textFile.substr(0, pos) + suffix + textFile.substr(pos + textSuffix.size());
+}
@@ -0,0 +1,62 @@
+#ifndef CORPUS_DOCUMENT_H
+#define CORPUS_DOCUMENT_H
+
+#include <MappedFile.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// \struct DocumentMetadata
+// \brief Title, tags and hubs of a corpus document, read from the files next to its text file.
+struct DocumentMetadata {
+    std::string title;             ///< First line of art<N>_title.txt.
+    std::vector<std::string> tags; ///< Lines of art<N>_tags.txt; empty if the file does not exist.
+    std::vector<std::string> hubs; ///< Lines of art<N>_hubs.txt; empty if the file does not exist.
+};
+
+// \class CorpusDocument
+// \brief A document of the texts directory (art<N>_text.txt). The text file is memory-mapped once and shared
+//        by every consumer: the corpus loader iterates over its paragraphs as string views and the sentence
+//        splitter reads it through a stream over the same mapping. The metadata is read on first access and cached.
+class CorpusDocument {
+public:
+    // \brief Maps the text file of the document.
+    // \param textFile      Path to the art<N>_text.txt file.
+    explicit CorpusDocument(const std::string& textFile);
+
+    const std::string& GetPath() const
+    {
+        return path;
+    }
+
+    std::string_view GetText() const
+    {
+        return text.View();
+    }
+
+    // \brief Returns the paragraphs (lines) of the text, splitting the same way as std::getline.
+    std::vector<std::string_view> GetParagraphs() const;
+
+    // \brief Returns a new input stream positioned at the beginning of the text.
+    std::unique_ptr<std::istream> OpenStream() const
+    {
+        return std::make_unique<ViewInputStream>(text.View());
+    }
+
+    // \brief Returns the metadata of the document, reading it on first access.
+    // \throws std::runtime_error if the title file cannot be read.
+    const DocumentMetadata& GetMetadata() const;
+
+    // \brief Returns the path to a file of the same document with another suffix, e.g. "_title.txt".
+    // \throws std::runtime_error if the path does not end with "_text.txt".
+    static std::string GetSiblingPath(const std::string& textFile, const std::string& suffix);
+
+private:
+    std::string path;
+    MappedFile text;
+    mutable std::unique_ptr<DocumentMetadata> metadata; ///< Cached metadata, created on first access.
+};
+
+#endif // CORPUS_DOCUMENT_H
@@ -0,0 +1,373 @@
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// \struct FlatHash
+// \brief Default hash of FlatHashMap. For std::string keys it hashes through std::string_view and is transparent, so
+//        maps keyed by strings can be searched with a string_view or a string literal without building a string.
+template <typename Key>
+struct FlatHash : std::hash<Key> {
+};
+
+template <>
+struct FlatHash<std::string> {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view value) const noexcept
+    {
+        return std::hash<std::string_view>{}(value);
+    }
+};
+
+// \class FlatHashMap
+// \brief Open-addressing hash map with the std::unordered_map interface used in this project.
+//        Elements are stored contiguously in insertion order in one vector, so iteration is a linear scan and there
+//        is no allocation per element. The table itself is an array of 8-byte buckets (a 32-bit fingerprint of the
+//        hash and the index of the element) searched with linear probing, so a lookup usually touches one cache line
+//        of buckets and compares the key only on a fingerprint match. The hash of every element is computed once on
+//        insertion and kept next to it, so growing the table and erasing never hash keys again.
+//
+//        Differences from std::unordered_map: value_type is std::pair<Key, Value> and the key must not be changed
+//        through an iterator; inserting may invalidate all references and iterators; erasing moves the last element
+//        into the place of the erased one, so it invalidates references to the last element and changes the order.
+//        erase(iterator) returns an iterator to the element that took the erased place, so the usual
+//        `it = map.erase(it)` loop still visits every element once.
+// \tparam Hash             Hash of the keys; lookups with other key types are allowed if it defines is_transparent.
+// \tparam KeyEqual         Key comparison, must accept the same key types as Hash.
+template <typename Key, typename Value, typename Hash = FlatHash<Key>, typename KeyEqual = std::equal_to<>>
+class FlatHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    FlatHashMap() = default;
+
+    iterator begin() noexcept
+    {
+        return entries.begin();
+    }
+
+    iterator end() noexcept
+    {
+        return entries.end();
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return entries.begin();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return entries.end();
+    }
+
+    size_t size() const noexcept
+    {
+        return entries.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return entries.empty();
+    }
+
+    // \brief Number of buckets of the table; the table grows when it is more than 80% full.
+    size_t bucket_count() const noexcept
+    {
+        return buckets.size();
+    }
+
+    template <typename K = Key>
+    iterator find(const K& key)
+    {
+        const size_t bucketInd = FindBucket(key, HashOf(key));
+        return bucketInd == kNotFound ? end() : begin() + buckets[bucketInd].entryInd;
+    }
+
+    template <typename K = Key>
+    const_iterator find(const K& key) const
+    {
+        const size_t bucketInd = FindBucket(key, HashOf(key));
+        return bucketInd == kNotFound ? end() : begin() + buckets[bucketInd].entryInd;
+    }
+
+    template <typename K = Key>
+    size_t count(const K& key) const
+    {
+        return FindBucket(key, HashOf(key)) == kNotFound ? 0 : 1;
+    }
+
+    template <typename K = Key>
+    bool contains(const K& key) const
+    {
+        return count(key) != 0;
+    }
+
+    template <typename K = Key>
+    Value& at(const K& key)
+    {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("FlatHashMap::at: key not found");
+        }
+        return it->second;
+    }
+
+    template <typename K = Key>
+    const Value& at(const K& key) const
+    {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("FlatHashMap::at: key not found");
+        }
+        return it->second;
+    }
+
+    Value& operator[](const Key& key)
+    {
+        return try_emplace(key).first->second;
+    }
+
+    Value& operator[](Key&& key)
+    {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    // \brief Inserts an element with the value built from args if the key is missing. With a transparent hash the key
+    //        may be of another type, e.g. a string_view; the Key is then constructed from it only on insertion.
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args)
+    {
+        const size_t hash = HashOf(key);
+        const size_t bucketInd = FindBucket(key, hash);
+        if (bucketInd != kNotFound) {
+            return {begin() + buckets[bucketInd].entryInd, false};
+        }
+        return {Insert(hash, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                       std::forward_as_tuple(std::forward<Args>(args)...)),
+                true};
+    }
+
+    template <typename K, typename V>
+    std::pair<iterator, bool> emplace(K&& key, V&& value)
+    {
+        return try_emplace(std::forward<K>(key), std::forward<V>(value));
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        return try_emplace(value.first, value.second);
+    }
+
+    template <typename K, typename V>
+    std::pair<iterator, bool> insert_or_assign(K&& key, V&& value)
+    {
+        auto result = try_emplace(std::forward<K>(key), std::forward<V>(value));
+        if (!result.second) {
+            result.first->second = std::forward<V>(value);
+        }
+        return result;
+    }
+
+    template <typename K = Key, typename = std::enable_if_t<!std::is_convertible_v<const K&, const_iterator>>>
+    size_t erase(const K& key)
+    {
+        const size_t bucketInd = FindBucket(key, HashOf(key));
+        if (bucketInd == kNotFound) {
+            return 0;
+        }
+        EraseBucket(bucketInd);
+        return 1;
+    }
+
+    // \brief Erases the element and returns an iterator to the element moved into its place (or end()).
+    iterator erase(const_iterator pos)
+    {
+        const size_t entryInd = static_cast<size_t>(pos - entries.cbegin());
+        EraseBucket(FindBucketOfEntry(entryInd));
+        return begin() + entryInd;
+    }
+
+    void reserve(size_t count)
+    {
+        entries.reserve(count);
+        hashes.reserve(count);
+        if (BucketsFor(count) > buckets.size()) {
+            Rehash(BucketsFor(count));
+        }
+    }
+
+    void clear() noexcept
+    {
+        entries.clear();
+        hashes.clear();
+        std::fill(buckets.begin(), buckets.end(), Bucket{});
+    }
+
+private:
+    struct Bucket {
+        uint32_t fingerprint = 0; ///< High bits of the hash with the lowest bit set; 0 marks an empty bucket.
+        uint32_t entryInd = 0;    ///< Index of the element in entries.
+    };
+
+    static constexpr size_t kNotFound = std::numeric_limits<size_t>::max();
+    static constexpr size_t kMinBuckets = 8;
+
+    std::vector<value_type> entries; ///< Elements in insertion order, with the last one moved into erased places.
+    std::vector<size_t> hashes;      ///< Hash of every element, computed once on insertion.
+    std::vector<Bucket> buckets;     ///< Power-of-two table, empty until the first insertion.
+
+    template <typename K>
+    static size_t HashOf(const K& key)
+    {
+        static_assert(std::is_same_v<std::decay_t<K>, Key> || std::is_convertible_v<const K&, const Key&> ||
+                          IsTransparent<Hash>::value,
+                      "Lookup with another key type requires a transparent hash");
+        // Remix the hash, so that the identity hashes of the standard library still spread over the low bits
+        const uint64_t hash = static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(hash ^ (hash >> 29));
+    }
+
+    template <typename H, typename = void>
+    struct IsTransparent : std::false_type {
+    };
+
+    template <typename H>
+    struct IsTransparent<H, std::void_t<typename H::is_transparent>> : std::true_type {
+    };
+
+    static uint32_t FingerprintOf(size_t hash)
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(hash) >> 32) | 1u;
+    }
+
+    size_t Mask() const
+    {
+        return buckets.size() - 1;
+    }
+
+    // Smallest power-of-two table that holds count elements at a load factor of at most 0.8.
+    static size_t BucketsFor(size_t count)
+    {
+        size_t bucketsCount = kMinBuckets;
+        while (bucketsCount * 4 < count * 5) {
+            bucketsCount *= 2;
+        }
+        return bucketsCount;
+    }
+
+    template <typename K>
+    size_t FindBucket(const K& key, size_t hash) const
+    {
+        if (buckets.empty()) {
+            return kNotFound;
+        }
+        const uint32_t fingerprint = FingerprintOf(hash);
+        const size_t mask = Mask();
+        for (size_t bucketInd = hash & mask;; bucketInd = (bucketInd + 1) & mask) {
+            const Bucket& bucket = buckets[bucketInd];
+            if (bucket.fingerprint == 0) {
+                return kNotFound;
+            }
+            if (bucket.fingerprint == fingerprint && KeyEqual{}(entries[bucket.entryInd].first, key)) {
+                return bucketInd;
+            }
+        }
+    }
+
+    size_t FindBucketOfEntry(size_t entryInd) const
+    {
+        const size_t mask = Mask();
+        size_t bucketInd = hashes[entryInd] & mask;
+        while (buckets[bucketInd].entryInd != entryInd || buckets[bucketInd].fingerprint == 0) {
+            bucketInd = (bucketInd + 1) & mask;
+        }
+        return bucketInd;
+    }
+
+    void PlaceBucket(size_t hash, size_t entryInd)
+    {
+        const size_t mask = Mask();
+        size_t bucketInd = hash & mask;
+        while (buckets[bucketInd].fingerprint != 0) {
+            bucketInd = (bucketInd + 1) & mask;
+        }
+        buckets[bucketInd] = Bucket{FingerprintOf(hash), static_cast<uint32_t>(entryInd)};
+    }
+
+    void Rehash(size_t bucketsCount)
+    {
+        buckets.assign(bucketsCount, Bucket{});
+        for (size_t entryInd = 0; entryInd < entries.size(); ++entryInd) {
+            PlaceBucket(hashes[entryInd], entryInd);
+        }
+    }
+
+    template <typename... Args>
+    iterator Insert(size_t hash, Args&&... args)
+    {
+        if (entries.size() >= std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("FlatHashMap: too many elements");
+        }
+        if (BucketsFor(entries.size() + 1) > buckets.size()) {
+            Rehash(std::max(BucketsFor(entries.size() + 1), buckets.size() * 2));
+        }
+        entries.emplace_back(std::forward<Args>(args)...);
+        try {
+            hashes.push_back(hash);
+        } catch (...) {
+            entries.pop_back();
+            throw;
+        }
+        PlaceBucket(hash, entries.size() - 1);
+        return entries.end() - 1;
+    }
+
+    void EraseBucket(size_t bucketInd)
+    {
+        const size_t entryInd = buckets[bucketInd].entryInd;
+
+        // Backward-shift deletion: pull later buckets of the probe chain into the hole, so no tombstones are needed
+        const size_t mask = Mask();
+        size_t hole = bucketInd;
+        for (size_t next = (hole + 1) & mask; buckets[next].fingerprint != 0; next = (next + 1) & mask) {
+            const size_t ideal = hashes[buckets[next].entryInd] & mask;
+            if (((next - ideal) & mask) >= ((next - hole) & mask)) {
+                buckets[hole] = buckets[next];
+                hole = next;
+            }
+        }
+        buckets[hole] = Bucket{};
+
+        // Keep the elements contiguous by moving the last one into the erased place
+        const size_t lastInd = entries.size() - 1;
+        if (entryInd != lastInd) {
+            buckets[FindBucketOfEntry(lastInd)].entryInd = static_cast<uint32_t>(entryInd);
+            entries[entryInd] = std::move(entries[lastInd]);
+            hashes[entryInd] = hashes[lastInd];
+        }
+        entries.pop_back();
+        hashes.pop_back();
+    }
+};
+
+#endif // FLAT_HASH_MAP_H
@@ -0,0 +1,544 @@
+#include <HnswIndex.h>
+#include <ParallelFor.h>
+#include <VectorKernels.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <random>
+#include <stdexcept>
+
+namespace {
+    // Layers above this one are so sparse that they would only hold a few vectors of any realistic index
+    constexpr int kMaxLevel = 16;
+
+    std::vector<float> Normalized(const float* vector, size_t dimension)
+    {
+        std::vector<float> normalized(vector, vector + dimension);
+        const float norm = std::sqrt(GetVectorKernels().dotProduct(vector, vector, dimension));
+        if (norm != 0.0f) {
+            for (float& value : normalized) {
+                value /= norm;
+            }
+        }
+        return normalized;
+    }
+}
+
+// Marks of the vectors visited by one search. Marking with an epoch that changes on every search avoids clearing
+// the marks, and lists are reused between searches, so a search neither allocates nor touches all vectors.
+struct HnswIndex::VisitedPool {
+    struct List {
+        std::vector<uint16_t> marks;
+        uint16_t epoch = 0;
+
+        void Next()
+        {
+            if (++epoch == 0) {
+                std::fill(marks.begin(), marks.end(), 0);
+                epoch = 1;
+            }
+        }
+
+        // Marks the vector; returns false if it was already visited by this search
+        bool Visit(uint32_t id)
+        {
+            if (marks[id] == epoch) {
+                return false;
+            }
+            marks[id] = epoch;
+            return true;
+        }
+    };
+
+    // Returns a list to the pool when the search ends
+    struct Lease {
+        VisitedPool& pool;
+        std::unique_ptr<List> list;
+
+        ~Lease()
+        {
+            std::lock_guard<std::mutex> lock(pool.mtx);
+            pool.lists.push_back(std::move(list));
+        }
+
+        List* operator->() const
+        {
+            return list.get();
+        }
+    };
+
+    explicit VisitedPool(size_t size) : size(size)
+    {
+    }
+
+    Lease Acquire()
+    {
+        std::unique_ptr<List> list;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!lists.empty()) {
+                list = std::move(lists.back());
+                lists.pop_back();
+            }
+        }
+        if (!list) {
+            list = std::make_unique<List>();
+            list->marks.assign(size, 0);
+        }
+        list->Next();
+        return Lease{*this, std::move(list)};
+    }
+
+    size_t size;
+    std::mutex mtx;
+    std::vector<std::unique_ptr<List>> lists;
+};
+
+HnswIndex::HnswIndex(HnswParameters parameters)
+    : parameters(parameters), linkMutexes(std::make_unique<std::mutex[]>(0)),
+      visitedPool(std::make_unique<VisitedPool>(0))
+{
+    if (parameters.maxLinks < 2) {
+        throw std::invalid_argument("HNSW index needs at least 2 links per vector");
+    }
+}
+
+HnswIndex::~HnswIndex() = default;
+
+HnswIndex::HnswIndex(HnswIndex&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+// The entry mutex only guards a build, so it is not moved
+HnswIndex& HnswIndex::operator=(HnswIndex&& other) noexcept
+{
+    parameters = other.parameters;
+    dimension = other.dimension;
+    count = other.count;
+    entryPoint = other.entryPoint;
+    maxLevel = other.maxLevel;
+    values = std::move(other.values);
+    levels = std::move(other.levels);
+    bottomLinks = std::move(other.bottomLinks);
+    upperLinks = std::move(other.upperLinks);
+    linkMutexes = std::move(other.linkMutexes);
+    visitedPool = std::move(other.visitedPool);
+    other.count = 0;
+    other.maxLevel = -1;
+    return *this;
+}
+
+void HnswIndex::Reset(size_t newCount, size_t newDimension)
+{
+    count = newCount;
+    dimension = newDimension;
+    entryPoint = 0;
+    maxLevel = -1;
+    values.assign(count * dimension, 0.0f);
+    levels.assign(count, 0);
+    bottomLinks.assign(count * (MaxLinks(0) + 1), 0);
+    upperLinks.assign(count, {});
+    linkMutexes = std::make_unique<std::mutex[]>(count);
+    visitedPool = std::make_unique<VisitedPool>(count);
+}
+
+uint32_t* HnswIndex::Links(uint32_t id, int level)
+{
+    if (level == 0) {
+        return bottomLinks.data() + static_cast<size_t>(id) * (MaxLinks(0) + 1);
+    }
+    return upperLinks[id].data() + static_cast<size_t>(level - 1) * (MaxLinks(level) + 1);
+}
+
+const uint32_t* HnswIndex::Links(uint32_t id, int level) const
+{
+    return const_cast<HnswIndex*>(this)->Links(id, level);
+}
+
+float HnswIndex::Similarity(const float* query, uint32_t id) const
+{
+    return GetVectorKernels().dotProduct(query, Vector(id), dimension);
+}
+
+uint32_t HnswIndex::GreedyClosest(const float* query, uint32_t start, int level, bool locked) const
+{
+    uint32_t closest = start;
+    float closestSimilarity = Similarity(query, closest);
+    std::vector<uint32_t> links;
+    for (bool improved = true; improved;) {
+        improved = false;
+        {
+            std::unique_lock<std::mutex> lock;
+            if (locked) {
+                lock = std::unique_lock<std::mutex>(linkMutexes[closest]);
+            }
+            const uint32_t* nodeLinks = Links(closest, level);
+            links.assign(nodeLinks + 1, nodeLinks + 1 + nodeLinks[0]);
+        }
+        for (uint32_t neighbor : links) {
+            const float similarity = Similarity(query, neighbor);
+            if (similarity > closestSimilarity) {
+                closestSimilarity = similarity;
+                closest = neighbor;
+                improved = true;
+            }
+        }
+    }
+    return closest;
+}
+
+std::vector<HnswIndex::Candidate> HnswIndex::SearchLayer(const float* query, const std::vector<uint32_t>& starts,
+                                                         size_t ef, int level, bool locked) const
+{
+    auto visited = visitedPool->Acquire();
+    // The most similar candidate to expand on top, and the least similar result on top
+    std::priority_queue<Candidate> candidates;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> results;
+    for (uint32_t start : starts) {
+        if (visited->Visit(start)) {
+            const float similarity = Similarity(query, start);
+            candidates.emplace(similarity, start);
+            results.emplace(similarity, start);
+        }
+    }
+    while (results.size() > ef) {
+        results.pop();
+    }
+
+    std::vector<uint32_t> links;
+    while (!candidates.empty()) {
+        const Candidate current = candidates.top();
+        if (results.size() >= ef && current.first < results.top().first) {
+            break;
+        }
+        candidates.pop();
+
+        {
+            std::unique_lock<std::mutex> lock;
+            if (locked) {
+                lock = std::unique_lock<std::mutex>(linkMutexes[current.second]);
+            }
+            const uint32_t* nodeLinks = Links(current.second, level);
+            links.assign(nodeLinks + 1, nodeLinks + 1 + nodeLinks[0]);
+        }
+        for (uint32_t neighbor : links) {
+            if (!visited->Visit(neighbor)) {
+                continue;
+            }
+            const float similarity = Similarity(query, neighbor);
+            if (results.size() < ef || similarity > results.top().first) {
+                candidates.emplace(similarity, neighbor);
+                results.emplace(similarity, neighbor);
+                if (results.size() > ef) {
+                    results.pop();
+                }
+            }
+        }
+    }
+
+    std::vector<Candidate> found;
+    found.reserve(results.size());
+    for (; !results.empty(); results.pop()) {
+        found.push_back(results.top());
+    }
+    std::reverse(found.begin(), found.end());
+    return found;
+}
+
+std::vector<uint32_t> HnswIndex::SelectNeighbors(const std::vector<Candidate>& candidates, size_t maxCount) const
+{
+    std::vector<uint32_t> selected;
+    std::vector<uint32_t> pruned;
+    for (const auto& [similarity, id] : candidates) {
+        if (selected.size() >= maxCount) {
+            break;
+        }
+        // A candidate closer to an already selected neighbour than to the query is reached through that neighbour
+        bool diverse = true;
+        for (uint32_t other : selected) {
+            if (Similarity(Vector(id), other) > similarity) {
+                diverse = false;
+                break;
+            }
+        }
+        (diverse ? selected : pruned).push_back(id);
+    }
+    for (size_t i = 0; i < pruned.size() && selected.size() < maxCount; ++i) {
+        selected.push_back(pruned[i]);
+    }
+    return selected;
+}
+
+void HnswIndex::Insert(uint32_t id)
+{
+    const int level = levels[id];
+    const float* query = Vector(id);
+
+    // Raising the top layer changes the entry point, so such insertions hold the lock to the end
+    std::unique_lock<std::mutex> entryLock(entryMutex);
+    const int topLevel = maxLevel;
+    uint32_t enter = entryPoint;
+    if (topLevel < 0) {
+        entryPoint = id;
+        maxLevel = level;
+        return;
+    }
+    if (level <= topLevel) {
+        entryLock.unlock();
+    }
+
+    for (int layer = topLevel; layer > level; --layer) {
+        enter = GreedyClosest(query, enter, layer, true);
+    }
+
+    std::vector<uint32_t> starts{enter};
+    for (int layer = std::min(level, topLevel); layer >= 0; --layer) {
+        std::vector<Candidate> candidates = SearchLayer(query, starts, parameters.efConstruction, layer, true);
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [id](const Candidate& candidate) { return candidate.second == id; }),
+                         candidates.end());
+        const std::vector<uint32_t> neighbors = SelectNeighbors(candidates, parameters.maxLinks);
+        {
+            std::lock_guard<std::mutex> lock(linkMutexes[id]);
+            uint32_t* links = Links(id, layer);
+            links[0] = static_cast<uint32_t>(neighbors.size());
+            std::copy(neighbors.begin(), neighbors.end(), links + 1);
+        }
+
+        const uint32_t maxLinks = MaxLinks(layer);
+        for (uint32_t neighbor : neighbors) {
+            std::lock_guard<std::mutex> lock(linkMutexes[neighbor]);
+            uint32_t* links = Links(neighbor, layer);
+            if (std::find(links + 1, links + 1 + links[0], id) != links + 1 + links[0]) {
+                continue;
+            }
+            if (links[0] < maxLinks) {
+                links[1 + links[0]++] = id;
+                continue;
+            }
+            // The list is full: the new link competes with the existing ones
+            std::vector<Candidate> linked;
+            linked.reserve(links[0] + 1);
+            const float* neighborVector = Vector(neighbor);
+            for (uint32_t i = 1; i <= links[0]; ++i) {
+                linked.emplace_back(Similarity(neighborVector, links[i]), links[i]);
+            }
+            linked.emplace_back(Similarity(neighborVector, id), id);
+            std::sort(linked.begin(), linked.end(), std::greater<Candidate>());
+            const std::vector<uint32_t> kept = SelectNeighbors(linked, maxLinks);
+            links[0] = static_cast<uint32_t>(kept.size());
+            std::copy(kept.begin(), kept.end(), links + 1);
+        }
+
+        starts.clear();
+        for (const auto& candidate : candidates) {
+            starts.push_back(candidate.second);
+        }
+        if (starts.empty()) {
+            starts.push_back(enter);
+        }
+    }
+
+    if (level > topLevel) {
+        entryPoint = id;
+        maxLevel = level;
+    }
+}
+
+void HnswIndex::Build(const std::vector<const float*>& vectors, size_t dimension, size_t threadsCount)
+{
+    Reset(vectors.size(), dimension);
+    if (count > UINT32_MAX) {
+        throw std::invalid_argument("HNSW index supports up to 2^32 vectors");
+    }
+
+    // Levels are drawn in order from the seed, so only the links depend on the thread scheduling
+    std::mt19937_64 random(parameters.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double levelScale = 1.0 / std::log(static_cast<double>(parameters.maxLinks));
+    for (size_t id = 0; id < count; ++id) {
+        const double level = -std::log(1.0 - uniform(random)) * levelScale;
+        levels[id] = static_cast<uint8_t>(std::min<double>(level, kMaxLevel));
+        upperLinks[id].assign(static_cast<size_t>(levels[id]) * (MaxLinks(1) + 1), 0);
+    }
+
+    ParallelFor(count, threadsCount, [&](size_t id) {
+        const std::vector<float> normalized = Normalized(vectors[id], dimension);
+        std::copy(normalized.begin(), normalized.end(), values.begin() + id * dimension);
+    });
+    if (count == 0) {
+        return;
+    }
+    Insert(0);
+    ParallelFor(count - 1, threadsCount, [&](size_t i) { Insert(static_cast<uint32_t>(i + 1)); });
+}
+
+std::vector<HnswIndex::Neighbor> HnswIndex::Search(const float* query, size_t k, size_t ef) const
+{
+    if (count == 0 || k == 0) {
+        return {};
+    }
+    const std::vector<float> normalized = Normalized(query, dimension);
+    uint32_t enter = entryPoint;
+    for (int layer = maxLevel; layer > 0; --layer) {
+        enter = GreedyClosest(normalized.data(), enter, layer, false);
+    }
+    const std::vector<Candidate> found = SearchLayer(normalized.data(), {enter}, std::max(ef, k), 0, false);
+
+    std::vector<Neighbor> neighbors;
+    for (size_t i = 0; i < found.size() && i < k; ++i) {
+        neighbors.push_back({found[i].second, found[i].first});
+    }
+    return neighbors;
+}
+
+std::vector<HnswIndex::Neighbor> HnswIndex::SearchRadius(const float* query, float minSimilarity, size_t ef) const
+{
+    if (count == 0) {
+        return {};
+    }
+    const std::vector<float> normalized = Normalized(query, dimension);
+    std::vector<Neighbor> neighbors;
+    auto visited = visitedPool->Acquire();
+    std::vector<uint32_t> queue;
+    for (const Neighbor& neighbor : Search(query, ef, ef)) {
+        visited->Visit(neighbor.id);
+        if (neighbor.similarity >= minSimilarity) {
+            neighbors.push_back(neighbor);
+            queue.push_back(neighbor.id);
+        }
+    }
+
+    // Vectors above the bound are usually linked to each other, so the ball is explored through them only
+    for (size_t i = 0; i < queue.size(); ++i) {
+        const uint32_t* links = Links(queue[i], 0);
+        for (uint32_t j = 1; j <= links[0]; ++j) {
+            if (!visited->Visit(links[j])) {
+                continue;
+            }
+            const float similarity = Similarity(normalized.data(), links[j]);
+            if (similarity >= minSimilarity) {
+                neighbors.push_back({links[j], similarity});
+                queue.push_back(links[j]);
+            }
+        }
+    }
+
+    std::sort(neighbors.begin(), neighbors.end(),
+              [](const Neighbor& a, const Neighbor& b) { return a.similarity > b.similarity; });
+    return neighbors;
+}
+
+std::vector<HnswIndex::Neighbor> HnswIndex::ExactSearch(const float* query, size_t k) const
+{
+    const std::vector<float> normalized = Normalized(query, dimension);
+    std::vector<Neighbor> neighbors(count);
+    for (uint32_t id = 0; id < count; ++id) {
+        neighbors[id] = {id, Similarity(normalized.data(), id)};
+    }
+    k = std::min(k, neighbors.size());
+    std::partial_sort(neighbors.begin(), neighbors.begin() + k, neighbors.end(),
+                      [](const Neighbor& a, const Neighbor& b) { return a.similarity > b.similarity; });
+    neighbors.resize(k);
+    return neighbors;
+}
+
+void HnswIndex::Save(BinaryWriter& writer) const
+{
+    writer.Write(static_cast<uint64_t>(count));
+    writer.Write(static_cast<uint32_t>(dimension));
+    writer.Write(parameters.maxLinks);
+    writer.Write(parameters.efConstruction);
+    writer.Write(parameters.seed);
+    writer.Write(entryPoint);
+    writer.Write(static_cast<int32_t>(maxLevel));
+    writer.WriteArray(values);
+    writer.WriteArray(levels);
+    writer.WriteArray(bottomLinks);
+    // Upper layers of all vectors are concatenated; their sizes follow from the levels
+    std::vector<uint32_t> upper;
+    for (const auto& links : upperLinks) {
+        upper.insert(upper.end(), links.begin(), links.end());
+    }
+    writer.Write(static_cast<uint64_t>(upper.size()));
+    writer.WriteArray(upper);
+}
+
+void HnswIndex::Save(const std::string& filename) const
+{
+    BinaryWriter writer(filename, kMagic, kVersion);
+    Save(writer);
+    writer.Close();
+}
+
+void HnswIndex::Load(BinaryReader& reader)
+{
+    const uint64_t loadedCount = reader.Read<uint64_t>();
+    const uint32_t loadedDimension = reader.Read<uint32_t>();
+    HnswParameters loadedParameters;
+    loadedParameters.maxLinks = reader.Read<uint32_t>();
+    loadedParameters.efConstruction = reader.Read<uint32_t>();
+    loadedParameters.seed = reader.Read<uint64_t>();
+    const uint32_t loadedEntryPoint = reader.Read<uint32_t>();
+    const int32_t loadedMaxLevel = reader.Read<int32_t>();
+    auto corrupted = [&reader](const std::string& what) {
+        return std::runtime_error("Corrupted HNSW index (" + what + "): " + reader.GetName());
+    };
+    if (loadedCount > UINT32_MAX || loadedParameters.maxLinks < 2 || loadedMaxLevel > kMaxLevel ||
+        (loadedCount == 0) != (loadedMaxLevel < 0) || (loadedCount > 0 && loadedEntryPoint >= loadedCount)) {
+        throw corrupted("header");
+    }
+
+    HnswIndex loaded(loadedParameters);
+    loaded.Reset(loadedCount, loadedDimension);
+    loaded.entryPoint = loadedEntryPoint;
+    loaded.maxLevel = loadedMaxLevel;
+    const float* loadedValues = reader.ReadArray<float>(loaded.values.size());
+    std::copy(loadedValues, loadedValues + loaded.values.size(), loaded.values.begin());
+    const uint8_t* loadedLevels = reader.ReadArray<uint8_t>(loaded.count);
+    std::copy(loadedLevels, loadedLevels + loaded.count, loaded.levels.begin());
+    const uint32_t* loadedBottom = reader.ReadArray<uint32_t>(loaded.bottomLinks.size());
+    std::copy(loadedBottom, loadedBottom + loaded.bottomLinks.size(), loaded.bottomLinks.begin());
+
+    const uint64_t upperSize = reader.Read<uint64_t>();
+    uint64_t expectedUpperSize = 0;
+    for (uint8_t level : loaded.levels) {
+        if (level > loadedMaxLevel) {
+            throw corrupted("levels");
+        }
+        expectedUpperSize += static_cast<uint64_t>(level) * (loaded.MaxLinks(1) + 1);
+    }
+    if (upperSize != expectedUpperSize) {
+        throw corrupted("upper layers");
+    }
+    const uint32_t* upper = reader.ReadArray<uint32_t>(upperSize);
+    for (size_t id = 0; id < loaded.count; ++id) {
+        const size_t size = static_cast<size_t>(loaded.levels[id]) * (loaded.MaxLinks(1) + 1);
+        loaded.upperLinks[id].assign(upper, upper + size);
+        upper += size;
+    }
+
+    for (uint32_t id = 0; id < loaded.count; ++id) {
+        for (int level = 0; level <= loaded.levels[id]; ++level) {
+            const uint32_t* links = loaded.Links(id, level);
+            if (links[0] > loaded.MaxLinks(level)) {
+                throw corrupted("links count");
+            }
+            for (uint32_t i = 1; i <= links[0]; ++i) {
+                if (links[i] >= loaded.count || loaded.levels[links[i]] < level) {
+                    throw corrupted("link");
+                }
+            }
+        }
+    }
+    *this = std::move(loaded);
+}
+
+void HnswIndex::Load(const std::string& filename)
+{
+    BinaryReader reader(filename, kMagic, kVersion);
+    Load(reader);
+}
@@ -0,0 +1,135 @@
+#ifndef HNSW_INDEX_H
+#define HNSW_INDEX_H
+
+#include <BinaryIO.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// \struct HnswParameters
+// \brief Parameters of an HnswIndex; larger values give a better recall for a slower build or search.
+struct HnswParameters {
+    uint32_t maxLinks = 16;        ///< Links per vector on the upper layers; the bottom layer keeps twice as many.
+    uint32_t efConstruction = 200; ///< Candidates considered while linking a new vector.
+    uint64_t seed = 42;            ///< Seed of the random layers of the vectors.
+};
+
+// \class HnswIndex
+// \brief Approximate nearest-neighbour index over vectors by cosine similarity: a Hierarchical Navigable Small World
+//        graph (Malkov and Yashunin). Every vector is linked to its approximate neighbours on the bottom layer and
+//        on a random number of sparser upper layers; a search descends greedily from the top layer and finishes
+//        with a beam search of ef candidates on the bottom layer. The vectors are normalized and copied into the
+//        index. Searches are thread-safe once the index is built.
+class HnswIndex {
+public:
+    // \struct Neighbor
+    // \brief A found vector: its index in the built vectors and its cosine similarity to the query.
+    struct Neighbor {
+        uint32_t id;
+        float similarity;
+    };
+
+    static constexpr std::string_view kMagic = "ATTHNSWI";
+    static constexpr uint32_t kVersion = 1;
+
+    explicit HnswIndex(HnswParameters parameters = {});
+    ~HnswIndex();
+
+    HnswIndex(HnswIndex&&) noexcept;
+    HnswIndex& operator=(HnswIndex&&) noexcept;
+
+    // \brief Builds the index over the vectors, replacing its previous contents. Vectors are inserted by several
+    //        threads, so the graph (but not its quality) depends on the scheduling.
+    // \param vectors       Vectors of the same dimension; their ids are their positions.
+    // \param threadsCount  Number of threads inserting vectors (0 uses all hardware threads).
+    void Build(const std::vector<const float*>& vectors, size_t dimension, size_t threadsCount = 1);
+
+    // \brief Finds the k vectors most similar to the query.
+    // \param ef            Candidates kept by the bottom-layer search (at least k); larger values raise the recall.
+    // \return              Up to k neighbours, the most similar first.
+    std::vector<Neighbor> Search(const float* query, size_t k, size_t ef = 64) const;
+
+    // \brief Finds the vectors with a similarity to the query of at least minSimilarity: the neighbours of a beam
+    //        search and then all vectors reachable from them on the bottom layer through vectors above the bound.
+    // \return              The found neighbours, the most similar first.
+    std::vector<Neighbor> SearchRadius(const float* query, float minSimilarity, size_t ef = 64) const;
+
+    // \brief Exact k nearest neighbours by comparing the query with every vector, for measuring the recall.
+    std::vector<Neighbor> ExactSearch(const float* query, size_t k) const;
+
+    size_t Size() const
+    {
+        return count;
+    }
+
+    size_t Dimension() const
+    {
+        return dimension;
+    }
+
+    // \brief Writes the vectors and the graph after the header of the writer, so the index can be part of a file.
+    void Save(BinaryWriter& writer) const;
+
+    void Save(const std::string& filename) const;
+
+    // \brief Reads an index written by Save, replacing the contents of this one.
+    // \throws std::runtime_error if the data are corrupted.
+    void Load(BinaryReader& reader);
+
+    void Load(const std::string& filename);
+
+private:
+    using Candidate = std::pair<float, uint32_t>; ///< Similarity and id.
+
+    struct VisitedPool;
+
+    HnswParameters parameters;
+    size_t dimension = 0;
+    size_t count = 0;
+    uint32_t entryPoint = 0;
+    int maxLevel = -1;                         ///< Top layer of the graph; -1 if the index is empty.
+    std::vector<float> values;                 ///< Normalized vectors, row by row.
+    std::vector<uint8_t> levels;               ///< Top layer of every vector.
+    std::vector<uint32_t> bottomLinks;         ///< Count and links of every vector on the bottom layer.
+    std::vector<std::vector<uint32_t>> upperLinks; ///< Count and links of every vector on each of its upper layers.
+    std::unique_ptr<std::mutex[]> linkMutexes; ///< Guard the links of every vector during the build.
+    std::mutex entryMutex;                     ///< Guards the entry point and the top layer during the build.
+    std::unique_ptr<VisitedPool> visitedPool;
+
+    const float* Vector(uint32_t id) const
+    {
+        return values.data() + static_cast<size_t>(id) * dimension;
+    }
+
+    uint32_t MaxLinks(int level) const
+    {
+        return level == 0 ? 2 * parameters.maxLinks : parameters.maxLinks;
+    }
+
+    uint32_t* Links(uint32_t id, int level);
+    const uint32_t* Links(uint32_t id, int level) const;
+
+    float Similarity(const float* query, uint32_t id) const;
+
+    // Moves greedily to the most similar vector on the layer.
+    uint32_t GreedyClosest(const float* query, uint32_t start, int level, bool locked) const;
+
+    // Beam search of ef candidates on the layer; returns them sorted, the most similar first.
+    std::vector<Candidate> SearchLayer(const float* query, const std::vector<uint32_t>& starts, size_t ef, int level,
+                                       bool locked) const;
+
+    // Keeps at most maxCount candidates that are more similar to the query than to any kept candidate, filling
+    // the remaining places with the most similar ones.
+    std::vector<uint32_t> SelectNeighbors(const std::vector<Candidate>& candidates, size_t maxCount) const;
+
+    void Insert(uint32_t id);
+
+    void Reset(size_t newCount, size_t newDimension);
+};
+
+#endif // HNSW_INDEX_H
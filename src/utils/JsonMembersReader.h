@@ -0,0 +1,163 @@
+#ifndef JSON_MEMBERS_READER_H
+#define JSON_MEMBERS_READER_H
+
+#include <nlohmann/json.hpp>
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// \class JsonMembersReader
+// \brief SAX handler for files that hold one large JSON object of independent members, e.g. total_results.json with
+//        one member per cluster. Only the member being parsed is built as a DOM; it is passed to the callback as soon
+//        as its value closes and is released right after, so the whole tree never exists in memory.
+//        Usage: JsonMembersReader reader(callback); json::sax_parse(input, &reader);
+class JsonMembersReader : public nlohmann::json_sax<nlohmann::json> {
+public:
+    using json = nlohmann::json;
+    using MemberCallback = std::function<void(const std::string& key, const json& value)>;
+
+    explicit JsonMembersReader(MemberCallback onMember) : onMember(std::move(onMember))
+    {
+    }
+
+    bool null() override
+    {
+        return AddValue(nullptr);
+    }
+
+    bool boolean(bool value) override
+    {
+        return AddValue(value);
+    }
+
+    bool number_integer(number_integer_t value) override
+    {
+        return AddValue(value);
+    }
+
+    bool number_unsigned(number_unsigned_t value) override
+    {
+        return AddValue(value);
+    }
+
+    bool number_float(number_float_t value, const string_t&) override
+    {
+        return AddValue(value);
+    }
+
+    bool string(string_t& value) override
+    {
+        return AddValue(std::move(value));
+    }
+
+    bool binary(binary_t& value) override
+    {
+        return AddValue(json::binary(std::move(value)));
+    }
+
+    bool start_object(std::size_t) override
+    {
+        if (depth++ == 0) {
+            return true;
+        }
+        return Open(json::object());
+    }
+
+    bool key(string_t& key) override
+    {
+        if (depth == 1) {
+            memberKey = std::move(key);
+        } else {
+            pendingKey = std::move(key);
+        }
+        return true;
+    }
+
+    bool end_object() override
+    {
+        if (--depth == 0) {
+            return true;
+        }
+        return Close();
+    }
+
+    bool start_array(std::size_t) override
+    {
+        if (depth++ == 0) {
+            throw std::runtime_error("Expected a JSON object.");
+        }
+        return Open(json::array());
+    }
+
+    bool end_array() override
+    {
+        --depth;
+        return Close();
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+    {
+        throw ex;
+    }
+
+private:
+    MemberCallback onMember;
+    size_t depth = 0;         ///< Nesting level of the current position, the top-level object is level 1.
+    std::string memberKey;    ///< Key of the member being built.
+    std::string pendingKey;   ///< Key of the next value inside the member.
+    json member;              ///< Value of the member being built.
+    std::vector<json*> stack; ///< Open objects and arrays of the member, innermost last.
+
+    // Inserts the value into the innermost open container and returns a pointer to the stored value.
+    json* Insert(json&& value)
+    {
+        json& parent = *stack.back();
+        if (parent.is_object()) {
+            json& slot = parent[pendingKey];
+            slot = std::move(value);
+            return &slot;
+        }
+        parent.push_back(std::move(value));
+        return &parent.back();
+    }
+
+    bool AddValue(json&& value)
+    {
+        if (stack.empty()) {
+            if (depth == 0) {
+                throw std::runtime_error("Expected a JSON object.");
+            }
+            // A member that is not an object or an array is complete at once
+            onMember(memberKey, value);
+            return true;
+        }
+        Insert(std::move(value));
+        return true;
+    }
+
+    bool Open(json&& container)
+    {
+        if (stack.empty()) {
+            member = std::move(container);
+            stack.push_back(&member);
+        } else {
+            stack.push_back(Insert(std::move(container)));
+        }
+        return true;
+    }
+
+    bool Close()
+    {
+        stack.pop_back();
+        if (stack.empty()) {
+            onMember(memberKey, member);
+            member = nullptr;
+        }
+        return true;
+    }
+};
+
+#endif // JSON_MEMBERS_READER_H
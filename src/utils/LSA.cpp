@@ -1,3 +1,4 @@
+#include <FlatHashMap.h>
 #include <LSA.h>
 #include <PatternPhrasesStorage.h>
 #include <StringFilters.h>
@@ -5,9 +6,9 @@
 // Method to create a term-document frequency matrix, excluding rare words
 std::pair<MatrixXd, std::vector<std::string>> LSA::CreateTermDocumentMatrix(bool useSentences)
 {
-    std::unordered_map<std::string, int> wordFrequency; // Word frequency count
-    std::unordered_map<std::string, int> wordIndex;     // Word indices for the matrix
-    std::vector<std::string> words;                     // List of unique words
+    FlatHashMap<std::string, int> wordFrequency; // Word frequency count
+    FlatHashMap<std::string, int> wordIndex;     // Word indices for the matrix
+    std::vector<std::string> words;              // List of unique words
     int index = 0;
     const auto& stopWords = GetStopWords();
 
@@ -16,21 +17,17 @@ std::pair<MatrixXd, std::vector<std::string>> LSA::CreateTermDocumentMatrix(bool
 
     if (useSentences) {
         // Use sentences as documents
-        for (const auto& [docNum, sentencesMap] : corpus.sentenceMap) {
-            for (const auto& [sentNum, sentence] : sentencesMap) {
-                size_t uniqueSentId = docNum * 100000 + sentNum; // Unique identifier for each sentence
-                texts[uniqueSentId] = sentence.normalizedStr;    // Add each sentence as a separate "document"
-            }
-        }
+        corpus.ForEachSentence([&](const TokenizedSentence& sentence) {
+            size_t uniqueSentId = sentence.docNum * 100000 + sentence.sentNum; // Unique identifier for each sentence
+            texts[uniqueSentId] = sentence.normalizedStr; // Add each sentence as a separate "document"
+        });
     } else {
-        // Use entire documents
-        for (const auto& [docNum, sentencesMap] : corpus.sentenceMap) {
-            std::string combinedText;
-            for (const auto& [sentNum, sentence] : sentencesMap) {
-                combinedText += sentence.normalizedStr + " "; // Combine sentences into one text
-            }
-            texts[docNum] = combinedText; // Save the combined text for each document
-        }
+        // Use entire documents; sentences of a document come one after another
+        corpus.ForEachSentence([&](const TokenizedSentence& sentence) {
+            std::string& combinedText = texts[sentence.docNum];
+            combinedText += sentence.normalizedStr; // Combine sentences into one text
+            combinedText += ' ';
+        });
     }
 
     // Count word frequency in each text
@@ -69,10 +66,11 @@ std::pair<MatrixXd, std::vector<std::string>> LSA::CreateTermDocumentMatrix(bool
         for (const auto& word : tokens) {
             // Check if the word is in the index and is not a stop word or contains unwanted characters
             if (!word.empty() && word.size() > 5 && LSAStopWords.find(word) == LSAStopWords.end() &&
-                stopWords.find(word) == stopWords.end() && wordIndex.find(word) != wordIndex.end() &&
-                !StringFilters::ContainsUnwantedCharacters(word) && !StringFilters::ShouldFilterOut(word)) {
-                int wordIdx = wordIndex[word];
-                termDocumentMatrix(wordIdx, textIndex) += 1; // Increase the frequency of the word in the text
+                stopWords.find(word) == stopWords.end() && !StringFilters::ContainsUnwantedCharacters(word) &&
+                !StringFilters::ShouldFilterOut(word)) {
+                if (auto it = wordIndex.find(word); it != wordIndex.end()) {
+                    termDocumentMatrix(it->second, textIndex) += 1; // Increase the frequency of the word in the text
+                }
             }
         }
         ++textIndex;
@@ -153,6 +151,55 @@ void LSA::PerformAnalysis(bool useSentences)
     this->words = words;
 }
 
+// Matrices are stored column by column, as Eigen keeps them in memory
+static void WriteMatrix(BinaryWriter& writer, const MatrixXd& matrix)
+{
+    writer.Write(static_cast<int64_t>(matrix.rows()));
+    writer.Write(static_cast<int64_t>(matrix.cols()));
+    writer.WriteArray(std::vector<double>(matrix.data(), matrix.data() + matrix.size()));
+}
+
+static MatrixXd ReadMatrix(BinaryReader& reader)
+{
+    const int64_t rows = reader.Read<int64_t>();
+    const int64_t cols = reader.Read<int64_t>();
+    if (rows < 0 || cols < 0 || (cols > 0 && static_cast<uint64_t>(rows) > UINT64_MAX / static_cast<uint64_t>(cols))) {
+        throw std::runtime_error("Corrupted LSA factors: " + reader.GetName());
+    }
+    const double* values = reader.ReadArray<double>(static_cast<size_t>(rows * cols));
+    return Map<const MatrixXd>(values, rows, cols);
+}
+
+void LSA::SaveFactors(const std::string& filename) const
+{
+    BinaryWriter writer(filename, kFactorsMagic, kFactorsVersion);
+    WriteMatrix(writer, U);
+    WriteMatrix(writer, Sigma);
+    WriteMatrix(writer, V);
+    writer.Write(static_cast<uint64_t>(words.size()));
+    for (const auto& word : words) {
+        writer.WriteString(word);
+    }
+    writer.Close();
+}
+
+void LSA::LoadFactors(BinaryReader& reader)
+{
+    MatrixXd loadedU = ReadMatrix(reader);
+    MatrixXd loadedSigma = ReadMatrix(reader);
+    MatrixXd loadedV = ReadMatrix(reader);
+    const uint64_t wordsCount = reader.Read<uint64_t>();
+    std::vector<std::string> loadedWords;
+    for (uint64_t wordInd = 0; wordInd < wordsCount; ++wordInd) {
+        loadedWords.push_back(reader.ReadString());
+    }
+
+    U = std::move(loadedU);
+    Sigma = std::move(loadedSigma);
+    V = std::move(loadedV);
+    words = std::move(loadedWords);
+}
+
 void LSA::AnalyzeTopics(int numTopics, int topWords)
 {
     if (numTopics > U.cols()) {
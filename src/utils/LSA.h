@@ -1,6 +1,7 @@
 #ifndef LSA_H
 #define LSA_H
 
+#include <BinaryIO.h>
 #include <Eigen/Dense>
 #include <TokenizedSentenceCorpus.h>
 #include <boost/algorithm/string.hpp>
@@ -38,6 +39,9 @@ struct LSA_MetricsConfig {
 
 class LSA {
 public:
+    static constexpr std::string_view kFactorsMagic = "ATTLSAFC";
+    static constexpr uint32_t kFactorsVersion = 1;
+
     // Constructor
     LSA(const TokenizedSentenceCorpus& corpus) : corpus(corpus)
     {
@@ -52,6 +56,14 @@ public:
     // Method to compute Singular Value Decomposition (SVD) of the matrix
     void ComputeSVD(const MatrixXd& termDocumentMatrix);
 
+    // \brief Saves U, Sigma, V and the words of the analysis, so that the metrics can be computed again without
+    //        building the term-document matrix and its SVD.
+    void SaveFactors(const std::string& filename) const;
+
+    // \brief Restores the factors written by SaveFactors instead of performing the analysis.
+    // \throws std::runtime_error if the factors are corrupted or have another format version.
+    void LoadFactors(BinaryReader& reader);
+
     // Methods to get the SVD results
     MatrixXd GetU() const
     {
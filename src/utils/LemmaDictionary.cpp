@@ -0,0 +1,48 @@
+#include <LemmaDictionary.h>
+
+#include <mutex>
+#include <stdexcept>
+
+uint32_t LemmaDictionary::GetId(std::string_view lemma)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        auto it = ids.find(lemma);
+        if (it != ids.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    auto it = ids.find(lemma);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    const uint32_t id = static_cast<uint32_t>(lemmas.size());
+    lemmas.emplace_back(lemma);
+    ids.emplace(lemmas.back(), id);
+    return id;
+}
+
+uint32_t LemmaDictionary::FindId(std::string_view lemma) const
+{
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto it = ids.find(lemma);
+    return it != ids.end() ? it->second : kUnknownId;
+}
+
+const std::string& LemmaDictionary::GetLemma(uint32_t id) const
+{
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    if (id >= lemmas.size()) {
+        throw std::out_of_range("Unknown lemma id: " + std::to_string(id));
+    }
+    return lemmas[id];
+}
+
+size_t LemmaDictionary::Size() const
+{
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return lemmas.size();
+}
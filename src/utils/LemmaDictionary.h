@@ -0,0 +1,49 @@
+#ifndef LEMMA_DICTIONARY_H
+#define LEMMA_DICTIONARY_H
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// \class LemmaDictionary
+// \brief Process-wide dictionary that maps lemmas to dense integer IDs and back.
+//        IDs are assigned in insertion order and never change during the lifetime of the process.
+//        All methods are thread-safe; returned references stay valid because lemmas are never removed.
+class LemmaDictionary {
+public:
+    static constexpr uint32_t kUnknownId = UINT32_MAX;
+
+    // \brief Gets the singleton instance of LemmaDictionary.
+    static LemmaDictionary& GetDictionary()
+    {
+        static LemmaDictionary dictionary;
+        return dictionary;
+    }
+
+    // \brief Returns the ID of the lemma, assigning a new one if the lemma has not been seen yet.
+    uint32_t GetId(std::string_view lemma);
+
+    // \brief Returns the ID of the lemma or kUnknownId if the lemma has not been seen yet.
+    uint32_t FindId(std::string_view lemma) const;
+
+    // \brief Returns the lemma with the given ID.
+    const std::string& GetLemma(uint32_t id) const;
+
+    // \brief Returns the number of known lemmas.
+    size_t Size() const;
+
+private:
+    LemmaDictionary() = default;
+
+    LemmaDictionary(const LemmaDictionary&) = delete;
+    LemmaDictionary& operator=(const LemmaDictionary&) = delete;
+
+    mutable std::shared_mutex mtx;
+    std::deque<std::string> lemmas;                     ///< Lemmas by ID; a deque keeps their addresses stable.
+    std::unordered_map<std::string_view, uint32_t> ids; ///< IDs by lemma; keys point into `lemmas`.
+};
+
+#endif // LEMMA_DICTIONARY_H
@@ -6,6 +6,7 @@ LogLevel Logger::globalLogLevel = LogLevel::Debug;       // Default global log l
 std::map<std::string, LogLevel> Logger::moduleLogLevels; // Empty initial module-specific log levels.
 std::set<std::string> Logger::disabledModules;           // No modules are disabled initially.
 std::ofstream Logger::logFile;                           // Log file stream.
+std::mutex Logger::logMutex;                             // Guards the log file and module settings.
 
 // Enables or disables logging globally.
 void Logger::enableLogging(bool enable)
@@ -40,10 +41,16 @@ void Logger::enableModuleLogging(const std::string& module)
 // Logs a message if the specified log level is at or above the configured log level.
 void Logger::log(const std::string& module, LogLevel level, const std::string& message)
 {
-    if (enabled && disabledModules.find(module) == disabledModules.end()) {
+    if (!enabled) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (disabledModules.find(module) == disabledModules.end()) {
         LogLevel effectiveLevel = globalLogLevel;
-        if (moduleLogLevels.find(module) != moduleLogLevels.end()) {
-            effectiveLevel = moduleLogLevels[module];
+        auto moduleLevel = moduleLogLevels.find(module);
+        if (moduleLevel != moduleLogLevels.end()) {
+            effectiveLevel = moduleLevel->second;
         }
 
         if (level >= effectiveLevel) {
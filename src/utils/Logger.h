@@ -5,6 +5,7 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
 
@@ -24,6 +25,7 @@ private:
     static std::map<std::string, LogLevel> moduleLogLevels; // Log levels specific to modules.
     static std::set<std::string> disabledModules;           // Set of modules with logging disabled.
     static std::ofstream logFile;                           // File stream for logging.
+    static std::mutex logMutex;                             // Serializes writes from concurrent collectors.
 
 public:
     // Enables or disables logging globally.
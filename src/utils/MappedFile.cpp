@@ -0,0 +1,105 @@
+#include <MappedFile.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open file: " + filename + " (" + std::strerror(errno) + ")");
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file: " + filename + " (" + std::strerror(errno) + ")");
+    }
+
+    if (st.st_size > 0) {
+        void* mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to map file: " + filename + " (" + std::strerror(errno) + ")");
+        }
+        ::madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapping);
+        size = static_cast<size_t>(st.st_size);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    Release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : data(other.data), size(other.size)
+{
+    other.data = nullptr;
+    other.size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        Release();
+        data = other.data;
+        size = other.size;
+        other.data = nullptr;
+        other.size = 0;
+    }
+    return *this;
+}
+
+void MappedFile::Release()
+{
+    if (data) {
+        ::munmap(const_cast<char*>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+}
+
+ViewStreamBuf::ViewStreamBuf(std::string_view view)
+{
+    // The get area is never written to: the buffer does not override pbackfail, so putback of a different
+    // character fails instead of modifying the memory.
+    char* begin = const_cast<char*>(view.data());
+    setg(begin, begin, begin + view.size());
+}
+
+ViewStreamBuf::pos_type ViewStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                               std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+
+    off_type base = 0;
+    if (dir == std::ios_base::cur) {
+        base = gptr() - eback();
+    } else if (dir == std::ios_base::end) {
+        base = egptr() - eback();
+    }
+
+    const off_type target = base + off;
+    if (target < 0 || target > egptr() - eback()) {
+        return pos_type(off_type(-1));
+    }
+
+    setg(eback(), eback() + target, egptr());
+    return pos_type(target);
+}
+
+ViewStreamBuf::pos_type ViewStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
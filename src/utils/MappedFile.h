@@ -0,0 +1,74 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+// \class MappedFile
+// \brief Read-only memory mapping of a whole file. The mapping is released in the destructor.
+//        Empty files are represented by an empty view without a mapping.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    // \brief Maps the file into memory.
+    // \param filename      Path to the file.
+    // \throws std::runtime_error if the file cannot be opened or mapped.
+    explicit MappedFile(const std::string& filename);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view View() const
+    {
+        return {data, size};
+    }
+
+    const char* Data() const
+    {
+        return data;
+    }
+
+    size_t Size() const
+    {
+        return size;
+    }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+
+    void Release();
+};
+
+// \class ViewStreamBuf
+// \brief Read-only stream buffer over existing memory, so stream-based readers can consume a mapped file
+//        without copying it.
+class ViewStreamBuf : public std::streambuf {
+public:
+    explicit ViewStreamBuf(std::string_view view);
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
+// \class ViewInputStream
+// \brief std::istream over existing memory. The memory must outlive the stream.
+class ViewInputStream : private ViewStreamBuf, public std::istream {
+public:
+    explicit ViewInputStream(std::string_view view)
+        : ViewStreamBuf(view), std::istream(static_cast<ViewStreamBuf*>(this))
+    {
+    }
+};
+
+#endif // MAPPED_FILE_H
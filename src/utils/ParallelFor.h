@@ -0,0 +1,88 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// \brief Returns the number of threads to use for a requested count: 0 means one thread per hardware core.
+inline size_t ResolveThreadsCount(size_t requested)
+{
+    if (requested != 0) {
+        return requested;
+    }
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// \brief Returns the number of chunks of chunkSize indices that cover count indices.
+inline size_t ChunksCount(size_t count, size_t chunkSize)
+{
+    return (count + chunkSize - 1) / chunkSize;
+}
+
+// \brief Calls body(index) for every index in [0, count) using up to threadsCount threads.
+//        Indices are handed out one by one, so uneven work items are balanced between threads. With a single thread
+//        (or a single item) the body runs on the calling thread in index order. The first exception thrown by the
+//        body stops handing out new indices and is rethrown after all threads have finished.
+template <typename Body>
+void ParallelFor(size_t count, size_t threadsCount, Body&& body)
+{
+    threadsCount = std::min(ResolveThreadsCount(threadsCount), count);
+    if (threadsCount <= 1) {
+        for (size_t index = 0; index < count; ++index) {
+            body(index);
+        }
+        return;
+    }
+
+    std::atomic<size_t> nextIndex{0};
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+
+    auto worker = [&]() {
+        for (size_t index = nextIndex++; index < count; index = nextIndex++) {
+            try {
+                body(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+                nextIndex = count;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadsCount - 1);
+    for (size_t i = 1; i < threadsCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+// \brief Splits [0, count) into consecutive chunks of chunkSize indices and calls body(chunk, begin, end) for every
+//        chunk using up to threadsCount threads. Work that accumulates per chunk (indexed by chunk) and is merged in
+//        chunk order afterwards gives the same result whatever the number of threads.
+template <typename Body>
+void ParallelForChunks(size_t count, size_t chunkSize, size_t threadsCount, Body&& body)
+{
+    const size_t chunksCount = ChunksCount(count, chunkSize);
+    ParallelFor(chunksCount, threadsCount, [&](size_t chunk) {
+        const size_t begin = chunk * chunkSize;
+        body(chunk, begin, std::min(begin + chunkSize, count));
+    });
+}
+
+#endif // PARALLEL_FOR_H
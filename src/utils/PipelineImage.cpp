@@ -0,0 +1,99 @@
+#include <PipelineImage.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+static constexpr size_t kMagicSize = 8;
+static constexpr size_t kSectionAlignment = alignof(std::max_align_t);
+
+static uint64_t AlignUp(uint64_t offset)
+{
+    return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+void PipelineImage::Write(const std::string& filename, const std::vector<std::string>& sectionFiles)
+{
+    std::vector<MappedFile> files;
+    std::vector<Section> table;
+    for (const auto& sectionFile : sectionFiles) {
+        if (!fs::exists(sectionFile)) {
+            continue;
+        }
+        MappedFile file(sectionFile);
+        if (file.Size() < kMagicSize) {
+            throw std::runtime_error("Not a binary state file: " + sectionFile);
+        }
+        std::string magic(file.Data(), kMagicSize);
+        for (const auto& section : table) {
+            if (section.magic == magic) {
+                throw std::runtime_error("Two sections of the image have the magic " + magic + ": " + sectionFile);
+            }
+        }
+        table.push_back(Section{std::move(magic), 0, file.Size()});
+        files.push_back(std::move(file));
+    }
+
+    // The table has a fixed size, so the offsets of the sections are known before it is written
+    uint64_t offset = kMagicSize + sizeof(uint32_t) + sizeof(uint32_t);
+    offset += table.size() * (sizeof(uint32_t) + kMagicSize + 2 * sizeof(uint64_t));
+    for (auto& section : table) {
+        section.begin = AlignUp(offset);
+        offset = section.begin + section.size;
+    }
+
+    BinaryWriter writer(filename, kMagic, kVersion);
+    writer.Write(static_cast<uint32_t>(table.size()));
+    for (const auto& section : table) {
+        writer.WriteString(section.magic);
+        writer.Write(section.begin);
+        writer.Write(section.size);
+    }
+    for (size_t sectionInd = 0; sectionInd < table.size(); ++sectionInd) {
+        writer.WriteBlock(files[sectionInd].View(), kSectionAlignment);
+        if (writer.Offset() != table[sectionInd].begin + table[sectionInd].size) {
+            throw std::logic_error("Unexpected offset of a section in " + filename);
+        }
+    }
+    writer.Close();
+}
+
+PipelineImage::PipelineImage(const std::string& filename)
+    : filename(filename), file(std::make_shared<MappedFile>(filename))
+{
+    BinaryReader reader(file, 0, file->Size(), filename, kMagic, kVersion);
+    const uint32_t sectionsCount = reader.Read<uint32_t>();
+    for (uint32_t sectionInd = 0; sectionInd < sectionsCount; ++sectionInd) {
+        Section section;
+        section.magic = reader.ReadString();
+        section.begin = reader.Read<uint64_t>();
+        section.size = reader.Read<uint64_t>();
+        if (section.begin > file->Size() || section.size > file->Size() - section.begin) {
+            throw std::runtime_error("Corrupted pipeline image: " + filename);
+        }
+        sections.push_back(std::move(section));
+    }
+}
+
+bool PipelineImage::HasSection(std::string_view magic) const
+{
+    for (const auto& section : sections) {
+        if (section.magic == magic) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<BinaryReader> PipelineImage::OpenSection(std::string_view magic, uint32_t version) const
+{
+    for (const auto& section : sections) {
+        if (section.magic == magic) {
+            return std::make_unique<BinaryReader>(file, section.begin, section.size,
+                                                  filename + ":" + section.magic, magic, version);
+        }
+    }
+    throw std::runtime_error("No " + std::string(magic) + " section in " + filename);
+}
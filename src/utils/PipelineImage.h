@@ -0,0 +1,55 @@
+#ifndef PIPELINE_IMAGE_H
+#define PIPELINE_IMAGE_H
+
+#include <BinaryIO.h>
+#include <MappedFile.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// \class PipelineImage
+// \brief One file holding the binary state files of the pipeline (clusters, storage, sentences, corpus statistics,
+//        LSA factors and lemma embeddings) as sections. Every section is a byte copy of a file written by BinaryWriter
+//        and is identified by the magic that file starts with, so a component reads its section with the same code as
+//        its own file. The image is mapped once and the sections are used in place, so restoring the state of the
+//        pipeline reads nothing but the headers.
+//
+//        Layout: header, number of sections, table of (magic, offset, size) and the sections, each starting at a
+//        multiple of alignof(std::max_align_t) so that the arrays inside keep their alignment.
+class PipelineImage {
+public:
+    static constexpr std::string_view kMagic = "ATTIMAGE";
+    static constexpr uint32_t kVersion = 1;
+
+    // \brief Writes an image of the given files; files that do not exist are skipped.
+    // \throws std::runtime_error if a file is not written by BinaryWriter, two files have the same magic or the image
+    //         cannot be written.
+    static void Write(const std::string& filename, const std::vector<std::string>& sectionFiles);
+
+    // \brief Maps the image and reads its table of sections.
+    // \throws std::runtime_error if the file is missing, corrupted or has another format version.
+    explicit PipelineImage(const std::string& filename);
+
+    bool HasSection(std::string_view magic) const;
+
+    // \brief Opens the section that starts with the magic. The reader keeps the image mapped, so pointers returned by
+    //        it stay valid after the image itself is destroyed.
+    // \throws std::runtime_error if there is no such section or it has another format version.
+    std::unique_ptr<BinaryReader> OpenSection(std::string_view magic, uint32_t version) const;
+
+private:
+    struct Section {
+        std::string magic;
+        uint64_t begin = 0;
+        uint64_t size = 0;
+    };
+
+    std::string filename;
+    std::shared_ptr<const MappedFile> file;
+    std::vector<Section> sections;
+};
+
+#endif // PIPELINE_IMAGE_H
@@ -0,0 +1,26 @@
+#ifndef RESOURCE_USAGE_H
+#define RESOURCE_USAGE_H
+
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// \brief Returns the resident set size of the process in kilobytes, or 0 where /proc is not available. Pages of
+//        mapped files count only once they are touched.
+inline size_t GetResidentMemoryKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmRSS:", 0) == 0) {
+            std::istringstream fields(line.substr(6));
+            size_t kilobytes = 0;
+            fields >> kilobytes;
+            return kilobytes;
+        }
+    }
+    return 0;
+}
+
+#endif // RESOURCE_USAGE_H
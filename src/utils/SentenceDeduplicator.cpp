@@ -0,0 +1,121 @@
+#include <SentenceDeduplicator.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+    constexpr uint32_t kNoCluster = std::numeric_limits<uint32_t>::max();
+    constexpr size_t kRowsPerBand = SentenceDeduplicator::kSignatureSize / SentenceDeduplicator::kBandsCount;
+
+    static_assert(SentenceDeduplicator::kSignatureSize % SentenceDeduplicator::kBandsCount == 0,
+                  "Signature must split into bands of equal size");
+
+    // SplitMix64 finalizer, used both as the shingle hash and as the family of MinHash functions.
+    uint64_t Mix(uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+} // namespace
+
+SentenceDeduplicator::SentenceDeduplicator(double nearThreshold) : nearThreshold(nearThreshold) {}
+
+bool SentenceDeduplicator::ComputeSignature(std::string_view sentence, Signature& signature) const
+{
+    if (sentence.size() < kShingleSize) {
+        return false;
+    }
+
+    signature.fill(std::numeric_limits<uint32_t>::max());
+    for (size_t pos = 0; pos + kShingleSize <= sentence.size(); ++pos) {
+        uint64_t shingle = 0;
+        std::memcpy(&shingle, sentence.data() + pos, kShingleSize);
+        shingle = Mix(shingle);
+
+        for (size_t i = 0; i < kSignatureSize; ++i) {
+            const uint32_t value = static_cast<uint32_t>(Mix(shingle ^ (0x5851f42d4c957f2dULL * (i + 1))));
+            signature[i] = std::min(signature[i], value);
+        }
+    }
+    return true;
+}
+
+uint32_t SentenceDeduplicator::FindNearDuplicate(const Signature& signature,
+                                                 std::array<uint64_t, kBandsCount>& bandKeys) const
+{
+    uint32_t bestCluster = kNoCluster;
+    size_t bestMatches = 0;
+    const size_t minMatches = static_cast<size_t>(nearThreshold * kSignatureSize + 0.5);
+
+    for (size_t band = 0; band < kBandsCount; ++band) {
+        uint64_t key = Mix(band);
+        for (size_t row = 0; row < kRowsPerBand; ++row) {
+            key = Mix(key ^ signature[band * kRowsPerBand + row]);
+        }
+        bandKeys[band] = key;
+
+        auto it = bands.find(key);
+        if (it == bands.end()) {
+            continue;
+        }
+
+        for (uint32_t clusterId : it->second) {
+            const auto& candidate = signatures[clusterId];
+            size_t matches = 0;
+            for (size_t i = 0; i < kSignatureSize; ++i) {
+                matches += candidate[i] == signature[i];
+            }
+            if (matches >= minMatches && matches > bestMatches) {
+                bestMatches = matches;
+                bestCluster = clusterId;
+            }
+        }
+    }
+    return bestCluster;
+}
+
+uint32_t SentenceDeduplicator::Add(std::string_view sentence)
+{
+    ++sentencesCount;
+
+    auto [it, inserted] = exactClusters.try_emplace(std::string(sentence), kNoCluster);
+    if (!inserted) {
+        ++occurrences[it->second];
+        return it->second;
+    }
+
+    const uint32_t clusterId = static_cast<uint32_t>(occurrences.size());
+    it->second = clusterId;
+    occurrences.push_back(1);
+    nearRepresentatives.push_back(clusterId);
+
+    if (nearThreshold > 1.0) {
+        return clusterId;
+    }
+
+    // Signatures are indexed by cluster ID; sentences shorter than a shingle keep a signature that is never
+    // registered in any band and therefore never matched
+    Signature signature{};
+    std::array<uint64_t, kBandsCount> bandKeys;
+    const bool hasSignature = ComputeSignature(sentence, signature);
+    signatures.push_back(hasSignature ? signature : Signature{});
+    if (!hasSignature) {
+        return clusterId;
+    }
+
+    // Only clusters that are not near-duplicates themselves are registered, so every near-duplicate refers to the
+    // first cluster of its group
+    const uint32_t nearCluster = FindNearDuplicate(signature, bandKeys);
+    if (nearCluster != kNoCluster) {
+        nearRepresentatives[clusterId] = nearCluster;
+        ++nearDuplicatesCount;
+    } else {
+        for (uint64_t key : bandKeys) {
+            bands[key].push_back(clusterId);
+        }
+    }
+    return clusterId;
+}
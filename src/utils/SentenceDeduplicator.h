@@ -0,0 +1,134 @@
+#ifndef SENTENCE_DEDUPLICATOR_H
+#define SENTENCE_DEDUPLICATOR_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// \class SentenceDeduplicator
+// \brief Groups identical sentences of a corpus into clusters by exact lookup, and optionally reports nearly
+//        identical ones. Near-duplicates are found with MinHash signatures over character shingles and
+//        locality-sensitive hashing (LSH) of signature bands: a new sentence is a near-duplicate of a cluster if they
+//        share a band and their estimated Jaccard similarity reaches the threshold. A near-duplicate still gets a
+//        cluster of its own, since its analysis differs from the analysis of the cluster it resembles.
+class SentenceDeduplicator {
+public:
+    static constexpr size_t kShingleSize = 8;    ///< Shingle length in bytes (about four Cyrillic characters).
+    static constexpr size_t kSignatureSize = 64; ///< Number of MinHash functions.
+    static constexpr size_t kBandsCount = 16;    ///< Number of LSH bands of kSignatureSize / kBandsCount rows.
+
+    // \brief Constructor.
+    // \param nearThreshold     Minimal estimated Jaccard similarity of near-duplicates. Values above 1 disable
+    //                          near-duplicate detection.
+    explicit SentenceDeduplicator(double nearThreshold = 2.0);
+
+    // \brief Registers the next sentence of the corpus.
+    // \return                  ID of the cluster of sentences identical to this one. IDs are dense and start from 0.
+    uint32_t Add(std::string_view sentence);
+
+    // \brief Returns the earlier cluster the cluster is a near-duplicate of, or the cluster itself.
+    uint32_t NearDuplicateOf(uint32_t clusterId) const
+    {
+        return nearRepresentatives[clusterId];
+    }
+
+    // \brief Returns how many sentences were added to the cluster.
+    uint32_t OccurrenceCount(uint32_t clusterId) const
+    {
+        return occurrences[clusterId];
+    }
+
+    size_t ClustersCount() const
+    {
+        return occurrences.size();
+    }
+
+    size_t SentencesCount() const
+    {
+        return sentencesCount;
+    }
+
+    // \brief Returns how many clusters are near-duplicates of an earlier cluster.
+    size_t NearDuplicatesCount() const
+    {
+        return nearDuplicatesCount;
+    }
+
+private:
+    using Signature = std::array<uint32_t, kSignatureSize>;
+
+    double nearThreshold;
+    size_t sentencesCount = 0;
+    size_t nearDuplicatesCount = 0;
+
+    std::vector<uint32_t> occurrences;                         ///< Number of sentences in each cluster.
+    std::vector<uint32_t> nearRepresentatives;                 ///< Result of NearDuplicateOf for each cluster.
+    std::unordered_map<std::string, uint32_t> exactClusters;   ///< Cluster ID by sentence text.
+    std::vector<Signature> signatures;                         ///< MinHash signatures of the clusters.
+    std::unordered_map<uint64_t, std::vector<uint32_t>> bands; ///< Clusters by hash of (band index, band rows).
+
+    bool ComputeSignature(std::string_view sentence, Signature& signature) const;
+
+    uint32_t FindNearDuplicate(const Signature& signature, std::array<uint64_t, kBandsCount>& bandKeys) const;
+};
+
+// \class DuplicateAnalysisCache
+// \brief Shares the analysis of a sentence with its identical copies when files are processed in parallel. The
+//        analysis of a cluster of SentenceDeduplicator is kept only while copies of the sentence remain to be
+//        processed, so the cache holds the analyses of the clusters that are in progress, not of the whole corpus.
+template <typename Analysis>
+class DuplicateAnalysisCache {
+public:
+    // \brief Starts sharing the analyses of clusters with the given numbers of sentences.
+    void Reset(std::vector<uint32_t> occurrences)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        remainingOccurrences = std::move(occurrences);
+        analyses.clear();
+    }
+
+    // \brief Returns the analysis of the next sentence of the cluster. The analysis is taken from an earlier copy of
+    //        the sentence if one is kept, and computed with analyze() otherwise.
+    template <typename AnalyzeFn>
+    Analysis Get(uint32_t clusterId, AnalyzeFn&& analyze)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto cached = analyses.find(clusterId);
+            if (cached != analyses.end()) {
+                if (--remainingOccurrences[clusterId] > 0) {
+                    return cached->second;
+                }
+                Analysis analysis = std::move(cached->second);
+                analyses.erase(cached);
+                return analysis;
+            }
+        }
+
+        // Copies processed at the same time by other threads are analyzed twice, which gives the same result
+        Analysis analysis = analyze();
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--remainingOccurrences[clusterId] > 0) {
+            analyses.emplace(clusterId, analysis);
+        }
+        return analysis;
+    }
+
+    // \brief Returns how many analyses are kept for later copies.
+    size_t CachedCount() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return analyses.size();
+    }
+
+private:
+    std::vector<uint32_t> remainingOccurrences;      ///< Sentences of each cluster that are not processed yet.
+    std::unordered_map<uint32_t, Analysis> analyses; ///< Analyses by cluster ID.
+    mutable std::mutex mtx;
+};
+
+#endif // SENTENCE_DEDUPLICATOR_H
@@ -0,0 +1,300 @@
+#ifndef SHARDED_MAP_H
+#define SHARDED_MAP_H
+
+#include <FlatHashMap.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+
+// \class ShardedMap
+// \brief Hash map split into a fixed number of independently locked shards.
+//        Methods whose names start with an upper-case letter (Upsert, Update, Visit, InsertOrAssign) lock the shard
+//        of the key and may be called from any number of threads at once. The lower-case methods mirror the
+//        std::unordered_map interface and do not lock; they are meant for phases where no other thread writes to
+//        the map, e.g. computing metrics after collection has finished.
+//        Every shard is a FlatHashMap, so inserting into a shard may move its values: references obtained through the
+//        lower-case methods stay valid only until the next insertion into the map.
+// \tparam ShardsCount      Number of shards, must be a power of two.
+template <typename Key, typename Value, typename Hash = FlatHash<Key>, size_t ShardsCount = 64>
+class ShardedMap {
+    static_assert(ShardsCount > 0 && (ShardsCount & (ShardsCount - 1)) == 0, "ShardsCount must be a power of two");
+
+    using Map = FlatHashMap<Key, Value, Hash>;
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mtx;
+        Map map;
+    };
+
+    using Shards = std::array<Shard, ShardsCount>;
+
+    template <bool IsConst>
+    class Iterator {
+        using ShardsPtr = std::conditional_t<IsConst, const Shards*, Shards*>;
+        using InnerIterator = std::conditional_t<IsConst, typename Map::const_iterator, typename Map::iterator>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename Map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+        using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+
+        Iterator() = default;
+
+        Iterator(ShardsPtr shards, size_t shardInd, InnerIterator it) : shards(shards), shardInd(shardInd), it(it)
+        {
+            SkipEmptyShards();
+        }
+
+        // Allows conversion from iterator to const_iterator
+        template <bool OtherConst, typename = std::enable_if_t<IsConst && !OtherConst>>
+        Iterator(const Iterator<OtherConst>& other) : shards(other.shards), shardInd(other.shardInd), it(other.it)
+        {
+        }
+
+        reference operator*() const
+        {
+            return *it;
+        }
+
+        pointer operator->() const
+        {
+            return &*it;
+        }
+
+        Iterator& operator++()
+        {
+            ++it;
+            SkipEmptyShards();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+            return shardInd == other.shardInd && (shardInd == ShardsCount || it == other.it);
+        }
+
+        bool operator!=(const Iterator& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        template <bool>
+        friend class Iterator;
+
+        ShardsPtr shards = nullptr;
+        size_t shardInd = ShardsCount;
+        InnerIterator it{};
+
+        void SkipEmptyShards()
+        {
+            while (shardInd < ShardsCount && it == (*shards)[shardInd].map.end()) {
+                if (++shardInd < ShardsCount) {
+                    it = (*shards)[shardInd].map.begin();
+                }
+            }
+        }
+    };
+
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = typename Map::value_type;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    // \brief Calls update(value) under the lock of the key's shard. If the key is missing, the value is created
+    //        with create() first. Creation and update are atomic with respect to other locking calls.
+    template <typename CreateFn, typename UpdateFn>
+    void Upsert(const Key& key, CreateFn&& create, UpdateFn&& update)
+    {
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end()) {
+            it = shard.map.emplace(key, create()).first;
+        }
+        update(it->second);
+    }
+
+    // \brief Calls update(value) under the lock of the key's shard, default-constructing a missing value.
+    template <typename UpdateFn>
+    void Update(const Key& key, UpdateFn&& update)
+    {
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        update(shard.map[key]);
+    }
+
+    // \brief Calls visit(value) under the shared lock of the key's shard.
+    // \return              False if the key is missing.
+    template <typename VisitFn>
+    bool Visit(const Key& key, VisitFn&& visit) const
+    {
+        const Shard& shard = GetShard(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end()) {
+            return false;
+        }
+        visit(it->second);
+        return true;
+    }
+
+    void InsertOrAssign(const Key& key, Value value)
+    {
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        shard.map.insert_or_assign(key, std::move(value));
+    }
+
+    Value& operator[](const Key& key)
+    {
+        return GetShard(key).map[key];
+    }
+
+    template <typename K = Key>
+    Value& at(const K& key)
+    {
+        return GetShard(key).map.at(key);
+    }
+
+    template <typename K = Key>
+    const Value& at(const K& key) const
+    {
+        return GetShard(key).map.at(key);
+    }
+
+    template <typename K = Key>
+    iterator find(const K& key)
+    {
+        const size_t shardInd = GetShardIndex(key);
+        auto it = shards[shardInd].map.find(key);
+        return it == shards[shardInd].map.end() ? end() : iterator(&shards, shardInd, it);
+    }
+
+    template <typename K = Key>
+    const_iterator find(const K& key) const
+    {
+        const size_t shardInd = GetShardIndex(key);
+        auto it = shards[shardInd].map.find(key);
+        return it == shards[shardInd].map.end() ? end() : const_iterator(&shards, shardInd, it);
+    }
+
+    template <typename K = Key>
+    size_t count(const K& key) const
+    {
+        return GetShard(key).map.count(key);
+    }
+
+    size_t erase(const Key& key)
+    {
+        return GetShard(key).map.erase(key);
+    }
+
+    iterator begin()
+    {
+        return iterator(&shards, 0, shards[0].map.begin());
+    }
+
+    iterator end()
+    {
+        return iterator(&shards, ShardsCount, typename Map::iterator{});
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(&shards, 0, shards[0].map.begin());
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(&shards, ShardsCount, typename Map::const_iterator{});
+    }
+
+    size_t size() const
+    {
+        size_t total = 0;
+        for (const auto& shard : shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.mtx);
+            total += shard.map.size();
+        }
+        return total;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // \brief Reserves space for count elements spread evenly over the shards.
+    void reserve(size_t count)
+    {
+        for (auto& shard : shards) {
+            std::unique_lock<std::shared_mutex> lock(shard.mtx);
+            shard.map.reserve(count / ShardsCount + 1);
+        }
+    }
+
+    void clear()
+    {
+        for (auto& shard : shards) {
+            std::unique_lock<std::shared_mutex> lock(shard.mtx);
+            shard.map.clear();
+        }
+    }
+
+    static constexpr size_t GetShardsCount()
+    {
+        return ShardsCount;
+    }
+
+    // \brief Calls fn(map) with the underlying map of one shard under its lock, e.g. to process shards in parallel.
+    template <typename Fn>
+    void WithShard(size_t shardInd, Fn&& fn)
+    {
+        std::unique_lock<std::shared_mutex> lock(shards[shardInd].mtx);
+        fn(shards[shardInd].map);
+    }
+
+private:
+    Shards shards;
+
+    template <typename K>
+    static size_t GetShardIndex(const K& key)
+    {
+        // Use the high bits of a remixed hash, so the shard does not correlate with the bucket inside the shard
+        constexpr int shift = 64 - __builtin_ctzll(ShardsCount);
+        const uint64_t hash = static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ULL;
+        return ShardsCount == 1 ? 0 : static_cast<size_t>(hash >> shift);
+    }
+
+    template <typename K>
+    Shard& GetShard(const K& key)
+    {
+        return shards[GetShardIndex(key)];
+    }
+
+    template <typename K>
+    const Shard& GetShard(const K& key) const
+    {
+        return shards[GetShardIndex(key)];
+    }
+};
+
+#endif // SHARDED_MAP_H
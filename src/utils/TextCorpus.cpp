@@ -1,15 +1,29 @@
 #include "Logger.h"
 #include <TextCorpus.h>
 
+#include <algorithm>
+
+namespace {
+    constexpr int32_t kMissing = AtomicCounterArray::kMissing;
+
+    json FrequenciesToJson(const AtomicCounterArray& frequencies)
+    {
+        auto& dictionary = LemmaDictionary::GetDictionary();
+        const size_t lemmasCount = std::min(frequencies.Size(), dictionary.Size());
+        json result = json::object();
+        for (uint32_t lemmaId = 0; lemmaId < lemmasCount; ++lemmaId) {
+            const int32_t frequency = frequencies.Get(lemmaId);
+            if (frequency != kMissing) {
+                result[dictionary.GetLemma(lemmaId)] = frequency;
+            }
+        }
+        return result;
+    }
+} // namespace
+
 std::string TextCorpus::ExtractTitleFromFilename(const std::string& filename) const
 {
-    std::string titleFilename = filename;
-    size_t pos = titleFilename.find("_text.txt");
-    if (pos != std::string::npos) {
-        titleFilename.replace(pos, 10, "_title.txt");
-    } else {
-        throw std::runtime_error("Unexpected filename format: " + filename);
-    }
+    std::string titleFilename = CorpusDocument::GetSiblingPath(filename, "_title.txt");
 
     std::ifstream titleFile(titleFilename);
     if (!titleFile.is_open()) {
@@ -28,13 +42,18 @@ std::string TextCorpus::ExtractTitleFromFilename(const std::string& filename) co
 // Also updates the total text count.
 void TextCorpus::AddText(const std::string& filename, const std::string& text)
 {
-    std::string title = ExtractTitleFromFilename(filename);
+    AddTextToDocument(ExtractTitleFromFilename(filename), text);
+}
 
-    if (texts.find(title) == texts.end()) {
+void TextCorpus::AddTextToDocument(const std::string& title, std::string_view text)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    auto [it, inserted] = texts.try_emplace(title);
+    if (inserted) {
         totalDocuments++;
     }
 
-    texts[title].push_back(text);
+    it->second.emplace_back(text);
     totalTexts++;
 }
 
@@ -42,7 +61,7 @@ void TextCorpus::AddText(const std::string& filename, const std::string& text)
 // Increments the count of the word in the `wordFrequency` map and the total word count.
 void TextCorpus::UpdateWordFrequency(const std::string& lemma)
 {
-    wordFrequency[lemma]++;
+    wordFrequency.Add(LemmaDictionary::GetDictionary().GetId(lemma), 1);
     totalWords++; // Increment the total number of words in the corpus.
 }
 
@@ -50,18 +69,41 @@ void TextCorpus::UpdateWordFrequency(const std::string& lemma)
 // This function increments the count of documents that contain the given word.
 void TextCorpus::UpdateDocumentFrequency(const std::string& lemma)
 {
-    documentFrequency[lemma]++;
+    documentFrequency.Add(LemmaDictionary::GetDictionary().GetId(lemma), 1);
+}
+
+// Merges the lemma counts of a whole document into the word and document frequencies.
+void TextCorpus::MergeDocumentFrequencies(const std::unordered_map<std::string, int>& documentCounts)
+{
+    auto& dictionary = LemmaDictionary::GetDictionary();
+    int documentWords = 0;
+    for (const auto& [lemma, count] : documentCounts) {
+        const uint32_t lemmaId = dictionary.GetId(lemma);
+        wordFrequency.Add(lemmaId, count);
+        documentFrequency.Add(lemmaId, 1);
+        documentWords += count;
+    }
+    totalWords += documentWords;
 }
 
 // Loads texts (paragraphs) from a file, where each paragraph is extracted and associated with the filename.
 void TextCorpus::LoadTextsFromFile(const std::string& filename)
 {
-    std::ifstream file(filename);
-    std::string line;
-    while (std::getline(file, line)) {
-        AddText(filename, line); // Add each paragraph as a text under the given filename.
+    LoadTextsFromDocument(CorpusDocument(filename));
+}
+
+// Loads texts (paragraphs) from a mapped document, all of them under the cached document title.
+void TextCorpus::LoadTextsFromDocument(const CorpusDocument& document)
+{
+    const auto paragraphs = document.GetParagraphs();
+    if (paragraphs.empty()) {
+        return;
+    }
+
+    const std::string& title = document.GetMetadata().title;
+    for (const auto& paragraph : paragraphs) {
+        AddTextToDocument(title, paragraph); // Add each paragraph as a text under the document title.
     }
-    file.close();
 }
 
 // Returns the total number of documents in the corpus (unique filenames).
@@ -86,22 +128,14 @@ int TextCorpus::GetTotalWords() const
 // If the word is not found, it returns 0.
 int TextCorpus::GetWordFrequency(const std::string& lemma) const
 {
-    auto it = wordFrequency.find(lemma);
-    if (it != wordFrequency.end()) {
-        return it->second;
-    }
-    return 0;
+    return std::max(wordFrequency.Get(LemmaDictionary::GetDictionary().FindId(lemma)), 0);
 }
 
 // Returns the document frequency of a specific word (lemma).
 // Document frequency refers to the number of documents (filenames) in which the word appears.
 int TextCorpus::GetDocumentFrequency(const std::string& lemma) const
 {
-    auto it = documentFrequency.find(lemma);
-    if (it != documentFrequency.end()) {
-        return it->second;
-    }
-    return 0;
+    return std::max(documentFrequency.Get(LemmaDictionary::GetDictionary().FindId(lemma)), 0);
 }
 
 // Returns the list of all texts (paragraphs) in the corpus.
@@ -110,28 +144,28 @@ const std::unordered_map<std::string, std::vector<std::string>>& TextCorpus::Get
     return texts;
 }
 
-// Returns the frequency map of all words (lemmas) in the corpus.
-const std::unordered_map<std::string, int>& TextCorpus::GetWordFrequencies() const
+// Calculates the Term Frequency (TF) for a specific word (lemma) in the corpus.
+double TextCorpus::CalculateTF(const std::string& lemma) const
 {
-    return wordFrequency;
+    return CalculateTF(LemmaDictionary::GetDictionary().FindId(lemma));
 }
 
-// Calculates the Term Frequency (TF) for a specific word (lemma) in the corpus.
-double TextCorpus::CalculateTF(const std::string& lemma) const
+double TextCorpus::CalculateTF(uint32_t lemmaId) const
 {
-    if (wordFrequency.find(lemma) != wordFrequency.end()) {
-        return static_cast<double>(wordFrequency.at(lemma)) / totalWords;
-    }
-    return 0.0;
+    const int32_t frequency = wordFrequency.Get(lemmaId);
+    return frequency != kMissing ? static_cast<double>(frequency) / totalWords : 0.0;
 }
 
 // Calculates the Inverse Document Frequency (IDF) for a specific word (lemma) in the corpus.
 double TextCorpus::CalculateIDF(const std::string& lemma) const
 {
-    if (documentFrequency.find(lemma) != documentFrequency.end()) {
-        return log(static_cast<double>(totalDocuments) / (1.0 + documentFrequency.at(lemma)));
-    }
-    return 0.0;
+    return CalculateIDF(LemmaDictionary::GetDictionary().FindId(lemma));
+}
+
+double TextCorpus::CalculateIDF(uint32_t lemmaId) const
+{
+    const int32_t frequency = documentFrequency.Get(lemmaId);
+    return frequency != kMissing ? log(static_cast<double>(totalDocuments) / (1.0 + frequency)) : 0.0;
 }
 
 // Calculates the TF-IDF for a specific word (lemma) in the corpus.
@@ -146,11 +180,11 @@ json TextCorpus::Serialize() const
     json j;
 
     // Serialize overall corpus information
-    j["0_totalDocuments"] = totalDocuments;
-    j["1_totalTexts"] = totalTexts;
-    j["2_totalWords"] = totalWords;
-    j["3_documentFrequency"] = documentFrequency;
-    j["4_wordFrequency"] = wordFrequency;
+    j["0_totalDocuments"] = totalDocuments.load();
+    j["1_totalTexts"] = totalTexts.load();
+    j["2_totalWords"] = totalWords.load();
+    j["3_documentFrequency"] = FrequenciesToJson(documentFrequency);
+    j["4_wordFrequency"] = FrequenciesToJson(wordFrequency);
 
     // Serialize the documents and their corresponding texts
     json documentsJson = json::array();
@@ -169,17 +203,19 @@ json TextCorpus::Serialize() const
 void TextCorpus::Deserialize(const json& j)
 {
     try {
+        auto& dictionary = LemmaDictionary::GetDictionary();
+
         // Filter and deserialize documentFrequencys
         for (const auto& item : j.at("3_documentFrequency").items()) {
             if (!StringFilters::ShouldFilterOut(item.key())) {
-                documentFrequency[item.key()] = item.value();
+                documentFrequency.Set(dictionary.GetId(item.key()), item.value());
             }
         }
 
         // Filter and deserialize wordFrequency
         for (const auto& item : j.at("4_wordFrequency").items()) {
             if (!StringFilters::ShouldFilterOut(item.key())) {
-                wordFrequency[item.key()] = item.value();
+                wordFrequency.Set(dictionary.GetId(item.key()), item.value());
             }
         }
 
@@ -233,3 +269,104 @@ void TextCorpus::LoadCorpusFromFile(const std::string& filename)
         std::cerr << "Failed to open file: " << filename << std::endl;
     }
 }
+
+void TextCorpus::SaveStatisticsToFile(const std::string& filename) const
+{
+    auto& dictionary = LemmaDictionary::GetDictionary();
+    const size_t idsCount = std::min(std::max(wordFrequency.Size(), documentFrequency.Size()), dictionary.Size());
+    std::vector<std::pair<std::string_view, uint32_t>> lemmas;
+    for (uint32_t lemmaId = 0; lemmaId < idsCount; ++lemmaId) {
+        if (wordFrequency.Get(lemmaId) == kMissing && documentFrequency.Get(lemmaId) == kMissing) {
+            continue;
+        }
+        const std::string& lemma = dictionary.GetLemma(lemmaId);
+        if (!StringFilters::ShouldFilterOut(lemma)) {
+            lemmas.emplace_back(lemma, lemmaId);
+        }
+    }
+    std::sort(lemmas.begin(), lemmas.end());
+
+    // A lemma may be missing from one of the arrays, which CalculateIDF tells apart from a zero frequency
+    std::vector<uint64_t> lemmaBegins{0};
+    std::vector<char> lemmaBytes;
+    std::vector<int32_t> wordFrequencies, documentFrequencies;
+    lemmaBegins.reserve(lemmas.size() + 1);
+    wordFrequencies.reserve(lemmas.size());
+    documentFrequencies.reserve(lemmas.size());
+    for (const auto& [lemma, lemmaId] : lemmas) {
+        lemmaBytes.insert(lemmaBytes.end(), lemma.begin(), lemma.end());
+        lemmaBegins.push_back(lemmaBytes.size());
+        wordFrequencies.push_back(wordFrequency.Get(lemmaId));
+        documentFrequencies.push_back(documentFrequency.Get(lemmaId));
+    }
+
+    BinaryWriter writer(filename, kStatisticsMagic, kStatisticsVersion);
+    writer.Write(static_cast<int64_t>(totalWords.load()));
+    writer.Write(static_cast<int64_t>(totalTexts.load()));
+    writer.Write(static_cast<int64_t>(totalDocuments.load()));
+    writer.Write(static_cast<uint64_t>(lemmas.size()));
+    writer.Write(static_cast<uint64_t>(lemmaBytes.size()));
+    writer.WriteArray(lemmaBegins);
+    writer.WriteArray(lemmaBytes);
+    writer.WriteArray(wordFrequencies);
+    writer.WriteArray(documentFrequencies);
+    writer.Close();
+
+    Logger::log("TextCorpus", LogLevel::Info,
+                "Saved statistics of " + std::to_string(lemmas.size()) + " lemmas to file: " + filename);
+}
+
+void TextCorpus::LoadStatisticsFromFile(const std::string& filename)
+{
+    Logger::log("TextCorpus", LogLevel::Info, "Loading corpus statistics from file: " + filename);
+    BinaryReader reader(filename, kStatisticsMagic, kStatisticsVersion);
+    LoadStatistics(reader);
+}
+
+void TextCorpus::LoadStatistics(BinaryReader& reader)
+{
+    const int64_t wordsCount = reader.Read<int64_t>();
+    const int64_t textsCount = reader.Read<int64_t>();
+    const int64_t documentsCount = reader.Read<int64_t>();
+    const uint64_t lemmasCount = reader.Read<uint64_t>();
+    const uint64_t lemmaBytesCount = reader.Read<uint64_t>();
+    const uint64_t* lemmaBegins = reader.ReadArray<uint64_t>(lemmasCount + 1);
+    const char* lemmaBytes = reader.ReadArray<char>(lemmaBytesCount);
+    const int32_t* wordFrequencies = reader.ReadArray<int32_t>(lemmasCount);
+    const int32_t* documentFrequencies = reader.ReadArray<int32_t>(lemmasCount);
+
+    // Entries of the file are spread over the ids of LemmaDictionary
+    auto& dictionary = LemmaDictionary::GetDictionary();
+    std::vector<int32_t> loadedWordFrequency, loadedDocumentFrequency;
+    for (uint64_t lemmaInd = 0; lemmaInd < lemmasCount; ++lemmaInd) {
+        if (lemmaBegins[lemmaInd] > lemmaBegins[lemmaInd + 1] || lemmaBegins[lemmaInd + 1] > lemmaBytesCount) {
+            throw std::runtime_error("Corrupted corpus statistics: " + reader.GetName());
+        }
+        const std::string_view lemma(lemmaBytes + lemmaBegins[lemmaInd],
+                                     lemmaBegins[lemmaInd + 1] - lemmaBegins[lemmaInd]);
+        const uint32_t lemmaId = dictionary.GetId(lemma);
+        if (lemmaId >= loadedWordFrequency.size()) {
+            const size_t size = std::max<size_t>(lemmaId + 1, dictionary.Size());
+            loadedWordFrequency.resize(size, kMissing);
+            loadedDocumentFrequency.resize(size, kMissing);
+        }
+        loadedWordFrequency[lemmaId] = std::max(wordFrequencies[lemmaInd], kMissing);
+        loadedDocumentFrequency[lemmaId] = std::max(documentFrequencies[lemmaInd], kMissing);
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    texts.clear();
+    wordFrequency.Clear();
+    documentFrequency.Clear();
+    for (uint32_t lemmaId = 0; lemmaId < loadedWordFrequency.size(); ++lemmaId) {
+        if (loadedWordFrequency[lemmaId] != kMissing) {
+            wordFrequency.Set(lemmaId, loadedWordFrequency[lemmaId]);
+        }
+        if (loadedDocumentFrequency[lemmaId] != kMissing) {
+            documentFrequency.Set(lemmaId, loadedDocumentFrequency[lemmaId]);
+        }
+    }
+    totalWords = static_cast<int>(wordsCount);
+    totalTexts = static_cast<int>(textsCount);
+    totalDocuments = static_cast<int>(documentsCount);
+}
@@ -1,12 +1,18 @@
 #ifndef TEXT_CORPUS_H
 #define TEXT_CORPUS_H
 
+#include <AtomicCounterArray.h>
+#include <BinaryIO.h>
+#include <CorpusDocument.h>
+#include <LemmaDictionary.h>
 #include <StringFilters.h>
+#include <atomic>
 #include <boost/algorithm/string.hpp>
 #include <cmath>
 #include <fasttext.h>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -21,8 +27,13 @@ using VectorPtr = std::shared_ptr<fasttext::Vector>;
 // \class TextCorpus
 // \brief This class handles the processing and storage of a text corpus,
 // where each document is represented by a filename, and the texts are paragraphs extracted from these documents.
+// Adding texts and updating frequencies is thread-safe, so documents can be collected concurrently; the getters and
+// metric calculations are meant to be used once collection has finished.
 class TextCorpus {
 public:
+    static constexpr std::string_view kStatisticsMagic = "ATTSTATS";
+    static constexpr uint32_t kStatisticsVersion = 1;
+
     // \brief Default constructor for the TextCorpus class.
     TextCorpus() = default;
 
@@ -51,10 +62,20 @@ public:
     // \param lemma The word (lemma) to update document frequency for.
     void UpdateDocumentFrequency(const std::string& lemma);
 
+    // Merges the lemma counts of one whole document: adds every count to the word frequency and increments the
+    // document frequency of every lemma. The counters are atomic, so documents are merged concurrently without a lock.
+    // \param documentCounts Frequencies of the lemmas within the document.
+    void MergeDocumentFrequencies(const std::unordered_map<std::string, int>& documentCounts);
+
     // Loads texts (paragraphs) from a file, where each paragraph is extracted and associated with the filename.
     // \param filename The path to the file containing the paragraphs.
     void LoadTextsFromFile(const std::string& filename);
 
+    // Loads texts (paragraphs) from an already mapped document. The title is taken from the cached
+    // document metadata, so the title file is read once per document instead of once per paragraph.
+    // \param document The document to load the paragraphs from.
+    void LoadTextsFromDocument(const CorpusDocument& document);
+
     // Returns the total number of documents in the corpus (unique filenames).
     int GetTotalDocuments() const;
 
@@ -76,10 +97,16 @@ public:
     // TF is calculated as the frequency of the word divided by the total number of words in the corpus.
     double CalculateTF(const std::string& lemma) const;
 
+    // Same as CalculateTF for the lemma with the given id of LemmaDictionary.
+    double CalculateTF(uint32_t lemmaId) const;
+
     // Calculates the Inverse Document Frequency (IDF) for a specific word (lemma) in the corpus.
     // IDF is calculated using the formula: log(total_documents / (1 + document_frequency_of_word)).
     double CalculateIDF(const std::string& lemma) const;
 
+    // Same as CalculateIDF for the lemma with the given id of LemmaDictionary.
+    double CalculateIDF(uint32_t lemmaId) const;
+
     // Calculates the TF-IDF for a specific word (lemma) in the corpus.
     // TF-IDF is the product of Term Frequency (TF) and Inverse Document Frequency (IDF).
     double CalculateTFIDF(const std::string& lemma) const;
@@ -93,23 +120,40 @@ public:
     // Returns the total number of words (lemmas) in the corpus.
     int GetTotalWords() const;
 
-    // Returns the frequency map of all words (lemmas) in the corpus.
-    const std::unordered_map<std::string, int>& GetWordFrequencies() const;
-
     // Saves the serialized corpus data to a file.
     void SaveCorpusToFile(const std::string& filename);
 
     // Loads the corpus data from a file, deserializes it, and returns the restored TextCorpus object.
     void LoadCorpusFromFile(const std::string& filename);
 
+    // \brief Saves the totals and the word and document frequencies, without the texts, to a binary file. Lemmas that
+    //        StringFilters::ShouldFilterOut rejects are dropped here, so loading the file needs no filtering.
+    //        Lemmas are stored once in a sorted table and both frequencies are arrays indexed by the position of the
+    //        lemma in the table.
+    void SaveStatisticsToFile(const std::string& filename) const;
+
+    // \brief Replaces the totals and frequencies with the ones of a file written by SaveStatisticsToFile. The texts
+    //        are left empty; commands that only need TF and IDF load this file instead of the whole corpus. The
+    //        table of the file is translated into LemmaDictionary ids once, the frequencies are not copied to a map.
+    // \throws std::runtime_error if the file is missing, corrupted or has another format version.
+    void LoadStatisticsFromFile(const std::string& filename);
+
+    // \brief Same as LoadStatisticsFromFile for a reader of such a file, e.g. a section of a PipelineImage.
+    void LoadStatistics(BinaryReader& reader);
+
 private:
+    // Adds a paragraph to the document with the given title.
+    void AddTextToDocument(const std::string& title, std::string_view text);
+
     std::unordered_map<std::string, std::vector<std::string>> texts; ///< Map to store paragraphs associated with
                                                                      ///< each document (filename).
-    std::unordered_map<std::string, int> wordFrequency;     ///< Map to store the frequency of words in the corpus.
-    std::unordered_map<std::string, int> documentFrequency; ///< Map to store the document frequency of words.
-    int totalWords = 0;                                     ///< Total number of words (lemmas) in the corpus.
-    int totalTexts = 0;
-    int totalDocuments = 0; ///< Total number of documents (filenames) in the corpus.
+    // Frequencies are indexed by the ids of LemmaDictionary; -1 marks lemmas without a frequency
+    AtomicCounterArray wordFrequency;     ///< Frequency of every lemma in the corpus.
+    AtomicCounterArray documentFrequency; ///< Number of documents that contain every lemma.
+    std::atomic<int> totalWords{0};       ///< Total number of words (lemmas) in the corpus.
+    std::atomic<int> totalTexts{0};
+    std::atomic<int> totalDocuments{0}; ///< Total number of documents (filenames) in the corpus.
+    std::mutex mtx;                     ///< Guards texts during concurrent collection.
 };
 
 #endif // TEXT_CORPUS_H
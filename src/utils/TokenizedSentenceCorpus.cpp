@@ -2,26 +2,101 @@
 #include "Logger.h"
 #include <TokenizedSentenceCorpus.h>
 
+#include <algorithm>
+
 // Adds a sentence to the corpus.
 void TokenizedSentenceCorpus::AddSentence(const size_t docNum, const size_t sentNum, const std::string& data,
                                           const std::string& normalizedData)
 {
-    TokenizedSentence sentence = {docNum, sentNum, data, normalizedData};
-    sentenceMap[docNum][sentNum] = sentence; // Insert the sentence into the map
+    addedSentences[{docNum, sentNum}] = {data, normalizedData}; // Insert the sentence into the map
     totalSentences++;
 }
 
-// Retrieves a sentence by document and sentence number.
-const TokenizedSentence* TokenizedSentenceCorpus::GetSentence(size_t docNum, size_t sentNum) const
+// Sentences already in the layout are kept unless they were added again.
+void TokenizedSentenceCorpus::Pack()
 {
-    auto docIt = sentenceMap.find(docNum);
-    if (docIt != sentenceMap.end()) {
-        auto sentIt = docIt->second.find(sentNum);
-        if (sentIt != docIt->second.end()) {
-            return &sentIt->second; // Return a pointer to the found sentence
+    if (addedSentences.empty()) {
+        return;
+    }
+    ForEachSentence([&](const TokenizedSentence& sentence) {
+        addedSentences.try_emplace({sentence.docNum, sentence.sentNum}, std::string(sentence.originalStr),
+                                   std::string(sentence.normalizedStr));
+    });
+    snapshot.reset();
+
+    docNums.clear();
+    docBegins.clear();
+    textBegins.clear();
+    normalizedBegins.clear();
+    present.clear();
+    arena.clear();
+
+    for (const auto& [position, texts] : addedSentences) {
+        const auto [docNum, sentNum] = position;
+        if (docNums.empty() || docNums.back() != docNum) {
+            docNums.push_back(docNum);
+            docBegins.push_back(present.size());
+        }
+        // Slots of the missing sentence numbers stay empty, so the slot of a sentence is docBegin + sentNum
+        while (present.size() - docBegins.back() < sentNum) {
+            textBegins.push_back(arena.size());
+            normalizedBegins.push_back(arena.size());
+            present.push_back(0);
         }
+        textBegins.push_back(arena.size());
+        arena += texts.first;
+        normalizedBegins.push_back(arena.size());
+        arena += texts.second;
+        present.push_back(1);
+    }
+    docBegins.push_back(present.size());
+    textBegins.push_back(arena.size());
+    addedSentences.clear();
+
+    UseOwnedLayout();
+}
+
+void TokenizedSentenceCorpus::UseOwnedLayout()
+{
+    layout.docsCount = docNums.size();
+    layout.slotsCount = present.size();
+    layout.docNums = docNums.data();
+    layout.docBegins = docBegins.data();
+    layout.textBegins = textBegins.data();
+    layout.normalizedBegins = normalizedBegins.data();
+    layout.present = present.data();
+    layout.arena = arena.data();
+}
+
+std::optional<uint32_t> TokenizedSentenceCorpus::FindSentenceId(size_t docNum, size_t sentNum) const
+{
+    const uint64_t* docsEnd = layout.docNums + layout.docsCount;
+    const uint64_t* docIt = std::lower_bound(layout.docNums, docsEnd, docNum);
+    if (docIt == docsEnd || *docIt != docNum) {
+        return std::nullopt;
+    }
+    const uint64_t docInd = static_cast<uint64_t>(docIt - layout.docNums);
+    const uint64_t slot = layout.docBegins[docInd] + sentNum;
+    if (slot >= layout.docBegins[docInd + 1] || !layout.present[slot]) {
+        return std::nullopt;
+    }
+    return static_cast<uint32_t>(slot);
+}
+
+// Retrieves a sentence by document and sentence number.
+std::optional<TokenizedSentence> TokenizedSentenceCorpus::GetSentence(size_t docNum, size_t sentNum) const
+{
+    if (auto sentenceId = FindSentenceId(docNum, sentNum)) {
+        return GetSentenceById(*sentenceId);
     }
-    return nullptr; // Return nullptr if the sentence is not found
+    return std::nullopt; // Return nullopt if the sentence is not found
+}
+
+TokenizedSentence TokenizedSentenceCorpus::GetSentenceById(uint32_t sentenceId) const
+{
+    // The document owning the slot is the last one that begins at or before it
+    const uint64_t* docIt = std::upper_bound(layout.docBegins, layout.docBegins + layout.docsCount, sentenceId);
+    return MakeSentence(static_cast<uint64_t>(docIt - layout.docBegins) - 1, sentenceId);
 }
 
 // Serializes the corpus data to JSON format.
@@ -31,14 +106,12 @@ json TokenizedSentenceCorpus::Serialize() const
     j["totalSentences"] = totalSentences;
     j["sentences"] = json::array();
 
-    for (const auto& [docNum, sentencesMap] : sentenceMap) {
-        for (const auto& [sentNum, sentence] : sentencesMap) {
-            j["sentences"].push_back({{"docNum", sentence.docNum},
-                                      {"sentNum", sentence.sentNum},
-                                      {"originalStr", sentence.originalStr},
-                                      {"normalizedStr", sentence.normalizedStr}});
-        }
-    }
+    ForEachSentence([&](const TokenizedSentence& sentence) {
+        j["sentences"].push_back({{"docNum", sentence.docNum},
+                                  {"sentNum", sentence.sentNum},
+                                  {"originalStr", sentence.originalStr},
+                                  {"normalizedStr", sentence.normalizedStr}});
+    });
 
     return j;
 }
@@ -46,24 +119,27 @@ json TokenizedSentenceCorpus::Serialize() const
 // Deserializes the corpus data from JSON format.
 void TokenizedSentenceCorpus::Deserialize(const json& j)
 {
-    totalSentences = j.at("totalSentences").get<int>();
-    sentenceMap.clear(); // Clear existing data before loading new ones
+    // Clear existing data before loading new ones
+    snapshot.reset();
+    layout = Layout{};
+    addedSentences.clear();
 
     for (const auto& item : j.at("sentences")) {
-        if (item.at("normalizedStr").get<std::string>().size() < 50)
+        std::string normalizedStr = item.at("normalizedStr").get<std::string>();
+        if (normalizedStr.size() < kMinNormalizedLength)
             continue;
-        TokenizedSentence sentence;
-        sentence.docNum = item.at("docNum").get<size_t>();
-        sentence.sentNum = item.at("sentNum").get<size_t>();
-        sentence.originalStr = item.at("originalStr").get<std::string>();
-        sentence.normalizedStr = item.at("normalizedStr").get<std::string>();
-        sentenceMap[sentence.docNum][sentence.sentNum] = sentence;
+        addedSentences[{item.at("docNum").get<size_t>(), item.at("sentNum").get<size_t>()}] = {
+            item.at("originalStr").get<std::string>(), std::move(normalizedStr)};
     }
+    Pack();
+    totalSentences = j.at("totalSentences").get<int>();
 }
 
 // Saves the serialized corpus data to a file.
 void TokenizedSentenceCorpus::SaveToFile(const std::string& filename)
 {
+    Pack();
+
     std::ofstream file(filename);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open file " + filename + " for saving.");
@@ -74,20 +150,120 @@ void TokenizedSentenceCorpus::SaveToFile(const std::string& filename)
     file.close();
 }
 
+void TokenizedSentenceCorpus::SaveSnapshot(const std::string& filename)
+{
+    Pack();
+
+    // Short sentences become empty slots, so sentence numbers keep addressing their slots
+    std::vector<uint64_t> keptTextBegins, keptNormalizedBegins;
+    std::vector<uint8_t> keptPresent;
+    std::string keptArena;
+    keptTextBegins.reserve(layout.slotsCount + 1);
+    keptNormalizedBegins.reserve(layout.slotsCount);
+    keptPresent.reserve(layout.slotsCount);
+    for (uint64_t slot = 0; slot < layout.slotsCount; ++slot) {
+        const std::string_view originalStr(layout.arena + layout.textBegins[slot],
+                                           layout.normalizedBegins[slot] - layout.textBegins[slot]);
+        const std::string_view normalizedStr(layout.arena + layout.normalizedBegins[slot],
+                                             layout.textBegins[slot + 1] - layout.normalizedBegins[slot]);
+        const bool keep = layout.present[slot] && normalizedStr.size() >= kMinNormalizedLength;
+
+        keptTextBegins.push_back(keptArena.size());
+        if (keep) {
+            keptArena += originalStr;
+        }
+        keptNormalizedBegins.push_back(keptArena.size());
+        if (keep) {
+            keptArena += normalizedStr;
+        }
+        keptPresent.push_back(keep ? 1 : 0);
+    }
+    keptTextBegins.push_back(keptArena.size());
+
+    BinaryWriter writer(filename, kMagic, kVersion);
+    writer.Write(static_cast<int64_t>(totalSentences));
+    writer.Write(static_cast<uint64_t>(layout.docsCount));
+    writer.Write(static_cast<uint64_t>(layout.slotsCount));
+    writer.Write(static_cast<uint64_t>(keptArena.size()));
+    writer.WriteArray(std::vector<uint64_t>(layout.docNums, layout.docNums + layout.docsCount));
+    writer.WriteArray(std::vector<uint64_t>(layout.docBegins, layout.docBegins + layout.docsCount + 1));
+    writer.WriteArray(keptTextBegins);
+    writer.WriteArray(keptNormalizedBegins);
+    writer.WriteArray(keptPresent);
+    writer.WriteArray(std::vector<char>(keptArena.begin(), keptArena.end()));
+    writer.Close();
+}
+
+void TokenizedSentenceCorpus::LoadSnapshot(std::unique_ptr<BinaryReader> reader)
+{
+    const int64_t sentencesCount = reader->Read<int64_t>();
+
+    Layout mapped;
+    mapped.docsCount = reader->Read<uint64_t>();
+    mapped.slotsCount = reader->Read<uint64_t>();
+    const uint64_t arenaSize = reader->Read<uint64_t>();
+    mapped.docNums = reader->ReadArray<uint64_t>(mapped.docsCount);
+    mapped.docBegins = reader->ReadArray<uint64_t>(mapped.docsCount + 1);
+    mapped.textBegins = reader->ReadArray<uint64_t>(mapped.slotsCount + 1);
+    mapped.normalizedBegins = reader->ReadArray<uint64_t>(mapped.slotsCount);
+    mapped.present = reader->ReadArray<uint8_t>(mapped.slotsCount);
+    mapped.arena = reader->ReadArray<char>(arenaSize);
+
+    // Check the offsets once, so that the accessors can use them without bounds checks
+    auto corrupted = [&reader]() { return std::runtime_error("Corrupted sentences snapshot: " + reader->GetName()); };
+    if (mapped.docBegins[0] != 0 || mapped.docBegins[mapped.docsCount] != mapped.slotsCount ||
+        mapped.textBegins[0] != 0 || mapped.textBegins[mapped.slotsCount] != arenaSize) {
+        throw corrupted();
+    }
+    for (uint64_t docInd = 0; docInd < mapped.docsCount; ++docInd) {
+        if (mapped.docBegins[docInd] > mapped.docBegins[docInd + 1] ||
+            (docInd > 0 && mapped.docNums[docInd - 1] >= mapped.docNums[docInd])) {
+            throw corrupted();
+        }
+    }
+    for (uint64_t slot = 0; slot < mapped.slotsCount; ++slot) {
+        if (mapped.textBegins[slot] > mapped.normalizedBegins[slot] ||
+            mapped.normalizedBegins[slot] > mapped.textBegins[slot + 1]) {
+            throw corrupted();
+        }
+    }
+
+    addedSentences.clear();
+    docNums.clear();
+    docBegins.clear();
+    textBegins.clear();
+    normalizedBegins.clear();
+    present.clear();
+    arena.clear();
+    snapshot = std::move(reader);
+    layout = mapped;
+    totalSentences = static_cast<int>(sentencesCount);
+}
+
 // Loads the corpus data from a file, deserializes it, and updates the corpus.
 void TokenizedSentenceCorpus::LoadFromFile(const std::string& filename)
 {
     Logger::log("TokenizedSentenceCorpus", LogLevel::Info, "Loading tokenized sentences from file: " + filename);
-    std::ifstream file(filename);
+    std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open file " + filename + " for loading.");
     }
 
-    json j;
-    file >> j;
-    file.close();
-    Deserialize(j);
+    char magic[kMagic.size()] = {};
+    file.read(magic, sizeof(magic));
+    if (file.gcount() == static_cast<std::streamsize>(sizeof(magic)) &&
+        std::string_view(magic, sizeof(magic)) == kMagic) {
+        file.close();
+        LoadSnapshot(std::make_unique<BinaryReader>(filename, kMagic, kVersion));
+    } else {
+        file.clear();
+        file.seekg(0);
+        json j;
+        file >> j;
+        file.close();
+        Deserialize(j);
+    }
 
     Logger::log("TokenizedSentenceCorpus", LogLevel::Info,
-                "Sentences loaded successfully. Total sentences: " + totalSentences);
-}
\ No newline at end of file
+                "Sentences loaded successfully. Total sentences: " + std::to_string(totalSentences));
+}
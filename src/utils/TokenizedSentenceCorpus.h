@@ -1,11 +1,17 @@
 #ifndef TOKENIZED_SENTENCE_CORPUS_H
 #define TOKENIZED_SENTENCE_CORPUS_H
 
+#include <BinaryIO.h>
 #include <boost/algorithm/string.hpp>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
@@ -13,15 +19,30 @@
 
 using json = nlohmann::json;
 
+// View of a sentence of the corpus; the strings point into the corpus and are valid while it is not reloaded.
 struct TokenizedSentence {
     size_t docNum;
     size_t sentNum;
-    std::string originalStr;
-    std::string normalizedStr;
+    std::string_view originalStr;
+    std::string_view normalizedStr;
 };
 
+// \class TokenizedSentenceCorpus
+// \brief Original and lemmatized sentences of the corpus in a packed layout: all strings are stored in one arena,
+//        documents are kept in a sorted table and every document owns a contiguous range of sentence slots indexed by
+//        the sentence number. Finding a sentence is a binary search over the document table followed by two array
+//        lookups, and the slot index serves as a dense sentence id.
+//
+//        The layout is either built in memory (from AddSentence or sentences.json) or mapped from the binary file
+//        written by SaveSnapshot, in which case loading reads nothing but the header.
 class TokenizedSentenceCorpus {
 public:
+    static constexpr std::string_view kMagic = "ATTSENTS";
+    static constexpr uint32_t kVersion = 1;
+
+    // Sentences with a shorter lemmatized text are dropped when the corpus is loaded.
+    static constexpr size_t kMinNormalizedLength = 50;
+
     // Default constructor for the TokenizedSentenceCorpus class.
     TokenizedSentenceCorpus() = default;
 
@@ -32,28 +53,99 @@ public:
         return corpus;
     }
 
-    // Adds a sentence to the corpus.
+    // \brief Adds a sentence to the corpus. Added sentences become visible to the getters after Pack(), which the
+    //        Save methods call.
     void AddSentence(const size_t docNum, const size_t sentNum, const std::string& data,
                      const std::string& normalizedData);
 
+    // \brief Rebuilds the packed layout from the added sentences.
+    void Pack();
+
     // Serializes the corpus data to JSON format for storage or transmission.
     json Serialize() const;
 
-    // Returns the total number of words (lemmas) in the corpus.
+    // \brief Replaces the corpus with the sentences of the JSON, dropping the ones shorter than kMinNormalizedLength.
     void Deserialize(const json& j);
 
     // Saves the serialized corpus data to a file.
     void SaveToFile(const std::string& filename);
 
-    // Loads the corpus data from a file, deserializes it, and returns the restored TextCorpus object.
+    // \brief Saves the packed layout to a binary file that LoadFromFile maps. Sentences shorter than
+    //        kMinNormalizedLength are dropped here, so loading the file needs no filtering.
+    void SaveSnapshot(const std::string& filename);
+
+    // \brief Loads the corpus from a file written by SaveSnapshot (mapped in place) or SaveToFile (parsed).
+    // \throws std::runtime_error if the file cannot be opened or is corrupted.
     void LoadFromFile(const std::string& filename);
 
+    // \brief Maps the corpus from a reader of a file written by SaveSnapshot, e.g. a section of a PipelineImage.
+    // \throws std::runtime_error if the snapshot is corrupted.
+    void LoadSnapshot(std::unique_ptr<BinaryReader> reader);
+
     // Retrieves a sentence by document and sentence number.
-    const TokenizedSentence* GetSentence(size_t docNum, size_t sentNum) const;
+    std::optional<TokenizedSentence> GetSentence(size_t docNum, size_t sentNum) const;
+
+    // \brief Returns the dense id of a sentence, so that other structures can refer to the sentence with 4 bytes
+    //        instead of a copy. Ids stay valid until the corpus is packed or loaded again.
+    std::optional<uint32_t> FindSentenceId(size_t docNum, size_t sentNum) const;
+
+    TokenizedSentence GetSentenceById(uint32_t sentenceId) const;
+
+    // \brief Calls fn(const TokenizedSentence&) for every sentence in the order of documents and sentence numbers.
+    template <typename Fn>
+    void ForEachSentence(Fn&& fn) const
+    {
+        for (uint64_t docInd = 0; docInd < layout.docsCount; ++docInd) {
+            for (uint64_t slot = layout.docBegins[docInd]; slot < layout.docBegins[docInd + 1]; ++slot) {
+                if (layout.present[slot]) {
+                    fn(MakeSentence(docInd, slot));
+                }
+            }
+        }
+    }
 
-    std::unordered_map<size_t, std::unordered_map<size_t, TokenizedSentence>>
-        sentenceMap; // Map for fast sentence retrieval
     int totalSentences = 0;
+
+private:
+    // Pointers to the arrays of the packed layout, owned either by the vectors below or by the mapped snapshot.
+    struct Layout {
+        uint64_t docsCount = 0;
+        uint64_t slotsCount = 0;
+        const uint64_t* docNums = nullptr;          ///< Sorted document numbers.
+        const uint64_t* docBegins = nullptr;        ///< First slot of every document, then the number of slots.
+        const uint64_t* textBegins = nullptr;       ///< Arena offset of the original text of every slot, then the end.
+        const uint64_t* normalizedBegins = nullptr; ///< Arena offset of the lemmatized text of every slot.
+        const uint8_t* present = nullptr;           ///< Whether the slot holds a sentence.
+        const char* arena = nullptr;
+    };
+
+    Layout layout;
+
+    // Storage of a layout built in memory
+    std::vector<uint64_t> docNums;
+    std::vector<uint64_t> docBegins;
+    std::vector<uint64_t> textBegins;
+    std::vector<uint64_t> normalizedBegins;
+    std::vector<uint8_t> present;
+    std::string arena;
+
+    std::unique_ptr<BinaryReader> snapshot; ///< Mapping of a loaded snapshot.
+
+    // Sentences added since the last Pack, by (docNum, sentNum): original and lemmatized text.
+    std::map<std::pair<size_t, size_t>, std::pair<std::string, std::string>> addedSentences;
+
+    // Points the layout to the in-memory vectors.
+    void UseOwnedLayout();
+
+    TokenizedSentence MakeSentence(uint64_t docInd, uint64_t slot) const
+    {
+        return TokenizedSentence{
+            layout.docNums[docInd], slot - layout.docBegins[docInd],
+            std::string_view(layout.arena + layout.textBegins[slot],
+                             layout.normalizedBegins[slot] - layout.textBegins[slot]),
+            std::string_view(layout.arena + layout.normalizedBegins[slot],
+                             layout.textBegins[slot + 1] - layout.normalizedBegins[slot])};
+    }
 };
 
-#endif // TEXT_CORPUS_H
+#endif // TOKENIZED_SENTENCE_CORPUS_H
@@ -0,0 +1,126 @@
+#include <ParallelFor.h>
+#include <TopicScoring.h>
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace {
+    using RowMatrix = Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    // Phrases scored by one matrix product: 256 rows of dimension 300 and their products with a few hundred topics
+    // stay in the L2 cache
+    constexpr size_t kBlockPhrases = 256;
+
+    // Extra distance of the bounds from the threshold that covers the rounding of the scores themselves
+    constexpr float kScoreMargin = 1e-5f;
+
+    enum class BoundsDecision { Above, NotAbove, Undecided };
+}
+
+float TopicScore(const VectorMetrics& metrics, float phraseNorm, float topicNorm)
+{
+    float cosine = 0.0f;
+    if (phraseNorm != 0.0f && topicNorm != 0.0f) {
+        cosine = metrics.dot / (phraseNorm * topicNorm);
+    }
+    return CombineTopicScore(cosine, std::sqrt(metrics.squaredDistance), metrics.manhattanDistance);
+}
+
+TopicScoreMatrix::TopicScoreMatrix(const std::vector<const float*>& topics, size_t dimension)
+    : topicsCount(topics.size()), dimension(dimension), topicValues(topics.size() * dimension),
+      topicNorms(topics.size())
+{
+    const VectorKernels& kernels = GetVectorKernels();
+    for (size_t topic = 0; topic < topicsCount; ++topic) {
+        std::copy(topics[topic], topics[topic] + dimension, topicValues.begin() + topic * dimension);
+        topicNorms[topic] = std::sqrt(kernels.dotProduct(topics[topic], topics[topic], dimension));
+    }
+}
+
+std::vector<std::vector<uint32_t>> TopicScoreMatrix::SelectTopics(const std::vector<const float*>& phrases,
+                                                                  float threshold, size_t threadsCount,
+                                                                  size_t* exactPairs) const
+{
+    std::vector<std::vector<uint32_t>> selected(phrases.size());
+    if (exactPairs) {
+        *exactPairs = 0;
+    }
+    if (topicsCount == 0 || phrases.empty()) {
+        return selected;
+    }
+
+    const VectorKernels& kernels = GetVectorKernels();
+    const Eigen::Map<const RowMatrix> topicMatrix(topicValues.data(), topicsCount, dimension);
+    const float sqrtDimension = std::sqrt(static_cast<float>(dimension));
+    // Bound of the relative error of float dot products, with a wide margin for the summation order of the kernels
+    const float tolerance = 4.0f * static_cast<float>(dimension) * std::numeric_limits<float>::epsilon();
+
+    // Decides from the dot product and the norms if the score is above the threshold whatever the Manhattan
+    // distance is, widening the bounds by the possible error of the dot product
+    auto decide = [&](float dot, float phraseNorm, float topicNorm) {
+        const float squaredNorms = phraseNorm * phraseNorm + topicNorm * topicNorm;
+        const float error = tolerance * squaredNorms;
+        float cosineLow = 0.0f;
+        float cosineHigh = 0.0f;
+        if (phraseNorm != 0.0f && topicNorm != 0.0f) {
+            cosineLow = (dot - error) / (phraseNorm * topicNorm);
+            cosineHigh = (dot + error) / (phraseNorm * topicNorm);
+        }
+        const float squaredDistance = squaredNorms - 2.0f * dot;
+        const float euclideanLow = std::sqrt(std::max(0.0f, squaredDistance - 3.0f * error));
+        const float euclideanHigh = std::sqrt(std::max(0.0f, squaredDistance + 3.0f * error));
+
+        if (CombineTopicScore(cosineLow, euclideanHigh, sqrtDimension * euclideanHigh) > threshold + kScoreMargin) {
+            return BoundsDecision::Above;
+        }
+        if (CombineTopicScore(cosineHigh, euclideanLow, euclideanLow) < threshold - kScoreMargin) {
+            return BoundsDecision::NotAbove;
+        }
+        return BoundsDecision::Undecided;
+    };
+
+    std::atomic<size_t> undecidedPairs{0};
+    const size_t blocksCount = (phrases.size() + kBlockPhrases - 1) / kBlockPhrases;
+    ParallelFor(blocksCount, threadsCount, [&](size_t block) {
+        const size_t begin = block * kBlockPhrases;
+        const size_t end = std::min(begin + kBlockPhrases, phrases.size());
+
+        RowMatrix phraseMatrix(end - begin, dimension);
+        std::vector<float> phraseNorms(end - begin);
+        for (size_t phrase = begin; phrase < end; ++phrase) {
+            std::copy(phrases[phrase], phrases[phrase] + dimension, phraseMatrix.row(phrase - begin).data());
+            phraseNorms[phrase - begin] = std::sqrt(kernels.dotProduct(phrases[phrase], phrases[phrase], dimension));
+        }
+        RowMatrix dots(end - begin, topicsCount);
+        dots.noalias() = phraseMatrix * topicMatrix.transpose();
+
+        size_t undecided = 0;
+        for (size_t phrase = begin; phrase < end; ++phrase) {
+            const size_t row = phrase - begin;
+            const float phraseNorm = phraseNorms[row];
+            for (size_t topic = 0; topic < topicsCount; ++topic) {
+                BoundsDecision decision = decide(dots(row, topic), phraseNorm, topicNorms[topic]);
+                if (decision == BoundsDecision::Undecided) {
+                    const VectorMetrics metrics =
+                        kernels.metrics(phrases[phrase], topicValues.data() + topic * dimension, dimension);
+                    const float score = TopicScore(metrics, phraseNorm, topicNorms[topic]);
+                    decision = score > threshold ? BoundsDecision::Above : BoundsDecision::NotAbove;
+                    ++undecided;
+                }
+                if (decision == BoundsDecision::Above) {
+                    selected[phrase].push_back(static_cast<uint32_t>(topic));
+                }
+            }
+        }
+        undecidedPairs += undecided;
+    });
+
+    if (exactPairs) {
+        *exactPairs = undecidedPairs;
+    }
+    return selected;
+}
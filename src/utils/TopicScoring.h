@@ -0,0 +1,64 @@
+#ifndef TOPIC_SCORING_H
+#define TOPIC_SCORING_H
+
+#include <VectorKernels.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// \brief Similarity of a phrase to a topic word used for tag_match: a weighted sum of the cosine similarity and of
+//        the inverted Euclidean and Manhattan distances of their embeddings.
+inline float CombineTopicScore(float cosine, float euclidean, float manhattan)
+{
+    const float cosineWeight = 0.6;
+    const float euclideanWeight = 0.2;
+    const float manhattanWeight = 0.2;
+
+    return cosineWeight * cosine + euclideanWeight * (1.0f / (1.0f + euclidean)) +
+           manhattanWeight * (1.0f / (1.0f + manhattan));
+}
+
+// \brief CombineTopicScore of two vectors from their fused metrics and norms. TopicSimilarity and TopicScoreMatrix
+//        both call it, so that a score compiled with -ffast-math is rounded the same way everywhere.
+float TopicScore(const VectorMetrics& metrics, float phraseNorm, float topicNorm);
+
+// \class TopicScoreMatrix
+// \brief Topic vectors packed into one row-major matrix with their norms, so that many phrase vectors are scored
+//        against all topics at once. The dot products of a block of phrases with all topics are one cache-tiled
+//        matrix product; the cosine similarity and the Euclidean distance follow from them and the norms, and the
+//        Manhattan distance is bounded by the Euclidean one (|x|_2 <= |x|_1 <= sqrt(n) |x|_2). Only the pairs whose
+//        bounds are too close to the threshold are compared with the fused kernel of VectorKernels, so the selected
+//        topics are the same as if TopicScore of every pair were compared with the threshold.
+class TopicScoreMatrix {
+public:
+    // \param topics        Topic vectors of the same dimension; their values are copied.
+    TopicScoreMatrix(const std::vector<const float*>& topics, size_t dimension);
+
+    size_t TopicsCount() const
+    {
+        return topicsCount;
+    }
+
+    size_t Dimension() const
+    {
+        return dimension;
+    }
+
+    // \brief Selects for every phrase the topics with a score above the threshold.
+    // \param phrases       Phrase vectors of the dimension of the topics.
+    // \param threshold     Minimal score of a selected topic (exclusive).
+    // \param threadsCount  Number of threads scoring blocks of phrases (0 uses all hardware threads).
+    // \param exactPairs    If set, receives the number of pairs that the bounds did not decide.
+    // \return              Indices of the selected topics of every phrase, in increasing order.
+    std::vector<std::vector<uint32_t>> SelectTopics(const std::vector<const float*>& phrases, float threshold,
+                                                    size_t threadsCount = 1, size_t* exactPairs = nullptr) const;
+
+private:
+    size_t topicsCount = 0;
+    size_t dimension = 0;
+    std::vector<float> topicValues; ///< Row-major topicsCount x dimension matrix.
+    std::vector<float> topicNorms;
+};
+
+#endif // TOPIC_SCORING_H
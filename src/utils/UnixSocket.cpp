@@ -0,0 +1,199 @@
+#include <UnixSocket.h>
+
+#include <ParallelFor.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    sockaddr_un MakeAddress(const std::string& path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path is too long: " + path);
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    std::runtime_error SocketError(const std::string& what, const std::string& path)
+    {
+        return std::runtime_error(what + ": " + path + " (" + std::strerror(errno) + ")");
+    }
+
+    // Reads until the peer shuts down its side of the connection.
+    bool ReadAll(int fd, std::string& data)
+    {
+        char buffer[4096];
+        while (true) {
+            ssize_t count = ::read(fd, buffer, sizeof(buffer));
+            if (count == 0) {
+                return true;
+            }
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data.append(buffer, static_cast<size_t>(count));
+        }
+    }
+
+    bool WriteAll(int fd, const std::string& data)
+    {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t count = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            written += static_cast<size_t>(count);
+        }
+        return true;
+    }
+}
+
+UnixSocketServer::UnixSocketServer(const std::string& path, Handler handler, size_t workersCount)
+    : path(path), handler(std::move(handler)), workersCount(ResolveThreadsCount(workersCount))
+{
+    sockaddr_un address = MakeAddress(path);
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd == -1) {
+        throw SocketError("Failed to create socket", path);
+    }
+
+    ::unlink(path.c_str());
+    if (::bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 ||
+        ::listen(listenFd, SOMAXCONN) == -1) {
+        auto error = SocketError("Failed to listen on socket", path);
+        ::close(listenFd);
+        throw error;
+    }
+}
+
+UnixSocketServer::~UnixSocketServer()
+{
+    Stop();
+    ::close(listenFd);
+    ::unlink(path.c_str());
+}
+
+void UnixSocketServer::Run()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        accepting = true;
+    }
+    std::vector<std::thread> workers;
+    for (size_t workerInd = 0; workerInd < workersCount; ++workerInd) {
+        workers.emplace_back([this]() { ServeConnections(); });
+    }
+
+    while (!stopped) {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // Stop shuts the listening socket down, which fails accept
+            break;
+        }
+
+        // At most one connection per worker waits in the queue, the others stay in the listen backlog
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueCv.wait(lock, [this]() { return pendingConnections.size() < workersCount || stopped; });
+        pendingConnections.push_back(fd);
+        queueCv.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        accepting = false;
+    }
+    queueCv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void UnixSocketServer::Stop()
+{
+    if (!stopped.exchange(true)) {
+        ::shutdown(listenFd, SHUT_RDWR);
+        // The lock orders the flag before a wait of Run for a free slot in the queue
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+        }
+        queueCv.notify_all();
+    }
+}
+
+void UnixSocketServer::ServeConnections()
+{
+    while (true) {
+        int fd = -1;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCv.wait(lock, [this]() { return !pendingConnections.empty() || !accepting; });
+            if (pendingConnections.empty()) {
+                return;
+            }
+            fd = pendingConnections.front();
+            pendingConnections.pop_front();
+        }
+        queueCv.notify_all();
+        HandleConnection(fd);
+    }
+}
+
+void UnixSocketServer::HandleConnection(int fd)
+{
+    std::string request;
+    if (ReadAll(fd, request)) {
+        std::string response;
+        try {
+            response = handler(request);
+        } catch (const std::exception& e) {
+            response = std::string("ERROR ") + e.what() + "\n";
+        }
+        WriteAll(fd, response);
+    }
+    ::close(fd);
+}
+
+std::string SendUnixSocketRequest(const std::string& path, const std::string& request)
+{
+    sockaddr_un address = MakeAddress(path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        throw SocketError("Failed to create socket", path);
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) {
+        auto error = SocketError("Failed to connect to server", path);
+        ::close(fd);
+        throw error;
+    }
+
+    std::string response;
+    bool ok = WriteAll(fd, request) && ::shutdown(fd, SHUT_WR) == 0 && ReadAll(fd, response);
+    if (!ok) {
+        auto error = SocketError("Failed to exchange data with server", path);
+        ::close(fd);
+        throw error;
+    }
+    ::close(fd);
+    return response;
+}
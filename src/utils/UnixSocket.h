@@ -0,0 +1,60 @@
+#ifndef UNIX_SOCKET_H
+#define UNIX_SOCKET_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// \class UnixSocketServer
+// \brief Request-response server on a Unix domain socket. A client writes one request, shuts down its side for
+//        writing and reads the response until the server closes the connection. Connections are handled by a fixed
+//        number of worker threads, so the handler must synchronize access to shared state itself. While every worker
+//        is busy, new connections wait in the listen backlog.
+class UnixSocketServer {
+public:
+    using Handler = std::function<std::string(const std::string& request)>;
+
+    // \brief Binds the socket and starts listening. A stale socket file left by a previous server is replaced.
+    // \param path          Path of the socket file.
+    // \param handler       Builds the response to a request; exceptions are answered with "ERROR <message>".
+    // \param workersCount  Number of requests handled at the same time (0 uses all hardware threads).
+    // \throws std::runtime_error if the socket cannot be created or bound.
+    UnixSocketServer(const std::string& path, Handler handler, size_t workersCount = 0);
+
+    // \brief Stops the server and removes the socket file.
+    ~UnixSocketServer();
+
+    UnixSocketServer(const UnixSocketServer&) = delete;
+    UnixSocketServer& operator=(const UnixSocketServer&) = delete;
+
+    // \brief Accepts connections until Stop is called, then answers the accepted ones and joins the workers.
+    void Run();
+
+    // \brief Makes Run return. Safe to call from any thread, including from the handler.
+    void Stop();
+
+private:
+    std::string path;
+    Handler handler;
+    int listenFd = -1;
+    std::atomic<bool> stopped{false};
+
+    size_t workersCount = 0;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCv;
+    std::deque<int> pendingConnections; ///< Accepted connections that no worker has taken yet.
+    bool accepting = false;             ///< Run still accepts connections, so idle workers keep waiting.
+
+    void ServeConnections();
+    void HandleConnection(int fd);
+};
+
+// \brief Sends a request to a UnixSocketServer and waits for the response.
+// \throws std::runtime_error if the server cannot be reached.
+std::string SendUnixSocketRequest(const std::string& path, const std::string& request);
+
+#endif // UNIX_SOCKET_H
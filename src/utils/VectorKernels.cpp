@@ -0,0 +1,168 @@
+#include <VectorKernels.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VECTOR_KERNELS_X86
+#endif
+
+namespace {
+    float DotProductScalar(const float* a, const float* b, size_t size)
+    {
+        float dot = 0.0f;
+        for (size_t i = 0; i < size; ++i) {
+            dot += a[i] * b[i];
+        }
+        return dot;
+    }
+
+    // Adds the coordinates from begin to the end of the vectors; also finishes the vectorized kernels.
+    void AddMetricsScalar(const float* a, const float* b, size_t begin, size_t size, VectorMetrics& metrics)
+    {
+        for (size_t i = begin; i < size; ++i) {
+            const float diff = a[i] - b[i];
+            metrics.dot += a[i] * b[i];
+            metrics.squaredDistance += diff * diff;
+            metrics.manhattanDistance += std::abs(diff);
+            metrics.minSum += std::min(a[i], b[i]);
+            metrics.maxSum += std::max(a[i], b[i]);
+        }
+    }
+
+    VectorMetrics MetricsScalar(const float* a, const float* b, size_t size)
+    {
+        VectorMetrics metrics;
+        AddMetricsScalar(a, b, 0, size, metrics);
+        return metrics;
+    }
+
+#ifdef VECTOR_KERNELS_X86
+// The AVX-512 intrinsics of GCC 12 initialize undefined vectors with themselves, which -Wuninitialized reports
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    __attribute__((target("avx2,fma"))) float HorizontalSumAvx2(__m256 v)
+    {
+        const __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        const __m128 sum2 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+        const __m128 sum1 = _mm_add_ss(sum2, _mm_shuffle_ps(sum2, sum2, 1));
+        return _mm_cvtss_f32(sum1);
+    }
+
+    __attribute__((target("avx2,fma"))) float DotProductAvx2(const float* a, const float* b, size_t size)
+    {
+        // Two accumulators hide the latency of the fused multiply-add
+        __m256 dot0 = _mm256_setzero_ps();
+        __m256 dot1 = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            dot0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), dot0);
+            dot1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), dot1);
+        }
+        for (; i + 8 <= size; i += 8) {
+            dot0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), dot0);
+        }
+        return HorizontalSumAvx2(_mm256_add_ps(dot0, dot1)) + DotProductScalar(a + i, b + i, size - i);
+    }
+
+    __attribute__((target("avx2,fma"))) VectorMetrics MetricsAvx2(const float* a, const float* b, size_t size)
+    {
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        __m256 dot = _mm256_setzero_ps();
+        __m256 squared = _mm256_setzero_ps();
+        __m256 manhattan = _mm256_setzero_ps();
+        __m256 minSum = _mm256_setzero_ps();
+        __m256 maxSum = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            const __m256 va = _mm256_loadu_ps(a + i);
+            const __m256 vb = _mm256_loadu_ps(b + i);
+            const __m256 diff = _mm256_sub_ps(va, vb);
+            dot = _mm256_fmadd_ps(va, vb, dot);
+            squared = _mm256_fmadd_ps(diff, diff, squared);
+            manhattan = _mm256_add_ps(manhattan, _mm256_andnot_ps(signMask, diff));
+            minSum = _mm256_add_ps(minSum, _mm256_min_ps(va, vb));
+            maxSum = _mm256_add_ps(maxSum, _mm256_max_ps(va, vb));
+        }
+        VectorMetrics metrics{HorizontalSumAvx2(dot), HorizontalSumAvx2(squared), HorizontalSumAvx2(manhattan),
+                              HorizontalSumAvx2(minSum), HorizontalSumAvx2(maxSum)};
+        AddMetricsScalar(a, b, i, size, metrics);
+        return metrics;
+    }
+
+    // The tail is loaded with a mask, so no scalar loop is needed: zero coordinates add nothing to any sum
+    __attribute__((target("avx512f"))) __mmask16 TailMask(size_t count)
+    {
+        return static_cast<__mmask16>((1u << count) - 1);
+    }
+
+    __attribute__((target("avx512f"))) float DotProductAvx512(const float* a, const float* b, size_t size)
+    {
+        __m512 dot0 = _mm512_setzero_ps();
+        __m512 dot1 = _mm512_setzero_ps();
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            dot0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), dot0);
+            dot1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), dot1);
+        }
+        for (; i + 16 <= size; i += 16) {
+            dot0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), dot0);
+        }
+        if (i < size) {
+            const __mmask16 mask = TailMask(size - i);
+            dot1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), dot1);
+        }
+        return _mm512_reduce_add_ps(_mm512_add_ps(dot0, dot1));
+    }
+
+    __attribute__((target("avx512f"))) VectorMetrics MetricsAvx512(const float* a, const float* b, size_t size)
+    {
+        __m512 dot = _mm512_setzero_ps();
+        __m512 squared = _mm512_setzero_ps();
+        __m512 manhattan = _mm512_setzero_ps();
+        __m512 minSum = _mm512_setzero_ps();
+        __m512 maxSum = _mm512_setzero_ps();
+        for (size_t i = 0; i < size; i += 16) {
+            const __mmask16 mask = i + 16 <= size ? static_cast<__mmask16>(0xFFFF) : TailMask(size - i);
+            const __m512 va = _mm512_maskz_loadu_ps(mask, a + i);
+            const __m512 vb = _mm512_maskz_loadu_ps(mask, b + i);
+            const __m512 diff = _mm512_sub_ps(va, vb);
+            dot = _mm512_fmadd_ps(va, vb, dot);
+            squared = _mm512_fmadd_ps(diff, diff, squared);
+            manhattan = _mm512_add_ps(manhattan, _mm512_abs_ps(diff));
+            minSum = _mm512_add_ps(minSum, _mm512_min_ps(va, vb));
+            maxSum = _mm512_add_ps(maxSum, _mm512_max_ps(va, vb));
+        }
+        return {_mm512_reduce_add_ps(dot), _mm512_reduce_add_ps(squared), _mm512_reduce_add_ps(manhattan),
+                _mm512_reduce_add_ps(minSum), _mm512_reduce_add_ps(maxSum)};
+    }
+#pragma GCC diagnostic pop
+#endif
+}
+
+const std::vector<VectorKernels>& GetSupportedVectorKernels()
+{
+    static const std::vector<VectorKernels> kernels = [] {
+        std::vector<VectorKernels> supported;
+#ifdef VECTOR_KERNELS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            supported.push_back({"avx512", DotProductAvx512, MetricsAvx512});
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            supported.push_back({"avx2", DotProductAvx2, MetricsAvx2});
+        }
+#endif
+        supported.push_back({"scalar", DotProductScalar, MetricsScalar});
+        return supported;
+    }();
+    return kernels;
+}
+
+const VectorKernels& GetVectorKernels()
+{
+    static const VectorKernels& kernels = GetSupportedVectorKernels().front();
+    return kernels;
+}
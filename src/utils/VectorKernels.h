@@ -0,0 +1,33 @@
+#ifndef VECTOR_KERNELS_H
+#define VECTOR_KERNELS_H
+
+#include <cstddef>
+#include <vector>
+
+// \struct VectorMetrics
+// \brief Sums over the coordinates of two vectors from which all embedding similarities are derived.
+struct VectorMetrics {
+    float dot = 0.0f;               ///< Sum of a[i] * b[i].
+    float squaredDistance = 0.0f;   ///< Sum of (a[i] - b[i])^2.
+    float manhattanDistance = 0.0f; ///< Sum of |a[i] - b[i]|.
+    float minSum = 0.0f;            ///< Sum of min(a[i], b[i]).
+    float maxSum = 0.0f;            ///< Sum of max(a[i], b[i]).
+};
+
+// \struct VectorKernels
+// \brief One implementation of the similarity kernels for an instruction set.
+struct VectorKernels {
+    const char* name;
+    float (*dotProduct)(const float* a, const float* b, size_t size);
+    // Computes all sums of VectorMetrics in one pass over the vectors.
+    VectorMetrics (*metrics)(const float* a, const float* b, size_t size);
+};
+
+// \brief Kernels that the CPU supports, the fastest first; the last one is the scalar fallback. The instruction sets
+//        are checked at run time, so the binary also runs on CPUs without AVX2 or AVX-512.
+const std::vector<VectorKernels>& GetSupportedVectorKernels();
+
+// \brief The fastest supported kernels.
+const VectorKernels& GetVectorKernels();
+
+#endif // VECTOR_KERNELS_H